@@ -24,9 +24,8 @@ AppManager::~AppManager() {
   app_.reset();
   // destroy resources in global context
   destroyDefaultAppContext();
-  // destroy render targets(ImageView) before swapchain and depth images
+  // destroy render targets(ImageView) before swapchain
   render_targets_.clear();
-  depth_images_.clear();
   swapchain_.reset();
   driver_.reset();
   window_.reset();
@@ -99,8 +98,9 @@ void AppManager::resize(uint32_t width, uint32_t height)
 {
   if(width_ == width && height_ == height)
     return;
-  
-  vkDeviceWaitIdle(driver_->getDevice());
+
+  // no device stall, the replaced swapchain and render targets are destroyed
+  // through the deletion queue once the frames using them completed
   width_ = width;
   height_ = height;
   initSwapchain();
@@ -124,22 +124,15 @@ void AppManager::initSwapchain() {
 
 void AppManager::initRenderTargets()
 {
-  // depth stencil images  
+  // only the swapchain images, the depth buffer is a transient attachment of the render
+  // graph shared by the frames, ds_format_ tells its format
   const auto img_cnt = swapchain_->getImageCount();  
   VkExtent3D extent{width_, height_, 1};
   render_targets_.resize(img_cnt);
-  depth_images_.resize(img_cnt);
   
   for (uint32_t i = 0; i < img_cnt; ++i) {
-    depth_images_[i] = std::make_shared<Image>(
-        driver_, 0,
-        ds_format_, extent, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
-    auto depth_img_view = std::make_shared<ImageView>(
-        depth_images_[i], VK_IMAGE_VIEW_TYPE_2D, ds_format_,
-        VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 0, 0, 1, 1);        
     render_targets_[i] = std::make_shared<RenderTarget>(
-      std::initializer_list<std::shared_ptr<ImageView>>{swapchain_->getImageView(i), depth_img_view},
+      std::initializer_list<std::shared_ptr<ImageView>>{swapchain_->getImageView(i)},
       std::initializer_list<VkFormat>{swapchain_->getImageFormat()},
       ds_format_, extent.width,
       extent.height, 1u);
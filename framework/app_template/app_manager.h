@@ -41,7 +41,6 @@ private:
 
   VkFormat color_format_;
   VkFormat ds_format_;  
-  std::vector<std::shared_ptr<Image>> depth_images_;
 
   std::shared_ptr<AppBase> app_;
   std::unique_ptr<Window> window_;
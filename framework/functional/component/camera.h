@@ -56,18 +56,26 @@ public:
     dirty_proj_ = true;
   }
 
+  float getNear() const noexcept { return -near_; }
+
+  float getFar() const noexcept { return -far_; }
+
   void setFovy(float fovy) // width / focalLength
   {
     fovy_ = fovy;
     dirty_proj_ = true;
   }
 
+  float getFovy() const noexcept { return fovy_; }
+
   void setAspect(float aspect) // width / height
   {
     aspect_ = aspect;
     dirty_proj_ = true;
   }
 
+  float getAspect() const noexcept { return aspect_; }
+
   void setExposure(const float aperture, const float shutter_speed, const float sensitivity)
   {
     aperture_ = aperture;
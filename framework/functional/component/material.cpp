@@ -1,5 +1,6 @@
 #include "material.h"
 #include <framework/functional/global/app_context.h>
+#include <framework/resources/asset_manager.hpp>
 #include <framework/utils/vk/buffer.h>
 #include <framework/utils/vk/pipeline.h>
 #include <framework/utils/vk/resource_cache.h>
@@ -41,9 +42,12 @@ MatGpuResourcePool::MatGpuResourcePool(VkFormat color_format,
 }
 
 void MatGpuResourcePool::gc() {
+  auto timeline = getDefaultAppContext().driver->getTimeline();
   for (auto itr = used_mat_params_set_.begin();
        itr != used_mat_params_set_.end();) {
     if (itr->use_count() == 1) {
+      // frames in flight may still use the ubo and descriptor set
+      (*itr)->released = timeline->pending();
       free_mat_params_set_.push_back(*itr);
       itr = used_mat_params_set_.erase(itr);
     } else
@@ -52,8 +56,9 @@ void MatGpuResourcePool::gc() {
 }
 
 std::shared_ptr<GraphicsPipeline> MatGpuResourcePool::requestGraphicsPipeline(
-    const std::shared_ptr<Material> &mat) {
-  auto itr = mat_pipelines_.find(mat->materialTypeId());
+    const std::shared_ptr<Material> &mat, VertexLayout layout) {
+  const auto key = std::make_pair(mat->materialTypeId(), layout);
+  auto itr = mat_pipelines_.find(key);
   if (itr != mat_pipelines_.end()) {
     return itr->second;
   }
@@ -62,47 +67,125 @@ std::shared_ptr<GraphicsPipeline> MatGpuResourcePool::requestGraphicsPipeline(
   auto &driver = getDefaultAppContext().driver;
   auto &rs_cache = getDefaultAppContext().resource_cache;
   auto pipeline_state = std::make_unique<GPipelineState>();
-  mat->setPipelineState(*pipeline_state);
+  mat->setPipelineState(*pipeline_state, layout);
   // set other pipeline state:
 
   auto pipeline = std::make_shared<GraphicsPipeline>(
       driver, rs_cache, default_render_pass_, std::move(pipeline_state));
-  mat_pipelines_.emplace(mat->materialTypeId(), pipeline);
+  mat_pipelines_.emplace(key, pipeline);
   return pipeline;
 }
 
 std::shared_ptr<DescriptorSet> MatGpuResourcePool::requestMatDescriptorSet(
     const std::shared_ptr<Material> &mat) {
-  if (mat->mat_param_set_ != nullptr)
+  if (mat->mat_param_set_ != nullptr) {
+    mat->mat_param_set_->bound = true;
     return mat->mat_param_set_->desc_set;
+  }
 
-  // find a free mat param set
+  // find a free mat param set, no longer used by the device
+  auto &driver = getDefaultAppContext().driver;
+  auto timeline = driver->getTimeline();
   auto mat_id = mat->materialTypeId();
   auto itr =
       std::find_if(free_mat_params_set_.begin(), free_mat_params_set_.end(),
-                   [mat_id](const std::shared_ptr<MatParamsSet> &ps) {
-                     return ps->mat_type_id == mat_id;
+                   [mat_id, &timeline](const std::shared_ptr<MatParamsSet> &ps) {
+                     return ps->mat_type_id == mat_id &&
+                            timeline->isCompleted(ps->released);
                    });
 
   if (itr != free_mat_params_set_.end()) {
     mat->mat_param_set_ = *itr;
+    // the set holds the textures of its previous material
+    mat->mat_param_set_->bound = false;
+    for (auto &tp : mat->texture_params_)
+      tp.dirty |= tp.img_view != nullptr;
     used_mat_params_set_.push_back(*itr);
     free_mat_params_set_.erase(itr);
     mat->updateParams(); // update mat paramsto gpu
+    mat->mat_param_set_->bound = true;
     return mat->mat_param_set_->desc_set;
   }
 
   // create new one
-  auto &driver = getDefaultAppContext().driver;
-  auto &rs_cache = getDefaultAppContext().resource_cache;
   auto mat_param_set = mat->createMatParamsSet(driver, *desc_pool_);
+  mat_param_set->desc_pool = desc_pool_.get();
   mat->mat_param_set_ = mat_param_set;
   used_mat_params_set_.push_back(mat_param_set);
   mat->updateParams(); // update mat paramsto gpu
+  mat_param_set->bound = true;
   return mat_param_set->desc_set;
 }
 
+VertexInputState Material::vertexInputState(VertexLayout layout) {
+  switch (layout) {
+  case VertexLayout::QUANTIZED16:
+    return VertexInputState{
+        {{0, 16, VK_VERTEX_INPUT_RATE_VERTEX}},
+        {{0, 0, VK_FORMAT_R16G16B16A16_UNORM, 0}, // pos
+         {1, 0, VK_FORMAT_R16G16_SNORM, 8},       // octahedral normal
+         {2, 0, VK_FORMAT_R16G16_SFLOAT, 12}}};   // uv
+  case VertexLayout::QUANTIZED8:
+    return VertexInputState{
+        {{0, 12, VK_VERTEX_INPUT_RATE_VERTEX}},
+        {{0, 0, VK_FORMAT_R16G16B16A16_UNORM, 0}, // pos, w: octahedral normal
+         {2, 0, VK_FORMAT_R16G16_SFLOAT, 8}}};    // uv
+  default:
+    return VertexInputState{
+        {// bindings, 3 float pos + 3 float normal + 2 float uv
+         {0, 8 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX}},
+        {                                                       // attribute
+         {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},                 // 3floats pos
+         {1, 0, VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float)}, // 3floats normal
+         {2, 0, VK_FORMAT_R32G32_SFLOAT, 6 * sizeof(float)}}};  // 2 floats uv
+  }
+}
+
+void Material::loadVertexShader(const ShaderVariant &variant,
+                                const std::string &path) {
+  vs_variant_ = variant;
+  vs_path_ = path;
+  vs_ = std::make_shared<ShaderModule>(variant);
+  vs_->load(path);
+  for (auto &vs : layout_vs_)
+    vs = nullptr;
+  layout_vs_[static_cast<uint32_t>(VertexLayout::FLOAT32)] = vs_;
+}
+
+std::shared_ptr<ShaderModule> Material::vertexShader(VertexLayout layout) {
+  auto &vs = layout_vs_[static_cast<uint32_t>(layout)];
+  if (vs != nullptr)
+    return vs;
+  ShaderVariant variant = vs_variant_;
+  variant.addDefine(layout == VertexLayout::QUANTIZED16 ? "VERTEX_QUANTIZED16"
+                                                        : "VERTEX_QUANTIZED8");
+  vs = std::make_shared<ShaderModule>(variant);
+  vs->load(vs_path_);
+  return vs;
+}
+
 void Material::updateParams() {
+  // textures downgraded by the asset manager under memory pressure
+  auto &asset_manager = getDefaultAppContext().gpu_asset_manager;
+  if (asset_version_ != asset_manager->version()) {
+    asset_version_ = asset_manager->version();
+    for (auto &tp : texture_params_) {
+      if (tp.img_view == nullptr)
+        continue;
+      auto img_view = asset_manager->latest(tp.img_view);
+      if (img_view != tp.img_view) {
+        tp.img_view = img_view;
+        tp.dirty = true;
+      }
+    }
+  }
+
+  // textures moved by the defragmenter have new views
+  for (auto &tp : texture_params_) {
+    if (tp.img_view != nullptr && tp.img_view->refresh())
+      tp.dirty = true;
+  }
+
   // update uniform buffer params
   if (mat_param_set_ == nullptr)
     return;
@@ -114,21 +197,51 @@ void Material::updateParams() {
 
   // update textures... descriptor set
   assert(mat_param_set_->desc_set != nullptr);
+  if (std::none_of(texture_params_.begin(), texture_params_.end(),
+                   [](const MaterialTextureParam &tp) { return tp.dirty; }))
+    return;
 
+  auto driver = getDefaultAppContext().driver;
   std::vector<VkDescriptorImageInfo> desc_img_infos;
   desc_img_infos.reserve(texture_params_.size());
 
   std::vector<VkWriteDescriptorSet> wds;
-  wds.reserve(texture_params_.size());
+  wds.reserve(texture_params_.size() + 1);
+
+  // command buffers pending on the device may use the bound set, updating it is invalid
+  // without UPDATE_AFTER_BIND. write all the bindings to a new set instead, the old one is
+  // freed through the deletion queue after its last use, and so are the replaced views
+  VkDescriptorBufferInfo desc_buffer_info{
+      .buffer = ubo->getHandle(),
+      .offset = 0,
+      .range = ubo_info_.size,
+  };
+  if (mat_param_set_->bound) {
+    assert(mat_param_set_->desc_pool != nullptr);
+    mat_param_set_->desc_set =
+        mat_param_set_->desc_pool->requestDescriptorSet(*desc_set_layout_);
+    mat_param_set_->bound = false;
+    wds.emplace_back(VkWriteDescriptorSet{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = mat_param_set_->desc_set->getHandle(),
+        .dstBinding = ubo_info_.binding,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .pBufferInfo = &desc_buffer_info});
+    for (auto &tp : texture_params_)
+      tp.dirty |= tp.img_view != nullptr;
+  }
+
   for (auto &tp : texture_params_) {
     if(!tp.dirty) continue;
     tp.dirty = false;
     // update descriptor set
-    auto driver = getDefaultAppContext().driver;
     // save sampler to texture params. to make sure sampler not deconstruct when use
+    // lod range matches the mip chain of the texture
     tp.sampler = getDefaultAppContext().resource_cache->requestSampler(driver, 
       VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR,
-      VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+      VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT,
+      static_cast<float>(tp.img_view->getMipLevels() - 1));
     
     desc_img_infos.emplace_back(VkDescriptorImageInfo{
         .sampler = tp.sampler->getHandle(),
@@ -143,7 +256,7 @@ void Material::updateParams() {
       .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
       .pImageInfo = &desc_img_infos.back()});
   }
-  if(!wds.empty()) getDefaultAppContext().driver->update(wds);  
+  if(!wds.empty()) driver->update(wds);
 }
 
 // void Material::writeDescriptorSets(
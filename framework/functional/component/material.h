@@ -13,6 +13,7 @@
 #include <framework/utils/vk/shader_module.h>
 #include <framework/utils/vk/vk_constants.h>
 #include <framework/utils/vk/vk_driver.h>
+#include <framework/functional/component/mesh.h>
 
 
 namespace vk_engine {
@@ -78,6 +79,9 @@ struct MatParamsSet {
   uint32_t mat_type_id{0};
   std::unique_ptr<Buffer> ubo;
   std::shared_ptr<DescriptorSet> desc_set;
+  DescriptorPool *desc_pool{nullptr}; //!< the pool desc_set is allocated from
+  bool bound{false}; //!< desc_set was handed out for recording, it must not be updated anymore
+  uint64_t released{0}; //!< timeline value of the last use, before it can be reused by another material
 };
 
 class Material;
@@ -86,7 +90,8 @@ class Material;
  * \brief MatGpuResourcePool is a gpu resource pool for material.
  * It manages GraphicsPipeline, MatParamsSet(uniform buffer + DescriptorSet)
  * 
- * the gc function should be called onece per frame
+ * the gc function should be called onece per frame, sets released by the materials are
+ * reused once the device timeline passes their last use
 */
 class MatGpuResourcePool {
 public:
@@ -94,15 +99,18 @@ public:
   
   void gc();
 
+  /**
+   * \brief pipeline of the material type and the mesh vertex layout
+   */
   std::shared_ptr<GraphicsPipeline>
-  requestGraphicsPipeline(const std::shared_ptr<Material> &mat);
+  requestGraphicsPipeline(const std::shared_ptr<Material> &mat, VertexLayout layout);
   
   std::shared_ptr<DescriptorSet>
   requestMatDescriptorSet(const std::shared_ptr<Material> &mat);
 
 private:
   std::shared_ptr<RenderPass> default_render_pass_;
-  std::map<uint32_t, std::shared_ptr<GraphicsPipeline>> mat_pipelines_;
+  std::map<std::pair<uint32_t, VertexLayout>, std::shared_ptr<GraphicsPipeline>> mat_pipelines_;
   std::unique_ptr<DescriptorPool> desc_pool_;
   std::list<std::shared_ptr<MatParamsSet>> used_mat_params_set_;
   std::list<std::shared_ptr<MatParamsSet>> free_mat_params_set_;
@@ -157,13 +165,17 @@ public:
     return texture_params_;
   }
 
+  /**
+   * \brief upload the dirty params. changed textures of a set already recorded are written
+   * to a new descriptor set, the old one is freed through the deletion queue
+   */
   void updateParams();
 
   /**
-   * \brief update the information(vs,fs, multisample, subpass index) to
-   * pipeline state
+   * \brief update the information(vs,fs, vertex input, multisample, subpass index) to
+   * pipeline state, for meshes of the vertex layout
    */
-  virtual void setPipelineState(GPipelineState &pipeline_state) = 0;
+  virtual void setPipelineState(GPipelineState &pipeline_state, VertexLayout layout) = 0;
 
   virtual void compile() = 0;
 
@@ -174,10 +186,29 @@ protected:
   virtual std::shared_ptr<MatParamsSet> createMatParamsSet(
       const std::shared_ptr<VkDriver> &driver,
       DescriptorPool &desc_pool) = 0;
+
+  /**
+   * \brief vertex input of the layout, interleaved in binding 0.
+   * locations: 0 position, 1 normal, 2 uv
+   */
+  static VertexInputState vertexInputState(VertexLayout layout);
+
+  /**
+   * \brief vertex shader of the layout, quantized variants are compiled on first use from vs_variant_ and vs_path_
+   */
+  std::shared_ptr<ShaderModule> vertexShader(VertexLayout layout);
+
+  /**
+   * \brief load vs_ as the FLOAT32 vertex shader, and reset the quantized variants
+   */
+  void loadVertexShader(const ShaderVariant &variant, const std::string &path);
   
   std::shared_ptr<ShaderModule> vs_;
   std::shared_ptr<ShaderModule> gs_;
   std::shared_ptr<ShaderModule> fs_;
+  ShaderVariant vs_variant_;
+  std::string vs_path_;
+  std::shared_ptr<ShaderModule> layout_vs_[static_cast<uint32_t>(VertexLayout::COUNT)];
 
   // std::shared_ptr<PipelineState> pipeline_state_;
   // std::vector<ShaderResource> shader_resources_;
@@ -189,6 +220,8 @@ protected:
   std::shared_ptr<MatParamsSet> mat_param_set_;
   std::unique_ptr<DescriptorSetLayout> desc_set_layout_;
     
+  uint64_t asset_version_{0}; //!< asset manager version the textures are resolved against
+
   uint32_t material_type_id_{0}; //!< using uint64_t to define a material type code, the higher 16 bit for Basic Material type, and the lower 16 bits for variant input.
 
   friend class MatGpuResourcePool;  
@@ -139,8 +139,7 @@ void NormalVisMaterial::compile() {
   desc_set_layout_ = std::make_unique<DescriptorSetLayout>(
       getDefaultAppContext().driver, MATERIAL_SET_INDEX, sr.data(), sr.size());
 
-  vs_ = std::make_shared<ShaderModule>(variant);
-  vs_->load("shaders/normal_visualize.vert");
+  loadVertexShader(variant, "shaders/normal_visualize.vert");
 
   gs_ = std::make_shared<ShaderModule>(variant);
   gs_->load("shaders/normal_visualize.geom");
@@ -181,15 +180,8 @@ NormalVisMaterial::createMatParamsSet(const std::shared_ptr<VkDriver> &driver,
 }
 
 
-void NormalVisMaterial::setPipelineState(GPipelineState &pipeline_state) {
-  VertexInputState vertex_input_state{
-      {// bindings, 3 float pos + 3 float normal + 2 float uv
-       {0, 8 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX}},
-      {                                                       // attribute
-       {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},                 // 3floats pos
-       {1, 0, VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float)}, // 3floats normal
-       {2, 0, VK_FORMAT_R32G32_SFLOAT, 6 * sizeof(float)}}};  // 2 floats uv
-  pipeline_state.setVertexInputState(vertex_input_state);
+void NormalVisMaterial::setPipelineState(GPipelineState &pipeline_state, VertexLayout layout) {
+  pipeline_state.setVertexInputState(vertexInputState(layout));
   pipeline_state.setInputAssemblyState(
       {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false});
   RasterizationState rasterize{.depth_clamp_enable = false,
@@ -200,7 +192,7 @@ void NormalVisMaterial::setPipelineState(GPipelineState &pipeline_state) {
                                .front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE,
                                .depth_bias_enable = false};
   pipeline_state.setRasterizationState(rasterize);
-  pipeline_state.setShaders({vs_, fs_});
+  pipeline_state.setShaders({vertexShader(layout), fs_});
   pipeline_state.setMultisampleState(
       {VK_SAMPLE_COUNT_1_BIT, false, 0.0f, 0xFFFFFFFF, false, false});
   // default depth stencil state, depth test enable, depth write enable, depth
@@ -15,7 +15,7 @@ public:
 
   ~NormalVisMaterial() override = default;
 
-  void setPipelineState(GPipelineState &pipeline_state) override;
+  void setPipelineState(GPipelineState &pipeline_state, VertexLayout layout) override;
 
   void compile() override;
 
@@ -16,7 +16,7 @@ public:
 
   ~PbrMaterial() override = default;
 
-  void setPipelineState(GPipelineState &pipeline_state) override;
+  void setPipelineState(GPipelineState &pipeline_state, VertexLayout layout) override;
 
   void compile() override;
 
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <vector>
 #include <Eigen/Geometry>
 #include <framework/utils/vk/buffer.h>
+#include <framework/utils/vk/geometry_arena.h>
+#include <framework/utils/base/mesh_optimizer.h>
 
 namespace vk_engine {
 
@@ -13,12 +16,41 @@ struct VertexBuffer {
     VkFormat data_type;
 };
 
+/**
+ * \brief a sub-mesh drawn from the index buffer, indices are relative to vertex_offset
+ */
+struct IndexRange {
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+};
+
 struct IndexBuffer {
     std::shared_ptr<Buffer> buffer;
     uint32_t offset;
     uint32_t index_count; // number of vertices
     VkIndexType data_type;
     VkPrimitiveTopology primitive_type;
+    //! more than one when a mesh over the 16-bit index limit is split
+    std::vector<IndexRange> ranges;
+};
+
+/**
+ * \brief interleaved vertex layouts of a static mesh, in one vertex buffer
+ */
+enum class VertexLayout : uint32_t {
+  FLOAT32 = 0, //!< 3 x f32 pos | 3 x f32 normal | 2 x f32 uv, 32 bytes
+  QUANTIZED16, //!< 4 x unorm16 pos | 2 x snorm16 octahedral normal | 2 x f16 uv, 16 bytes
+  QUANTIZED8,  //!< 3 x unorm16 pos + 2 x snorm8 octahedral normal in pos.w | 2 x f16 uv, 12 bytes
+  COUNT
+};
+
+/**
+ * \brief a coarser level of detail, in the same index buffer and vertices
+ */
+struct MeshLevel {
+    std::vector<IndexRange> ranges;
+    float error; //!< simplification error relative to the mesh extent
 };
 
 struct StaticMesh {
@@ -27,6 +59,19 @@ struct StaticMesh {
   VertexBuffer texture_coords;
   IndexBuffer faces;
   Eigen::AlignedBox3f aabb;
+  VertexLayout layout{VertexLayout::FLOAT32};
+  //! quantized position is dequantized by offset + scale * unorm, identity for FLOAT32
+  Eigen::Vector3f dequant_offset{Eigen::Vector3f::Zero()};
+  Eigen::Vector3f dequant_scale{Eigen::Vector3f::Ones()};
+  //! sub-allocated from the geometry arena, buffers above are the arena pages
+  std::shared_ptr<GeometryRange> vertex_range;
+  std::shared_ptr<GeometryRange> index_range;
+  int32_t base_vertex{0};   //!< first vertex in the arena vertex buffer
+  uint32_t first_index{0};  //!< first index in the arena index buffer
+  //! clusters of faces culled per frame, in faces order, empty for small meshes
+  std::vector<Meshlet> meshlets;
+  //! coarser levels after the full detail faces.ranges, empty if not simplified
+  std::vector<MeshLevel> lods;
 };
 
 } // namespace vk_engine
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <framework/utils/vk/queue.h>
 #include <framework/utils/vk/resource_cache.h>
 #include <framework/utils/vk/stage_pool.h>
+#include <framework/utils/vk/upload_scheduler.h>
+#include <framework/utils/vk/geometry_arena.h>
 #include <framework/utils/vk/sampler.h>
 #include <framework/utils/vk/image.h>
 #include <framework/utils/vk/syncs.h>
@@ -35,7 +37,12 @@ bool initAppContext(const std::shared_ptr<VkDriver> &driver,
     auto pcw = std::make_unique<VkPipelineCacheWraper>(driver->getDevice());
     g_app_context.resource_cache->setPipelineCache(std::move(pcw));
   }
-  g_app_context.stage_pool = std::make_shared<StagePool>(driver);
+  g_app_context.timeline = driver->getTimeline();
+  g_app_context.stage_pool =
+      std::make_shared<StagePool>(driver, g_app_context.timeline);
+  g_app_context.upload_scheduler = std::make_shared<UploadScheduler>(
+      driver, g_app_context.stage_pool, g_app_context.timeline);
+  g_app_context.geometry_arena = std::make_shared<GeometryArena>(driver);
 
   // gpu asset manager
   g_app_context.gpu_asset_manager = std::make_shared<GPUAssetManager>();
@@ -63,7 +70,6 @@ bool initAppContext(const std::shared_ptr<VkDriver> &driver,
                                       CommandPool::CmbResetMode::ResetPool);
     frames_data[i].render_tgt = rts[i];
     auto &sync = g_app_context.render_output_syncs[i];
-    sync.render_fence = std::make_shared<Fence>(driver, true);
     sync.render_semaphore = std::make_shared<Semaphore>(driver);
     sync.present_semaphore = std::make_shared<Semaphore>(driver);
   }
@@ -12,6 +12,8 @@ namespace vk_engine
 {
     class VkDriver;
     class StagePool;
+    class UploadScheduler;
+    class GeometryArena;
     class ResourceCache;
     class GPUAssetManager;
     class CommandPool;
@@ -26,6 +28,7 @@ namespace vk_engine
     {
         std::shared_ptr<CommandPool> command_pool;
         std::shared_ptr<RenderTarget> render_tgt;
+        uint64_t timeline_value{0}; //!< device timeline value signaled by the last submit of the frame
     };
 
 
@@ -69,8 +72,11 @@ namespace vk_engine
     struct AppContext
     {
         std::shared_ptr<VkDriver> driver;
+        std::shared_ptr<DeviceTimeline> timeline; //!< gpu completion of the graphics submits
         std::shared_ptr<DescriptorPool> descriptor_pool;
         std::shared_ptr<StagePool> stage_pool;
+        std::shared_ptr<UploadScheduler> upload_scheduler; //!< async uploading on transfer queue
+        std::shared_ptr<GeometryArena> geometry_arena; //!< vertices and indices of static meshes
         std::shared_ptr<GPUAssetManager> gpu_asset_manager;
         std::shared_ptr<ResourceCache> resource_cache;
         std::vector<FrameData> frames_data;
@@ -79,12 +85,15 @@ namespace vk_engine
 
         void destroy() {
             resource_cache.reset();
+            upload_scheduler.reset();
+            geometry_arena.reset();
             stage_pool.reset();
             gpu_asset_manager.reset();
             global_param_set.reset();
             descriptor_pool.reset();            
             frames_data.clear();
             render_output_syncs.clear();
+            timeline.reset();
         }
     };
 
@@ -0,0 +1,33 @@
+#include <framework/functional/render/lod_selection.h>
+
+namespace vk_engine {
+
+uint32_t selectLod(const StaticMesh &mesh, const Eigen::Matrix4f &model,
+                   const Eigen::Vector3f &camera_pos, float pixel_scale,
+                   float max_pixel_error, uint32_t prev) {
+  const uint32_t level_count = static_cast<uint32_t>(mesh.lods.size());
+  if (level_count == 0)
+    return 0;
+  const Eigen::Affine3f tr(model);
+  const float scale = tr.linear().colwise().norm().maxCoeff();
+  const Eigen::Vector3f center = tr * mesh.aabb.center();
+  const float radius = 0.5f * mesh.aabb.diagonal().norm() * scale;
+  const float dist = (center - camera_pos).norm() - radius;
+  if (dist <= 0.0f)
+    return 0;
+
+  // lod errors are relative to the largest side of the mesh
+  const float pixels = mesh.aabb.sizes().maxCoeff() * scale * pixel_scale / dist;
+  auto error = [&](uint32_t level) {
+    return level == 0 ? 0.0f : mesh.lods[level - 1].error * pixels;
+  };
+  uint32_t level = std::min(prev, level_count);
+  while (level > 0 && error(level) > max_pixel_error)
+    --level;
+  while (level < level_count &&
+         error(level + 1) <= max_pixel_error * (1.0f - LOD_HYSTERESIS))
+    ++level;
+  return level;
+}
+
+} // namespace vk_engine
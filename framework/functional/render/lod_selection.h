@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <framework/functional/component/mesh.h>
+
+namespace vk_engine {
+
+//! a coarser level is only taken when its error is this much under the bound
+constexpr float LOD_HYSTERESIS = 0.25f;
+
+/**
+ * \brief pick the coarsest level of the mesh whose error projected on screen is
+ * within max_pixel_error, at the distance of the mesh aabb. pixel_scale is
+ * proj(1, 1) * viewport height / 2. 0 is the full detail, i the lods[i - 1].
+ * prev is the level of the last frame, for the hysteresis against popping
+ */
+uint32_t selectLod(const StaticMesh &mesh, const Eigen::Matrix4f &model,
+                   const Eigen::Vector3f &camera_pos, float pixel_scale,
+                   float max_pixel_error, uint32_t prev);
+
+} // namespace vk_engine
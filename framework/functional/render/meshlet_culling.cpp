@@ -0,0 +1,45 @@
+#include <framework/functional/render/meshlet_culling.h>
+
+namespace vk_engine {
+
+Frustum::Frustum(const Eigen::Matrix4f &view_proj) {
+  // Gribb-Hartmann, clip space -w <= x, y <= w
+  const Eigen::Vector4f r0 = view_proj.row(0);
+  const Eigen::Vector4f r1 = view_proj.row(1);
+  const Eigen::Vector4f r3 = view_proj.row(3);
+  planes[0] = r3 + r0;
+  planes[1] = r3 - r0;
+  planes[2] = r3 + r1;
+  planes[3] = r3 - r1;
+  for (auto &p : planes)
+    p /= p.head<3>().norm();
+}
+
+bool cullMeshlets(const StaticMesh &mesh, const Eigen::Matrix4f &model,
+                  const Frustum &frustum, const Eigen::Vector3f &camera_pos,
+                  std::vector<IndexRange> &ranges) {
+  if (mesh.meshlets.empty())
+    return false;
+  ranges.clear();
+
+  const Eigen::Affine3f tr(model);
+  const float scale = tr.linear().colwise().norm().maxCoeff();
+  // facing is affine invariant, the cone is tested in model space
+  const Eigen::Vector3f eye = tr.inverse() * camera_pos;
+  for (const auto &m : mesh.meshlets) {
+    if (meshletBackFacing(m.center, m.radius, m.cone_axis, m.cone_cutoff,
+                          eye.data()))
+      continue;
+    if (!frustum.intersects(tr * Eigen::Vector3f::Map(m.center),
+                            m.radius * scale))
+      continue;
+    if (!ranges.empty() && ranges.back().vertex_offset == m.vertex_offset &&
+        ranges.back().first_index + ranges.back().index_count == m.first_index)
+      ranges.back().index_count += m.index_count;
+    else
+      ranges.push_back({m.first_index, m.index_count, m.vertex_offset});
+  }
+  return true;
+}
+
+} // namespace vk_engine
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Dense>
+#include <framework/functional/component/mesh.h>
+
+namespace vk_engine {
+
+/**
+ * \brief side planes of the view frustum in world space, normals point inward.
+ * near/far are left to the depth test
+ */
+struct Frustum {
+  explicit Frustum(const Eigen::Matrix4f &view_proj);
+
+  bool intersects(const Eigen::Vector3f &center, float radius) const {
+    for (const auto &p : planes)
+      if (p.head<3>().dot(center) + p[3] < -radius)
+        return false;
+    return true;
+  }
+
+  Eigen::Vector4f planes[4];
+};
+
+/**
+ * \brief cull the meshlets of a mesh against the frustum and by their normal
+ * cone, the visible ones are compacted into ranges, adjacent meshlets merged.
+ * return false if the mesh has no meshlets, ranges untouched then
+ */
+bool cullMeshlets(const StaticMesh &mesh, const Eigen::Matrix4f &model,
+                  const Frustum &frustum, const Eigen::Vector3f &camera_pos,
+                  std::vector<IndexRange> &ranges);
+
+} // namespace vk_engine
@@ -38,7 +38,7 @@ namespace vk_engine
             auto ret = free_mesh_params_set_.front();
             free_mesh_params_set_.pop_front();
             used_mesh_params_set_.emplace_back(ret);
-            ret->last_access = cur_frame_;
+            ret->last_use = getDefaultAppContext().timeline->pending();
             return ret;
         }
         // create new one
@@ -64,20 +64,17 @@ namespace vk_engine
           .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
           .pBufferInfo = &desc_buffer_info}});
         used_mesh_params_set_.emplace_front(ret);
-        ret->last_access = cur_frame_;
+        ret->last_use = getDefaultAppContext().timeline->pending();
         return ret;
     }
 
     void MeshParamsPool::gc()
     {
-        // If this is one of the first few frames, return early to avoid wrapping unsigned integers.
-        if (++cur_frame_ <= TIME_BEFORE_EVICTION) {
-            return;
-        }
-        const uint32_t eviction_time = cur_frame_ - TIME_BEFORE_EVICTION;
+        // reuse the sets the device is done with
+        const uint64_t completed = getDefaultAppContext().timeline->completed();
         for(auto itr=used_mesh_params_set_.begin(); itr!=used_mesh_params_set_.end();)
         {
-            if((*itr)->last_access < eviction_time)
+            if((*itr)->last_use <= completed)
             {
                 free_mesh_params_set_.emplace_front(*itr);
                 itr = used_mesh_params_set_.erase(itr);                
@@ -125,18 +122,28 @@ namespace vk_engine
 
     void RPass::draw(const std::shared_ptr<Material> &mat, const Eigen::Matrix4f &rt,
         const std::shared_ptr<StaticMesh> &mesh, const std::shared_ptr<CommandBuffer> &cmd_buf,
-        const uint32_t width, const uint32_t height)
+        const uint32_t width, const uint32_t height, const std::vector<IndexRange> *ranges)
     {
+        if (ranges == nullptr)
+            ranges = &mesh->faces.ranges;
+        if (ranges->empty())
+            return;
+
         // global param set
         auto global_param_set = getDefaultAppContext().global_param_set->getDescSet();
         
         // bind ubo set3
         auto mesh_params_set = mesh_params_pool_.requestMeshParamsSet();
-        mesh_params_set->ubo->update(rt.data(), sizeof(rt));
+        // model | dequant offset | dequant scale, written in place to the mapped ubo
+        auto mesh_ubo = static_cast<float *>(
+            mesh_params_set->ubo->mapRange(0, sizeof(float) * 24));
+        memcpy(mesh_ubo, rt.data(), sizeof(float) * 16);
+        Eigen::Vector4f::Map(mesh_ubo + 16) << mesh->dequant_offset, 0.0f;
+        Eigen::Vector4f::Map(mesh_ubo + 20) << mesh->dequant_scale, 0.0f;
+        mesh_params_set->ubo->flushDirty();
 
-        // todo: fixme pipeline's vertex input state
-        // using VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE
-        auto gp = mat_gpu_res_pool_.requestGraphicsPipeline(mat);
+        // pipeline's vertex input state follows the mesh's vertex layout
+        auto gp = mat_gpu_res_pool_.requestGraphicsPipeline(mat, mesh->layout);
         auto mat_desc_set = mat_gpu_res_pool_.requestMatDescriptorSet(mat);
         cmd_buf->bindPipelineWithDescriptorSets(gp, {global_param_set, mat_desc_set, mesh_params_set->desc_set}, {}, 0);
         
@@ -145,10 +152,19 @@ namespace vk_engine
                                      static_cast<float>(height), 0.f, 1.f}});
         cmd_buf->setScissor({VkRect2D{{0, 0}, {width, height}}});
 
-        // bind mesh vertices
-        cmd_buf->bindVertexBuffer({mesh->vertices.buffer, mesh->normals.buffer},
-            {mesh->vertices.offset, mesh->normals.offset}, 0);
-        cmd_buf->bindIndexBuffer(mesh->faces.buffer, mesh->faces.offset, mesh->faces.data_type);
-        cmd_buf->drawIndexed(mesh->faces.index_count, 1, 0, 0, 0);
+        // meshes share the geometry arena pages, only rebind when the page changes
+        if (mesh->vertices.buffer.get() != bound_vertex_buffer_) {
+            cmd_buf->bindVertexBuffer({mesh->vertices.buffer}, {0}, 0);
+            bound_vertex_buffer_ = mesh->vertices.buffer.get();
+        }
+        if (mesh->faces.buffer.get() != bound_index_buffer_ ||
+            mesh->faces.data_type != bound_index_type_) {
+            cmd_buf->bindIndexBuffer(mesh->faces.buffer, 0, mesh->faces.data_type);
+            bound_index_buffer_ = mesh->faces.buffer.get();
+            bound_index_type_ = mesh->faces.data_type;
+        }
+        for (const auto &r : *ranges)
+            cmd_buf->drawIndexed(r.index_count, 1, mesh->first_index + r.first_index,
+                                 mesh->base_vertex + r.vertex_offset, 0);
     }
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <list>
 #include <Eigen/Dense>
 #include <framework/functional/component/material.h>
+#include <framework/functional/component/mesh.h>
 #include <framework/utils/vk/vk_driver.h>
 
 namespace vk_engine {
@@ -17,13 +18,13 @@ class DescriptorPool;
 class DescriptorSetLayout;
 class RenderPass;
 
-constexpr uint32_t MESH_UBO_SIZE=sizeof(float)*16;
+constexpr uint32_t MESH_UBO_SIZE=sizeof(float)*24;
 constexpr uint32_t MAX_MESH_DESC_SET=90 * TIME_BEFORE_EVICTION;
 struct MeshParamsSet
 {
     std::unique_ptr<Buffer> ubo;
     std::shared_ptr<DescriptorSet> desc_set;
-    mutable uint32_t last_access{0};
+    mutable uint64_t last_use{0}; //!< device timeline value of the submit drawing with it
 };
 
 class MeshParamsPool final
@@ -39,7 +40,6 @@ private:
     std::unique_ptr<DescriptorPool> desc_pool_;
     std::list<MeshParamsSet*> free_mesh_params_set_;
     std::list<MeshParamsSet*> used_mesh_params_set_;
-    uint32_t cur_frame_{0};
 };
 
 class RPass {
@@ -47,13 +47,24 @@ public:
     RPass(VkFormat color_format, VkFormat ds_format);
     virtual ~RPass() = default;
     void gc() { mesh_params_pool_.gc(); mat_gpu_res_pool_.gc(); }
+    /**
+     * \brief forget the bound vertex/index buffers, call before drawing into a new command buffer
+     */
+    void resetBindings() { bound_vertex_buffer_ = nullptr; bound_index_buffer_ = nullptr; }
+    /**
+     * \brief draw the mesh, or only the given ranges of its faces(e.g. the visible meshlets)
+     */
     void draw(const std::shared_ptr<Material> &mat, const Eigen::Matrix4f &rt, 
         const std::shared_ptr<StaticMesh> &mesh, const std::shared_ptr<CommandBuffer> &cmd_buf,
-        const uint32_t width, const uint32_t height);
+        const uint32_t width, const uint32_t height,
+        const std::vector<IndexRange> *ranges = nullptr);
     std::shared_ptr<RenderPass> getRenderPass() const noexcept { return render_pass_; }
 private:
     std::shared_ptr<RenderPass> render_pass_;
     MeshParamsPool mesh_params_pool_;
     MatGpuResourcePool mat_gpu_res_pool_;
+    Buffer *bound_vertex_buffer_{nullptr};
+    Buffer *bound_index_buffer_{nullptr};
+    VkIndexType bound_index_type_{VK_INDEX_TYPE_UINT32};
 };
 } // namespace vk_engine
@@ -1,28 +1,29 @@
 #include <cassert>
 #include <framework/functional/render/render.h>
 #include <framework/functional/render/pass/rpass.h>
+#include <framework/functional/render/meshlet_culling.h>
+#include <framework/functional/render/lod_selection.h>
 #include <framework/functional/scene/scene.h>
 #include <framework/functional/global/app_context.h>
+#include <framework/resources/asset_manager.hpp>
 #include <framework/utils/vk/commands.h>
+#include <framework/utils/vk/defragmenter.h>
+#include <framework/utils/vk/deletion_queue.h>
 #include <framework/utils/vk/frame_buffer.h>
+#include <framework/utils/vk/memory_stats.h>
 #include <framework/utils/vk/queue.h>
+#include <framework/utils/vk/upload_scheduler.h>
+#include <framework/utils/base/parallel.h>
 
 
 namespace vk_engine {
 Render::Render(VkFormat color_format, VkFormat ds_format)
-    : rpass_(color_format, ds_format) {
-  initRts();
-}
+    : rpass_(color_format, ds_format), ds_format_(ds_format) {}
 
 void Render::initRts()
 {
-  auto &frames_data = getDefaultAppContext().frames_data;
-  frame_buffers_.resize(frames_data.size());
-  auto &driver = getDefaultAppContext().driver;
-  for (auto i = 0; i < frames_data.size(); ++i) {
-    frame_buffers_[i] = std::move(std::make_unique<FrameBuffer>(
-        driver, rpass_.getRenderPass(), frames_data[i].render_tgt));
-  }
+  // the graph recreates them at the new size on the next frame
+  graph_.releaseResources();
 }
 
 void Render::beginFrame(const float time_elapse, const uint32_t frame_index,
@@ -32,14 +33,32 @@ void Render::beginFrame(const float time_elapse, const uint32_t frame_index,
   cur_frame_index_ = frame_index;
   cur_rt_index_ = rt_index;
   cur_time_ = time_elapse;
-  auto &sync = render_output_syncs[frame_index];
-  sync.render_fence->wait();
-  sync.render_fence->reset();
-  auto &cmd_pool =
-      getDefaultAppContext().frames_data[cur_frame_index_].command_pool;
+  // wait for the last submit of the frame before reusing its command pool
+  auto &frame_data = getDefaultAppContext().frames_data[cur_frame_index_];
+  getDefaultAppContext().timeline->wait(frame_data.timeline_value);
+  auto &driver = getDefaultAppContext().driver;
+  // end the defragmentation pass copied by a completed frame, before its allocations can be freed
+  driver->getDefragmenter()->retire();
+  // destroy the gpu objects released by completed frames
+  driver->getDeletionQueue()->pump();
+  // heap budgets and category usage, warns when a heap gets close to its budget
+  driver->getMemoryStats()->snapshot();
+  auto &cmd_pool = frame_data.command_pool;
   cmd_pool->reset();
   cmd_buf_ = cmd_pool->requestCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
   cmd_buf_->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);  
+
+  // take ownership of the uploads finished on transfer queue
+  wait_semaphores_.clear();
+  wait_stages_.clear();
+  getDefaultAppContext().upload_scheduler->acquire(cmd_buf_, wait_semaphores_,
+                                                   wait_stages_);
+  // keep the assets in budget, downgraded textures are copied before rendering
+  getDefaultAppContext().gpu_asset_manager->gc(cmd_buf_);
+  // move relocatable buffers and images within the pass budget, not while transfers may
+  // still write them
+  if (getDefaultAppContext().upload_scheduler->idle())
+    driver->getDefragmenter()->step(cmd_buf_->getHandle());
 }
 
 void Render::render(Scene *scene, Gui * gui)
@@ -47,10 +66,35 @@ void Render::render(Scene *scene, Gui * gui)
   assert(scene != nullptr);
   scene->update(cur_time_);
 
+  const auto &render_tgt = getDefaultAppContext().frames_data[cur_rt_index_].render_tgt;
+  auto width = render_tgt->getWidth();
+  auto height = render_tgt->getHeight();
+
+  // the swapchain image is written after the present semaphore wait, and presented. the present
+  // waits on the render semaphore, the final barrier has no destination stage
+  graph_.reset();
+  const auto backbuffer = graph_.importImage(
+      "backbuffer", render_tgt->getImageViews()[0],
+      RGImageDesc{render_tgt->getColorFormat(0), {width, height}},
+      RGImageState{VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                   VK_ACCESS_2_NONE},
+      RGImageState{VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE});
+  // one depth buffer for all the frames in flight, the graph orders its uses
+  const auto depth = graph_.createImage("depth", RGImageDesc{ds_format_, {width, height}});
+  auto &forward = graph_.addPass("forward")
+                      .writeColor(backbuffer, VkClearColorValue{{0.0f, 0.0f, 0.0f, 1.0f}})
+                      .writeDepth(depth, VkClearDepthStencilValue{1.0f, 0});
+
   // update camera  
   auto &camera_manager = scene->camera_manager();
   auto view_camera = camera_manager.view<std::shared_ptr<TransformRelationship>,
                                          Camera>();
+  if (view_camera.begin() == view_camera.end()) {
+    // scene is still loading, only clear the render target
+    graph_.compile();
+    graph_.execute(cmd_buf_);
+    return;
+  }
   const auto &cam_tr = camera_manager.get<std::shared_ptr<TransformRelationship>>(*view_camera.begin());
   auto &cam = camera_manager.get<Camera>(*view_camera.begin());
   auto &global_param_set = getDefaultAppContext().global_param_set;
@@ -76,74 +120,81 @@ void Render::render(Scene *scene, Gui * gui)
   auto view = rm.view<std::shared_ptr<TransformRelationship>,
                       std::shared_ptr<Material>, std::shared_ptr<StaticMesh>>();
   rpass_.gc();
-  auto width = frame_buffers_[cur_rt_index_]->getWidth();
-  auto height = frame_buffers_[cur_rt_index_]->getHeight();
-  cmd_buf_->beginRenderPass(rpass_.getRenderPass(), frame_buffers_[cur_rt_index_]);
-  view.each(
-      [this, width, height](const std::shared_ptr<TransformRelationship> &tr,
-                            const std::shared_ptr<Material> &mat,
-                            const std::shared_ptr<StaticMesh> &mesh) {
-        // update materials
-        mat->updateParams();
-
-        // // debug
-        // static float total_time = 0.0f;
-        // total_time += cur_time_;
-        // tr->gtransform.block<3, 3>(0, 0) =
-        //     Eigen::AngleAxisf(total_time, Eigen::Vector3f::UnitX()) * Eigen::AngleAxisf(3.1415926f*0.5f, Eigen::Vector3f::UnitY())
-        //         .toRotationMatrix();
-        rpass_.draw(mat, tr->gtransform, mesh, cmd_buf_, width, height);
-      });  
-  cmd_buf_->endRenderPass();
-
-  // image memory barrier
-  ImageMemoryBarrier barrier{
-      .old_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-      .new_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-      .src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-      .dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-      .src_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      .dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      .src_queue_family_index = VK_QUEUE_FAMILY_IGNORED,
-      .dst_queue_family_index = VK_QUEUE_FAMILY_IGNORED};
-  cmd_buf_->imageMemoryBarrier(barrier,
-                               frame_buffers_[cur_rt_index_]->getRenderTarget()->getImageViews()[0]);
+  rpass_.resetBindings();
+
+  // lods are selected and meshlets of the large meshes culled on worker threads
+  draws_.clear();
+  uint32_t parallel_draws = 0;
+  view.each([this, &parallel_draws](const std::shared_ptr<TransformRelationship> &tr,
+                                    const std::shared_ptr<Material> &mat,
+                                    const std::shared_ptr<StaticMesh> &mesh) {
+    auto it = lod_levels_.find(std::make_pair(tr.get(), mesh.get()));
+    const uint32_t lod = it == lod_levels_.end() ? 0 : it->second;
+    draws_.push_back({tr.get(), mat, mesh, {}, false, lod});
+    parallel_draws += (mesh->meshlets.empty() && mesh->lods.empty()) ? 0 : 1;
+  });
+  if (parallel_draws > 0) {
+    const Frustum frustum(cam.getProjMatrix() * cam.getViewMatrix());
+    const Eigen::Vector3f camera_pos = cam.getCameraPos();
+    const float pixel_scale = cam.getProjMatrix()(1, 1) * 0.5f * height;
+    parallelFor(0, static_cast<uint32_t>(draws_.size()), [&](uint32_t i) {
+      auto &d = draws_[i];
+      d.lod = selectLod(*d.mesh, d.tr->gtransform, camera_pos, pixel_scale,
+                        lod_pixel_error_, d.lod);
+      if (d.lod == 0)
+        d.culled = cullMeshlets(*d.mesh, d.tr->gtransform, frustum, camera_pos,
+                                d.ranges);
+    }, 4);
+  }
+
+  stats_ = {};
+  lod_levels_.clear();
+  forward.setExecute([this, width, height](const std::shared_ptr<CommandBuffer> &cmd_buf) {
+    for (auto &d : draws_) {
+      if (!d.mesh->lods.empty())
+        lod_levels_[std::make_pair(d.tr, d.mesh.get())] = d.lod;
+      const std::vector<IndexRange> &ranges =
+          d.lod > 0 ? d.mesh->lods[d.lod - 1].ranges
+                    : (d.culled ? d.ranges : d.mesh->faces.ranges);
+      for (const auto &r : ranges)
+        stats_.triangles += r.index_count / 3;
+      stats_.draws += ranges.empty() ? 0 : 1;
+
+      // update materials
+      d.mat->updateParams();
+      rpass_.draw(d.mat, d.tr->gtransform, d.mesh, cmd_buf, width, height, &ranges);
+    }
+  });
+  // barriers, layout transitions and the final present transition are emitted by the graph
+  graph_.compile();
+  graph_.execute(cmd_buf_);
+
   // render gui
   // gui->update(cmd_buf_, cur_time_, cur_frame_index_, cur_rt_index_);
 }
 
 void Render::endFrame() {
-  // add a barrier to transition the swapchain image from color attachment to
-  // present
-  ImageMemoryBarrier barrier{
-      .old_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-      .new_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-      .src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-      .dst_access_mask = 0,
-      .src_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      .dst_stage_mask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-      .src_queue_family_index = VK_QUEUE_FAMILY_IGNORED,
-      .dst_queue_family_index = VK_QUEUE_FAMILY_IGNORED};
-  auto &frame_data = getDefaultAppContext().frames_data[cur_rt_index_];
-  cmd_buf_->imageMemoryBarrier(barrier,
-                               frame_data.render_tgt->getImageViews()[0]);
+  // the swapchain image was transitioned to present by the render graph
   cmd_buf_->end();
   auto cmd_queue = getDefaultAppContext().driver->getGraphicsQueue();
   auto &sync = getDefaultAppContext().render_output_syncs[cur_frame_index_];
   auto cmd_buf_handle = cmd_buf_->getHandle();
   auto present_semaphore = sync.present_semaphore->getHandle();
   auto render_semaphore = sync.render_semaphore->getHandle();
-  auto render_fence = sync.render_fence->getHandle();
-  VkPipelineStageFlags wait_stage{
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+  wait_semaphores_.emplace_back(present_semaphore);
+  wait_stages_.emplace_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+  // uploads recorded this frame are acquired next frame
+  getDefaultAppContext().upload_scheduler->submit();
   VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
   submit_info.commandBufferCount = 1;
   submit_info.pCommandBuffers = &cmd_buf_handle;
-  submit_info.waitSemaphoreCount = 1;
-  submit_info.pWaitSemaphores = &present_semaphore;
-  submit_info.pWaitDstStageMask = &wait_stage;
+  submit_info.waitSemaphoreCount = wait_semaphores_.size();
+  submit_info.pWaitSemaphores = wait_semaphores_.data();
+  submit_info.pWaitDstStageMask = wait_stages_.data();
   submit_info.signalSemaphoreCount = 1;
   submit_info.pSignalSemaphores = &render_semaphore;
-  cmd_queue->submit({submit_info}, render_fence);
+  getDefaultAppContext().frames_data[cur_frame_index_].timeline_value =
+      getDefaultAppContext().timeline->submit(*cmd_queue, submit_info);
 }
 } // namespace vk_engine
\ No newline at end of file
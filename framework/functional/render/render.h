@@ -1,14 +1,21 @@
 #pragma once
 
+#include <map>
 #include <vector>
 #include <framework/functional/render/pass/rpass.h>
+#include <framework/functional/render/render_graph.h>
 #include <framework/utils/vk/syncs.h>
 
 namespace vk_engine {
 class CommandBuffer;
 class Scene;
-class FrameBuffer;
 class Gui;
+struct TransformRelationship;
+struct RenderStats {
+  uint32_t draws{0};
+  uint64_t triangles{0}; //!< submitted after lod selection and meshlet culling
+};
+
 class Render {
 public:
   Render(VkFormat color_format, VkFormat ds_format);
@@ -18,16 +25,51 @@ public:
 
   void render(Scene *scene, Gui *gui);
 
+  /**
+   * \brief release the attachments and framebuffers of the old render targets, e.g. on resize
+   */
   void initRts();
 
   void endFrame();
 
+  /**
+   * \brief command buffer of current frame, valid between beginFrame and endFrame
+   */
+  const std::shared_ptr<CommandBuffer> &getCommandBuffer() const { return cmd_buf_; }
+
+  /**
+   * \brief statistics of the last rendered frame
+   */
+  const RenderStats &stats() const { return stats_; }
+
+  /**
+   * \brief max screen space error of the selected mesh lods, in pixels
+   */
+  void setLodPixelError(const float pixels) { lod_pixel_error_ = pixels; }
+
 private:
   uint32_t cur_frame_index_{0};
   uint32_t cur_rt_index_{0};
   float cur_time_{0.0};
   std::shared_ptr<CommandBuffer> cmd_buf_;
+  std::vector<VkSemaphore> wait_semaphores_;
+  std::vector<VkPipelineStageFlags> wait_stages_;
+  struct Draw {
+    const TransformRelationship *tr;
+    std::shared_ptr<Material> mat;
+    std::shared_ptr<StaticMesh> mesh;
+    std::vector<IndexRange> ranges; //!< visible meshlets
+    bool culled;                    //!< false: draw the whole mesh
+    uint32_t lod;                   //!< 0: full detail
+  };
+
   RPass rpass_;
-  std::vector<std::unique_ptr<FrameBuffer>> frame_buffers_;
+  VkFormat ds_format_;
+  RenderGraph graph_; //!< rebuilt every frame, keeps the transient attachments while unchanged
+  std::vector<Draw> draws_;
+  //! lod of each renderable in the last frame, for the hysteresis
+  std::map<std::pair<const TransformRelationship *, const StaticMesh *>, uint32_t> lod_levels_;
+  float lod_pixel_error_{1.0f};
+  RenderStats stats_;
 };
 } // namespace vk_engine
\ No newline at end of file
@@ -0,0 +1,557 @@
+#include <framework/functional/render/render_graph.h>
+
+#include <algorithm>
+#include <cassert>
+#include <framework/functional/global/app_context.h>
+#include <framework/utils/base/error.h>
+#include <framework/utils/base/logging.h>
+#include <framework/utils/vk/barriers.h>
+#include <framework/utils/vk/commands.h>
+#include <framework/utils/vk/deletion_queue.h>
+#include <framework/utils/vk/frame_buffer.h>
+#include <framework/utils/vk/image.h>
+#include <framework/utils/vk/memory_stats.h>
+#include <framework/utils/vk/render_pass.h>
+#include <framework/utils/vk/resource_cache.h>
+#include <framework/utils/vk/vk_common.h>
+#include <framework/utils/vk/vk_driver.h>
+#include <glm/gtx/hash.hpp>
+
+namespace vk_engine {
+
+namespace {
+struct AccessInfo {
+  VkImageLayout layout;
+  VkPipelineStageFlags2 stages;
+  VkAccessFlags2 access;
+  bool write;
+  VkImageUsageFlags usage;
+};
+
+constexpr VkPipelineStageFlags2 SHADER_STAGES =
+    VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+constexpr VkPipelineStageFlags2 DEPTH_STAGES = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                                               VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+constexpr VkAccessFlags2 WRITE_ACCESS =
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+const AccessInfo &accessInfo(RGAccess access) {
+  static const AccessInfo infos[] = {
+      // ColorWrite
+      {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+       VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, true,
+       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT},
+      // DepthWrite
+      {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, DEPTH_STAGES,
+       VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+           VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+       true, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT},
+      // DepthRead
+      {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, DEPTH_STAGES,
+       VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, false,
+       VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT},
+      // Sampled
+      {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, SHADER_STAGES,
+       VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, false, VK_IMAGE_USAGE_SAMPLED_BIT},
+      // StorageRead
+      {VK_IMAGE_LAYOUT_GENERAL, SHADER_STAGES, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, false,
+       VK_IMAGE_USAGE_STORAGE_BIT},
+      // StorageWrite
+      {VK_IMAGE_LAYOUT_GENERAL, SHADER_STAGES,
+       VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, true,
+       VK_IMAGE_USAGE_STORAGE_BIT},
+      // TransferSrc
+      {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+       VK_ACCESS_2_TRANSFER_READ_BIT, false, VK_IMAGE_USAGE_TRANSFER_SRC_BIT},
+      // TransferDst
+      {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+       VK_ACCESS_2_TRANSFER_WRITE_BIT, true, VK_IMAGE_USAGE_TRANSFER_DST_BIT},
+  };
+  static_assert(sizeof(infos) / sizeof(infos[0]) == static_cast<uint32_t>(RGAccess::Count));
+  return infos[static_cast<uint32_t>(access)];
+}
+
+VkImageAspectFlags aspectMask(VkFormat format) {
+  if (!isDepthFormat(format))
+    return VK_IMAGE_ASPECT_COLOR_BIT;
+  if (format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT)
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+  return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+}
+} // namespace
+
+RGPass &RGPass::writeColor(RGHandle image, std::optional<VkClearColorValue> clear) {
+  std::optional<VkClearValue> value;
+  if (clear.has_value())
+    value = VkClearValue{.color = *clear};
+  uses_.push_back({image, RGAccess::ColorWrite, value});
+  return *this;
+}
+
+RGPass &RGPass::writeDepth(RGHandle image, std::optional<VkClearDepthStencilValue> clear) {
+  std::optional<VkClearValue> value;
+  if (clear.has_value())
+    value = VkClearValue{.depthStencil = *clear};
+  uses_.push_back({image, RGAccess::DepthWrite, value});
+  return *this;
+}
+
+RGPass &RGPass::readDepth(RGHandle image) {
+  uses_.push_back({image, RGAccess::DepthRead, std::nullopt});
+  return *this;
+}
+
+RGPass &RGPass::read(RGHandle image, RGAccess access) {
+  assert(!accessInfo(access).write);
+  uses_.push_back({image, access, std::nullopt});
+  return *this;
+}
+
+RGPass &RGPass::write(RGHandle image, RGAccess access) {
+  assert(accessInfo(access).write);
+  uses_.push_back({image, access, std::nullopt});
+  return *this;
+}
+
+bool RGPass::isRaster() const {
+  return std::any_of(uses_.begin(), uses_.end(), [](const Use &use) {
+    return use.access == RGAccess::ColorWrite || use.access == RGAccess::DepthWrite ||
+           use.access == RGAccess::DepthRead;
+  });
+}
+
+RenderGraph::RenderGraph() : driver_(getDefaultAppContext().driver) {}
+
+RenderGraph::~RenderGraph() { releaseResources(); }
+
+void RenderGraph::reset() {
+  ++frame_;
+  images_.clear();
+  passes_.clear();
+  // framebuffers of old swapchain images or render passes no longer used
+  for (auto itr = frame_buffers_.begin(); itr != frame_buffers_.end();) {
+    if (itr->second.last_frame + FRAMEBUFFER_KEEP_FRAMES < frame_)
+      itr = frame_buffers_.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+RGHandle RenderGraph::importImage(const std::string &name,
+                                  const std::shared_ptr<ImageView> &view,
+                                  const RGImageDesc &desc, const RGImageState &initial,
+                                  const RGImageState &final) {
+  Image image;
+  image.name = name;
+  image.desc = desc;
+  image.imported = true;
+  image.view = view;
+  image.initial = initial;
+  image.final = final;
+  images_.emplace_back(std::move(image));
+  return static_cast<RGHandle>(images_.size() - 1);
+}
+
+RGHandle RenderGraph::createImage(const std::string &name, const RGImageDesc &desc) {
+  Image image;
+  image.name = name;
+  image.desc = desc;
+  images_.emplace_back(std::move(image));
+  return static_cast<RGHandle>(images_.size() - 1);
+}
+
+RGPass &RenderGraph::addPass(const std::string &name) {
+  passes_.emplace_back(std::make_unique<RGPass>(name));
+  return *passes_.back();
+}
+
+const std::shared_ptr<ImageView> &RenderGraph::getImageView(RGHandle image) const {
+  const auto &img = images_[image];
+  if (img.imported || img.physical == 0xFFFFFFFF)
+    return img.view;
+  return transients_[img.physical].view;
+}
+
+void RenderGraph::compile() {
+  cull();
+  computeLifetimes();
+  allocateTransients();
+  createRenderPasses();
+}
+
+void RenderGraph::cull() {
+  // walk back from the outputs: a pass is kept if it has side effects, writes an imported
+  // image or an image read by a kept pass after it
+  std::vector<bool> needed(images_.size(), false);
+  stats_.passes = static_cast<uint32_t>(passes_.size());
+  stats_.culled_passes = 0;
+  for (auto itr = passes_.rbegin(); itr != passes_.rend(); ++itr) {
+    auto &pass = **itr;
+    bool keep = pass.side_effect_;
+    for (const auto &use : pass.uses_) {
+      if (accessInfo(use.access).write &&
+          (images_[use.image].imported || needed[use.image]))
+        keep = true;
+    }
+    pass.culled_ = !keep;
+    if (!keep) {
+      ++stats_.culled_passes;
+      continue;
+    }
+    for (const auto &use : pass.uses_) {
+      // a cleared attachment doesn't depend on the earlier writers, other writes keep the
+      // content they don't overwrite
+      needed[use.image] = !(accessInfo(use.access).write && use.clear.has_value());
+    }
+  }
+}
+
+void RenderGraph::computeLifetimes() {
+  for (uint32_t i = 0; i < passes_.size(); ++i) {
+    if (passes_[i]->culled_)
+      continue;
+    for (const auto &use : passes_[i]->uses_) {
+      auto &image = images_[use.image];
+      image.usage |= accessInfo(use.access).usage;
+      image.first_pass = std::min(image.first_pass, i);
+      image.last_pass = std::max(image.last_pass, i);
+    }
+  }
+}
+
+void RenderGraph::allocateTransients() {
+  std::vector<Transient> wanted;
+  for (auto &image : images_) {
+    if (image.imported || image.first_pass == 0xFFFFFFFF)
+      continue;
+    image.physical = static_cast<uint32_t>(wanted.size());
+    wanted.push_back({.desc = image.desc,
+                      .usage = image.usage,
+                      .first_pass = image.first_pass,
+                      .last_pass = image.last_pass});
+  }
+
+  // same images with the same lifetimes as last frame, keep them and their aliasing
+  const bool unchanged =
+      wanted.size() == transients_.size() &&
+      std::equal(wanted.begin(), wanted.end(), transients_.begin(),
+                 [](const Transient &a, const Transient &b) {
+                   return a.desc == b.desc && a.usage == b.usage &&
+                          a.first_pass == b.first_pass && a.last_pass == b.last_pass;
+                 });
+  if (unchanged)
+    return;
+
+  releaseTransients();
+  transients_ = std::move(wanted);
+
+  auto device = driver_->getDevice();
+  auto allocator = driver_->getAllocator();
+  std::vector<VkMemoryRequirements> requirements(transients_.size());
+  for (uint32_t i = 0; i < transients_.size(); ++i) {
+    auto &t = transients_[i];
+    VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = t.desc.format;
+    image_info.extent = {t.desc.extent.width, t.desc.extent.height, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = t.desc.samples;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = t.usage;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VK_THROW_IF_ERROR(vkCreateImage(device, &image_info, nullptr, &t.image),
+                      "failed to create transient image!");
+    vkGetImageMemoryRequirements(device, t.image, &requirements[i]);
+  }
+
+  // largest first, each image goes to the first block whose images all live in other passes
+  std::vector<uint32_t> order(transients_.size());
+  for (uint32_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&requirements](uint32_t a, uint32_t b) {
+    return requirements[a].size > requirements[b].size;
+  });
+  std::vector<VkMemoryRequirements> block_requirements;
+  std::vector<std::vector<uint32_t>> block_members;
+  stats_.unaliased_bytes = 0;
+  for (auto i : order) {
+    auto &t = transients_[i];
+    const auto &req = requirements[i];
+    stats_.unaliased_bytes += req.size;
+    uint32_t b = 0;
+    for (; b < block_members.size(); ++b) {
+      if ((block_requirements[b].memoryTypeBits & req.memoryTypeBits) == 0)
+        continue;
+      const bool disjoint = std::all_of(
+          block_members[b].begin(), block_members[b].end(), [&](uint32_t m) {
+            return t.last_pass < transients_[m].first_pass ||
+                   t.first_pass > transients_[m].last_pass;
+          });
+      if (disjoint)
+        break;
+    }
+    if (b == block_members.size()) {
+      block_requirements.push_back(req);
+      block_members.emplace_back();
+    } else {
+      auto &block_req = block_requirements[b];
+      block_req.size = std::max(block_req.size, req.size);
+      block_req.alignment = std::max(block_req.alignment, req.alignment);
+      block_req.memoryTypeBits &= req.memoryTypeBits;
+    }
+    block_members[b].push_back(i);
+    t.block = b;
+  }
+
+  blocks_.resize(block_members.size());
+  stats_.transient_bytes = 0;
+  for (uint32_t b = 0; b < blocks_.size(); ++b) {
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    VK_THROW_IF_ERROR(vmaAllocateMemory(allocator, &block_requirements[b], &alloc_info,
+                                        &blocks_[b].allocation, nullptr),
+                      "failed to allocate transient image memory!");
+    driver_->getMemoryStats()->onAllocate(blocks_[b].allocation, MemoryCategory::Attachment);
+    blocks_[b].size = block_requirements[b].size;
+    stats_.transient_bytes += blocks_[b].size;
+  }
+
+  for (auto &t : transients_) {
+    VK_THROW_IF_ERROR(vmaBindImageMemory(allocator, blocks_[t.block].allocation, t.image),
+                      "failed to bind transient image memory!");
+    t.view = std::make_shared<ImageView>(driver_, t.image, VK_IMAGE_VIEW_TYPE_2D,
+                                         t.desc.format, aspectMask(t.desc.format), 0, 0,
+                                         1, 1);
+  }
+  stats_.transient_images = static_cast<uint32_t>(transients_.size());
+  stats_.memory_blocks = static_cast<uint32_t>(blocks_.size());
+  LOGI("render graph: {} transient images in {} memory blocks, {}KB({}KB without aliasing)",
+       stats_.transient_images, stats_.memory_blocks, stats_.transient_bytes >> 10,
+       stats_.unaliased_bytes >> 10);
+}
+
+void RenderGraph::releaseTransients() {
+  // framebuffers hold the views, and released view handles may be reused
+  frame_buffers_.clear();
+  auto deletion_queue = driver_->getDeletionQueue();
+  for (auto &t : transients_) {
+    t.view.reset();
+    if (t.image != VK_NULL_HANDLE)
+      deletion_queue->destroyImage(t.image, VK_NULL_HANDLE);
+  }
+  transients_.clear();
+  // the images are destroyed before their memory, in enqueue order
+  for (auto &block : blocks_) {
+    driver_->getMemoryStats()->onFree(block.allocation);
+    deletion_queue->destroyImage(VK_NULL_HANDLE, block.allocation);
+  }
+  blocks_.clear();
+  stats_.transient_images = 0;
+  stats_.memory_blocks = 0;
+  stats_.transient_bytes = 0;
+  stats_.unaliased_bytes = 0;
+}
+
+void RenderGraph::releaseResources() {
+  releaseTransients();
+  frame_buffers_.clear();
+}
+
+void RenderGraph::createRenderPasses() {
+  auto &resource_cache = getDefaultAppContext().resource_cache;
+  for (uint32_t i = 0; i < passes_.size(); ++i) {
+    auto &pass = *passes_[i];
+    if (pass.culled_ || !pass.isRaster())
+      continue;
+
+    // color attachments in declaration order, then the depth attachment
+    std::vector<const RGPass::Use *> uses;
+    for (const auto &use : pass.uses_) {
+      if (use.access == RGAccess::ColorWrite)
+        uses.push_back(&use);
+    }
+    for (const auto &use : pass.uses_) {
+      if (use.access == RGAccess::DepthWrite || use.access == RGAccess::DepthRead)
+        uses.push_back(&use);
+    }
+
+    std::vector<Attachment> attachments;
+    std::vector<LoadStoreInfo> load_store_infos;
+    std::vector<RGHandle> handles;
+    SubpassInfo subpass;
+    pass.clear_values_.clear();
+    for (const auto *use : uses) {
+      const auto &image = images_[use->image];
+      const auto &info = accessInfo(use->access);
+      // written by an earlier pass of the frame, or imported with content
+      const bool has_content = i > image.first_pass ||
+                               (image.imported && image.initial.layout != VK_IMAGE_LAYOUT_UNDEFINED);
+      // read by a later pass, or an output of the graph
+      const bool keep_content = image.imported || i < image.last_pass;
+      LoadStoreInfo load_store;
+      load_store.load_op = use->clear.has_value() ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                           : has_content          ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                                  : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+      load_store.store_op =
+          keep_content ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+      const auto index = static_cast<uint32_t>(attachments.size());
+      if (use->access == RGAccess::ColorWrite)
+        subpass.output_attachments.push_back(index);
+      else
+        subpass.depth_stencil_attachment = index;
+      // the layouts are transitioned by the graph's barriers, not by the render pass
+      attachments.push_back(Attachment{image.desc.format, image.desc.samples, info.usage,
+                                       info.layout});
+      load_store_infos.push_back(load_store);
+      handles.push_back(use->image);
+      pass.clear_values_.push_back(use->clear.value_or(VkClearValue{}));
+    }
+    pass.render_pass_ = resource_cache->requestRenderPass(driver_, attachments,
+                                                          load_store_infos, {subpass});
+    pass.frame_buffer_ = requestFrameBuffer(pass.render_pass_, handles);
+  }
+}
+
+FrameBuffer *RenderGraph::requestFrameBuffer(const std::shared_ptr<RenderPass> &render_pass,
+                                             const std::vector<RGHandle> &attachments) {
+  size_t hash = std::hash<VkRenderPass>()(render_pass->getHandle());
+  std::vector<std::shared_ptr<ImageView>> views;
+  for (auto handle : attachments) {
+    views.push_back(getImageView(handle));
+    glm::detail::hash_combine(hash, std::hash<VkImageView>()(views.back()->getHandle()));
+  }
+  auto &entry = frame_buffers_[hash];
+  entry.last_frame = frame_;
+  if (entry.frame_buffer != nullptr)
+    return entry.frame_buffer.get();
+
+  std::vector<VkFormat> color_formats;
+  VkFormat ds_format = VK_FORMAT_UNDEFINED;
+  for (auto handle : attachments) {
+    const auto format = images_[handle].desc.format;
+    if (isDepthFormat(format))
+      ds_format = format;
+    else
+      color_formats.push_back(format);
+  }
+  const auto &extent = images_[attachments[0]].desc.extent;
+  auto render_target = std::make_shared<RenderTarget>(views, color_formats, ds_format,
+                                                      extent.width, extent.height, 1u);
+  entry.frame_buffer = std::make_unique<FrameBuffer>(driver_, render_pass, render_target);
+  return entry.frame_buffer.get();
+}
+
+void RenderGraph::transition(RGHandle image, RGAccess access, BarrierBatcher &barriers) {
+  auto &state = states_[image];
+  const auto &info = accessInfo(access);
+  const bool layout_change = state.layout != info.layout;
+
+  VkPipelineStageFlags2 src = VK_PIPELINE_STAGE_2_NONE;
+  VkAccessFlags2 src_access = VK_ACCESS_2_NONE;
+  if (info.write || layout_change) {
+    // write after write/read, layout transitions write the image too
+    src = state.write_stages | state.read_stages;
+    src_access = state.write_access;
+  } else if (state.write_stages != 0 && (info.stages & ~state.read_stages) != 0) {
+    // read after write, by stages not synchronized with the write yet
+    src = state.write_stages;
+    src_access = state.write_access;
+  }
+
+  if (layout_change || src != VK_PIPELINE_STAGE_2_NONE) {
+    const auto &img = images_[image];
+    VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.srcStageMask = src;
+    barrier.srcAccessMask = src_access;
+    barrier.dstStageMask = info.stages;
+    barrier.dstAccessMask = info.access;
+    barrier.oldLayout = state.layout;
+    barrier.newLayout = info.layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = getImageView(image)->getVkImage();
+    barrier.subresourceRange = {aspectMask(img.desc.format), 0, 1, 0, 1};
+    barriers.imageBarrier(barrier);
+  }
+
+  if (info.write) {
+    state = {info.layout, info.stages, info.access & WRITE_ACCESS, 0};
+  } else if (layout_change) {
+    // later reads by other stages wait for the transition
+    state = {info.layout, info.stages, 0, info.stages};
+  } else {
+    state.read_stages |= info.stages;
+  }
+
+  const auto &img = images_[image];
+  if (!img.imported) {
+    auto &block = blocks_[transients_[img.physical].block];
+    block.stages = state.write_stages | state.read_stages;
+    block.write_access = state.write_access;
+  }
+}
+
+void RenderGraph::execute(const std::shared_ptr<CommandBuffer> &cmd_buf) {
+  states_.assign(images_.size(), State{});
+  for (uint32_t i = 0; i < images_.size(); ++i) {
+    const auto &image = images_[i];
+    if (image.imported)
+      states_[i] = {image.initial.layout, image.initial.stages, image.initial.access, 0};
+  }
+
+  // one barrier call per pass, each barrier with the stages of its own image
+  BarrierBatcher barriers;
+  for (uint32_t i = 0; i < passes_.size(); ++i) {
+    auto &pass = *passes_[i];
+    if (pass.culled_)
+      continue;
+
+    // a transient starts undefined, after the last accesses of the memory it aliases
+    for (uint32_t h = 0; h < images_.size(); ++h) {
+      const auto &image = images_[h];
+      if (image.imported || image.first_pass != i)
+        continue;
+      const auto &block = blocks_[transients_[image.physical].block];
+      states_[h] = {VK_IMAGE_LAYOUT_UNDEFINED, block.stages, block.write_access, 0};
+    }
+
+    for (const auto &use : pass.uses_)
+      transition(use.image, use.access, barriers);
+    barriers.flush(cmd_buf->getHandle());
+
+    if (pass.render_pass_ != nullptr)
+      cmd_buf->beginRenderPass(pass.render_pass_, *pass.frame_buffer_, pass.clear_values_);
+    if (pass.execute_)
+      pass.execute_(cmd_buf);
+    if (pass.render_pass_ != nullptr)
+      cmd_buf->endRenderPass();
+  }
+
+  // hand the imported images back in their final state, e.g. present
+  for (uint32_t h = 0; h < images_.size(); ++h) {
+    const auto &image = images_[h];
+    const auto &state = states_[h];
+    if (!image.imported || image.first_pass == 0xFFFFFFFF ||
+        (state.layout == image.final.layout && state.write_access == 0))
+      continue;
+    VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.srcStageMask = state.write_stages | state.read_stages;
+    barrier.srcAccessMask = state.write_access;
+    barrier.dstStageMask = image.final.stages;
+    barrier.dstAccessMask = image.final.access;
+    barrier.oldLayout = state.layout;
+    barrier.newLayout = image.final.layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.view->getVkImage();
+    barrier.subresourceRange = {aspectMask(image.desc.format), 0, 1, 0, 1};
+    barriers.imageBarrier(barrier);
+  }
+  barriers.flush(cmd_buf->getHandle());
+}
+} // namespace vk_engine
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <volk.h>
+
+namespace vk_engine {
+class VkDriver;
+class CommandBuffer;
+class FrameBuffer;
+class RenderPass;
+class ImageView;
+class BarrierBatcher;
+
+using RGHandle = uint32_t;
+constexpr RGHandle RG_INVALID_HANDLE = 0xFFFFFFFF;
+
+/**
+ * \brief how a pass uses an image, decides the layout, stages and access of the barriers
+ */
+enum class RGAccess : uint32_t {
+  ColorWrite = 0, //!< color attachment
+  DepthWrite,     //!< depth stencil attachment, tested and written
+  DepthRead,      //!< read only depth stencil attachment, e.g. after a depth prepass
+  Sampled,        //!< sampled in fragment or compute shaders
+  StorageRead,
+  StorageWrite,
+  TransferSrc,
+  TransferDst,
+  Count
+};
+
+struct RGImageDesc {
+  VkFormat format{VK_FORMAT_UNDEFINED};
+  VkExtent2D extent{0, 0};
+  VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
+
+  bool operator==(const RGImageDesc &other) const {
+    return format == other.format && extent.width == other.extent.width &&
+           extent.height == other.extent.height && samples == other.samples;
+  }
+};
+
+/**
+ * \brief state of an imported image before and after the graph
+ */
+struct RGImageState {
+  VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+  VkPipelineStageFlags2 stages{VK_PIPELINE_STAGE_2_NONE};
+  VkAccessFlags2 access{VK_ACCESS_2_NONE};
+};
+
+class RGPass final {
+public:
+  using ExecuteFunc = std::function<void(const std::shared_ptr<CommandBuffer> &cmd_buf)>;
+
+  explicit RGPass(const std::string &name) : name_(name) {}
+
+  /**
+   * \brief render to a color attachment, cleared if clear is set, otherwise its content is
+   * loaded when an earlier pass wrote it
+   */
+  RGPass &writeColor(RGHandle image, std::optional<VkClearColorValue> clear = std::nullopt);
+
+  RGPass &writeDepth(RGHandle image,
+                     std::optional<VkClearDepthStencilValue> clear = std::nullopt);
+
+  RGPass &readDepth(RGHandle image);
+
+  RGPass &read(RGHandle image, RGAccess access = RGAccess::Sampled);
+
+  RGPass &write(RGHandle image, RGAccess access);
+
+  /**
+   * \brief never culled, for passes writing outside the graph(buffers, queries...)
+   */
+  RGPass &setSideEffect() { side_effect_ = true; return *this; }
+
+  RGPass &setExecute(ExecuteFunc &&execute) { execute_ = std::move(execute); return *this; }
+
+  const std::string &getName() const { return name_; }
+
+private:
+  struct Use {
+    RGHandle image;
+    RGAccess access;
+    std::optional<VkClearValue> clear;
+  };
+
+  friend class RenderGraph;
+
+  bool isRaster() const;
+
+  std::string name_;
+  std::vector<Use> uses_;
+  bool side_effect_{false};
+  ExecuteFunc execute_;
+
+  // compiled
+  bool culled_{false};
+  std::shared_ptr<RenderPass> render_pass_;
+  FrameBuffer *frame_buffer_{nullptr};
+  std::vector<VkClearValue> clear_values_;
+};
+
+struct RenderGraphStats {
+  uint32_t passes{0};
+  uint32_t culled_passes{0};
+  uint32_t transient_images{0};
+  uint32_t memory_blocks{0};          //!< allocations shared by the transient images
+  VkDeviceSize transient_bytes{0};    //!< memory of the transient images after aliasing
+  VkDeviceSize unaliased_bytes{0};    //!< memory they would take without aliasing
+};
+
+/**
+ * \brief RenderGraph records the passes of a frame from their declared image reads and writes.
+ *
+ * The graph is rebuilt every frame: reset(), import the external images(e.g. the swapchain
+ * image) and create the transient ones, add the passes, compile() and execute(). compile()
+ * culls the passes that don't contribute to an imported image or have no side effect, picks
+ * the load/store ops of the attachments, and places transient images whose lifetimes don't
+ * overlap in the same memory. The transient images and their memory are kept as long as the
+ * graph's transients and lifetimes don't change, so a steady graph allocates nothing per frame.
+ * execute() emits the barriers and layout transitions before each pass, begins the render pass
+ * of raster passes, and transitions the imported images to their final state at the end.
+ */
+class RenderGraph final {
+public:
+  RenderGraph();
+
+  ~RenderGraph();
+
+  RenderGraph(const RenderGraph &) = delete;
+  RenderGraph &operator=(const RenderGraph &) = delete;
+
+  /**
+   * \brief start declaring the passes of a new frame
+   */
+  void reset();
+
+  /**
+   * \brief image owned outside the graph, e.g. the swapchain image. passes writing it are
+   * never culled, it is transitioned to the final state at the end of execute
+   */
+  RGHandle importImage(const std::string &name, const std::shared_ptr<ImageView> &view,
+                       const RGImageDesc &desc, const RGImageState &initial,
+                       const RGImageState &final);
+
+  /**
+   * \brief image living only within the frame, its content is undefined at the first use
+   */
+  RGHandle createImage(const std::string &name, const RGImageDesc &desc);
+
+  /**
+   * \brief the pass is executed in declaration order, the reference is valid until reset
+   */
+  RGPass &addPass(const std::string &name);
+
+  void compile();
+
+  void execute(const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+  /**
+   * \brief view of an image, transient views are valid after compile
+   */
+  const std::shared_ptr<ImageView> &getImageView(RGHandle image) const;
+
+  const RGImageDesc &getImageDesc(RGHandle image) const { return images_[image].desc; }
+
+  /**
+   * \brief release the transient images and the cached framebuffers, e.g. on resize
+   */
+  void releaseResources();
+
+  const RenderGraphStats &stats() const { return stats_; }
+
+  static constexpr uint32_t FRAMEBUFFER_KEEP_FRAMES = 8; //!< unused framebuffers are released after
+
+private:
+  struct Image {
+    std::string name;
+    RGImageDesc desc;
+    bool imported{false};
+    std::shared_ptr<ImageView> view;
+    RGImageState initial;
+    RGImageState final;
+
+    // compiled
+    VkImageUsageFlags usage{0};
+    uint32_t first_pass{0xFFFFFFFF};
+    uint32_t last_pass{0};
+    uint32_t physical{0xFFFFFFFF}; //!< index into transients_
+  };
+
+  //! layout and pending hazards of an image while executing
+  struct State {
+    VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+    VkPipelineStageFlags2 write_stages{VK_PIPELINE_STAGE_2_NONE};
+    VkAccessFlags2 write_access{VK_ACCESS_2_NONE};
+    VkPipelineStageFlags2 read_stages{VK_PIPELINE_STAGE_2_NONE}; //!< stages that read since the last write
+  };
+
+  struct Transient {
+    RGImageDesc desc;
+    VkImageUsageFlags usage{0};
+    uint32_t first_pass{0};
+    uint32_t last_pass{0};
+    VkImage image{VK_NULL_HANDLE};
+    std::shared_ptr<ImageView> view;
+    uint32_t block{0};
+  };
+
+  //! memory shared by transients with disjoint lifetimes
+  struct MemoryBlock {
+    VmaAllocation allocation{VK_NULL_HANDLE};
+    VkDeviceSize size{0};
+    // last accesses of the block, the first use of the next transient placed in it waits
+    // for them, across frames too
+    VkPipelineStageFlags2 stages{VK_PIPELINE_STAGE_2_NONE};
+    VkAccessFlags2 write_access{VK_ACCESS_2_NONE};
+  };
+
+  struct CachedFrameBuffer {
+    std::unique_ptr<FrameBuffer> frame_buffer;
+    uint64_t last_frame{0};
+  };
+
+  void cull();
+
+  void computeLifetimes();
+
+  void allocateTransients();
+
+  void releaseTransients();
+
+  void createRenderPasses();
+
+  FrameBuffer *requestFrameBuffer(const std::shared_ptr<RenderPass> &render_pass,
+                                  const std::vector<RGHandle> &attachments);
+
+  void transition(RGHandle image, RGAccess access, BarrierBatcher &barriers);
+
+  std::shared_ptr<VkDriver> driver_;
+  uint64_t frame_{0};
+
+  std::vector<Image> images_;
+  std::vector<std::unique_ptr<RGPass>> passes_;
+  std::vector<State> states_;
+
+  std::vector<Transient> transients_;
+  std::vector<MemoryBlock> blocks_;
+  std::unordered_map<size_t, CachedFrameBuffer> frame_buffers_;
+  RenderGraphStats stats_;
+};
+} // namespace vk_engine
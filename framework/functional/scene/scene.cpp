@@ -47,6 +47,8 @@ Scene::createLightEntity(const std::string_view &name,
 }
 
 void Scene::update(const float seconds) {
+  if (root_tr_ == nullptr) // nothing loaded yet
+    return;
   auto &scene_aabb = root_tr_->aabb;
   scene_aabb.setEmpty();
   //// update rt
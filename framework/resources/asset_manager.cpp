@@ -1,53 +1,99 @@
 #include <framework/resources/asset_manager.hpp>
 
 #include <stb_image.h>
+#include <algorithm>
 #include <cassert>
-#include <framework/utils/base/data_reshaper.hpp>
+#include <cstdio>
+#include <vector>
+#include <framework/utils/base/hash.h>
+#include <framework/utils/base/logging.h>
+#include <framework/utils/base/mipmap.h>
+#include <framework/utils/base/pixel_convert.h>
+#include <framework/resources/texture_compressor.h>
 #include <framework/functional/global/app_context.h>
+#include <framework/utils/vk/barriers.h>
 #include <framework/utils/vk/image.h>
 #include <framework/utils/vk/vk_driver.h>
 #include <framework/utils/vk/commands.h>
+#include <framework/utils/vk/upload_batch.h>
+#include <framework/utils/vk/upload_scheduler.h>
 
 
 namespace vk_engine
 {
-    static constexpr uint32_t ASSET_TIME_BEFORE_EVICTION = 100;   
+    static constexpr size_t DEFAULT_TEXTURE_BUDGET = 1024ull << 20;
+    static constexpr size_t DEFAULT_IMAGE_BUDGET = 256ull << 20;
+    static constexpr uint32_t MAX_DOWNGRADES_PER_FRAME = 4;
+    static constexpr uint32_t MIN_DOWNGRADE_EXTENT = 64; //!< textures this small are kept
+    static constexpr uint32_t MAX_DECODE_THREADS = 4;
 
-    std::shared_ptr<ImageView> createImageView(void * img_data, uint32_t width, uint32_t height, uint32_t channel,
-        const std::shared_ptr<CommandBuffer> &cmd_buf)
+    static std::shared_ptr<Image> createImage(uint32_t width, uint32_t height)
     {
         VkExtent3D extent{width, height, 1};
-        
+        auto driver = getDefaultAppContext().driver;
+        return std::make_shared<Image>(
+            driver, 0, VK_FORMAT_R8G8B8A8_SRGB, extent, VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, Image::mipLevelCount(width, height));
+    }
+
+    template <typename Func>
+    static std::shared_ptr<ImageView> createRgbaImageView(void * img_data, uint32_t width, uint32_t height, uint32_t channel,
+        Func &&upload)
+    {
         // if channel is not 4 need to add channel to it
         void *data_ptr = img_data;
         if (channel != 4) {
-            data_ptr = new uint8_t[width * height * 4];
-            reshapeImageData<uint8_t>(data_ptr, img_data, 3, 4,
-                                      width * height * channel);
+            data_ptr = new uint8_t[static_cast<size_t>(width) * height * 4];
+            expandToRgba8(static_cast<uint8_t *>(data_ptr), static_cast<const uint8_t *>(img_data),
+                          channel, static_cast<size_t>(width) * height);
         }
 
-        auto driver = getDefaultAppContext().driver;
-        auto image = std::make_shared<Image>(
-            driver, 0, VK_FORMAT_R8G8B8A8_SRGB, extent, VK_SAMPLE_COUNT_1_BIT,
-            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
-        image->updateByStaging(data_ptr, getDefaultAppContext().stage_pool, cmd_buf);
+        auto image = createImage(width, height);
+        upload(image, data_ptr);
         if (data_ptr != img_data) delete[] static_cast<uint8_t *>(data_ptr);
-        VkImageSubresourceRange range = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        };        
-        image->transitionLayout(cmd_buf->getHandle(), range,
-                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
         auto img_v = std::make_shared<ImageView>(
             image, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R8G8B8A8_SRGB,
-            VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1, 1);
+            VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, image->getMipLevels(), 1);
 
         return img_v;
     }
 
+    std::shared_ptr<ImageView> createImageView(void * img_data, uint32_t width, uint32_t height, uint32_t channel,
+        const std::shared_ptr<CommandBuffer> &cmd_buf)
+    {
+        return createRgbaImageView(img_data, width, height, channel,
+            [&cmd_buf](const std::shared_ptr<Image> &image, void *data_ptr) {
+                UploadBatch batch(getDefaultAppContext().stage_pool);
+                batch.addImage(image, data_ptr);
+                if (image->supportsBlitMipmaps()) {
+                    batch.record(cmd_buf, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+                    image->generateMipmaps(cmd_buf);
+                    return;
+                }
+                const auto &extent = image->getExtent();
+                auto levels = generateMipChainRgba8(static_cast<uint8_t *>(data_ptr),
+                                                    extent.width, extent.height, true);
+                for (uint32_t i = 0; i < levels.size(); ++i)
+                    batch.addImage(image, levels[i].data(), i + 1);
+                batch.record(cmd_buf);
+            });
+    }
+
+    std::shared_ptr<ImageView> createImageView(void * img_data, uint32_t width, uint32_t height, uint32_t channel,
+        UploadScheduler &scheduler)
+    {
+        return createRgbaImageView(img_data, width, height, channel,
+            [&scheduler](const std::shared_ptr<Image> &image, void *data_ptr) {
+                scheduler.uploadImage(image, data_ptr);
+                const auto &extent = image->getExtent();
+                auto levels = generateMipChainRgba8(static_cast<uint8_t *>(data_ptr),
+                                                    extent.width, extent.height, true);
+                for (uint32_t i = 0; i < levels.size(); ++i)
+                    scheduler.uploadImage(image, levels[i].data(), i + 1);
+            });
+    }
+
     std::shared_ptr<ImageView> createImageView(const float * img_data, uint32_t width, uint32_t height, uint32_t channel,
         const std::shared_ptr<CommandBuffer> &cmd_buf)
     {
@@ -57,23 +103,50 @@ namespace vk_engine
         auto image = std::make_shared<Image>(
             driver, 0, VK_FORMAT_R32G32B32A32_SFLOAT, extent, VK_SAMPLE_COUNT_1_BIT,
             VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
-        void * data_ptr = const_cast<float*>(img_data);
-        image->updateByStaging(data_ptr, getDefaultAppContext().stage_pool, cmd_buf);
-        VkImageSubresourceRange range = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        };
-        image->transitionLayout(cmd_buf->getHandle(), range,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        UploadBatch batch(getDefaultAppContext().stage_pool);
+        batch.addImage(image, img_data);
+        batch.record(cmd_buf);
         auto img_v = std::make_shared<ImageView>(
             image, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R32G32B32A32_SFLOAT,
             VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1, 1);
         return img_v;      
     }
 
+    static std::shared_ptr<Image> createTextureImage(const TextureData &data)
+    {
+        VkExtent3D extent{data.width, data.height, 1};
+        auto image = std::make_shared<Image>(
+            getDefaultAppContext().driver, 0, data.format, extent, VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, static_cast<uint32_t>(data.levels.size()));
+        // material textures, the materials refresh their views after a move
+        image->setRelocatable();
+        return image;
+    }
+
+    std::shared_ptr<ImageView> createImageView(const TextureData &data,
+        const std::shared_ptr<CommandBuffer> &cmd_buf)
+    {
+        auto image = createTextureImage(data);
+        UploadBatch batch(getDefaultAppContext().stage_pool);
+        for (uint32_t i = 0; i < data.levels.size(); ++i)
+            batch.addImage(image, data.levels[i].data(), i);
+        batch.record(cmd_buf);
+        return std::make_shared<ImageView>(
+            image, VK_IMAGE_VIEW_TYPE_2D, data.format,
+            VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, image->getMipLevels(), 1);
+    }
+
+    std::shared_ptr<ImageView> createImageView(const TextureData &data, UploadScheduler &scheduler)
+    {
+        auto image = createTextureImage(data);
+        for (uint32_t i = 0; i < data.levels.size(); ++i)
+            scheduler.uploadImage(image, data.levels[i].data(), i);
+        return std::make_shared<ImageView>(
+            image, VK_IMAGE_VIEW_TYPE_2D, data.format,
+            VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, image->getMipLevels(), 1);
+    }
+
     template <>
     std::shared_ptr<ImageView> load(const std::string &path, const std::shared_ptr<CommandBuffer> &cmd_buf) {
         int width = 0;
@@ -104,21 +177,481 @@ namespace vk_engine
         return ret;
     } 
 
-    void GPUAssetManager::gc()
+    template <>
+    AssetHandle<ImageView> GPUAssetManager::requestAsync<ImageView>(const std::string &path)
     {
-        if(++current_frame_ < ASSET_TIME_BEFORE_EVICTION) return;
-        for(auto itr = assets_.begin(); itr != assets_.end();)
+        return AssetHandle<ImageView>(enqueueAsync(path, AssetClass::IMAGE, [&path]() -> DecodeFunc {
+            return [path]() -> UploadFunc {
+                int width = 0;
+                int height = 0;
+                int channel = 0;
+                stbi_uc *img_data = stbi_load(path.c_str(), &width, &height, &channel, 0);
+                if (img_data == nullptr) {
+                    LOGW("failed to load image: {}", path);
+                    return nullptr;
+                }
+                std::shared_ptr<stbi_uc> pixels(img_data, stbi_image_free);
+                return [pixels, width, height, channel](UploadScheduler &scheduler) {
+                    return createImageView(pixels.get(), width, height, channel, scheduler);
+                };
+            };
+        }));
+    }
+
+    std::string GPUAssetManager::textureKey(const std::string &key, const uint8_t *data, const size_t size,
+        TextureUsage usage)
+    {
+        // embedded texture names are only unique in a scene, use the content hash.
+        // the same file may be sampled as color and as data
+        return ((data != nullptr) ? contentKey(data, size) : key) +
+            "#" + std::to_string(static_cast<uint32_t>(usage));
+    }
+
+    std::shared_ptr<ImageView> GPUAssetManager::requestTexture(const std::string &key, const uint8_t *data,
+        const size_t size, TextureUsage usage, const std::shared_ptr<CommandBuffer> &cmd_buf)
+    {
+        return std::static_pointer_cast<ImageView>(requestSync(textureKey(key, data, size, usage),
+            AssetClass::TEXTURE, [&]() {
+                const bool compress = bcTexturesSupported(getDefaultAppContext().driver->getPhysicalDevice());
+                TextureData texture;
+                const bool loaded = (data != nullptr)
+                    ? loadTextureData(data, size, usage, compress, texture)
+                    : loadTextureData(key, usage, compress, texture);
+                if (!loaded)
+                    throw std::runtime_error("failed to load texture: " + key);
+                auto ret = createImageView(texture, cmd_buf);
+                return std::make_pair(std::shared_ptr<void>(ret), assetBytes(*ret));
+            }));
+    }
+
+    AssetHandle<ImageView> GPUAssetManager::requestTextureAsync(const std::string &key, const uint8_t *data,
+        const size_t size, TextureUsage usage)
+    {
+        return AssetHandle<ImageView>(enqueueAsync(textureKey(key, data, size, usage), AssetClass::TEXTURE,
+            [&]() -> DecodeFunc {
+                // the caller's data may be gone when decoded
+                std::shared_ptr<std::vector<uint8_t>> bytes;
+                if (data != nullptr) bytes = std::make_shared<std::vector<uint8_t>>(data, data + size);
+                return [key, bytes, usage]() -> UploadFunc {
+                    const bool compress = bcTexturesSupported(getDefaultAppContext().driver->getPhysicalDevice());
+                    auto texture = std::make_shared<TextureData>();
+                    const bool loaded = (bytes != nullptr)
+                        ? loadTextureData(bytes->data(), bytes->size(), usage, compress, *texture)
+                        : loadTextureData(key, usage, compress, *texture);
+                    if (!loaded) {
+                        LOGW("failed to load texture: {}", key);
+                        return nullptr;
+                    }
+                    return [texture](UploadScheduler &scheduler) { return createImageView(*texture, scheduler); };
+                };
+            }));
+    }
+
+    std::string GPUAssetManager::contentKey(const void *data, const size_t size)
+    {
+        // two seeds give a 128 bit key, the size guards the rest
+        char key[64];
+        snprintf(key, sizeof(key), "mem:%016llx%016llx:%zu",
+                 static_cast<unsigned long long>(hash64(data, size)),
+                 static_cast<unsigned long long>(hash64(data, size, 0x9E3779B97F4A7C15ull)), size);
+        return key;
+    }
+
+    template <> size_t assetBytes(const ImageView &asset)
+    {
+        const auto &image = asset.getImage();
+        return image != nullptr ? image->getMemorySize() : 0;
+    }
+
+    GPUAssetManager::GPUAssetManager()
+    {
+        budgets_[static_cast<uint32_t>(AssetClass::TEXTURE)] = DEFAULT_TEXTURE_BUDGET;
+        budgets_[static_cast<uint32_t>(AssetClass::IMAGE)] = DEFAULT_IMAGE_BUDGET;
+    }
+
+    GPUAssetManager::~GPUAssetManager()
+    {
+        {
+            std::lock_guard<std::mutex> lk(jobs_mtx_);
+            stop_ = true;
+        }
+        jobs_cv_.notify_all();
+        for (auto &w : workers_) w.join();
+    }
+
+    GPUAssetManager::Shard &GPUAssetManager::shardOf(const std::string &key)
+    {
+        return shards_[std::hash<std::string>{}(key) % SHARD_COUNT];
+    }
+
+    std::shared_ptr<void> GPUAssetManager::requestSync(const std::string &key, AssetClass asset_class,
+        const LoadFunc &load)
+    {
+        auto &shard = shardOf(key);
+        std::shared_future<std::shared_ptr<void>> loading;
+        std::shared_ptr<std::promise<std::shared_ptr<void>>> promise;
         {
-            auto & a = itr->second;
-            if(a.data_ptr.use_count() == 1 && a.last_accessed + ASSET_TIME_BEFORE_EVICTION <= current_frame_)
+            std::lock_guard<std::mutex> lk(shard.mtx);
+            auto cached = findAsset(shard, key);
+            if (cached != nullptr) return cached;
+            auto itr = shard.pending.find(key);
+            if (itr != shard.pending.end() && !itr->second.async) {
+                loading = itr->second.future;
+                ++shard.stats.hits;
+            } else {
+                ++shard.stats.misses;
+                // an async request is resolved on render thread, which may be this one, a private copy is loaded
+                if (itr == shard.pending.end()) {
+                    promise = std::make_shared<std::promise<std::shared_ptr<void>>>();
+                    shard.pending.emplace(key, PendingAsset{promise, promise->get_future().share(), false});
+                }
+            }
+        }
+        // rethrow if the loading thread failed
+        if (loading.valid()) return loading.get();
+
+        std::pair<std::shared_ptr<void>, size_t> ret;
+        try {
+            ret = load();
+        } catch (...) {
+            if (promise != nullptr) {
+                {
+                    std::lock_guard<std::mutex> lk(shard.mtx);
+                    shard.pending.erase(key);
+                }
+                promise->set_exception(std::current_exception());
+            }
+            throw;
+        }
+        if (promise != nullptr) {
             {
-                itr = assets_.erase(itr);
-            } else ++itr;
+                std::lock_guard<std::mutex> lk(shard.mtx);
+                shard.pending.erase(key);
+                addAsset(shard, key, ret.first, ret.second, asset_class);
+            }
+            promise->set_value(ret.first);
         }
+        return ret.first;
+    }
+
+    std::shared_future<std::shared_ptr<void>> GPUAssetManager::enqueueAsync(const std::string &key,
+        AssetClass asset_class, const std::function<DecodeFunc()> &prepare)
+    {
+        auto &shard = shardOf(key);
+        DecodeFunc decode;
+        std::shared_future<std::shared_ptr<void>> future;
+        {
+            std::lock_guard<std::mutex> lk(shard.mtx);
+            auto cached = findAsset(shard, key);
+            if (cached != nullptr) {
+                std::promise<std::shared_ptr<void>> resident;
+                resident.set_value(cached);
+                return resident.get_future().share();
+            }
+            auto itr = shard.pending.find(key);
+            if (itr != shard.pending.end()) {
+                ++shard.stats.hits;
+                return itr->second.future;
+            }
+            ++shard.stats.misses;
+            auto promise = std::make_shared<std::promise<std::shared_ptr<void>>>();
+            future = promise->get_future().share();
+            shard.pending.emplace(key, PendingAsset{promise, future, true});
+            decode = prepare();
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(jobs_mtx_);
+            if (workers_.empty()) {
+                const uint32_t count = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_DECODE_THREADS);
+                for (uint32_t i = 0; i < count; ++i)
+                    workers_.emplace_back(&GPUAssetManager::workerLoop, this);
+            }
+            jobs_.emplace_back([this, key, asset_class, decode]() {
+                UploadFunc upload;
+                try {
+                    upload = decode();
+                } catch (const std::exception &e) {
+                    LOGW("failed to decode asset {}: {}", key, e.what());
+                }
+                std::lock_guard<std::mutex> lk(decoded_mtx_);
+                decoded_.push_back(DecodedAsset{key, asset_class, std::move(upload)});
+            });
+        }
+        jobs_cv_.notify_one();
+        return future;
+    }
+
+    void GPUAssetManager::workerLoop()
+    {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lk(jobs_mtx_);
+                jobs_cv_.wait(lk, [this]() { return stop_ || !jobs_.empty(); });
+                if (stop_) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    void GPUAssetManager::resolve(const std::string &key, AssetClass asset_class,
+        const std::shared_ptr<ImageView> &img_view)
+    {
+        auto &shard = shardOf(key);
+        std::shared_ptr<std::promise<std::shared_ptr<void>>> promise;
+        {
+            std::lock_guard<std::mutex> lk(shard.mtx);
+            auto itr = shard.pending.find(key);
+            if (itr == shard.pending.end()) return; // reset meanwhile
+            promise = itr->second.promise;
+            shard.pending.erase(itr);
+            if (img_view != nullptr)
+                addAsset(shard, key, img_view, assetBytes(*img_view), asset_class);
+        }
+        promise->set_value(img_view);
+    }
+
+    std::shared_ptr<void> GPUAssetManager::findAsset(Shard &shard, const std::string &key)
+    {
+        auto itr = shard.assets.find(key);
+        if (itr == shard.assets.end()) return nullptr;
+        auto &a = itr->second;
+        a.last_accessed = current_frame_;
+        shard.lru.splice(shard.lru.begin(), shard.lru, a.lru);
+        ++shard.stats.hits;
+        return a.data_ptr;
+    }
+
+    void GPUAssetManager::addAsset(Shard &shard, const std::string &key, const std::shared_ptr<void> &data_ptr,
+        size_t bytes, AssetClass asset_class)
+    {
+        auto [itr, inserted] = shard.assets.emplace(key, Asset{data_ptr, current_frame_, bytes, asset_class});
+        if (!inserted) return;
+        shard.lru.push_front(&itr->first);
+        itr->second.lru = shard.lru.begin();
+        shard.stats.resident_bytes[static_cast<uint32_t>(asset_class)] += bytes;
+    }
+
+    void GPUAssetManager::evict(Shard &shard, std::map<std::string, Asset>::iterator itr)
+    {
+        auto &a = itr->second;
+        shard.stats.resident_bytes[static_cast<uint32_t>(a.asset_class)] -= a.bytes;
+        ++shard.stats.evictions;
+        {
+            std::lock_guard<std::mutex> lk(retired_mtx_);
+            retired_.emplace_back(a.data_ptr, getDefaultAppContext().timeline->pending());
+        }
+        shard.lru.erase(a.lru);
+        shard.assets.erase(itr);
+    }
+
+    bool GPUAssetManager::downgrade(Shard &shard, Asset &asset, const std::shared_ptr<CommandBuffer> &cmd_buf)
+    {
+        auto src_view = std::static_pointer_cast<ImageView>(asset.data_ptr);
+        const auto &src = src_view->getImage();
+        // not acquired from the transfer queue yet, or nothing to drop
+        if (src == nullptr || src->getLayout() != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ||
+            src->getMipLevels() <= 1)
+            return false;
+        const auto &extent = src->getExtent();
+        if (std::max(extent.width, extent.height) <= MIN_DOWNGRADE_EXTENT) return false;
+
+        // the new image is the old mip chain without level 0
+        const uint32_t levels = src->getMipLevels() - 1;
+        VkExtent3D dst_extent{std::max(extent.width >> 1, 1u), std::max(extent.height >> 1, 1u), 1};
+        auto dst = std::make_shared<Image>(
+            src->getDriver(), 0, src->getFormat(), dst_extent, VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, levels);
+
+        // the source waits for the sampling of the frames in flight, one barrier call for both
+        auto cmd_buf_handle = cmd_buf->getHandle();
+        const VkImageSubresourceRange src_range{VK_IMAGE_ASPECT_COLOR_BIT, 1, levels, 0, 1};
+        BarrierBatcher barriers;
+        barriers.transition(*src, src_range, imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+        barriers.transition(*dst, imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+        barriers.flush(cmd_buf_handle);
+
+        std::vector<VkImageCopy> regions(levels);
+        for (uint32_t i = 0; i < levels; ++i) {
+            regions[i] = VkImageCopy{
+                .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i + 1, 0, 1},
+                .srcOffset = {0, 0, 0},
+                .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1},
+                .dstOffset = {0, 0, 0},
+                .extent = {std::max(extent.width >> (i + 1), 1u), std::max(extent.height >> (i + 1), 1u), 1}};
+        }
+        vkCmdCopyImage(cmd_buf_handle, src->getHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       dst->getHandle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levels, regions.data());
+
+        // the old image is still sampled until the materials switched
+        const auto sampled = imageAccessFor(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        barriers.transition(*src, src_range, sampled);
+        barriers.transition(*dst, sampled);
+        barriers.flush(cmd_buf_handle);
+
+        auto dst_view = std::make_shared<ImageView>(
+            dst, VK_IMAGE_VIEW_TYPE_2D, dst->getFormat(),
+            VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, levels, 1);
+        {
+            std::lock_guard<std::mutex> lk(retired_mtx_);
+            replaced_[src_view.get()] = std::make_pair(std::weak_ptr<ImageView>(src_view), dst_view);
+            retired_.emplace_back(src_view, getDefaultAppContext().timeline->pending());
+        }
+
+        const size_t bytes = assetBytes(*dst_view);
+        shard.stats.resident_bytes[static_cast<uint32_t>(asset.asset_class)] += bytes;
+        shard.stats.resident_bytes[static_cast<uint32_t>(asset.asset_class)] -= asset.bytes;
+        asset.bytes = bytes;
+        asset.data_ptr = dst_view;
+        ++shard.stats.downgrades;
+        ++version_;
+        return true;
+    }
+
+    std::shared_ptr<ImageView> GPUAssetManager::latest(const std::shared_ptr<ImageView> &img_view) const
+    {
+        std::lock_guard<std::mutex> lk(retired_mtx_);
+        auto ret = img_view;
+        // an expired entry is a freed view at a reused address
+        for (auto itr = replaced_.find(ret.get());
+             itr != replaced_.end() && !itr->second.first.expired();
+             itr = replaced_.find(ret.get()))
+            ret = itr->second.second;
+        return ret;
+    }
+
+    void GPUAssetManager::gc(const std::shared_ptr<CommandBuffer> &cmd_buf)
+    {
+        ++current_frame_;
+        {
+            const auto &timeline = getDefaultAppContext().timeline;
+            const uint64_t completed = timeline->completed();
+            const uint64_t pending = timeline->pending();
+            std::lock_guard<std::mutex> lk(retired_mtx_);
+            for (auto itr = retired_.begin(); itr != retired_.end();) {
+                // a material not switched to the replacement yet may record it until it does,
+                // so it is kept until the timeline passes the last frame that referenced it
+                if (itr->first.use_count() > 1) {
+                    itr->second = pending;
+                    ++itr;
+                } else if (itr->second <= completed) {
+                    itr = retired_.erase(itr);
+                } else {
+                    ++itr;
+                }
+            }
+            for (auto itr = replaced_.begin(); itr != replaced_.end();) {
+                if (itr->second.first.expired()) itr = replaced_.erase(itr);
+                else ++itr;
+            }
+        }
+
+        // decoded async requests are resident once acquired
+        std::deque<DecodedAsset> decoded;
+        {
+            std::lock_guard<std::mutex> lk(decoded_mtx_);
+            decoded.swap(decoded_);
+        }
+        auto &scheduler = *getDefaultAppContext().upload_scheduler;
+        for (auto &d : decoded) {
+            auto img_view = (d.upload != nullptr) ? d.upload(scheduler) : nullptr;
+            if (img_view == nullptr) {
+                resolve(d.key, d.asset_class, nullptr);
+                continue;
+            }
+            scheduler.onAcquired([this, key = std::move(d.key), asset_class = d.asset_class, img_view]() {
+                resolve(key, asset_class, img_view);
+            });
+        }
+
+        size_t resident[static_cast<uint32_t>(AssetClass::COUNT)] = {};
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lk(shard.mtx);
+            for (uint32_t c = 0; c < static_cast<uint32_t>(AssetClass::COUNT); ++c)
+                resident[c] += shard.stats.resident_bytes[c];
+        }
+
+        // the lru order is kept per shard, the first shard rotates to spread the evictions
+        gc_shard_ = (gc_shard_ + 1) % SHARD_COUNT;
+        for (uint32_t c = 0; c < static_cast<uint32_t>(AssetClass::COUNT); ++c) {
+            const auto asset_class = static_cast<AssetClass>(c);
+            const size_t budget = budgets_[c];
+            // unreferenced assets first, least recently used first
+            for (uint32_t i = 0; i < SHARD_COUNT && resident[c] > budget; ++i) {
+                auto &shard = shards_[(gc_shard_ + i) % SHARD_COUNT];
+                std::lock_guard<std::mutex> lk(shard.mtx);
+                for (auto itr = shard.lru.end(); itr != shard.lru.begin() && resident[c] > budget;) {
+                    auto cur = std::prev(itr);
+                    auto asset_itr = shard.assets.find(**cur);
+                    const auto &a = asset_itr->second;
+                    if (a.asset_class == asset_class && a.data_ptr.use_count() == 1) {
+                        resident[c] -= a.bytes;
+                        evict(shard, asset_itr);
+                    } else
+                        itr = cur;
+                }
+            }
+
+            if (asset_class != AssetClass::TEXTURE || cmd_buf == nullptr) continue;
+            uint32_t downgrades = 0;
+            for (uint32_t i = 0; i < SHARD_COUNT && resident[c] > budget && downgrades < MAX_DOWNGRADES_PER_FRAME; ++i) {
+                auto &shard = shards_[(gc_shard_ + i) % SHARD_COUNT];
+                std::lock_guard<std::mutex> lk(shard.mtx);
+                for (auto itr = shard.lru.rbegin(); itr != shard.lru.rend() && resident[c] > budget &&
+                                                    downgrades < MAX_DOWNGRADES_PER_FRAME; ++itr) {
+                    auto &asset = shard.assets.find(**itr)->second;
+                    const size_t bytes = asset.bytes;
+                    if (asset.asset_class == asset_class && downgrade(shard, asset, cmd_buf)) {
+                        resident[c] -= bytes - asset.bytes;
+                        ++downgrades;
+                    }
+                }
+            }
+        }
+    }
+
+    AssetStats GPUAssetManager::stats() const
+    {
+        AssetStats ret;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lk(shard.mtx);
+            for (uint32_t c = 0; c < static_cast<uint32_t>(AssetClass::COUNT); ++c)
+                ret.resident_bytes[c] += shard.stats.resident_bytes[c];
+            ret.hits += shard.stats.hits;
+            ret.misses += shard.stats.misses;
+            ret.evictions += shard.stats.evictions;
+            ret.downgrades += shard.stats.downgrades;
+        }
+        return ret;
     }
 
     void GPUAssetManager::reset()
-    {        
-        assets_.clear();
+    {
+        // async promises are only held here, destroying them would break their handles.
+        // a synchronous request's promise is held and set by its loading thread
+        std::vector<std::shared_ptr<std::promise<std::shared_ptr<void>>>> dropped;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lk(shard.mtx);
+            shard.assets.clear();
+            shard.lru.clear();
+            for (auto &[key, pending] : shard.pending) {
+                if (pending.async) dropped.emplace_back(pending.promise);
+            }
+            shard.pending.clear();
+            for (auto &bytes : shard.stats.resident_bytes) bytes = 0;
+        }
+        for (auto &promise : dropped)
+            promise->set_value(nullptr);
+        {
+            std::lock_guard<std::mutex> lk(decoded_mtx_);
+            decoded_.clear();
+        }
+        std::lock_guard<std::mutex> lk(retired_mtx_);
+        replaced_.clear();
+        retired_.clear();
     }
-}
\ No newline at end of file
+}
@@ -1,19 +1,60 @@
 #pragma once
 
 #include <stdexcept>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
+#include <list>
 #include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace vk_engine {
 
 class ImageView; // in visualstudio stract and class use different namemangling rules 
 class CommandBuffer;
+class UploadScheduler;
+struct TextureData;
+enum class TextureUsage : uint32_t;
+
+/**
+ * \brief asset classes have their own memory budget, material textures can be downgraded under pressure
+ */
+enum class AssetClass : uint32_t {
+  TEXTURE = 0, //!< material textures, with full mip chain
+  IMAGE = 1,   //!< other images, decoded data or lookup tables
+  COUNT
+};
 
 struct Asset {
   std::shared_ptr<void> data_ptr;
   mutable uint64_t last_accessed;
+  size_t bytes{0}; //!< device memory held by the asset
+  AssetClass asset_class{AssetClass::IMAGE};
+  std::list<const std::string *>::iterator lru; //!< position in the lru list
 };
 
+struct AssetStats {
+  size_t resident_bytes[static_cast<uint32_t>(AssetClass::COUNT)]{};
+  uint64_t hits{0};
+  uint64_t misses{0};
+  uint64_t evictions{0};
+  uint64_t downgrades{0}; //!< textures reduced to lower mips
+};
+
+/**
+ * \brief device memory held by an asset, for the budget
+ */
+template <typename T> size_t assetBytes(const T &asset) { return 0; }
+
+template <> size_t assetBytes(const ImageView &asset);
+
 template <typename T> std::shared_ptr<T> load(const std::string &path, const std::shared_ptr<CommandBuffer> &cmd_buf) {
   throw std::logic_error("load type unsupported!");
 }
@@ -34,44 +75,245 @@ template <> std::shared_ptr<ImageView> load(const uint8_t *data, const size_t si
 template <> std::shared_ptr<ImageView> load(const float *data, const uint32_t width, const uint32_t height, const uint32_t channel,
   const std::shared_ptr<CommandBuffer> &cmd_buf);
 
+/**
+ * \brief create a sampled rgba8 srgb image with full mip chain from decoded rgb/rgba pixels,
+ * mips are blit on gpu if the format supports, otherwise filtered on cpu
+ */
+std::shared_ptr<ImageView> createImageView(void *img_data, uint32_t width, uint32_t height, uint32_t channel,
+  const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+/**
+ * \brief same as above, uploaded on transfer queue(cpu filtered mips, transfer queue can't blit),
+ * usable after the scheduler acquired it
+ */
+std::shared_ptr<ImageView> createImageView(void *img_data, uint32_t width, uint32_t height, uint32_t channel,
+  UploadScheduler &scheduler);
+
+/**
+ * \brief create a sampled image from the prepared mip chain(block compressed or rgba8),
+ * all levels are uploaded and transitioned to shader read only
+ */
+std::shared_ptr<ImageView> createImageView(const TextureData &data,
+  const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+/**
+ * \brief same as above, uploaded on transfer queue, usable after the scheduler acquired it
+ */
+std::shared_ptr<ImageView> createImageView(const TextureData &data, UploadScheduler &scheduler);
+
+/**
+ * \brief handle of an asynchronously requested asset, resident once the upload is acquired by the graphics queue
+ */
+template <typename T> class AssetHandle final {
+public:
+  AssetHandle() = default;
+
+  explicit AssetHandle(const std::shared_future<std::shared_ptr<void>> &future) : future_(future) {}
+
+  bool resident() const {
+    return future_.valid() && future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+      future_.get() != nullptr;
+  }
+
+  /**
+   * \brief true once the request finished, get() is nullptr if it failed
+   */
+  bool finished() const {
+    return future_.valid() && future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  /**
+   * \brief the asset, nullptr until resident
+   */
+  std::shared_ptr<T> get() const { return finished() ? std::static_pointer_cast<T>(future_.get()) : nullptr; }
+
+private:
+  std::shared_future<std::shared_ptr<void>> future_;
+};
+
 /**
  * \brief GPUAssertManager is used to manage the GPU assert.
  * The assert is load from file, and will not change.
+ *
+ * Thread safe, the assets are sharded by key with a lock per shard. Concurrent requests of
+ * an asset being loaded wait for the same load. Synchronous requests record on the caller's
+ * command buffer, asynchronous requests are decoded on worker threads and uploaded through
+ * the UploadScheduler in gc().
  */
 class GPUAssetManager final {
 public:
-  GPUAssetManager() = default;
+  GPUAssetManager();
+
+  ~GPUAssetManager();
 
-  ~GPUAssetManager() = default;
+  GPUAssetManager(const GPUAssetManager &) = delete;
+  GPUAssetManager &operator=(const GPUAssetManager &) = delete;
 
   template <typename T> [[nondiscard]] std::shared_ptr<T> request(const std::string &path, const std::shared_ptr<CommandBuffer> &cmd_buf) {
-    auto itr = assets_.find(path);
-    if (itr != assets_.end()) {
-      return std::static_pointer_cast<T>(itr->second.data_ptr);
-    }
-
-    auto ret = load<T>(path, cmd_buf);
-    assets_.emplace(path, Asset{ret, current_frame_});
-    return ret;
+    return std::static_pointer_cast<T>(requestSync(path, AssetClass::IMAGE, [&]() {
+      auto ret = load<T>(path, cmd_buf);
+      return std::make_pair(std::shared_ptr<void>(ret), assetBytes(*ret));
+    }));
   }
 
+  /**
+   * \brief in memory(embedded) asset, cached by the content hash of the encoded data,
+   * the same data referenced by many materials is decoded and uploaded once
+   */
   template <typename T> [[nondiscard]] std::shared_ptr<T> request(const uint8_t *data, const size_t size, const std::shared_ptr<CommandBuffer> &cmd_buf) {
-    auto ret = load<T>(data, size, cmd_buf);
-    return ret;
+    return std::static_pointer_cast<T>(requestSync(contentKey(data, size), AssetClass::IMAGE, [&]() {
+      auto ret = load<T>(data, size, cmd_buf);
+      return std::make_pair(std::shared_ptr<void>(ret), assetBytes(*ret));
+    }));
   }
 
   template <typename T> std::shared_ptr<T> request(const float *data,
     const uint32_t width, const uint32_t height, const uint32_t channel, const std::shared_ptr<CommandBuffer> &cmd_buf) {
+    // same pixels with another shape is another image
+    const std::string key = contentKey(data, sizeof(float) * width * height * channel) + "#" +
+      std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(channel);
+    return std::static_pointer_cast<T>(requestSync(key, AssetClass::IMAGE, [&]() {
       auto ret = load<T>(data, width, height, channel, cmd_buf);
-      return ret;
+      return std::make_pair(std::shared_ptr<void>(ret), assetBytes(*ret));
+    }));
   }
 
-  void gc();
+  /**
+   * \brief request the asset from file without blocking, decoded on a worker thread
+   */
+  template <typename T> AssetHandle<T> requestAsync(const std::string &path) {
+    throw std::logic_error("async request type unsupported!");
+  }
+
+  /**
+   * \brief material texture from file path(data is nullptr) or encoded file data, cached by path(or content) and usage.
+   * block compressed by usage if the device supports it.
+   */
+  std::shared_ptr<ImageView> requestTexture(const std::string &key, const uint8_t *data, const size_t size,
+    TextureUsage usage, const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+  /**
+   * \brief same as above without blocking, data is copied
+   */
+  AssetHandle<ImageView> requestTextureAsync(const std::string &key, const uint8_t *data, const size_t size,
+    TextureUsage usage);
+
+  /**
+   * \brief device memory budget of the asset class in bytes
+   */
+  void setBudget(AssetClass asset_class, size_t bytes) { budgets_[static_cast<uint32_t>(asset_class)] = bytes; }
 
+  /**
+   * \brief called once per frame on the render thread. the decoded async requests are uploaded.
+   * over budget classes evict the least recently used unreferenced assets first, then referenced
+   * textures are downgraded to lower mips, copied on cmd_buf.
+   * released assets are kept until the device timeline passes the submits that may use them
+   */
+  void gc(const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+  /**
+   * \brief bumped when a texture is replaced by its downgraded version
+   */
+  uint64_t version() const { return version_; }
+
+  /**
+   * \brief the current version of a (possibly downgraded) texture
+   */
+  std::shared_ptr<ImageView> latest(const std::shared_ptr<ImageView> &img_view) const;
+
+  AssetStats stats() const;
+
+  /**
+   * \brief drop all assets. pending async requests finish with a null asset, their handles
+   * report finished() with get() == nullptr as for a failed request. synchronous loads in
+   * progress still complete for their callers
+   */
   void reset();
 
 private:
-  std::map<std::string, Asset> assets_;
-  uint64_t current_frame_{0};
+  using LoadFunc = std::function<std::pair<std::shared_ptr<void>, size_t>()>;
+  //! decode on worker thread, return the upload to record on render thread(nullptr if failed)
+  using UploadFunc = std::function<std::shared_ptr<ImageView>(UploadScheduler &)>;
+  using DecodeFunc = std::function<UploadFunc()>;
+
+  struct PendingAsset {
+    std::shared_ptr<std::promise<std::shared_ptr<void>>> promise;
+    std::shared_future<std::shared_ptr<void>> future;
+    bool async; //!< resolved on render thread, synchronous requests don't wait for it
+  };
+
+  struct Shard {
+    mutable std::mutex mtx;
+    std::map<std::string, Asset> assets;
+    std::list<const std::string *> lru; //!< keys of assets, most recently used first
+    std::map<std::string, PendingAsset> pending;
+    AssetStats stats;
+  };
+
+  struct DecodedAsset {
+    std::string key;
+    AssetClass asset_class;
+    UploadFunc upload;
+  };
+
+  /**
+   * \brief cache key of in memory data, can't collide with a file path
+   */
+  static std::string contentKey(const void *data, const size_t size);
+
+  static std::string textureKey(const std::string &key, const uint8_t *data, const size_t size, TextureUsage usage);
+
+  Shard &shardOf(const std::string &key);
+
+  std::shared_ptr<void> requestSync(const std::string &key, AssetClass asset_class, const LoadFunc &load);
+
+  /**
+   * \brief prepare is called on a miss, on the calling thread, to capture the inputs of the decode
+   */
+  std::shared_future<std::shared_ptr<void>> enqueueAsync(const std::string &key, AssetClass asset_class,
+    const std::function<DecodeFunc()> &prepare);
+
+  /**
+   * \brief async request finished, on render thread
+   */
+  void resolve(const std::string &key, AssetClass asset_class, const std::shared_ptr<ImageView> &img_view);
+
+  // shard locked
+  std::shared_ptr<void> findAsset(Shard &shard, const std::string &key);
+
+  void addAsset(Shard &shard, const std::string &key, const std::shared_ptr<void> &data_ptr, size_t bytes,
+    AssetClass asset_class);
+
+  void evict(Shard &shard, std::map<std::string, Asset>::iterator itr);
+
+  bool downgrade(Shard &shard, Asset &asset, const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+  void workerLoop();
+
+  static constexpr uint32_t SHARD_COUNT = 16;
+  Shard shards_[SHARD_COUNT];
+  uint32_t gc_shard_{0}; //!< first shard to evict from, rotated per frame
+  std::atomic<size_t> budgets_[static_cast<uint32_t>(AssetClass::COUNT)];
+
+  mutable std::mutex retired_mtx_; //!< guard replaced_ and retired_, locked after a shard
+  //! downgraded views to their replacement, until no material holds them
+  std::map<const ImageView *, std::pair<std::weak_ptr<ImageView>, std::shared_ptr<ImageView>>> replaced_;
+  //! released assets and the device timeline value of their last possible use. an asset still
+  //! held by a material, e.g. a downgraded full resolution view, is re-tagged every frame
+  std::list<std::pair<std::shared_ptr<void>, uint64_t>> retired_;
+
+  std::mutex jobs_mtx_;
+  std::condition_variable jobs_cv_;
+  std::deque<std::function<void()>> jobs_;
+  std::vector<std::thread> workers_; //!< started on the first async request
+  bool stop_{false};
+
+  std::mutex decoded_mtx_;
+  std::deque<DecodedAsset> decoded_;
+
+  std::atomic<uint64_t> version_{0};
+  std::atomic<uint64_t> current_frame_{0};
 };
-} // namespace vk_engine
\ No newline at end of file
+
+template <> AssetHandle<ImageView> GPUAssetManager::requestAsync<ImageView>(const std::string &path);
+} // namespace vk_engine
@@ -5,8 +5,16 @@
 #include <stbi/stb_image.h>
 
 #include <framework/utils/base/logging.h>
+#include <framework/utils/base/mesh_optimizer.h>
+#include <framework/utils/base/parallel.h>
 #include <framework/utils/vk/commands.h>
+#include <framework/utils/vk/geometry_arena.h>
+#include <framework/utils/vk/upload_batch.h>
+#include <framework/utils/vk/upload_scheduler.h>
 #include <framework/resources/asset_manager.hpp>
+#include <framework/resources/mesh_cache.h>
+#include <framework/resources/texture_compressor.h>
+#include <framework/resources/vertex_quantizer.h>
 #include <framework/functional/component/camera.h>
 #include <framework/functional/component/material_pbr.h>
 
@@ -15,9 +23,7 @@ namespace vk_engine {
 
 std::shared_ptr<TransformRelationship>
 AssimpLoader::processNode(const std::shared_ptr<TransformRelationship> &parent,
-                          aiNode *node, const aiScene *a_scene, Scene &scene,
-                          std::vector<std::shared_ptr<StaticMesh>> &meshes,
-                          std::vector<std::shared_ptr<Material>> &materials) {
+                          aiNode *node, const aiScene *a_scene, SceneDesc &desc) {
   auto cur_tr = std::make_shared<TransformRelationship>();
   cur_tr->parent = parent;
   memcpy(cur_tr->ltransform.data(), &node->mTransformation,
@@ -27,55 +33,43 @@ AssimpLoader::processNode(const std::shared_ptr<TransformRelationship> &parent,
   // process all the node's meshes (if any)
   for (uint32_t i = 0; i < node->mNumMeshes; ++i) {
     aiMesh *a_mesh = a_scene->mMeshes[node->mMeshes[i]];
-    assert(materials.size() > a_mesh->mMaterialIndex);
-    assert(meshes.size() > node->mMeshes[i]);
-    auto renderable_entt = scene.createRenderableEntity(
-        a_mesh->mName.C_Str(), cur_tr, materials[a_mesh->mMaterialIndex],
-        meshes[node->mMeshes[i]]);
-    cur_tr->aabb.extend(meshes[node->mMeshes[i]]->aabb);
+    assert(desc.materials.size() > a_mesh->mMaterialIndex);
+    assert(desc.mesh_count > node->mMeshes[i]);
+    desc.renderables.emplace_back(RenderableDesc{a_mesh->mName.C_Str(), cur_tr,
+                                                 node->mMeshes[i],
+                                                 a_mesh->mMaterialIndex});
+    cur_tr->aabb.extend(Eigen::AlignedBox3f(
+        Eigen::Vector3f(a_mesh->mAABB.mMin.x, a_mesh->mAABB.mMin.y,
+                        a_mesh->mAABB.mMin.z),
+        Eigen::Vector3f(a_mesh->mAABB.mMax.x, a_mesh->mAABB.mMax.y,
+                        a_mesh->mAABB.mMax.z)));
   }
   return cur_tr;
 }
 
-void AssimpLoader::loadScene(const std::string &path, Scene &scene,
-                             const std::shared_ptr<CommandBuffer> &cmd_buf) {
-  Assimp::Importer importer;
-  const aiScene *a_scene =
-      importer.ReadFile(path, aiProcessPreset_TargetRealtime_Quality |
-                                  aiProcess_GenBoundingBoxes);
-
-  std::size_t found = path.find_last_of("/\\");
-  std::string dir = (found == std::string::npos) ? "./" : path.substr(0, found+1);
-
-  if (!a_scene) {
-    throw std::runtime_error("Assimp import error:" +
-                             std::string(importer.GetErrorString()));
-  }
-  // file_directory_ = path.substr(0, path.find_last_of('/'));
-  //  add materials and meshes to scene
-  std::vector<std::shared_ptr<StaticMesh>> meshes =
-      processMeshs(a_scene, cmd_buf);
-  std::vector<std::shared_ptr<Material>> materials =
-      processMaterials(a_scene, dir, cmd_buf);
-  std::vector<Camera> cameras = processCameras(a_scene);
-  auto lights = processLight(a_scene);
+void AssimpLoader::buildSceneDesc(const aiScene *a_scene, const std::string &dir,
+                                  SceneDesc &desc) {
+  desc.mesh_count = a_scene->mNumMeshes;
+  desc.materials.resize(a_scene->mNumMaterials);
+  for (uint32_t i = 0; i < a_scene->mNumMaterials; ++i)
+    desc.materials[i] = describeMaterial(a_scene, a_scene->mMaterials[i], dir);
+  desc.cameras = processCameras(a_scene);
+  desc.lights = processLight(a_scene);
 
   // process root node's mesh
-  auto root_tr = std::make_shared<TransformRelationship>();
-  scene.setRootTr(root_tr);
-  auto scene_root = processNode(nullptr, a_scene->mRootNode, a_scene, scene,
-                                meshes, materials);
-  root_tr->child = scene_root;
-  scene_root->parent = root_tr;
+  desc.root_tr = std::make_shared<TransformRelationship>();
+  auto scene_root = processNode(nullptr, a_scene->mRootNode, a_scene, desc);
+  desc.root_tr->child = scene_root;
+  scene_root->parent = desc.root_tr;
 
   std::queue<std::pair<std::shared_ptr<TransformRelationship>,
                        aiNode *>> // parent tr, parent node
       process_queue;
   process_queue.push(std::make_pair(scene_root, a_scene->mRootNode));
 
-  auto camera_node_name =
-      cameras.empty() ? "vk_engine_default_main_camera" : cameras[0].getName();
-  auto camera_tr = root_tr;
+  desc.camera_name = desc.cameras.empty() ? "vk_engine_default_main_camera"
+                                          : desc.cameras[0].getName();
+  desc.camera_tr = desc.root_tr;
   //auto light_tr = root_tr;
   while (!process_queue.empty()) {
     auto e = process_queue.front();
@@ -86,12 +80,11 @@ void AssimpLoader::loadScene(const std::string &path, Scene &scene,
     std::shared_ptr<TransformRelationship> pre_tr_re = nullptr;
     for (auto i = 0; i < pnode->mNumChildren; ++i) {
       // process children's mesh
-      auto cur_tr_re = processNode(parent_tr, pnode->mChildren[i], a_scene,
-                                   scene, meshes, materials);
+      auto cur_tr_re = processNode(parent_tr, pnode->mChildren[i], a_scene, desc);
 
-      if (!cameras.empty() &&
-          pnode->mChildren[i]->mName.C_Str() == camera_node_name)
-        camera_tr = cur_tr_re;
+      if (!desc.cameras.empty() &&
+          pnode->mChildren[i]->mName.C_Str() == desc.camera_name)
+        desc.camera_tr = cur_tr_re;
 
       if (i == 0)
         parent_tr->child = cur_tr_re;
@@ -102,111 +95,400 @@ void AssimpLoader::loadScene(const std::string &path, Scene &scene,
       process_queue.push(std::make_pair(cur_tr_re, pnode->mChildren[i]));
     }
   }
+}
 
-  if (cameras.empty()) {
+void AssimpLoader::setupScene(const SceneDesc &desc, Scene &scene) {
+  scene.setRootTr(desc.root_tr);
+  if (desc.cameras.empty()) {
     Camera default_camera;
-    default_camera.setName(camera_node_name);
+    default_camera.setName(desc.camera_name);
     scene.update(0);
-    const auto &scene_aabb = root_tr->aabb;
+    const auto &scene_aabb = desc.root_tr->aabb;
     Eigen::Vector3f center = scene_aabb.center();
     float radius = 0.5f * scene_aabb.sizes().norm();
     Eigen::Vector3f eye = center + Eigen::Vector3f(0, 0, 5.0f * radius);
     default_camera.setLookAt(eye, Eigen::Vector3f(0, 1, 0), center);
     default_camera.setFovy(0.6f);
-    scene.createCameraEntity(camera_node_name, camera_tr, default_camera);
+    scene.createCameraEntity(desc.camera_name, desc.camera_tr, default_camera);
   } else
-    scene.createCameraEntity(camera_node_name, camera_tr, cameras[0]);
+    scene.createCameraEntity(desc.camera_name, desc.camera_tr, desc.cameras[0]);
+
+  scene.createLightEntity("default_light", desc.root_tr, desc.lights.l[0]);
+}
 
-  scene.createLightEntity("default_light", root_tr, lights.l[0]);
+void AssimpLoader::loadScene(const std::string &path, Scene &scene,
+                             const std::shared_ptr<CommandBuffer> &cmd_buf) {
+  SceneDesc desc;
+  std::vector<std::shared_ptr<StaticMesh>> meshes;
+  Assimp::Importer importer; // keep embedded textures alive until uploaded
+  // the meshes are uploaded into the shared arenas with a few multi-region copies
+  UploadBatch batch(getDefaultAppContext().stage_pool);
+  auto cache = MeshCache::open(path, lod_settings_);
+  if (cache != nullptr) {
+    cache->buildSceneDesc(desc);
+    meshes.resize(cache->meshCount());
+    for (uint32_t i = 0; i < meshes.size(); ++i)
+      meshes[i] = createStaticMesh(cache->mesh(i), batch, quantization_);
+  } else {
+    const aiScene *a_scene = importer.ReadFile(path, kImportFlags);
+    if (!a_scene) {
+      throw std::runtime_error("Assimp import error:" +
+                               std::string(importer.GetErrorString()));
+    }
+    buildSceneDesc(a_scene, MeshCache::sourceDir(path), desc);
+
+    std::vector<MeshData> mesh_datas = packMeshes(a_scene, lod_settings_);
+    MeshCache::write(path, lod_settings_, desc, mesh_datas);
+    meshes.resize(mesh_datas.size());
+    for (uint32_t i = 0; i < meshes.size(); ++i)
+      meshes[i] = createStaticMesh(mesh_datas[i], batch, quantization_);
+  }
+  batch.record(cmd_buf);
+
+  //  add materials and meshes to scene
+  std::vector<std::shared_ptr<Material>> materials =
+      processMaterials(desc.materials, cmd_buf);
+  for (const auto &r : desc.renderables)
+    scene.createRenderableEntity(r.name, r.tr, materials[r.material_index],
+                                 meshes[r.mesh_index]);
 
   // load the default camera if have
-  LOGI("load scene: {}", path.c_str());
+  setupScene(desc, scene);
+  LOGI("load scene: {}{}", path.c_str(), cache != nullptr ? " (cached)" : "");
+}
+
+MeshData AssimpLoader::packMesh(const aiMesh *a_mesh) {
+  MeshData ret;
+  // mesh data to static mesh data
+  // vertices data: 3f_pos | 3f_normal | 2f_uv
+  auto nv = a_mesh->mNumVertices;
+  ret.vertices.resize(nv * 8);
+  static_assert(std::is_same<ai_real, float>::value,
+                "Type should be same while using memory copy.");
+  auto &data = ret.vertices;
+  for (auto vi = 0; vi < nv; ++vi) {
+    data[8 * vi] = a_mesh->mVertices[vi].x;
+    data[8 * vi + 1] = a_mesh->mVertices[vi].y;
+    data[8 * vi + 2] = a_mesh->mVertices[vi].z;
+    data[8 * vi + 3] = a_mesh->mNormals[vi].x;
+    data[8 * vi + 4] = a_mesh->mNormals[vi].y;
+    data[8 * vi + 5] = a_mesh->mNormals[vi].z;
+    data[8 * vi + 6] = a_mesh->mTextureCoords[0][vi].x;
+    data[8 * vi + 7] = a_mesh->mTextureCoords[0][vi].y;
+  }
+
+  // faces
+  auto nf = a_mesh->mNumFaces;
+  ret.indices.reserve(nf * 3);
+  for (auto j = 0; j < nf; ++j) {
+    assert(a_mesh->mFaces[j].mNumIndices == 3);
+    ret.indices.emplace_back(a_mesh->mFaces[j].mIndices[0]);
+    ret.indices.emplace_back(a_mesh->mFaces[j].mIndices[1]);
+    ret.indices.emplace_back(a_mesh->mFaces[j].mIndices[2]);
+  }
+  ret.aabb.min() = Eigen::Vector3f(a_mesh->mAABB.mMin.x, a_mesh->mAABB.mMin.y,
+                                   a_mesh->mAABB.mMin.z);
+  ret.aabb.max() = Eigen::Vector3f(a_mesh->mAABB.mMax.x, a_mesh->mAABB.mMax.y,
+                                   a_mesh->mAABB.mMax.z);
+  return ret;
+}
+
+/**
+ * \brief simplify the full detail level into coarser lods appended to the indices,
+ * each from the previous level, the error accumulates
+ */
+static void generateLods(MeshData &mesh, const MeshLodSettings &settings) {
+  constexpr uint32_t stride = 8;
+  const uint32_t vertex_count = static_cast<uint32_t>(mesh.vertices.size() / stride);
+  auto &indices = mesh.indices;
+  mesh.lods = {{0, static_cast<uint32_t>(indices.size()), 0.0f}};
+  std::vector<uint32_t> lod_indices;
+  const uint32_t max_levels = std::min(settings.max_levels, MAX_MESH_LODS);
+  while (mesh.lods.size() < max_levels) {
+    const MeshLod prev = mesh.lods.back();
+    if (prev.index_count / 3 < settings.min_triangles)
+      break;
+    const size_t target = static_cast<size_t>(prev.index_count * settings.reduction) / 3 * 3;
+    lod_indices.resize(prev.index_count);
+    float error = 0.0f;
+    const size_t count = simplifyMesh(
+        lod_indices.data(), indices.data() + prev.first_index, prev.index_count,
+        mesh.vertices.data(), vertex_count, stride, target,
+        std::max(settings.target_error - prev.error, 0.0f), &error);
+    // the error bound is hit before a worthwhile reduction
+    if (count == 0 || count > prev.index_count * 0.85f)
+      break;
+    optimizeVertexCache(lod_indices.data(), count, vertex_count);
+    mesh.lods.push_back({static_cast<uint32_t>(indices.size()),
+                         static_cast<uint32_t>(count), prev.error + error});
+    indices.insert(indices.end(), lod_indices.begin(), lod_indices.begin() + count);
+  }
+  if (mesh.lods.size() == 1)
+    mesh.lods.clear();
 }
 
-std::vector<std::shared_ptr<StaticMesh>>
-AssimpLoader::processMeshs(const aiScene *a_scene,
-                           const std::shared_ptr<CommandBuffer> &cmd_buf) {
-  auto a_meshes = a_scene->mMeshes;
-  std::vector<std::shared_ptr<StaticMesh>> ret_meshes(a_scene->mNumMeshes);
-  for (auto i = 0; i < a_scene->mNumMeshes; ++i) {
-    auto tmp_a_mesh = a_meshes[i];
-    ret_meshes[i] = std::make_shared<StaticMesh>();
-
-    // mesh data to static mesh data
-    // vertices data: 3f_pos | 3f_normal | 2f_uv
-    auto nv = tmp_a_mesh->mNumVertices;
-    auto driver = getDefaultAppContext().driver;
-    auto vb = std::make_shared<Buffer>(driver, 0, nv * 8 * sizeof(float),
-                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                       0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
-    std::vector<float> data(nv * 8);
-    static_assert(std::is_same<ai_real, float>::value,
-                  "Type should be same while using memory copy.");
-    for (auto vi = 0; vi < nv; ++vi) {
-      data[8 * vi] = tmp_a_mesh->mVertices[vi].x;
-      data[8 * vi + 1] = tmp_a_mesh->mVertices[vi].y;
-      data[8 * vi + 2] = tmp_a_mesh->mVertices[vi].z;
-      data[8 * vi + 3] = tmp_a_mesh->mNormals[vi].x;
-      data[8 * vi + 4] = tmp_a_mesh->mNormals[vi].y;
-      data[8 * vi + 5] = tmp_a_mesh->mNormals[vi].z;
-      data[8 * vi + 6] = tmp_a_mesh->mTextureCoords[0][vi].x;
-      data[8 * vi + 7] = tmp_a_mesh->mTextureCoords[0][vi].y;
+static VertexCacheStats optimizeMesh(MeshData &mesh,
+                                     const MeshLodSettings &lod_settings) {
+  constexpr uint32_t stride = 8;
+  auto &indices = mesh.indices;
+  auto &vertices = mesh.vertices;
+  uint32_t vertex_count = static_cast<uint32_t>(vertices.size() / stride);
+  std::vector<uint32_t> cluster_starts(indices.size() / 3);
+  uint32_t cluster_count = optimizeVertexCache(
+      indices.data(), indices.size(), vertex_count, DEFAULT_VERTEX_CACHE_SIZE,
+      cluster_starts.data());
+  optimizeOverdraw(indices.data(), indices.size(), vertices.data(),
+                   vertex_count, stride, cluster_starts.data(), cluster_count);
+  const size_t full_index_count = indices.size();
+  if (lod_settings.max_levels > 1)
+    generateLods(mesh, lod_settings);
+  // vertices in first use order of the full detail level, coarser levels use a subset
+  vertex_count = optimizeVertexFetch(vertices.data(), vertex_count, stride,
+                                     indices.data(), indices.size());
+  vertices.resize(static_cast<size_t>(vertex_count) * stride);
+  return analyzeVertexCache(indices.data(), full_index_count, vertex_count);
+}
+
+std::vector<MeshData>
+AssimpLoader::packMeshes(const aiScene *a_scene,
+                         const MeshLodSettings &lod_settings) {
+  std::vector<MeshData> ret(a_scene->mNumMeshes);
+  std::vector<std::pair<VertexCacheStats, VertexCacheStats>> stats(ret.size());
+  parallelFor(0, a_scene->mNumMeshes, [&](uint32_t i) {
+    ret[i] = packMesh(a_scene->mMeshes[i]);
+    stats[i].first = analyzeVertexCache(ret[i].indices.data(), ret[i].indices.size(),
+                                        static_cast<uint32_t>(ret[i].vertices.size() / 8));
+    stats[i].second = optimizeMesh(ret[i], lod_settings);
+  });
+  for (uint32_t i = 0; i < ret.size(); ++i) {
+    LOGI("optimize mesh {}: acmr {:.3f} -> {:.3f}, atvr {:.3f} -> {:.3f}",
+         a_scene->mMeshes[i]->mName.C_Str(), stats[i].first.acmr,
+         stats[i].second.acmr, stats[i].first.atvr, stats[i].second.atvr);
+    for (uint32_t l = 1; l < ret[i].lods.size(); ++l)
+      LOGI("  lod {}: {} triangles, error {:.4f}", l,
+           ret[i].lods[l].index_count / 3, ret[i].lods[l].error);
+  }
+  return ret;
+}
+
+/**
+ * \brief 16-bit indices for the mesh. an oversized mesh is split in triangle
+ * order into ranges spanning less than 65536 vertices, drawn with vertex
+ * offset, vertex fetch optimization keeps the ranges few. return false if a
+ * triangle spans more or the split is too fragmented, keep 32-bit then
+ */
+static bool packIndices16(const uint32_t *indices, uint32_t index_count,
+                          uint32_t vertex_count, std::vector<uint16_t> &out,
+                          std::vector<IndexRange> &ranges) {
+  constexpr uint32_t kMaxSpan = 65535;
+  ranges.clear();
+  if (vertex_count <= kMaxSpan + 1) {
+    out.assign(indices, indices + index_count);
+    ranges.push_back({0, index_count, 0});
+    return true;
+  }
+
+  uint32_t first = 0;
+  uint32_t lo = UINT32_MAX;
+  uint32_t hi = 0;
+  for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+    const uint32_t tlo = std::min({indices[i], indices[i + 1], indices[i + 2]});
+    const uint32_t thi = std::max({indices[i], indices[i + 1], indices[i + 2]});
+    if (thi - tlo > kMaxSpan)
+      return false;
+    if (std::max(hi, thi) - std::min(lo, tlo) > kMaxSpan) {
+      ranges.push_back({first, i - first, static_cast<int32_t>(lo)});
+      first = i;
+      lo = tlo;
+      hi = thi;
+    } else {
+      lo = std::min(lo, tlo);
+      hi = std::max(hi, thi);
     }
+  }
+  if (first < index_count)
+    ranges.push_back({first, index_count - first, static_cast<int32_t>(lo)});
+  if (ranges.size() > 4 * ((vertex_count + kMaxSpan) / (kMaxSpan + 1)))
+    return false;
+
+  out.resize(index_count);
+  for (const auto &r : ranges)
+    for (uint32_t i = r.first_index; i < r.first_index + r.index_count; ++i)
+      out[i] = static_cast<uint16_t>(indices[i] - r.vertex_offset);
+  return true;
+}
 
-    auto stage_pool = getDefaultAppContext().stage_pool;
-    // upload to gpu
-    vb->updateByStaging(data.data(), data.size() * sizeof(float), 0, stage_pool,
-                        cmd_buf);
-    const auto stride = sizeof(float) * 8;
-    ret_meshes[i]->vertices = {vb, 0, stride, nv, VK_FORMAT_R32G32B32_SFLOAT};
-    ret_meshes[i]->normals = {vb, sizeof(float) * 3, stride, nv,
-                              VK_FORMAT_R32G32B32_SFLOAT};
-    ret_meshes[i]->texture_coords = {vb, sizeof(float) * 6, stride, nv,
-                                     VK_FORMAT_R32G32_SFLOAT};
-
-    // faces
-    auto nf = tmp_a_mesh->mNumFaces;
-    std::vector<uint32_t> tri_v_inds;
-    tri_v_inds.reserve(nf * 3);
-    for (auto j = 0; j < nf; ++j) {
-      assert(tmp_a_mesh->mFaces[j].mNumIndices == 3);
-      tri_v_inds.emplace_back(tmp_a_mesh->mFaces[j].mIndices[0]);
-      tri_v_inds.emplace_back(tmp_a_mesh->mFaces[j].mIndices[1]);
-      tri_v_inds.emplace_back(tmp_a_mesh->mFaces[j].mIndices[2]);
+//! meshes with fewer triangles are drawn whole
+constexpr uint32_t MESHLET_MIN_TRIANGLES = 4096;
+
+/**
+ * \brief alloc the mesh buffers in the requested vertex layout, quantized and
+ * indices16 hold the bytes to upload, empty when the mesh data is uploaded as is
+ */
+static std::shared_ptr<StaticMesh>
+allocStaticMesh(const MeshDataView &mesh_data,
+                const VertexQuantization &quantization,
+                std::vector<uint8_t> &quantized,
+                std::vector<uint16_t> &indices16) {
+  auto ret = std::make_shared<StaticMesh>();
+  const uint32_t nv = mesh_data.vertex_count;
+  quantized.clear();
+  if (quantization.layout != VertexLayout::FLOAT32) {
+    VertexQuantizeError error;
+    if (quantizeVertices(mesh_data.vertices, nv, quantization, quantized,
+                         ret->dequant_offset, ret->dequant_scale, error)) {
+      ret->layout = quantization.layout;
+    } else {
+      LOGW("mesh with {} vertices exceeds the quantization error bound "
+           "(relative position {}, normal {}, uv {}), keep float vertices",
+           nv, error.position, error.normal, error.uv);
+      quantized.clear();
+      ret->dequant_offset.setZero();
+      ret->dequant_scale.setOnes();
     }
+  }
+
+  // vertices and indices are sub-allocated from the shared arena pages
+  auto &arena = *getDefaultAppContext().geometry_arena;
+  const uint32_t stride = vertexStride(ret->layout);
+  ret->vertex_range = arena.allocateVertices(stride, nv);
+  ret->base_vertex = static_cast<int32_t>(ret->vertex_range->first());
+  const auto &vb = ret->vertex_range->buffer();
+  const uint32_t vb_offset = static_cast<uint32_t>(ret->vertex_range->byteOffset());
+  switch (ret->layout) {
+  case VertexLayout::QUANTIZED16:
+    ret->vertices = {vb, vb_offset, stride, nv, VK_FORMAT_R16G16B16A16_UNORM};
+    ret->normals = {vb, vb_offset + 8, stride, nv, VK_FORMAT_R16G16_SNORM};
+    ret->texture_coords = {vb, vb_offset + 12, stride, nv, VK_FORMAT_R16G16_SFLOAT};
+    break;
+  case VertexLayout::QUANTIZED8:
+    // normal is packed in pos.w
+    ret->vertices = {vb, vb_offset, stride, nv, VK_FORMAT_R16G16B16A16_UNORM};
+    ret->normals = {vb, vb_offset, stride, nv, VK_FORMAT_R16G16B16A16_UNORM};
+    ret->texture_coords = {vb, vb_offset + 8, stride, nv, VK_FORMAT_R16G16_SFLOAT};
+    break;
+  default:
+    ret->vertices = {vb, vb_offset, stride, nv, VK_FORMAT_R32G32B32_SFLOAT};
+    ret->normals = {vb, vb_offset + sizeof(float) * 3, stride, nv,
+                    VK_FORMAT_R32G32B32_SFLOAT};
+    ret->texture_coords = {vb, vb_offset + sizeof(float) * 6, stride, nv,
+                           VK_FORMAT_R32G32_SFLOAT};
+  }
 
-    // buffer: indices data triangle faces
-    auto ib = std::make_shared<Buffer>(
-        driver, 0, tri_v_inds.size() * sizeof(uint32_t),
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 0,
-        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
-    // upload data to buffer
-    ib->updateByStaging(tri_v_inds.data(), tri_v_inds.size() * sizeof(uint32_t),
-                        0, stage_pool, cmd_buf);
-    ret_meshes[i]->faces = {ib, 0, static_cast<uint32_t>(tri_v_inds.size()),
-                            VK_INDEX_TYPE_UINT32,
-                            VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
-    ret_meshes[i]->aabb.min() =
-        Eigen::Vector3f(tmp_a_mesh->mAABB.mMin.x, tmp_a_mesh->mAABB.mMin.y,
-                        tmp_a_mesh->mAABB.mMin.z);
-    ret_meshes[i]->aabb.max() =
-        Eigen::Vector3f(tmp_a_mesh->mAABB.mMax.x, tmp_a_mesh->mAABB.mMax.y,
-                        tmp_a_mesh->mAABB.mMax.z);
+  // buffer: indices data triangle faces, each lod is packed on its own
+  std::vector<MeshLod> lods(mesh_data.lods, mesh_data.lods + mesh_data.lod_count);
+  if (lods.empty())
+    lods.push_back({0, mesh_data.index_count, 0.0f});
+  std::vector<std::vector<IndexRange>> lod_ranges(lods.size());
+  VkIndexType index_type = VK_INDEX_TYPE_UINT16;
+  std::vector<uint16_t> packed;
+  indices16.resize(mesh_data.index_count);
+  for (size_t l = 0; l < lods.size(); ++l) {
+    if (!packIndices16(mesh_data.indices + lods[l].first_index,
+                       lods[l].index_count, nv, packed, lod_ranges[l])) {
+      if (l == 0) {
+        LOGW("mesh with {} vertices can't be split for 16-bit indices, keep 32-bit", nv);
+        index_type = VK_INDEX_TYPE_UINT32;
+      } else {
+        // coarse levels span the whole vertex buffer, drop them rather than the 16-bit indices
+        lods.resize(l);
+        lod_ranges.resize(l);
+      }
+      break;
+    }
+    std::copy(packed.begin(), packed.end(), indices16.begin() + lods[l].first_index);
+    for (auto &r : lod_ranges[l])
+      r.first_index += lods[l].first_index;
   }
+  if (index_type == VK_INDEX_TYPE_UINT32) {
+    indices16.clear();
+    for (size_t l = 0; l < lods.size(); ++l)
+      lod_ranges[l] = {{lods[l].first_index, lods[l].index_count, 0}};
+  }
+  const uint32_t index_count = lods.back().first_index + lods.back().index_count;
+  if (!indices16.empty())
+    indices16.resize(index_count);
+
+  // large meshes are split into meshlets, culled per frame
+  if (lods[0].index_count / 3 >= MESHLET_MIN_TRIANGLES) {
+    for (const auto &r : lod_ranges[0]) {
+      const size_t begin = ret->meshlets.size();
+      buildMeshlets(mesh_data.indices + r.first_index, r.index_count,
+                    mesh_data.vertices, 8, ret->meshlets);
+      for (size_t i = begin; i < ret->meshlets.size(); ++i) {
+        ret->meshlets[i].first_index += r.first_index;
+        ret->meshlets[i].vertex_offset = r.vertex_offset;
+      }
+    }
+  }
+  for (size_t l = 1; l < lods.size(); ++l)
+    ret->lods.push_back({std::move(lod_ranges[l]), lods[l].error});
+
+  ret->index_range = arena.allocateIndices(index_type, index_count);
+  ret->first_index = ret->index_range->first();
+  ret->faces = {ret->index_range->buffer(),
+                static_cast<uint32_t>(ret->index_range->byteOffset()),
+                index_count, index_type,
+                VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, std::move(lod_ranges[0])};
+  ret->aabb = mesh_data.aabb;
+  return ret;
+}
 
-  // // add barrier to make sure transfer is complete before rendering
-  // VkMemoryBarrier memoryBarrier = {};
-  // memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-  // memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  // memoryBarrier.dstAccessMask =
-  //     VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+std::shared_ptr<StaticMesh>
+AssimpLoader::createStaticMesh(const MeshDataView &mesh_data,
+                               const std::shared_ptr<CommandBuffer> &cmd_buf,
+                               const VertexQuantization &quantization) {
+  UploadBatch batch(getDefaultAppContext().stage_pool);
+  auto ret = createStaticMesh(mesh_data, batch, quantization);
+  batch.record(cmd_buf);
+  return ret;
+}
 
-  // vkCmdPipelineBarrier(cmd_buf->getHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT,
-  //                      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1,
-  //                      &memoryBarrier, 0, nullptr, 0, nullptr);
+std::shared_ptr<StaticMesh>
+AssimpLoader::createStaticMesh(const MeshDataView &mesh_data,
+                               UploadBatch &batch,
+                               const VertexQuantization &quantization) {
+  std::vector<uint8_t> quantized;
+  std::vector<uint16_t> indices16;
+  auto ret = allocStaticMesh(mesh_data, quantization, quantized, indices16);
+  const void *vertices = quantized.empty()
+                             ? static_cast<const void *>(mesh_data.vertices)
+                             : quantized.data();
+  const void *indices = indices16.empty()
+                            ? static_cast<const void *>(mesh_data.indices)
+                            : indices16.data();
+  // upload to gpu
+  batch.addBuffer(ret->vertices.buffer, vertices, ret->vertex_range->byteSize(),
+                  ret->vertex_range->byteOffset());
+  batch.addBuffer(ret->faces.buffer, indices, ret->index_range->byteSize(),
+                  ret->index_range->byteOffset());
+  return ret;
+}
 
-  return ret_meshes;
+std::shared_ptr<StaticMesh>
+AssimpLoader::createStaticMesh(const MeshDataView &mesh_data,
+                               UploadScheduler &scheduler,
+                               const VertexQuantization &quantization) {
+  std::vector<uint8_t> quantized;
+  std::vector<uint16_t> indices16;
+  auto ret = allocStaticMesh(mesh_data, quantization, quantized, indices16);
+  const void *vertices = quantized.empty()
+                             ? static_cast<const void *>(mesh_data.vertices)
+                             : quantized.data();
+  const void *indices = indices16.empty()
+                            ? static_cast<const void *>(mesh_data.indices)
+                            : indices16.data();
+  scheduler.uploadBuffer(ret->vertices.buffer, vertices,
+                         ret->vertex_range->byteSize(),
+                         ret->vertex_range->byteOffset(),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+  scheduler.uploadBuffer(ret->faces.buffer, indices,
+                         ret->index_range->byteSize(),
+                         ret->index_range->byteOffset(),
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_INDEX_READ_BIT);
+  return ret;
 }
 
 std::vector<Camera> AssimpLoader::processCameras(const aiScene *a_scene) {
@@ -230,26 +512,32 @@ std::vector<Camera> AssimpLoader::processCameras(const aiScene *a_scene) {
   return ret_cameras;
 }
 
-void loadAndSet(const std::string &dir, const aiScene *a_scene,
-                              aiMaterial *a_mat,
-                              const std::shared_ptr<CommandBuffer> &cmd_buf,
-                              std::shared_ptr<PbrMaterial> &mat) {                              
+static MaterialTextureDesc textureDesc(const aiScene *a_scene,
+                                       const char *name,
+                                       const aiString &texture_path,
+                                       const std::string &dir) {
+  auto a_texture = a_scene->GetEmbeddedTexture(texture_path.C_Str());
+  if (a_texture != nullptr)
+    return MaterialTextureDesc{
+        name, texture_path.C_Str(),
+        reinterpret_cast<const uint8_t *>(a_texture->pcData), a_texture->mWidth};
+  return MaterialTextureDesc{name, dir + texture_path.C_Str()};
+}
+
+MaterialDesc AssimpLoader::describeMaterial(const aiScene *a_scene,
+                                            const aiMaterial *a_mat,
+                                            const std::string &dir) {
+  // aiTextureType_DIFFUSE is same as aiTextureType_BASE_COLOR
+  // diffuse is used for old specular-glossiness workflow
+  // and base color is used for metallic-roughness workflow
+  MaterialDesc desc;
   aiString texture_path;
   if (AI_SUCCESS == a_mat->GetTexture(AI_MATKEY_BASE_COLOR_TEXTURE, &texture_path)) {
-    auto a_texture = a_scene->GetEmbeddedTexture(texture_path.C_Str());
-
-    auto &asset_manager = getDefaultAppContext().gpu_asset_manager;
-    std::shared_ptr<ImageView> img_view = (a_texture != nullptr) ? asset_manager->request<ImageView>(
-          reinterpret_cast<uint8_t *>(a_texture->pcData), a_texture->mWidth,
-          cmd_buf) : asset_manager->request<ImageView>(dir + texture_path.C_Str(),
-                                            cmd_buf);
-    mat->setTexture(BASE_COLOR_TEXTURE_NAME, img_view);
+    desc.textures.emplace_back(textureDesc(a_scene, BASE_COLOR_TEXTURE_NAME, texture_path, dir));
   } else {
     aiColor3D value(0.0f, 0.0f, 0.0f);
     a_mat->Get(AI_MATKEY_COLOR_DIFFUSE, value);
-    mat->setUboParamValue(
-        BASE_COLOR_NAME,
-        Eigen::Vector4f(value.r, value.g, value.b, 1.0));
+    desc.base_color = Eigen::Vector4f(value.r, value.g, value.b, 1.0);
   }
 
   // metallic - roughness
@@ -258,96 +546,67 @@ void loadAndSet(const std::string &dir, const aiScene *a_scene,
   bool has_r = (AI_SUCCESS == a_mat->GetTexture(AI_MATKEY_ROUGHNESS_TEXTURE, &roughness_tex_path));
   if(has_m && has_r && metallic_tex_path == roughness_tex_path)
   {
-    auto a_texture = a_scene->GetEmbeddedTexture(metallic_tex_path.C_Str());
-
-    auto &asset_manager = getDefaultAppContext().gpu_asset_manager;
-    std::shared_ptr<ImageView> img_view = (a_texture != nullptr) ? asset_manager->request<ImageView>(
-          reinterpret_cast<uint8_t *>(a_texture->pcData), a_texture->mWidth,
-          cmd_buf) : asset_manager->request<ImageView>(dir + metallic_tex_path.C_Str(),
-                                            cmd_buf);
-    mat->setTexture(METALLIC_ROUGHNESS_TEXTURE_NAME, img_view);
+    desc.textures.emplace_back(textureDesc(a_scene, METALLIC_ROUGHNESS_TEXTURE_NAME, metallic_tex_path, dir));
   } else {
     if(has_m)
     {
-      auto a_texture = a_scene->GetEmbeddedTexture(metallic_tex_path.C_Str());
-
-      auto &asset_manager = getDefaultAppContext().gpu_asset_manager;
-      std::shared_ptr<ImageView> img_view = (a_texture != nullptr) ? asset_manager->request<ImageView>(
-            reinterpret_cast<uint8_t *>(a_texture->pcData), a_texture->mWidth,
-            cmd_buf) : asset_manager->request<ImageView>(dir + metallic_tex_path.C_Str(),
-                                              cmd_buf);
-      mat->setTexture(METALLIC_TEXTURE_NAME, img_view);      
+      desc.textures.emplace_back(textureDesc(a_scene, METALLIC_TEXTURE_NAME, metallic_tex_path, dir));
     } else {
       float value = 0.0f;
       a_mat->Get(AI_MATKEY_METALLIC_FACTOR, value);
-      mat->setUboParamValue(
-          METALLIC_NAME, value);      
+      desc.float_params.emplace_back(METALLIC_NAME, value);
     }
     if(has_r)
     {
-      auto a_texture = a_scene->GetEmbeddedTexture(roughness_tex_path.C_Str());
-
-      auto &asset_manager = getDefaultAppContext().gpu_asset_manager;
-      std::shared_ptr<ImageView> img_view = (a_texture != nullptr) ? asset_manager->request<ImageView>(
-            reinterpret_cast<uint8_t *>(a_texture->pcData), a_texture->mWidth,
-            cmd_buf) : asset_manager->request<ImageView>(dir + roughness_tex_path.C_Str(),
-                                              cmd_buf);
-      mat->setTexture(ROUGHNESS_TEXTURE_NAME, img_view);      
+      desc.textures.emplace_back(textureDesc(a_scene, ROUGHNESS_TEXTURE_NAME, roughness_tex_path, dir));
     } else {
       float value = 0.0f;
       a_mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, value);
-      mat->setUboParamValue(
-          ROUGHNESS_NAME, value);      
+      desc.float_params.emplace_back(ROUGHNESS_NAME, value);
     }
   }
 
   // specular
   if (AI_SUCCESS == a_mat->GetTexture(aiTextureType_SPECULAR, 0, &texture_path)) {
-    auto a_texture = a_scene->GetEmbeddedTexture(texture_path.C_Str());
-
-    auto &asset_manager = getDefaultAppContext().gpu_asset_manager;
-    std::shared_ptr<ImageView> img_view = (a_texture != nullptr) ? asset_manager->request<ImageView>(
-          reinterpret_cast<uint8_t *>(a_texture->pcData), a_texture->mWidth,
-          cmd_buf) : asset_manager->request<ImageView>(dir + texture_path.C_Str(),
-                                            cmd_buf);
-    mat->setTexture(SPECULAR_TEXTURE_NAME, img_view);
+    desc.textures.emplace_back(textureDesc(a_scene, SPECULAR_TEXTURE_NAME, texture_path, dir));
   } else {
     float value = 0.5f;
     a_mat->Get(AI_MATKEY_SPECULAR_FACTOR, value);
-    mat->setUboParamValue(SPECULAR_NAME, value);
+    desc.float_params.emplace_back(SPECULAR_NAME, value);
   }
 
   // normal map 
   if(AI_SUCCESS ==  a_mat->GetTexture(aiTextureType_NORMALS, 0, &texture_path))
   {
-    auto a_texture = a_scene->GetEmbeddedTexture(texture_path.C_Str());
-
-    auto &asset_manager = getDefaultAppContext().gpu_asset_manager;
-    std::shared_ptr<ImageView> img_view = (a_texture != nullptr) ? asset_manager->request<ImageView>(
-          reinterpret_cast<uint8_t *>(a_texture->pcData), a_texture->mWidth,
-          cmd_buf) : asset_manager->request<ImageView>(dir + texture_path.C_Str(),
-                                            cmd_buf);
-    mat->setTexture(NORMAL_TEXTURE_NAME, img_view);
+    desc.textures.emplace_back(textureDesc(a_scene, NORMAL_TEXTURE_NAME, texture_path, dir));
   }
+  return desc;
+}
+
+void AssimpLoader::applyMaterialParams(const MaterialDesc &desc, Material &mat) {
+  if (desc.base_color)
+    mat.setUboParamValue(BASE_COLOR_NAME, *desc.base_color);
+  for (const auto &p : desc.float_params)
+    mat.setUboParamValue(p.first, p.second);
 }
 
 std::vector<std::shared_ptr<Material>>
-AssimpLoader::processMaterials(const aiScene *a_scene, const std::string &dir,
+AssimpLoader::processMaterials(const std::vector<MaterialDesc> &descs,
                                const std::shared_ptr<CommandBuffer> &cmd_buf) {
-  auto num_materials = a_scene->mNumMaterials;
+  auto num_materials = descs.size();
   std::vector<std::shared_ptr<Material>> ret_mats(num_materials);
 
-  auto driver = getDefaultAppContext().driver;
-  auto gpu_asset_manager = getDefaultAppContext().gpu_asset_manager;
+  auto &asset_manager = getDefaultAppContext().gpu_asset_manager;
 
   for (uint32_t i = 0; i < num_materials; ++i) {
-    auto a_mat = a_scene->mMaterials[i];
     auto cur_mat = std::make_shared<PbrMaterial>();
     ret_mats[i] = cur_mat;
-    // aiTextureType_DIFFUSE is same as aiTextureType_BASE_COLOR
-    // diffuse is used for old specular-glossiness workflow
-    // and base color is used for metallic-roughness workflow
-    loadAndSet(dir, a_scene, a_mat, cmd_buf, cur_mat);
+    for (const auto &t : descs[i].textures) {
+      auto img_view = asset_manager->requestTexture(
+          t.key, t.embedded_data, t.embedded_size, textureUsage(t.name), cmd_buf);
+      cur_mat->setTexture(t.name, img_view);
+    }
+    applyMaterialParams(descs[i], *cur_mat);
     cur_mat->compile();
   }
   return ret_mats;
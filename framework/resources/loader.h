@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
@@ -7,44 +8,205 @@
 #include <framework/functional/global/app_context.h>
 #include <framework/utils/vk/vk_driver.h>
 #include <framework/functional/component/light.h>
+#include <framework/functional/component/camera.h>
+#include <framework/resources/vertex_quantizer.h>
 
 namespace vk_engine {
 
 class CommandBuffer;
 class StagePool;
 class GPUAssetManager;
-class Camera;
+class UploadScheduler;
+class UploadBatch;
+
+constexpr uint32_t MAX_MESH_LODS = 4; //!< including the full detail level
+
+/**
+ * \brief a level of detail in the mesh indices, level 0 is the full mesh
+ */
+struct MeshLod {
+  uint32_t first_index;
+  uint32_t index_count;
+  float error; //!< simplification error relative to the mesh extent
+};
+
+/**
+ * \brief lod generation of the imported meshes, each level keeps about
+ * reduction of the previous one's triangles, while the error is in target_error
+ */
+struct MeshLodSettings {
+  uint32_t max_levels{MAX_MESH_LODS};
+  float reduction{0.5f};
+  float target_error{0.02f};  //!< relative to the mesh extent
+  uint32_t min_triangles{256}; //!< smaller levels are not simplified further
+};
+
+/**
+ * \brief cpu side mesh data, vertices: 3f_pos | 3f_normal | 2f_uv
+ */
+struct MeshData {
+  std::vector<float> vertices;
+  std::vector<uint32_t> indices; //!< lods one after another
+  std::vector<MeshLod> lods;     //!< empty if indices is a single level
+  Eigen::AlignedBox3f aabb;
+};
+
+/**
+ * \brief non-owning view of packed mesh data, e.g. pointing into a mapped mesh cache
+ */
+struct MeshDataView {
+  MeshDataView() = default;
+
+  MeshDataView(const MeshData &mesh_data)
+      : vertices(mesh_data.vertices.data()),
+        vertex_count(static_cast<uint32_t>(mesh_data.vertices.size() / 8)),
+        indices(mesh_data.indices.data()),
+        index_count(static_cast<uint32_t>(mesh_data.indices.size())),
+        lods(mesh_data.lods.data()),
+        lod_count(static_cast<uint32_t>(mesh_data.lods.size())),
+        aabb(mesh_data.aabb) {}
+
+  const float *vertices{nullptr}; //!< 8 floats per vertex
+  uint32_t vertex_count{0};
+  const uint32_t *indices{nullptr};
+  uint32_t index_count{0};
+  const MeshLod *lods{nullptr};
+  uint32_t lod_count{0};
+  Eigen::AlignedBox3f aabb;
+};
+
+struct MaterialTextureDesc {
+  const char *name; //!< texture param name in material
+  std::string key;  //!< texture file path, or embedded texture name
+  //! compressed embedded texture, only valid while the importer or mesh cache is alive
+  const uint8_t *embedded_data{nullptr};
+  uint32_t embedded_size{0};
+};
+
+/**
+ * \brief cpu side description of a pbr material, textures are referenced by key
+ */
+struct MaterialDesc {
+  std::vector<MaterialTextureDesc> textures;
+  std::optional<Eigen::Vector4f> base_color;
+  std::vector<std::pair<const char *, float>> float_params;
+};
+
+struct RenderableDesc {
+  std::string name;
+  std::shared_ptr<TransformRelationship> tr;
+  uint32_t mesh_index;
+  uint32_t material_index;
+};
+
+/**
+ * \brief everything of a scene except the gpu resources
+ */
+struct SceneDesc {
+  std::shared_ptr<TransformRelationship> root_tr;
+  std::shared_ptr<TransformRelationship> camera_tr;
+  std::string camera_name;
+  std::vector<Camera> cameras;
+  Lights lights;
+  std::vector<MaterialDesc> materials;
+  std::vector<RenderableDesc> renderables;
+  uint32_t mesh_count{0};
+};
 
 // todo Static Mesh, Material TransformRelationship memory management
 class AssimpLoader final {
 public:
   AssimpLoader() = default;
 
+  /**
+   * \brief load scene to gpu, the packed meshes are read from the mesh cache
+   * next to the file when it's up to date, otherwise imported by assimp and cached
+   */
   void loadScene(const std::string &path, Scene &scene,
                  const std::shared_ptr<CommandBuffer> &cmd_buf);
 
+  /**
+   * \brief build the transform hierarchy, materials and cameras from assimp scene, no gpu work
+   */
+  void buildSceneDesc(const aiScene *a_scene, const std::string &dir,
+                      SceneDesc &desc);
+
+  /**
+   * \brief pack the assimp mesh into interleaved vertices and triangle indices
+   */
+  static MeshData packMesh(const aiMesh *a_mesh);
+
+  /**
+   * \brief pack all meshes of the scene in parallel, each is optimized for the
+   * vertex cache, overdraw and vertex fetch, with the acmr/atvr logged, and
+   * simplified into lods sharing the vertices
+   */
+  static std::vector<MeshData>
+  packMeshes(const aiScene *a_scene, const MeshLodSettings &lod_settings = {});
+
+  /**
+   * \brief vertices are quantized to the requested layout, a mesh over the
+   * error bound falls back to FLOAT32
+   */
+  static std::shared_ptr<StaticMesh>
+  createStaticMesh(const MeshDataView &mesh_data,
+                   const std::shared_ptr<CommandBuffer> &cmd_buf,
+                   const VertexQuantization &quantization = {});
+
+  /**
+   * \brief the uploads are added to batch, the mesh is usable after the batch is recorded
+   */
+  static std::shared_ptr<StaticMesh>
+  createStaticMesh(const MeshDataView &mesh_data, UploadBatch &batch,
+                   const VertexQuantization &quantization = {});
+
+  /**
+   * \brief upload on transfer queue, the mesh is usable after the scheduler acquired it
+   */
+  static std::shared_ptr<StaticMesh>
+  createStaticMesh(const MeshDataView &mesh_data, UploadScheduler &scheduler,
+                   const VertexQuantization &quantization = {});
+
+  /**
+   * \brief opt-in compact vertex layout for meshes loaded by loadScene
+   */
+  void setVertexQuantization(const VertexQuantization &quantization) {
+    quantization_ = quantization;
+  }
+
+  /**
+   * \brief lod generation for meshes imported by loadScene, a cache written
+   * with other settings is out of date and rebuilt
+   */
+  void setLodSettings(const MeshLodSettings &settings) { lod_settings_ = settings; }
+
+  static void applyMaterialParams(const MaterialDesc &desc, Material &mat);
+
+  /**
+   * \brief set root transform, camera and light to scene
+   */
+  static void setupScene(const SceneDesc &desc, Scene &scene);
+
+  static const unsigned int kImportFlags =
+      aiProcessPreset_TargetRealtime_Quality | aiProcess_GenBoundingBoxes;
+
 private:
   std::shared_ptr<TransformRelationship>
   processNode(const std::shared_ptr<TransformRelationship> &parent,
-              aiNode *node, const aiScene *a_scene, Scene &scene,
-              std::vector<std::shared_ptr<StaticMesh>> &meshes,
-              std::vector<std::shared_ptr<Material>> &materials);
-
-  std::vector<std::shared_ptr<StaticMesh>>
-  processMeshs(const aiScene *a_scene,
-               const std::shared_ptr<CommandBuffer> &cmd_buf);
+              aiNode *node, const aiScene *a_scene, SceneDesc &desc);
 
   std::vector<std::shared_ptr<Material>>
-  processMaterials(const aiScene *a_scene, const std::string &dir, const std::shared_ptr<CommandBuffer> &cmd_buf);
+  processMaterials(const std::vector<MaterialDesc> &descs,
+                   const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+  MaterialDesc describeMaterial(const aiScene *a_scene, const aiMaterial *a_mat,
+                                const std::string &dir);
 
   std::vector<Camera> processCameras(const aiScene *a_scene);
 
   Lights processLight(const aiScene *a_scene);
-  // void loadAndSet(const std::string &dir, const aiScene *a_scene, aiMaterial *a_mat,
-  //                 const std::shared_ptr<CommandBuffer> &cmd_buf,
-  //                 aiTextureType ttype, const char *pKey, unsigned int vtype,
-  //                 unsigned int idx, const char *shader_texture_name,
-  //                 const char *shader_color_name,
-  //                 std::shared_ptr<PbrMaterial> &mat);
-};
-} // namespace vk_engine
\ No newline at end of file
+
+  VertexQuantization quantization_;
+  MeshLodSettings lod_settings_;
+};
+} // namespace vk_engine
@@ -0,0 +1,632 @@
+#include <framework/resources/mesh_cache.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+#include <framework/utils/base/hash.h>
+#include <framework/utils/base/logging.h>
+#include <framework/functional/component/material.h>
+
+namespace vk_engine {
+
+constexpr uint32_t MESH_CACHE_MAGIC = 0x434d4b56; // "VKMC"
+constexpr uint32_t MESH_CACHE_VERSION = 4; // 2: optimized index/vertex order, 3: lods, 4: lod settings
+constexpr uint32_t MESH_CACHE_ALIGNMENT = 16;
+constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+enum MeshCacheSection : uint32_t {
+  SECTION_MESHES = 0,
+  SECTION_NODES,
+  SECTION_RENDERABLES,
+  SECTION_MATERIALS,
+  SECTION_TEXTURES,
+  SECTION_FLOAT_PARAMS,
+  SECTION_CAMERAS,
+  SECTION_LIGHTS,
+  SECTION_STRINGS,
+  SECTION_BLOBS,
+  SECTION_VERTICES,
+  SECTION_INDICES,
+  SECTION_COUNT
+};
+
+struct SectionRange {
+  uint64_t offset; //!< from the file begin
+  uint64_t size;   //!< in bytes
+};
+
+struct MeshCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t source_hash;
+  uint32_t import_flags;
+  uint32_t camera_node;
+  uint32_t camera_name;
+  uint32_t record_sizes_hash; //!< guard against layout changes of the records
+  uint64_t lod_settings_hash; //!< the lods were built with these settings
+  SectionRange sections[SECTION_COUNT];
+};
+
+struct MeshRecord {
+  uint64_t vertex_offset;
+  uint64_t index_offset;
+  uint32_t vertex_count;
+  uint32_t index_count;
+  float aabb_min[3];
+  float aabb_max[3];
+  uint32_t lod_count; //!< 0 if the indices are a single level
+  MeshLod lods[MAX_MESH_LODS];
+  uint32_t padding; //!< keep the record free of uninitialized bytes
+};
+
+struct NodeRecord {
+  uint32_t parent; //!< INVALID_INDEX for root, parent is always stored before child
+  float ltransform[16];
+  float aabb_min[3];
+  float aabb_max[3];
+};
+
+struct RenderableRecord {
+  uint32_t name;
+  uint32_t node;
+  uint32_t mesh;
+  uint32_t material;
+};
+
+struct MaterialRecord {
+  uint32_t texture_begin;
+  uint32_t texture_count;
+  uint32_t param_begin;
+  uint32_t param_count;
+  uint32_t has_base_color;
+  float base_color[4];
+};
+
+struct TextureRecord {
+  uint32_t name_id;
+  uint32_t key;
+  uint32_t relative; //!< key is relative to the source dir
+  uint32_t blob_size; //!< 0 for texture file
+  uint64_t blob_offset;
+};
+
+struct FloatParamRecord {
+  uint32_t name_id;
+  float value;
+};
+
+struct CameraRecord {
+  uint32_t name;
+  float near_plane;
+  float far_plane;
+  float fovy;
+  float aspect;
+  float dis;
+  float view[16];
+};
+
+// material param names are stored by index
+static const char *const PARAM_NAMES[] = {
+    BASE_COLOR_NAME,
+    METALLIC_NAME,
+    ROUGHNESS_NAME,
+    SPECULAR_NAME,
+    BASE_COLOR_TEXTURE_NAME,
+    METALLIC_TEXTURE_NAME,
+    ROUGHNESS_TEXTURE_NAME,
+    METALLIC_ROUGHNESS_TEXTURE_NAME,
+    SPECULAR_TEXTURE_NAME,
+    NORMAL_TEXTURE_NAME};
+constexpr uint32_t PARAM_NAMES_COUNT = sizeof(PARAM_NAMES) / sizeof(PARAM_NAMES[0]);
+
+static uint32_t paramId(const char *name) {
+  for (uint32_t i = 0; i < PARAM_NAMES_COUNT; ++i) {
+    if (strcmp(PARAM_NAMES[i], name) == 0)
+      return i;
+  }
+  return INVALID_INDEX;
+}
+
+static uint32_t recordSizesHash() {
+  const uint64_t sizes[] = {sizeof(MeshCacheHeader), sizeof(MeshRecord),
+                            sizeof(NodeRecord),      sizeof(RenderableRecord),
+                            sizeof(MaterialRecord),  sizeof(TextureRecord),
+                            sizeof(FloatParamRecord), sizeof(CameraRecord),
+                            sizeof(Lights),          PARAM_NAMES_COUNT};
+  return static_cast<uint32_t>(hash64(sizes, sizeof(sizes)));
+}
+
+static uint64_t lodSettingsHash(const MeshLodSettings &settings) {
+  uint32_t fields[4] = {settings.max_levels, 0, 0, settings.min_triangles};
+  memcpy(&fields[1], &settings.reduction, sizeof(float));
+  memcpy(&fields[2], &settings.target_error, sizeof(float));
+  return hash64(fields, sizeof(fields));
+}
+
+static uint64_t alignUp(const uint64_t v) {
+  return (v + MESH_CACHE_ALIGNMENT - 1) & ~uint64_t(MESH_CACHE_ALIGNMENT - 1);
+}
+
+static bool sourceStat(const std::string &path, uint64_t &size,
+                       int64_t &mtime) {
+  std::error_code ec;
+  size = std::filesystem::file_size(path, ec);
+  if (ec)
+    return false;
+  auto t = std::filesystem::last_write_time(path, ec);
+  if (ec)
+    return false;
+  mtime = static_cast<int64_t>(t.time_since_epoch().count());
+  return true;
+}
+
+static bool sourceHash(const std::string &path, uint64_t &hash) {
+  MappedFile file;
+  if (!file.open(path))
+    return false;
+  hash = hash64(file.data(), file.size());
+  return true;
+}
+
+std::string MeshCache::cachePath(const std::string &source_path) {
+  return source_path + ".vkmc";
+}
+
+std::string MeshCache::sourceDir(const std::string &source_path) {
+  std::size_t found = source_path.find_last_of("/\\");
+  return (found == std::string::npos) ? "./"
+                                      : source_path.substr(0, found + 1);
+}
+
+template <typename T> const T *MeshCache::section(uint32_t index) const {
+  return reinterpret_cast<const T *>(file_.data() +
+                                     header_->sections[index].offset);
+}
+
+const char *MeshCache::string(uint32_t offset) const {
+  return section<char>(SECTION_STRINGS) + offset;
+}
+
+std::unique_ptr<MeshCache> MeshCache::open(const std::string &source_path,
+                                           const MeshLodSettings &lod_settings) {
+  uint64_t source_size = 0;
+  int64_t source_mtime = 0;
+  if (!sourceStat(source_path, source_size, source_mtime))
+    return nullptr;
+
+  std::unique_ptr<MeshCache> cache(new MeshCache());
+  if (!cache->file_.open(cachePath(source_path)))
+    return nullptr;
+  const uint64_t file_size = cache->file_.size();
+  if (file_size < sizeof(MeshCacheHeader))
+    return nullptr;
+  const auto header =
+      reinterpret_cast<const MeshCacheHeader *>(cache->file_.data());
+  if (header->magic != MESH_CACHE_MAGIC ||
+      header->version != MESH_CACHE_VERSION ||
+      header->import_flags != AssimpLoader::kImportFlags ||
+      header->record_sizes_hash != recordSizesHash() ||
+      header->lod_settings_hash != lodSettingsHash(lod_settings))
+    return nullptr;
+  if (header->source_size != source_size)
+    return nullptr;
+  if (header->source_mtime != source_mtime) {
+    // touched but maybe not modified
+    uint64_t hash = 0;
+    if (!sourceHash(source_path, hash) || hash != header->source_hash)
+      return nullptr;
+  }
+
+  // sanity check, a truncated or corrupted cache is treated as out of date
+  for (const auto &s : header->sections) {
+    if (s.offset % MESH_CACHE_ALIGNMENT != 0 || s.offset > file_size ||
+        s.size > file_size - s.offset)
+      return nullptr;
+  }
+  cache->header_ = header;
+  const auto &strings = header->sections[SECTION_STRINGS];
+  if (strings.size == 0 || cache->string(strings.size - 1)[0] != '\0' ||
+      header->sections[SECTION_LIGHTS].size != sizeof(Lights))
+    return nullptr;
+  const auto &vertices = header->sections[SECTION_VERTICES];
+  const auto &indices = header->sections[SECTION_INDICES];
+  const auto meshes = cache->section<MeshRecord>(SECTION_MESHES);
+  for (uint32_t i = 0; i < cache->meshCount(); ++i) {
+    const auto &m = meshes[i];
+    if (m.vertex_offset < vertices.offset ||
+        m.vertex_offset + m.vertex_count * 8ull * sizeof(float) >
+            vertices.offset + vertices.size ||
+        m.index_offset < indices.offset ||
+        m.index_offset + m.index_count * 4ull > indices.offset + indices.size ||
+        m.lod_count > MAX_MESH_LODS)
+      return nullptr;
+    for (uint32_t l = 0; l < m.lod_count; ++l)
+      if (m.lods[l].first_index + static_cast<uint64_t>(m.lods[l].index_count) >
+          m.index_count)
+        return nullptr;
+  }
+  cache->dir_ = sourceDir(source_path);
+  return cache;
+}
+
+uint32_t MeshCache::meshCount() const {
+  return header_->sections[SECTION_MESHES].size / sizeof(MeshRecord);
+}
+
+MeshDataView MeshCache::mesh(uint32_t index) const {
+  assert(index < meshCount());
+  const auto &m = section<MeshRecord>(SECTION_MESHES)[index];
+  MeshDataView ret;
+  ret.vertices = reinterpret_cast<const float *>(file_.data() + m.vertex_offset);
+  ret.vertex_count = m.vertex_count;
+  ret.indices = reinterpret_cast<const uint32_t *>(file_.data() + m.index_offset);
+  ret.index_count = m.index_count;
+  ret.lods = m.lods;
+  ret.lod_count = m.lod_count;
+  ret.aabb.min() = Eigen::Vector3f(m.aabb_min[0], m.aabb_min[1], m.aabb_min[2]);
+  ret.aabb.max() = Eigen::Vector3f(m.aabb_max[0], m.aabb_max[1], m.aabb_max[2]);
+  return ret;
+}
+
+void MeshCache::buildSceneDesc(SceneDesc &desc) const {
+  const auto count = [this](uint32_t s, size_t record_size) {
+    return static_cast<uint32_t>(header_->sections[s].size / record_size);
+  };
+
+  // node hierarchy, siblings are stored in order
+  const auto node_records = section<NodeRecord>(SECTION_NODES);
+  const uint32_t node_count = count(SECTION_NODES, sizeof(NodeRecord));
+  if (node_count == 0)
+    throw std::runtime_error("mesh cache without root node");
+  std::vector<std::shared_ptr<TransformRelationship>> nodes(node_count);
+  std::vector<TransformRelationship *> last_child(node_count, nullptr);
+  for (uint32_t i = 0; i < node_count; ++i) {
+    const auto &r = node_records[i];
+    auto tr = std::make_shared<TransformRelationship>();
+    memcpy(tr->ltransform.data(), r.ltransform, sizeof(r.ltransform));
+    tr->aabb.min() = Eigen::Vector3f(r.aabb_min[0], r.aabb_min[1], r.aabb_min[2]);
+    tr->aabb.max() = Eigen::Vector3f(r.aabb_max[0], r.aabb_max[1], r.aabb_max[2]);
+    if (r.parent != INVALID_INDEX) {
+      if (r.parent >= i)
+        throw std::runtime_error("invalid node hierarchy in mesh cache");
+      tr->parent = nodes[r.parent];
+      if (last_child[r.parent] == nullptr)
+        nodes[r.parent]->child = tr;
+      else
+        last_child[r.parent]->sibling = tr;
+      last_child[r.parent] = tr.get();
+    }
+    nodes[i] = tr;
+  }
+  desc.root_tr = nodes[0];
+  desc.camera_tr = nodes.at(header_->camera_node);
+  desc.camera_name = string(header_->camera_name);
+
+  // cameras
+  const auto camera_records = section<CameraRecord>(SECTION_CAMERAS);
+  desc.cameras.resize(count(SECTION_CAMERAS, sizeof(CameraRecord)));
+  for (uint32_t i = 0; i < desc.cameras.size(); ++i) {
+    const auto &r = camera_records[i];
+    auto &camera = desc.cameras[i];
+    camera.setName(string(r.name));
+    camera.setClipPlanes(r.near_plane, r.far_plane);
+    camera.setFovy(r.fovy);
+    camera.setAspect(r.aspect);
+    memcpy(camera.getViewMatrix().data(), r.view, sizeof(r.view));
+    if (r.dis > 0.0f) {
+      // restore the orbit distance
+      const Eigen::Matrix4f view = camera.getViewMatrix();
+      const Eigen::Vector3f eye = camera.getCameraPos();
+      camera.setLookAt(eye, view.block<1, 3>(1, 0).transpose(),
+                       eye - r.dis * view.block<1, 3>(2, 0).transpose());
+    }
+  }
+
+  memcpy(static_cast<void *>(&desc.lights), section<uint8_t>(SECTION_LIGHTS),
+         sizeof(Lights));
+
+  // materials
+  const auto material_records = section<MaterialRecord>(SECTION_MATERIALS);
+  const auto texture_records = section<TextureRecord>(SECTION_TEXTURES);
+  const auto param_records = section<FloatParamRecord>(SECTION_FLOAT_PARAMS);
+  const uint32_t texture_count = count(SECTION_TEXTURES, sizeof(TextureRecord));
+  const uint32_t param_count =
+      count(SECTION_FLOAT_PARAMS, sizeof(FloatParamRecord));
+  const auto &blobs = header_->sections[SECTION_BLOBS];
+  desc.materials.resize(count(SECTION_MATERIALS, sizeof(MaterialRecord)));
+  for (uint32_t i = 0; i < desc.materials.size(); ++i) {
+    const auto &r = material_records[i];
+    auto &mat = desc.materials[i];
+    if (r.texture_begin + r.texture_count > texture_count ||
+        r.param_begin + r.param_count > param_count)
+      throw std::runtime_error("invalid material in mesh cache");
+    for (uint32_t j = 0; j < r.texture_count; ++j) {
+      const auto &t = texture_records[r.texture_begin + j];
+      if (t.name_id >= PARAM_NAMES_COUNT ||
+          (t.blob_size != 0 && (t.blob_offset < blobs.offset ||
+                                t.blob_offset + t.blob_size >
+                                    blobs.offset + blobs.size)))
+        throw std::runtime_error("invalid texture in mesh cache");
+      MaterialTextureDesc tex{PARAM_NAMES[t.name_id], string(t.key)};
+      if (t.relative)
+        tex.key = dir_ + tex.key;
+      if (t.blob_size != 0) {
+        tex.embedded_data = file_.data() + t.blob_offset;
+        tex.embedded_size = t.blob_size;
+      }
+      mat.textures.emplace_back(std::move(tex));
+    }
+    for (uint32_t j = 0; j < r.param_count; ++j) {
+      const auto &p = param_records[r.param_begin + j];
+      if (p.name_id >= PARAM_NAMES_COUNT)
+        throw std::runtime_error("invalid material param in mesh cache");
+      mat.float_params.emplace_back(PARAM_NAMES[p.name_id], p.value);
+    }
+    if (r.has_base_color)
+      mat.base_color = Eigen::Vector4f(r.base_color[0], r.base_color[1],
+                                       r.base_color[2], r.base_color[3]);
+  }
+
+  // renderables
+  desc.mesh_count = meshCount();
+  const auto renderable_records = section<RenderableRecord>(SECTION_RENDERABLES);
+  const uint32_t renderable_count =
+      count(SECTION_RENDERABLES, sizeof(RenderableRecord));
+  desc.renderables.reserve(renderable_count);
+  for (uint32_t i = 0; i < renderable_count; ++i) {
+    const auto &r = renderable_records[i];
+    if (r.node >= node_count || r.mesh >= desc.mesh_count ||
+        r.material >= desc.materials.size())
+      throw std::runtime_error("invalid renderable in mesh cache");
+    desc.renderables.emplace_back(
+        RenderableDesc{string(r.name), nodes[r.node], r.mesh, r.material});
+  }
+}
+
+namespace {
+class StringPool {
+public:
+  uint32_t add(const std::string &str) {
+    auto itr = offsets_.find(str);
+    if (itr != offsets_.end())
+      return itr->second;
+    uint32_t offset = static_cast<uint32_t>(data_.size());
+    data_.insert(data_.end(), str.begin(), str.end());
+    data_.emplace_back('\0');
+    offsets_.emplace(str, offset);
+    return offset;
+  }
+
+  const std::vector<char> &data() const { return data_; }
+
+private:
+  std::vector<char> data_;
+  std::unordered_map<std::string, uint32_t> offsets_;
+};
+} // namespace
+
+bool MeshCache::write(const std::string &source_path,
+                      const MeshLodSettings &lod_settings, const SceneDesc &desc,
+                      const std::vector<MeshData> &meshes) {
+  MeshCacheHeader header{};
+  header.magic = MESH_CACHE_MAGIC;
+  header.version = MESH_CACHE_VERSION;
+  header.import_flags = AssimpLoader::kImportFlags;
+  header.record_sizes_hash = recordSizesHash();
+  header.lod_settings_hash = lodSettingsHash(lod_settings);
+  if (!sourceStat(source_path, header.source_size, header.source_mtime) ||
+      !sourceHash(source_path, header.source_hash)) {
+    LOGW("mesh cache: failed to read source {}", source_path);
+    return false;
+  }
+
+  StringPool strings;
+  strings.add(""); // nonempty pool
+
+  // node hierarchy in pre order, so that parent comes first and siblings keep the order
+  std::vector<NodeRecord> node_records;
+  std::unordered_map<const TransformRelationship *, uint32_t> node_index;
+  std::vector<const TransformRelationship *> stack{desc.root_tr.get()};
+  while (!stack.empty()) {
+    auto tr = stack.back();
+    stack.pop_back();
+    NodeRecord r{INVALID_INDEX};
+    if (tr->parent != nullptr)
+      r.parent = node_index.at(tr->parent.get());
+    memcpy(r.ltransform, tr->ltransform.data(), sizeof(r.ltransform));
+    memcpy(r.aabb_min, tr->aabb.min().data(), sizeof(r.aabb_min));
+    memcpy(r.aabb_max, tr->aabb.max().data(), sizeof(r.aabb_max));
+    node_index.emplace(tr, static_cast<uint32_t>(node_records.size()));
+    node_records.emplace_back(r);
+    if (tr != desc.root_tr.get() && tr->sibling != nullptr)
+      stack.emplace_back(tr->sibling.get());
+    if (tr->child != nullptr)
+      stack.emplace_back(tr->child.get());
+  }
+  header.camera_node = node_index.at(desc.camera_tr.get());
+  header.camera_name = strings.add(desc.camera_name);
+
+  std::vector<RenderableRecord> renderable_records;
+  renderable_records.reserve(desc.renderables.size());
+  for (const auto &r : desc.renderables)
+    renderable_records.emplace_back(RenderableRecord{
+        strings.add(r.name), node_index.at(r.tr.get()), r.mesh_index,
+        r.material_index});
+
+  std::vector<CameraRecord> camera_records;
+  for (const auto &camera : desc.cameras) {
+    CameraRecord r{strings.add(camera.getName()), camera.getNear(),
+                   camera.getFar(), camera.getFovy(), camera.getAspect(),
+                   camera.getDis()};
+    memcpy(r.view, camera.getViewMatrix().data(), sizeof(r.view));
+    camera_records.emplace_back(r);
+  }
+
+  // materials, embedded textures are stored once
+  const std::string dir = sourceDir(source_path);
+  std::vector<MaterialRecord> material_records;
+  std::vector<TextureRecord> texture_records;
+  std::vector<FloatParamRecord> param_records;
+  std::vector<std::pair<const uint8_t *, uint32_t>> blobs;
+  std::unordered_map<const uint8_t *, uint64_t> blob_offsets; //!< offset in blob section
+  uint64_t blobs_size = 0;
+  for (const auto &mat : desc.materials) {
+    MaterialRecord r{static_cast<uint32_t>(texture_records.size()),
+                     static_cast<uint32_t>(mat.textures.size()),
+                     static_cast<uint32_t>(param_records.size()),
+                     static_cast<uint32_t>(mat.float_params.size()),
+                     mat.base_color.has_value()};
+    if (mat.base_color)
+      memcpy(r.base_color, mat.base_color->data(), sizeof(r.base_color));
+    for (const auto &t : mat.textures) {
+      TextureRecord tr{paramId(t.name)};
+      if (tr.name_id == INVALID_INDEX) {
+        LOGW("mesh cache: unknown texture param {}", t.name);
+        return false;
+      }
+      if (t.embedded_data != nullptr) {
+        tr.key = strings.add(t.key);
+        auto itr = blob_offsets.find(t.embedded_data);
+        if (itr == blob_offsets.end()) {
+          itr = blob_offsets.emplace(t.embedded_data, blobs_size).first;
+          blobs.emplace_back(t.embedded_data, t.embedded_size);
+          blobs_size += t.embedded_size;
+        }
+        tr.blob_offset = itr->second; // fixed up after layout
+        tr.blob_size = t.embedded_size;
+      } else if (t.key.compare(0, dir.size(), dir) == 0) {
+        tr.key = strings.add(t.key.substr(dir.size()));
+        tr.relative = 1;
+      } else {
+        tr.key = strings.add(t.key);
+      }
+      texture_records.emplace_back(tr);
+    }
+    for (const auto &p : mat.float_params) {
+      FloatParamRecord pr{paramId(p.first), p.second};
+      if (pr.name_id == INVALID_INDEX) {
+        LOGW("mesh cache: unknown material param {}", p.first);
+        return false;
+      }
+      param_records.emplace_back(pr);
+    }
+    material_records.emplace_back(r);
+  }
+
+  // layout
+  uint64_t vertices_size = 0;
+  uint64_t indices_size = 0;
+  for (const auto &m : meshes) {
+    vertices_size += m.vertices.size() * sizeof(float);
+    indices_size += m.indices.size() * sizeof(uint32_t);
+  }
+  const uint64_t section_sizes[SECTION_COUNT] = {
+      meshes.size() * sizeof(MeshRecord),
+      node_records.size() * sizeof(NodeRecord),
+      renderable_records.size() * sizeof(RenderableRecord),
+      material_records.size() * sizeof(MaterialRecord),
+      texture_records.size() * sizeof(TextureRecord),
+      param_records.size() * sizeof(FloatParamRecord),
+      camera_records.size() * sizeof(CameraRecord),
+      sizeof(Lights),
+      strings.data().size(),
+      blobs_size,
+      vertices_size,
+      indices_size};
+  uint64_t offset = alignUp(sizeof(MeshCacheHeader));
+  for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+    header.sections[i] = SectionRange{offset, section_sizes[i]};
+    offset = alignUp(offset + section_sizes[i]);
+  }
+  for (auto &t : texture_records) {
+    if (t.blob_size != 0)
+      t.blob_offset += header.sections[SECTION_BLOBS].offset;
+  }
+  std::vector<MeshRecord> mesh_records;
+  mesh_records.reserve(meshes.size());
+  uint64_t vertex_offset = header.sections[SECTION_VERTICES].offset;
+  uint64_t index_offset = header.sections[SECTION_INDICES].offset;
+  for (const auto &m : meshes) {
+    MeshRecord r{vertex_offset, index_offset,
+                 static_cast<uint32_t>(m.vertices.size() / 8),
+                 static_cast<uint32_t>(m.indices.size())};
+    memcpy(r.aabb_min, m.aabb.min().data(), sizeof(r.aabb_min));
+    memcpy(r.aabb_max, m.aabb.max().data(), sizeof(r.aabb_max));
+    r.lod_count = static_cast<uint32_t>(std::min<size_t>(m.lods.size(), MAX_MESH_LODS));
+    std::copy(m.lods.begin(), m.lods.begin() + r.lod_count, r.lods);
+    vertex_offset += m.vertices.size() * sizeof(float);
+    index_offset += m.indices.size() * sizeof(uint32_t);
+    mesh_records.emplace_back(r);
+  }
+
+  // write to a temporary file and rename, so a reader never sees a partial cache
+  const std::string path = cachePath(source_path);
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      LOGW("mesh cache: failed to create {}", tmp_path);
+      return false;
+    }
+    const auto put = [&ofs](const void *data, uint64_t size) {
+      ofs.write(static_cast<const char *>(data), size);
+    };
+    const auto seek = [&ofs, &header](uint32_t s) {
+      // zero padding up to the section
+      static const char zeros[MESH_CACHE_ALIGNMENT] = {};
+      uint64_t pos = static_cast<uint64_t>(ofs.tellp());
+      ofs.write(zeros, header.sections[s].offset - pos);
+    };
+    put(&header, sizeof(header));
+    seek(SECTION_MESHES);
+    put(mesh_records.data(), section_sizes[SECTION_MESHES]);
+    seek(SECTION_NODES);
+    put(node_records.data(), section_sizes[SECTION_NODES]);
+    seek(SECTION_RENDERABLES);
+    put(renderable_records.data(), section_sizes[SECTION_RENDERABLES]);
+    seek(SECTION_MATERIALS);
+    put(material_records.data(), section_sizes[SECTION_MATERIALS]);
+    seek(SECTION_TEXTURES);
+    put(texture_records.data(), section_sizes[SECTION_TEXTURES]);
+    seek(SECTION_FLOAT_PARAMS);
+    put(param_records.data(), section_sizes[SECTION_FLOAT_PARAMS]);
+    seek(SECTION_CAMERAS);
+    put(camera_records.data(), section_sizes[SECTION_CAMERAS]);
+    seek(SECTION_LIGHTS);
+    put(&desc.lights, sizeof(Lights));
+    seek(SECTION_STRINGS);
+    put(strings.data().data(), section_sizes[SECTION_STRINGS]);
+    seek(SECTION_BLOBS);
+    for (const auto &b : blobs)
+      put(b.first, b.second);
+    seek(SECTION_VERTICES);
+    for (const auto &m : meshes)
+      put(m.vertices.data(), m.vertices.size() * sizeof(float));
+    seek(SECTION_INDICES);
+    for (const auto &m : meshes)
+      put(m.indices.data(), m.indices.size() * sizeof(uint32_t));
+    if (!ofs) {
+      LOGW("mesh cache: failed to write {}", tmp_path);
+      ofs.close();
+      std::error_code ec;
+      std::filesystem::remove(tmp_path, ec);
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    LOGW("mesh cache: failed to rename {}: {}", tmp_path, ec.message());
+    std::filesystem::remove(tmp_path, ec);
+    return false;
+  }
+  LOGI("mesh cache: written {}", path);
+  return true;
+}
+
+} // namespace vk_engine
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <framework/resources/loader.h>
+#include <framework/utils/base/mapped_file.h>
+
+namespace vk_engine {
+
+struct MeshCacheHeader;
+
+/**
+ * \brief MeshCache is the binary form of an imported scene, stored next to the
+ * source file as `<source>.vkmc`.
+ *
+ * It holds the packed interleaved vertices, indices, aabbs, node hierarchy,
+ * cameras, lights, material descriptions and the embedded texture blobs. The
+ * file is memory mapped and mesh data is uploaded straight from the mapping.
+ * A cache is valid if it was written with the same format version, import
+ * flags and lod settings, and the source file has the same size and mtime, or
+ * the same content hash when only the mtime changed.
+ *
+ * layout: header | sections of records | string pool | texture blobs | vertices | indices
+ */
+class MeshCache final {
+public:
+  /**
+   * \brief map the cache of the source file, nullptr if missing or out of date
+   */
+  static std::unique_ptr<MeshCache> open(const std::string &source_path,
+                                         const MeshLodSettings &lod_settings);
+
+  /**
+   * \brief write the cache of the source file, the embedded textures of desc
+   * must be still alive. return false(and logged) if failed
+   */
+  static bool write(const std::string &source_path,
+                    const MeshLodSettings &lod_settings, const SceneDesc &desc,
+                    const std::vector<MeshData> &meshes);
+
+  static std::string cachePath(const std::string &source_path);
+
+  /**
+   * \brief directory of source file with the trailing separator, texture paths are relative to it
+   */
+  static std::string sourceDir(const std::string &source_path);
+
+  /**
+   * \brief rebuild the scene description, embedded texture data points into the mapping
+   */
+  void buildSceneDesc(SceneDesc &desc) const;
+
+  uint32_t meshCount() const;
+
+  /**
+   * \brief mesh data in the mapping, valid while the cache is alive
+   */
+  MeshDataView mesh(uint32_t index) const;
+
+  MeshCache(const MeshCache &) = delete;
+  MeshCache &operator=(const MeshCache &) = delete;
+
+private:
+  MeshCache() = default;
+
+  template <typename T> const T *section(uint32_t index) const;
+
+  const char *string(uint32_t offset) const;
+
+  MappedFile file_;
+  const MeshCacheHeader *header_{nullptr};
+  std::string dir_;
+};
+
+} // namespace vk_engine
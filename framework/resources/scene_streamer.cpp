@@ -0,0 +1,236 @@
+#include <framework/resources/scene_streamer.h>
+
+#include <cstring>
+
+#include <framework/utils/base/logging.h>
+#include <framework/resources/mesh_cache.h>
+#include <framework/utils/vk/image.h>
+#include <framework/utils/vk/upload_scheduler.h>
+#include <framework/resources/asset_manager.hpp>
+#include <framework/functional/component/material_pbr.h>
+
+namespace vk_engine {
+
+SceneStreamer::~SceneStreamer() {
+  cancel_ = true;
+  if (worker_.joinable())
+    worker_.join();
+  // callbacks still queued in the scheduler must not touch this streamer
+  alive_.reset();
+}
+
+void SceneStreamer::start(const std::string &path) {
+  if (worker_.joinable())
+    throw std::runtime_error("scene streamer already started");
+  compress_textures_ =
+      bcTexturesSupported(getDefaultAppContext().driver->getPhysicalDevice());
+  worker_ = std::thread(&SceneStreamer::run, this, path);
+}
+
+void SceneStreamer::run(const std::string path) {
+  try {
+    auto desc = std::make_unique<SceneDesc>();
+    std::vector<MeshData> meshes;
+    Assimp::Importer importer; // embedded textures are decoded from it if not cached
+    cache_ = MeshCache::open(path, lod_settings_);
+    if (cache_ == nullptr) {
+      const aiScene *a_scene =
+          importer.ReadFile(path, AssimpLoader::kImportFlags);
+      if (!a_scene) {
+        throw std::runtime_error("Assimp import error:" +
+                                 std::string(importer.GetErrorString()));
+      }
+      AssimpLoader loader;
+      loader.buildSceneDesc(a_scene, MeshCache::sourceDir(path), *desc);
+      meshes = AssimpLoader::packMeshes(a_scene, lod_settings_);
+      if (!cancel_ && MeshCache::write(path, lod_settings_, *desc, meshes))
+        cache_ = MeshCache::open(path, lod_settings_);
+    }
+    if (cache_ != nullptr) {
+      // stream from the mapping
+      desc = std::make_unique<SceneDesc>();
+      cache_->buildSceneDesc(*desc);
+      meshes.clear();
+    }
+
+    // unique textures, embedded texture data is only valid in this thread
+    std::map<TextureKey, std::pair<const uint8_t *, uint32_t>> textures;
+    for (auto &m : desc->materials) {
+      for (auto &t : m.textures) {
+        textures.emplace(TextureKey(t.key, textureUsage(t.name)),
+                         std::make_pair(t.embedded_data, t.embedded_size));
+        t.embedded_data = nullptr;
+        t.embedded_size = 0;
+      }
+    }
+    const uint32_t mesh_count = desc->mesh_count;
+    total_items_ = 1 + mesh_count + textures.size();
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      ready_desc_ = std::move(desc);
+    }
+
+    for (uint32_t i = 0; i < mesh_count && !cancel_; ++i) {
+      ReadyMesh mesh{i};
+      if (cache_ != nullptr) {
+        mesh.view = cache_->mesh(i);
+      } else {
+        mesh.data = std::move(meshes[i]);
+        mesh.view = mesh.data; // vector buffers are kept by move
+      }
+      std::lock_guard<std::mutex> lk(mtx_);
+      ready_meshes_.emplace_back(std::move(mesh));
+    }
+
+    for (auto itr = textures.begin(); itr != textures.end() && !cancel_; ++itr) {
+      ReadyTexture t{itr->first, false};
+      const auto &embedded = itr->second;
+      const auto usage = itr->first.second;
+      t.valid = (embedded.first != nullptr)
+                    ? loadTextureData(embedded.first, embedded.second, usage,
+                                      compress_textures_, t.data)
+                    : loadTextureData(itr->first.first, usage,
+                                      compress_textures_, t.data);
+      if (!t.valid)
+        LOGW("failed to load texture: {}", itr->first.first);
+      std::lock_guard<std::mutex> lk(mtx_);
+      ready_textures_.emplace_back(std::move(t));
+    }
+    LOGI("stream scene: {} decoded{}", path.c_str(),
+         cache_ != nullptr ? " (cached)" : "");
+  } catch (const std::exception &e) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    error_ = e.what();
+  }
+  worker_done_ = true;
+}
+
+void SceneStreamer::update(Scene &scene) {
+  std::unique_ptr<SceneDesc> desc;
+  std::vector<ReadyMesh> meshes;
+  std::vector<ReadyTexture> textures;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!error_.empty())
+      throw std::runtime_error(error_);
+    desc = std::move(ready_desc_);
+    size_t bytes = 0;
+    while (!ready_meshes_.empty() && (bytes < upload_budget_ || meshes.empty())) {
+      const auto &m = ready_meshes_.front().view;
+      bytes += m.vertex_count * 8 * sizeof(float) +
+               m.index_count * sizeof(uint32_t);
+      meshes.emplace_back(std::move(ready_meshes_.front()));
+      ready_meshes_.pop_front();
+    }
+    while (!ready_textures_.empty() && bytes < upload_budget_) {
+      auto &t = ready_textures_.front();
+      for (const auto &l : t.data.levels)
+        bytes += l.size();
+      textures.emplace_back(std::move(t));
+      ready_textures_.pop_front();
+    }
+  }
+
+  // uploads go to the transfer queue, the resources are published to scene
+  // once acquired by the graphics queue
+  auto &scheduler = *getDefaultAppContext().upload_scheduler;
+  if (desc != nullptr)
+    publishDesc(*desc, scene, scheduler);
+  assert(scene_ready_ || (meshes.empty() && textures.empty()));
+
+  for (const auto &m : meshes) {
+    auto mesh = AssimpLoader::createStaticMesh(m.view, scheduler, quantization_);
+    std::vector<std::pair<RenderableDesc, std::shared_ptr<Material>>> renderables;
+    for (auto ri : mesh_renderables_[m.index])
+      renderables.emplace_back(renderables_[ri],
+                               materials_[renderables_[ri].material_index]);
+    scheduler.onAcquired([this, alive = std::weak_ptr<bool>(alive_), &scene, mesh,
+                          renderables = std::move(renderables)]() {
+      if (alive.expired())
+        return;
+      for (const auto &r : renderables)
+        scene.createRenderableEntity(r.first.name, r.first.tr, r.second, mesh);
+      ++published_items_;
+    });
+  }
+
+  for (auto &t : textures) {
+    std::shared_ptr<ImageView> img_view;
+    if (t.valid)
+      img_view = createImageView(t.data, scheduler);
+    // swap the placeholder. frames in flight keep sampling it through the material's
+    // current set, Material::updateParams writes the streamed view to a new one
+    scheduler.onAcquired([this, alive = std::weak_ptr<bool>(alive_), img_view,
+                          slots = std::move(texture_slots_[t.key])]() {
+      if (alive.expired())
+        return;
+      if (img_view != nullptr) {
+        for (auto &slot : slots)
+          slot.first->setTexture(slot.second, img_view);
+      }
+      ++published_items_;
+    });
+    texture_slots_.erase(t.key);
+  }
+}
+
+void SceneStreamer::publishDesc(SceneDesc &desc, Scene &scene,
+                                UploadScheduler &scheduler) {
+  AssimpLoader::setupScene(desc, scene);
+
+  // compile with placeholders, so the shader variant won't change while streaming
+  materials_.resize(desc.materials.size());
+  for (uint32_t i = 0; i < desc.materials.size(); ++i) {
+    auto mat = std::make_shared<PbrMaterial>();
+    for (const auto &t : desc.materials[i].textures) {
+      mat->setTexture(t.name, requestPlaceholder(t.name, scheduler));
+      texture_slots_[TextureKey(t.key, textureUsage(t.name))].emplace_back(mat, t.name);
+    }
+    AssimpLoader::applyMaterialParams(desc.materials[i], *mat);
+    mat->compile();
+    materials_[i] = mat;
+  }
+
+  renderables_ = std::move(desc.renderables);
+  mesh_renderables_.resize(desc.mesh_count);
+  for (uint32_t i = 0; i < renderables_.size(); ++i)
+    mesh_renderables_[renderables_[i].mesh_index].emplace_back(i);
+  scene_ready_ = true;
+  ++published_items_;
+}
+
+std::shared_ptr<ImageView>
+SceneStreamer::requestPlaceholder(const char *texture_name,
+                                  UploadScheduler &scheduler) {
+  // neutral value of each texture: rgba
+  uint8_t color[4] = {255, 255, 255, 255};
+  if (strcmp(texture_name, METALLIC_TEXTURE_NAME) == 0) {
+    color[0] = color[1] = color[2] = 0;
+  } else if (strcmp(texture_name, METALLIC_ROUGHNESS_TEXTURE_NAME) == 0) {
+    color[0] = color[2] = 0; // r: metallic, g: roughness
+  } else if (strcmp(texture_name, SPECULAR_TEXTURE_NAME) == 0) {
+    color[0] = color[1] = color[2] = 188; // 0.5 after srgb decode
+  } else if (strcmp(texture_name, NORMAL_TEXTURE_NAME) == 0) {
+    color[0] = color[1] = 128; // flat normal
+  }
+  uint32_t key = 0;
+  memcpy(&key, color, sizeof(key));
+  auto itr = placeholders_.find(key);
+  if (itr != placeholders_.end())
+    return itr->second;
+  auto img_view = createImageView(color, 1, 1, 4, scheduler);
+  placeholders_.emplace(key, img_view);
+  return img_view;
+}
+
+float SceneStreamer::progress() const {
+  uint32_t total = total_items_;
+  if (total == 0)
+    return 0.0f;
+  return static_cast<float>(published_items_) / total;
+}
+
+bool SceneStreamer::finished() const {
+  return worker_done_ && total_items_ != 0 && published_items_ == total_items_;
+}
+} // namespace vk_engine
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <framework/resources/loader.h>
+#include <framework/resources/texture_compressor.h>
+
+namespace vk_engine {
+
+class ImageView;
+class MeshCache;
+class UploadScheduler;
+
+/**
+ * \brief SceneStreamer loads a scene in a background thread and publishes it
+ * to the Scene progressively.
+ *
+ * The worker thread maps the mesh cache, or does the assimp import, vertex/index
+ * packing and writes the cache, then decodes the textures and block compresses
+ * them(through the texture cache) if the device supports it. update() should be called once per frame from the render thread,
+ * it uploads the ready items within a byte budget through the UploadScheduler:
+ * the hierarchy, camera, light and materials(with 1x1 placeholder textures)
+ * come first, renderables appear as their meshes are acquired by the graphics
+ * queue, and textures are swapped in the same way.
+ *
+ * The publishing callbacks stay in the UploadScheduler until acquired, they are
+ * dropped if the streamer is destroyed first. The scene passed to update must
+ * outlive the streamer.
+ */
+class SceneStreamer final {
+public:
+  SceneStreamer() = default;
+
+  /**
+   * \brief cancel the worker and drop the pending publishing callbacks, on the render thread
+   */
+  ~SceneStreamer();
+
+  void start(const std::string &path);
+
+  void update(Scene &scene);
+
+  /**
+   * \brief ratio of the published items in [0, 1]
+   */
+  float progress() const;
+
+  bool finished() const;
+
+  /**
+   * \brief whether the hierarchy, camera and light have been published
+   */
+  bool sceneReady() const { return scene_ready_; }
+
+  /**
+   * \brief max bytes uploaded by one update call, at least one item is uploaded
+   */
+  void setUploadBudget(const size_t bytes) { upload_budget_ = bytes; }
+
+  /**
+   * \brief opt-in compact vertex layout, set before start
+   */
+  void setVertexQuantization(const VertexQuantization &quantization) {
+    quantization_ = quantization;
+  }
+
+  /**
+   * \brief lod generation of the imported meshes, set before start
+   */
+  void setLodSettings(const MeshLodSettings &settings) { lod_settings_ = settings; }
+
+  SceneStreamer(const SceneStreamer &) = delete;
+  SceneStreamer &operator=(const SceneStreamer &) = delete;
+
+private:
+  struct ReadyMesh {
+    uint32_t index;
+    MeshData data;     //!< empty if mapped from the mesh cache
+    MeshDataView view; //!< points to data or into the mesh cache
+  };
+
+  //! a file may be sampled with different usages
+  using TextureKey = std::pair<std::string, TextureUsage>;
+
+  struct ReadyTexture {
+    TextureKey key;
+    bool valid; //!< false if decode failed
+    TextureData data;
+  };
+
+  void run(const std::string path);
+
+  void publishDesc(SceneDesc &desc, Scene &scene, UploadScheduler &scheduler);
+
+  std::shared_ptr<ImageView> requestPlaceholder(const char *texture_name,
+                                                UploadScheduler &scheduler);
+
+  std::unique_ptr<MeshCache> cache_; //!< written by worker before meshes are ready
+  bool compress_textures_{false};    //!< set before the worker starts
+  MeshLodSettings lod_settings_; //!< set before the worker starts
+  std::thread worker_;
+  std::atomic<bool> cancel_{false};
+  std::atomic<bool> worker_done_{false};
+  std::atomic<uint32_t> total_items_{0};
+  std::atomic<uint32_t> published_items_{0};
+
+  std::mutex mtx_; //!< guard the ready items and error
+  std::unique_ptr<SceneDesc> ready_desc_;
+  std::deque<ReadyMesh> ready_meshes_;
+  std::deque<ReadyTexture> ready_textures_;
+  std::string error_;
+
+  // render thread only
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)}; //!< expired by the destructor
+  bool scene_ready_{false};
+  size_t upload_budget_{32u << 20};
+  VertexQuantization quantization_;
+  std::vector<std::shared_ptr<Material>> materials_;
+  std::vector<RenderableDesc> renderables_;
+  std::vector<std::vector<uint32_t>> mesh_renderables_; //!< mesh index -> renderable indices
+  std::map<TextureKey, std::vector<std::pair<std::shared_ptr<Material>, const char *>>> texture_slots_;
+  std::map<uint32_t, std::shared_ptr<ImageView>> placeholders_; //!< packed rgba8 -> 1x1 image
+};
+} // namespace vk_engine
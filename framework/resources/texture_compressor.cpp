@@ -0,0 +1,271 @@
+#include <framework/resources/texture_compressor.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stb_image.h>
+#include <thread>
+
+#include <framework/utils/base/bc_encoder.h>
+#include <framework/utils/base/hash.h>
+#include <framework/utils/base/logging.h>
+#include <framework/utils/base/mapped_file.h>
+#include <framework/utils/base/mipmap.h>
+#include <framework/utils/base/pixel_convert.h>
+#include <framework/functional/component/material.h>
+
+namespace vk_engine {
+
+constexpr uint32_t TEXTURE_CACHE_MAGIC = 0x43544b56; // "VKTC"
+constexpr uint32_t TEXTURE_CACHE_VERSION = 2; // 2: bc3 for alpha masks
+
+struct TextureCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format; //!< VkFormat
+  uint32_t width;
+  uint32_t height;
+  uint32_t level_count; //!< followed by uint64_t level sizes, then the levels
+};
+
+static std::mutex cache_dir_mtx;
+static std::optional<std::string> cache_dir; //!< default on first use
+
+TextureUsage textureUsage(const char *texture_name) {
+  if (strcmp(texture_name, NORMAL_TEXTURE_NAME) == 0)
+    return TextureUsage::NORMAL;
+  if (strcmp(texture_name, METALLIC_ROUGHNESS_TEXTURE_NAME) == 0)
+    return TextureUsage::DUAL_CHANNEL;
+  if (strcmp(texture_name, METALLIC_TEXTURE_NAME) == 0 ||
+      strcmp(texture_name, ROUGHNESS_TEXTURE_NAME) == 0 ||
+      strcmp(texture_name, SPECULAR_TEXTURE_NAME) == 0)
+    return TextureUsage::SINGLE_CHANNEL;
+  return TextureUsage::COLOR;
+}
+
+bool bcTexturesSupported(VkPhysicalDevice physical_device) {
+  VkPhysicalDeviceFeatures features;
+  vkGetPhysicalDeviceFeatures(physical_device, &features);
+  if (features.textureCompressionBC != VK_TRUE)
+    return false;
+  for (auto format : {VK_FORMAT_BC1_RGB_SRGB_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK,
+                      VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_BC5_UNORM_BLOCK,
+                      VK_FORMAT_BC7_SRGB_BLOCK}) {
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(physical_device, format, &props);
+    if ((props.optimalTilingFeatures &
+         VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) == 0)
+      return false;
+  }
+  return true;
+}
+
+void setTextureCacheDir(const std::string &dir) {
+  std::lock_guard<std::mutex> lk(cache_dir_mtx);
+  cache_dir = dir;
+}
+
+static std::string textureCacheDir() {
+  std::lock_guard<std::mutex> lk(cache_dir_mtx);
+  if (!cache_dir) {
+    std::error_code ec;
+    auto temp_dir = std::filesystem::temp_directory_path(ec);
+    cache_dir = ec ? std::string() : (temp_dir / "vk_engine_texture_cache").string();
+  }
+  return *cache_dir;
+}
+
+static size_t levelBytes(VkFormat format, uint32_t width, uint32_t height) {
+  const size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+  switch (format) {
+  case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+  case VK_FORMAT_BC4_UNORM_BLOCK:
+    return blocks * 8;
+  case VK_FORMAT_BC3_SRGB_BLOCK:
+  case VK_FORMAT_BC5_UNORM_BLOCK:
+  case VK_FORMAT_BC7_SRGB_BLOCK:
+    return blocks * 16;
+  default:
+    return static_cast<size_t>(width) * height * 4;
+  }
+}
+
+static bool readCache(const std::string &path, TextureData &out) {
+  MappedFile file;
+  if (!file.open(path))
+    return false;
+  TextureCacheHeader header;
+  if (file.size() < sizeof(header))
+    return false;
+  memcpy(&header, file.data(), sizeof(header));
+  if (header.magic != TEXTURE_CACHE_MAGIC ||
+      header.version != TEXTURE_CACHE_VERSION || header.level_count == 0 ||
+      header.level_count > 32)
+    return false;
+  size_t offset = sizeof(header) + header.level_count * sizeof(uint64_t);
+  if (file.size() < offset)
+    return false;
+  std::vector<uint64_t> sizes(header.level_count);
+  memcpy(sizes.data(), file.data() + sizeof(header), sizes.size() * sizeof(uint64_t));
+
+  const auto format = static_cast<VkFormat>(header.format);
+  out.levels.resize(header.level_count);
+  for (uint32_t i = 0; i < header.level_count; ++i) {
+    const size_t expected =
+        levelBytes(format, std::max(header.width >> i, 1u),
+                   std::max(header.height >> i, 1u));
+    if (sizes[i] != expected || file.size() < offset + expected)
+      return false;
+    out.levels[i].assign(file.data() + offset, file.data() + offset + expected);
+    offset += expected;
+  }
+  out.format = format;
+  out.width = header.width;
+  out.height = header.height;
+  return true;
+}
+
+static void writeCache(const std::string &path, const TextureData &data) {
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+  // unique temporary file, the same texture may be written by several threads
+  std::stringstream tmp_path;
+  tmp_path << path << ".tmp" << std::this_thread::get_id();
+  {
+    std::ofstream ofs(tmp_path.str(), std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      LOGW("texture cache: failed to create {}", tmp_path.str());
+      return;
+    }
+    TextureCacheHeader header{TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION,
+                              static_cast<uint32_t>(data.format), data.width,
+                              data.height,
+                              static_cast<uint32_t>(data.levels.size())};
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto &l : data.levels) {
+      uint64_t size = l.size();
+      ofs.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    }
+    for (const auto &l : data.levels)
+      ofs.write(reinterpret_cast<const char *>(l.data()), l.size());
+    if (!ofs) {
+      LOGW("texture cache: failed to write {}", tmp_path.str());
+      ofs.close();
+      std::filesystem::remove(tmp_path.str(), ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp_path.str(), path, ec);
+  if (ec) {
+    LOGW("texture cache: failed to rename {}: {}", tmp_path.str(), ec.message());
+    std::filesystem::remove(tmp_path.str(), ec);
+  }
+}
+
+static void compressTexture(const std::vector<std::vector<uint8_t>> &rgba_levels,
+                            TextureUsage usage, TextureData &out) {
+  BcFormat bc_format = BcFormat::BC1;
+  switch (usage) {
+  case TextureUsage::COLOR: {
+    // bc1 has no usable alpha in 4 color mode. bc7 mode 6 interpolates alpha with the
+    // color indices, which blurs the edges of cutout masks, bc3 keeps its own alpha indices
+    const auto &l0 = rgba_levels[0];
+    bool opaque = true, mask = true;
+    for (size_t i = 3; i < l0.size(); i += 4) {
+      opaque = opaque && (l0[i] == 255);
+      mask = mask && (l0[i] == 0 || l0[i] == 255);
+    }
+    if (opaque) {
+      bc_format = BcFormat::BC1;
+      out.format = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    } else if (mask) {
+      bc_format = BcFormat::BC3;
+      out.format = VK_FORMAT_BC3_SRGB_BLOCK;
+    } else {
+      bc_format = BcFormat::BC7;
+      out.format = VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+    break;
+  }
+  case TextureUsage::SINGLE_CHANNEL:
+    bc_format = BcFormat::BC4;
+    out.format = VK_FORMAT_BC4_UNORM_BLOCK;
+    break;
+  case TextureUsage::NORMAL:
+  case TextureUsage::DUAL_CHANNEL:
+    bc_format = BcFormat::BC5;
+    out.format = VK_FORMAT_BC5_UNORM_BLOCK;
+    break;
+  }
+  out.levels.resize(rgba_levels.size());
+  for (uint32_t i = 0; i < rgba_levels.size(); ++i)
+    out.levels[i] = compressBc(rgba_levels[i].data(),
+                               std::max(out.width >> i, 1u),
+                               std::max(out.height >> i, 1u), bc_format);
+}
+
+bool loadTextureData(const uint8_t *file_data, size_t size, TextureUsage usage,
+                     bool compress, TextureData &out) {
+  std::string cache_path;
+  if (compress) {
+    const std::string dir = textureCacheDir();
+    if (!dir.empty()) {
+      const uint64_t seed =
+          (static_cast<uint64_t>(TEXTURE_CACHE_VERSION) << 32) |
+          static_cast<uint32_t>(usage);
+      char name[32];
+      snprintf(name, sizeof(name), "%016llx.vktc",
+               static_cast<unsigned long long>(hash64(file_data, size, seed)));
+      cache_path = (std::filesystem::path(dir) / name).string();
+      if (readCache(cache_path, out))
+        return true;
+    }
+  }
+
+  // decoded in the source channels, expanded to rgba by the simd kernels
+  int width = 0, height = 0, channel = 0;
+  stbi_uc *pixels = stbi_load_from_memory(file_data, static_cast<int>(size),
+                                          &width, &height, &channel, 0);
+  if (pixels == nullptr) {
+    LOGW("failed to decode texture: {}", stbi_failure_reason());
+    return false;
+  }
+  out.width = width;
+  out.height = height;
+  std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+  expandToRgba8(rgba.data(), pixels, channel, static_cast<size_t>(width) * height);
+  stbi_image_free(pixels);
+  // color is filtered in linear space, data textures as is
+  const bool srgb = (usage == TextureUsage::COLOR);
+  std::vector<std::vector<uint8_t>> levels =
+      generateMipChainRgba8(rgba.data(), out.width, out.height, srgb);
+  levels.emplace(levels.begin(), std::move(rgba));
+
+  if (!compress) {
+    out.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    out.levels = std::move(levels);
+    return true;
+  }
+  compressTexture(levels, usage, out);
+  if (!cache_path.empty())
+    writeCache(cache_path, out);
+  return true;
+}
+
+bool loadTextureData(const std::string &path, TextureUsage usage, bool compress,
+                     TextureData &out) {
+  MappedFile file;
+  if (!file.open(path)) {
+    LOGW("failed to open texture: {}", path);
+    return false;
+  }
+  return loadTextureData(file.data(), file.size(), usage, compress, out);
+}
+
+} // namespace vk_engine
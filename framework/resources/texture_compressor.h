@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <volk.h>
+
+namespace vk_engine {
+
+/**
+ * \brief how the texture is sampled, decides the compressed format.
+ * only COLOR is stored in _SRGB formats and its mips filtered in linear space. the
+ * data textures(normals, metallic, roughness...) are linear values and use _UNORM
+ * formats, compressed or not, so the sampler returns them unchanged
+ */
+enum class TextureUsage : uint32_t {
+  COLOR,          //!< srgb rgb(a): bc1 if opaque, bc3 for cutout alpha masks(0 or 255), otherwise bc7
+  NORMAL,         //!< tangent space normal, xy in rg: bc5
+  SINGLE_CHANNEL, //!< linear r, e.g. metallic, roughness: bc4
+  DUAL_CHANNEL    //!< linear rg, e.g. packed metallic roughness: bc5
+};
+
+/**
+ * \brief usage of a material texture param
+ */
+TextureUsage textureUsage(const char *texture_name);
+
+/**
+ * \brief cpu side texture with the full mip chain, ready for upload
+ */
+struct TextureData {
+  VkFormat format{VK_FORMAT_UNDEFINED};
+  uint32_t width{0};
+  uint32_t height{0};
+  std::vector<std::vector<uint8_t>> levels; //!< level 0 first, tightly packed
+};
+
+/**
+ * \brief whether the device samples the bc formats used by the texture compressor
+ */
+bool bcTexturesSupported(VkPhysicalDevice physical_device);
+
+/**
+ * \brief directory of the compressed texture cache, empty to disable.
+ * default is <temp>/vk_engine_texture_cache
+ */
+void setTextureCacheDir(const std::string &dir);
+
+/**
+ * \brief decode an image file(png, jpg...) and build its mip chain. If compress, levels are block
+ * compressed by usage and the result is cached on disk keyed by the file content, otherwise they are rgba8.
+ * thread safe. return false(and logged) if decode failed.
+ */
+bool loadTextureData(const uint8_t *file_data, size_t size, TextureUsage usage,
+                     bool compress, TextureData &out);
+
+bool loadTextureData(const std::string &path, TextureUsage usage, bool compress,
+                     TextureData &out);
+
+} // namespace vk_engine
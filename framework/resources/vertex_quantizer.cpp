@@ -0,0 +1,135 @@
+#include <framework/resources/vertex_quantizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vk_engine {
+
+uint32_t vertexStride(VertexLayout layout) {
+  switch (layout) {
+  case VertexLayout::QUANTIZED16:
+    return 16;
+  case VertexLayout::QUANTIZED8:
+    return 12;
+  default:
+    return 8 * sizeof(float);
+  }
+}
+
+static Eigen::Vector3f octDecode(float x, float y) {
+  Eigen::Vector3f n(x, y, 1.0f - std::abs(x) - std::abs(y));
+  const float t = std::max(-n.z(), 0.0f);
+  n.x() += (n.x() >= 0.0f) ? -t : t;
+  n.y() += (n.y() >= 0.0f) ? -t : t;
+  return n.normalized();
+}
+
+/**
+ * \brief octahedral encode to snorm of bits, the rounding with the least angle error is chosen
+ */
+static float octEncode(const Eigen::Vector3f &normal, uint32_t bits,
+                       int32_t q[2]) {
+  const float range = static_cast<float>((1 << (bits - 1)) - 1);
+  const float l1 = normal.cwiseAbs().sum();
+  if (l1 <= 0.0f) {
+    q[0] = q[1] = 0;
+    return 0.0f;
+  }
+  float u = normal.x() / l1;
+  float v = normal.y() / l1;
+  if (normal.z() < 0.0f) {
+    const float fu = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+    const float fv = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+    u = fu;
+    v = fv;
+  }
+  const Eigen::Vector3f n = normal.normalized();
+  float best_dot = -2.0f;
+  for (int i = 0; i < 4; ++i) {
+    const int32_t qu = static_cast<int32_t>((i & 1) ? std::ceil(u * range) : std::floor(u * range));
+    const int32_t qv = static_cast<int32_t>((i & 2) ? std::ceil(v * range) : std::floor(v * range));
+    const float dot = n.dot(octDecode(qu / range, qv / range));
+    if (dot > best_dot) {
+      best_dot = dot;
+      q[0] = qu;
+      q[1] = qv;
+    }
+  }
+  return std::acos(std::clamp(best_dot, -1.0f, 1.0f));
+}
+
+bool quantizeVertices(const float *vertices, uint32_t vertex_count,
+                      const VertexQuantization &quantization,
+                      std::vector<uint8_t> &out, Eigen::Vector3f &dequant_offset,
+                      Eigen::Vector3f &dequant_scale, VertexQuantizeError &error) {
+  const VertexLayout layout = quantization.layout;
+  error = VertexQuantizeError{};
+  if (layout == VertexLayout::FLOAT32) {
+    out.resize(static_cast<size_t>(vertex_count) * vertexStride(layout));
+    memcpy(out.data(), vertices, out.size());
+    dequant_offset.setZero();
+    dequant_scale.setOnes();
+    return true;
+  }
+
+  // quantize against the bounds of the vertices
+  Eigen::AlignedBox3f aabb;
+  for (uint32_t i = 0; i < vertex_count; ++i)
+    aabb.extend(Eigen::Vector3f::Map(vertices + 8 * i));
+  if (aabb.isEmpty())
+    aabb.extend(Eigen::Vector3f::Zero());
+  dequant_offset = aabb.min();
+  dequant_scale = aabb.sizes();
+
+  const uint32_t stride = vertexStride(layout);
+  const uint32_t normal_bits = (layout == VertexLayout::QUANTIZED16) ? 16 : 8;
+  out.assign(static_cast<size_t>(vertex_count) * stride, 0);
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    const float *v = vertices + 8 * i;
+    uint8_t *dst = out.data() + static_cast<size_t>(i) * stride;
+
+    uint16_t pos[4] = {0, 0, 0, 0};
+    Eigen::Vector3f decoded;
+    for (int k = 0; k < 3; ++k) {
+      const float t = dequant_scale[k] > 0.0f
+                          ? (v[k] - dequant_offset[k]) / dequant_scale[k]
+                          : 0.0f;
+      pos[k] = static_cast<uint16_t>(std::clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+      decoded[k] = dequant_offset[k] + dequant_scale[k] * (pos[k] / 65535.0f);
+    }
+    error.position = std::max(error.position,
+                              (decoded - Eigen::Vector3f::Map(v)).norm());
+
+    int32_t oct[2] = {0, 0};
+    error.normal = std::max(error.normal,
+                            octEncode(Eigen::Vector3f::Map(v + 3), normal_bits, oct));
+
+    uint16_t uv[2];
+    for (int k = 0; k < 2; ++k) {
+      uv[k] = floatToHalf(v[6 + k]);
+      error.uv = std::max(error.uv, std::abs(halfToFloat(uv[k]) - v[6 + k]));
+    }
+
+    if (layout == VertexLayout::QUANTIZED16) {
+      const int16_t normal[2] = {static_cast<int16_t>(oct[0]),
+                                 static_cast<int16_t>(oct[1])};
+      memcpy(dst, pos, 8);
+      memcpy(dst + 8, normal, 4);
+      memcpy(dst + 12, uv, 4);
+    } else {
+      // snorm8 x in the low byte, y in the high byte of pos.w
+      pos[3] = static_cast<uint16_t>((oct[0] & 0xff) | ((oct[1] & 0xff) << 8));
+      memcpy(dst, pos, 8);
+      memcpy(dst + 8, uv, 4);
+    }
+  }
+  // the unorm16 step scales with the bounds, an absolute bound would reject every large mesh
+  const float extent = dequant_scale.maxCoeff();
+  error.position = extent > 0.0f ? error.position / extent : 0.0f;
+  return error.position <= quantization.max_position_error &&
+         error.normal <= quantization.max_normal_error &&
+         error.uv <= quantization.max_uv_error;
+}
+
+} // namespace vk_engine
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <framework/functional/component/mesh.h>
+#include <framework/utils/base/pixel_convert.h>
+
+namespace vk_engine {
+
+/**
+ * \brief opt-in compact vertex layout, with the max error allowed. a mesh over
+ * any bound is kept in FLOAT32
+ */
+struct VertexQuantization {
+  VertexLayout layout{VertexLayout::FLOAT32};
+  float max_position_error{1e-4f}; //!< relative to the largest extent of the bounding box
+  float max_normal_error{0.02f};   //!< angle in radians, ~1.1 degree
+  float max_uv_error{1.0f / 2048};
+};
+
+struct VertexQuantizeError {
+  float position{0.0f}; //!< relative to the largest extent of the bounding box
+  float normal{0.0f};
+  float uv{0.0f};
+};
+
+uint32_t vertexStride(VertexLayout layout);
+
+/**
+ * \brief quantize the packed float vertices(pos3 | normal3 | uv2) to the layout,
+ * positions against their bounding box. error receives the max error of each
+ * attribute. return false if any exceeds the bound, out is undefined then
+ */
+bool quantizeVertices(const float *vertices, uint32_t vertex_count,
+                      const VertexQuantization &quantization,
+                      std::vector<uint8_t> &out, Eigen::Vector3f &dequant_offset,
+                      Eigen::Vector3f &dequant_scale, VertexQuantizeError &error);
+
+} // namespace vk_engine
@@ -0,0 +1,398 @@
+#include <framework/utils/base/bc_encoder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <framework/utils/base/parallel.h>
+
+namespace vk_engine {
+
+namespace {
+
+// the pixel loops are over fixed 16 element float arrays, so that the
+// compiler could vectorize them
+
+/**
+ * \brief principal axis of the first n channels of 16 pixels by power iteration
+ */
+template <int N>
+void principalAxis(const float px[16][4], float mean[4], float axis[4]) {
+  for (int c = 0; c < N; ++c) {
+    float s = 0.0f;
+    for (int i = 0; i < 16; ++i)
+      s += px[i][c];
+    mean[c] = s / 16.0f;
+  }
+  float cov[N][N] = {};
+  for (int i = 0; i < 16; ++i) {
+    float d[N];
+    for (int c = 0; c < N; ++c)
+      d[c] = px[i][c] - mean[c];
+    for (int r = 0; r < N; ++r)
+      for (int c = 0; c < N; ++c)
+        cov[r][c] += d[r] * d[c];
+  }
+  float v[N];
+  for (int c = 0; c < N; ++c)
+    v[c] = 1.0f;
+  for (int iter = 0; iter < 8; ++iter) {
+    float nv[N] = {};
+    for (int r = 0; r < N; ++r)
+      for (int c = 0; c < N; ++c)
+        nv[r] += cov[r][c] * v[c];
+    float len = 0.0f;
+    for (int c = 0; c < N; ++c)
+      len = std::max(len, std::abs(nv[c]));
+    if (len < 1e-6f)
+      break; // flat block
+    for (int c = 0; c < N; ++c)
+      v[c] = nv[c] / len;
+  }
+  float len = 0.0f;
+  for (int c = 0; c < N; ++c)
+    len += v[c] * v[c];
+  len = std::sqrt(len);
+  for (int c = 0; c < N; ++c)
+    axis[c] = v[c] / len;
+}
+
+/**
+ * \brief end points of the pixels projected on the principal axis
+ */
+template <int N>
+void axisEndpoints(const float px[16][4], float e0[4], float e1[4]) {
+  float mean[4], axis[4];
+  principalAxis<N>(px, mean, axis);
+  float tmin = 0.0f, tmax = 0.0f;
+  for (int i = 0; i < 16; ++i) {
+    float t = 0.0f;
+    for (int c = 0; c < N; ++c)
+      t += (px[i][c] - mean[c]) * axis[c];
+    tmin = std::min(tmin, t);
+    tmax = std::max(tmax, t);
+  }
+  for (int c = 0; c < N; ++c) {
+    e0[c] = std::clamp(mean[c] + tmin * axis[c], 0.0f, 255.0f);
+    e1[c] = std::clamp(mean[c] + tmax * axis[c], 0.0f, 255.0f);
+  }
+}
+
+void loadBlock(const uint8_t *rgba, float px[16][4]) {
+  for (int i = 0; i < 16; ++i)
+    for (int c = 0; c < 4; ++c)
+      px[i][c] = rgba[4 * i + c];
+}
+
+// ---------------------------------------------------------------- bc1
+uint16_t to565(const float c[3]) {
+  uint32_t r = static_cast<uint32_t>(std::clamp(c[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+  uint32_t g = static_cast<uint32_t>(std::clamp(c[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+  uint32_t b = static_cast<uint32_t>(std::clamp(c[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void from565(const uint16_t v, float c[3]) {
+  uint32_t r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+  c[0] = static_cast<float>((r << 3) | (r >> 2));
+  c[1] = static_cast<float>((g << 2) | (g >> 4));
+  c[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+/**
+ * \brief pick the indices of the 4 color palette, return the squared error
+ */
+float bc1Indices(const float px[16][4], uint16_t c0, uint16_t c1,
+                 uint8_t indices[16]) {
+  float palette[4][3];
+  from565(c0, palette[0]);
+  from565(c1, palette[1]);
+  for (int c = 0; c < 3; ++c) {
+    palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+    palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+  }
+  float error = 0.0f;
+  for (int i = 0; i < 16; ++i) {
+    float best = 1e30f;
+    for (uint8_t p = 0; p < 4; ++p) {
+      float d = 0.0f;
+      for (int c = 0; c < 3; ++c)
+        d += (px[i][c] - palette[p][c]) * (px[i][c] - palette[p][c]);
+      if (d < best) {
+        best = d;
+        indices[i] = p;
+      }
+    }
+    error += best;
+  }
+  return error;
+}
+
+/**
+ * \brief least squares end points for the given indices
+ */
+bool bc1Refit(const float px[16][4], const uint8_t indices[16], float e0[3],
+              float e1[3]) {
+  static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+  float ax[3] = {}, bx[3] = {};
+  for (int i = 0; i < 16; ++i) {
+    const float a = weights[indices[i]];
+    const float b = 1.0f - a;
+    aa += a * a;
+    bb += b * b;
+    ab += a * b;
+    for (int c = 0; c < 3; ++c) {
+      ax[c] += a * px[i][c];
+      bx[c] += b * px[i][c];
+    }
+  }
+  const float det = aa * bb - ab * ab;
+  if (std::abs(det) < 1e-6f)
+    return false;
+  for (int c = 0; c < 3; ++c) {
+    e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+    e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+  }
+  return true;
+}
+
+void writeBc1(uint16_t c0, uint16_t c1, const uint8_t indices[16],
+              uint8_t *out) {
+  uint32_t bits = 0;
+  for (int i = 0; i < 16; ++i)
+    bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+  out[0] = c0 & 0xFF;
+  out[1] = c0 >> 8;
+  out[2] = c1 & 0xFF;
+  out[3] = c1 >> 8;
+  for (int i = 0; i < 4; ++i)
+    out[4 + i] = (bits >> (8 * i)) & 0xFF;
+}
+
+/**
+ * \brief always 4 color mode, as required by bc3
+ */
+void encodeBc1(const float px[16][4], uint8_t *out) {
+  float e0[4], e1[4];
+  axisEndpoints<3>(px, e0, e1);
+  // inset the end points a little, the extremes are usually outliers
+  for (int c = 0; c < 3; ++c) {
+    const float inset = (e1[c] - e0[c]) / 16.0f;
+    e0[c] += inset;
+    e1[c] -= inset;
+  }
+
+  uint16_t best_c0 = 0, best_c1 = 0;
+  uint8_t best_indices[16] = {};
+  float best_error = 1e30f;
+  for (int iter = 0; iter < 2; ++iter) {
+    uint16_t c0 = to565(e1);
+    uint16_t c1 = to565(e0);
+    if (c0 < c1)
+      std::swap(c0, c1);
+    uint8_t indices[16] = {};
+    float error = 0.0f;
+    if (c0 == c1) {
+      float p[3];
+      from565(c0, p);
+      for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+          error += (px[i][c] - p[c]) * (px[i][c] - p[c]);
+    } else {
+      error = bc1Indices(px, c0, c1, indices);
+    }
+    if (error < best_error) {
+      best_error = error;
+      best_c0 = c0;
+      best_c1 = c1;
+      memcpy(best_indices, indices, sizeof(indices));
+    }
+    // refit: e1 <- color of index 0, e0 <- color of index 1
+    if (c0 == c1 || !bc1Refit(px, indices, e1, e0))
+      break;
+  }
+  writeBc1(best_c0, best_c1, best_indices, out);
+}
+
+// ---------------------------------------------------------------- bc4
+/**
+ * \brief 8 value mode, out 8 bytes
+ */
+void encodeBc4(const float v[16], uint8_t *out) {
+  float vmin = v[0], vmax = v[0];
+  for (int i = 1; i < 16; ++i) {
+    vmin = std::min(vmin, v[i]);
+    vmax = std::max(vmax, v[i]);
+  }
+  const uint32_t r0 = static_cast<uint32_t>(vmax + 0.5f);
+  const uint32_t r1 = static_cast<uint32_t>(vmin + 0.5f);
+  out[0] = static_cast<uint8_t>(r0);
+  out[1] = static_cast<uint8_t>(r1);
+  uint64_t bits = 0;
+  if (r0 > r1) {
+    const float scale = 7.0f / (r0 - r1);
+    for (int i = 0; i < 16; ++i) {
+      // step 0 is r0, 7 is r1
+      uint32_t step = static_cast<uint32_t>(
+          std::clamp((r0 - v[i]) * scale + 0.5f, 0.0f, 7.0f));
+      uint32_t index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+      bits |= static_cast<uint64_t>(index) << (3 * i);
+    }
+  }
+  for (int i = 0; i < 6; ++i)
+    out[2 + i] = (bits >> (8 * i)) & 0xFF;
+}
+
+void encodeBc4Channel(const float px[16][4], int channel, uint8_t *out) {
+  float v[16];
+  for (int i = 0; i < 16; ++i)
+    v[i] = px[i][channel];
+  encodeBc4(v, out);
+}
+
+// ---------------------------------------------------------------- bc7
+class BitWriter {
+public:
+  explicit BitWriter(uint8_t *out) : out_(out) { memset(out_, 0, 16); }
+
+  void put(uint32_t value, uint32_t bits) {
+    for (uint32_t i = 0; i < bits; ++i, ++pos_)
+      out_[pos_ >> 3] |= ((value >> i) & 1) << (pos_ & 7);
+  }
+
+private:
+  uint8_t *out_;
+  uint32_t pos_{0};
+};
+
+/**
+ * \brief 7 bit value and shared p bit of an rgba end point with the least error
+ */
+void quantizeBc7Endpoint(const float e[4], uint32_t q[4], uint32_t &pbit) {
+  float best = 1e30f;
+  for (uint32_t p = 0; p < 2; ++p) {
+    uint32_t cq[4];
+    float error = 0.0f;
+    for (int c = 0; c < 4; ++c) {
+      float v = std::round((e[c] - p) / 2.0f);
+      cq[c] = static_cast<uint32_t>(std::clamp(v, 0.0f, 127.0f));
+      float d = static_cast<float>((cq[c] << 1) | p) - e[c];
+      error += d * d;
+    }
+    if (error < best) {
+      best = error;
+      pbit = p;
+      memcpy(q, cq, sizeof(cq));
+    }
+  }
+}
+
+/**
+ * \brief mode 6: one subset, rgba 7.7.7.7 end points with unique p bits, 4 bit indices
+ */
+void encodeBc7(const float px[16][4], uint8_t *out) {
+  static const uint32_t weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                       34, 38, 43, 47, 51, 55, 60, 64};
+  float e0[4], e1[4];
+  axisEndpoints<4>(px, e0, e1);
+  uint32_t q[2][4], pbits[2];
+  quantizeBc7Endpoint(e0, q[0], pbits[0]);
+  quantizeBc7Endpoint(e1, q[1], pbits[1]);
+
+  float palette[16][4];
+  for (int c = 0; c < 4; ++c) {
+    const uint32_t a = (q[0][c] << 1) | pbits[0];
+    const uint32_t b = (q[1][c] << 1) | pbits[1];
+    for (int w = 0; w < 16; ++w)
+      palette[w][c] = static_cast<float>(((64 - weights[w]) * a + weights[w] * b + 32) >> 6);
+  }
+  uint32_t indices[16];
+  for (int i = 0; i < 16; ++i) {
+    float best = 1e30f;
+    for (uint32_t w = 0; w < 16; ++w) {
+      float d = 0.0f;
+      for (int c = 0; c < 4; ++c)
+        d += (px[i][c] - palette[w][c]) * (px[i][c] - palette[w][c]);
+      if (d < best) {
+        best = d;
+        indices[i] = w;
+      }
+    }
+  }
+
+  // the msb of the anchor index is implicit 0
+  if (indices[0] & 8) {
+    std::swap(q[0], q[1]);
+    std::swap(pbits[0], pbits[1]);
+    for (auto &index : indices)
+      index = 15 - index;
+  }
+
+  BitWriter writer(out);
+  writer.put(1 << 6, 7); // mode 6
+  for (int c = 0; c < 4; ++c) {
+    writer.put(q[0][c], 7);
+    writer.put(q[1][c], 7);
+  }
+  writer.put(pbits[0], 1);
+  writer.put(pbits[1], 1);
+  writer.put(indices[0], 3);
+  for (int i = 1; i < 16; ++i)
+    writer.put(indices[i], 4);
+}
+
+} // namespace
+
+uint32_t bcBlockBytes(BcFormat format) {
+  return (format == BcFormat::BC1 || format == BcFormat::BC4) ? 8 : 16;
+}
+
+void encodeBcBlock(const uint8_t *rgba, BcFormat format, uint8_t *out) {
+  float px[16][4];
+  loadBlock(rgba, px);
+  switch (format) {
+  case BcFormat::BC1:
+    encodeBc1(px, out);
+    break;
+  case BcFormat::BC3:
+    encodeBc4Channel(px, 3, out);
+    encodeBc1(px, out + 8);
+    break;
+  case BcFormat::BC4:
+    encodeBc4Channel(px, 0, out);
+    break;
+  case BcFormat::BC5:
+    encodeBc4Channel(px, 0, out);
+    encodeBc4Channel(px, 1, out + 8);
+    break;
+  case BcFormat::BC7:
+    encodeBc7(px, out);
+    break;
+  }
+}
+
+std::vector<uint8_t> compressBc(const uint8_t *rgba, uint32_t width,
+                                uint32_t height, BcFormat format) {
+  const uint32_t block_bytes = bcBlockBytes(format);
+  const uint32_t blocks_x = (width + 3) / 4;
+  const uint32_t blocks_y = (height + 3) / 4;
+  std::vector<uint8_t> ret(static_cast<size_t>(blocks_x) * blocks_y * block_bytes);
+  parallelFor(0, blocks_y, [&](uint32_t by) {
+    uint8_t block[64];
+    for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+      for (uint32_t y = 0; y < 4; ++y) {
+        const uint32_t sy = std::min(by * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+          const uint32_t sx = std::min(bx * 4 + x, width - 1);
+          memcpy(block + 4 * (4 * y + x),
+                 rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+        }
+      }
+      encodeBcBlock(block, format,
+                    ret.data() + (static_cast<size_t>(by) * blocks_x + bx) * block_bytes);
+    }
+  }, 4);
+  return ret;
+}
+
+} // namespace vk_engine
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace vk_engine {
+
+enum class BcFormat : uint32_t {
+  BC1, //!< rgb, 4bpp
+  BC3, //!< rgba, bc1 color + bc4 alpha, 8bpp
+  BC4, //!< r, 4bpp
+  BC5, //!< rg, 8bpp
+  BC7  //!< rgba, mode 6 only, 8bpp
+};
+
+/**
+ * \brief bytes of a 4x4 block
+ */
+uint32_t bcBlockBytes(BcFormat format);
+
+/**
+ * \brief encode a 4x4 block of rgba8 pixels(row major, 64 bytes) to out(8 or 16 bytes)
+ */
+void encodeBcBlock(const uint8_t *rgba, BcFormat format, uint8_t *out);
+
+/**
+ * \brief block compress a tightly packed rgba8 image, edge pixels are repeated
+ * to fill the partial blocks. block rows are encoded in parallel.
+ */
+std::vector<uint8_t> compressBc(const uint8_t *rgba, uint32_t width,
+                                uint32_t height, BcFormat format);
+
+} // namespace vk_engine
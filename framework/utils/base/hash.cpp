@@ -0,0 +1,94 @@
+#include <framework/utils/base/hash.h>
+
+#include <cstring>
+
+namespace vk_engine {
+
+namespace {
+constexpr uint64_t PRIME64_1 = 11400714785074694791ULL;
+constexpr uint64_t PRIME64_2 = 14029467366897019727ULL;
+constexpr uint64_t PRIME64_3 = 1609587929392839161ULL;
+constexpr uint64_t PRIME64_4 = 9650029242287828579ULL;
+constexpr uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(const uint64_t x, const int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t round(uint64_t acc, const uint64_t input) {
+  acc += input * PRIME64_2;
+  acc = rotl(acc, 31);
+  return acc * PRIME64_1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, const uint64_t val) {
+  acc ^= round(0, val);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+} // namespace
+
+uint64_t hash64(const void *data, size_t size, uint64_t seed) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  const uint8_t *const end = p + size;
+  uint64_t h64;
+
+  if (size >= 32) {
+    const uint8_t *const limit = end - 32;
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME64_1;
+    do {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h64 = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h64 = mergeRound(h64, v1);
+    h64 = mergeRound(h64, v2);
+    h64 = mergeRound(h64, v3);
+    h64 = mergeRound(h64, v4);
+  } else {
+    h64 = seed + PRIME64_5;
+  }
+  h64 += static_cast<uint64_t>(size);
+
+  while (p + 8 <= end) {
+    h64 ^= round(0, read64(p));
+    h64 = rotl(h64, 27) * PRIME64_1 + PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h64 ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+    h64 = rotl(h64, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h64 ^= (*p) * PRIME64_5;
+    h64 = rotl(h64, 11) * PRIME64_1;
+    ++p;
+  }
+
+  // avalanche
+  h64 ^= h64 >> 33;
+  h64 *= PRIME64_2;
+  h64 ^= h64 >> 29;
+  h64 *= PRIME64_3;
+  h64 ^= h64 >> 32;
+  return h64;
+}
+} // namespace vk_engine
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vk_engine {
+
+/**
+ * \brief 64 bit xxhash(XXH64) of data, fast non-cryptographic content hash
+ */
+uint64_t hash64(const void *data, size_t size, uint64_t seed = 0);
+
+} // namespace vk_engine
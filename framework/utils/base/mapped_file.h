@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vk_engine {
+
+/**
+ * \brief read only memory mapping of a whole file
+ */
+class MappedFile final {
+public:
+  MappedFile() = default;
+
+  ~MappedFile() { close(); }
+
+  /**
+   * \brief map the file, return false if the file can't be opened or is empty
+   */
+  bool open(const std::string &path);
+
+  void close();
+
+  const uint8_t *data() const noexcept { return data_; }
+
+  size_t size() const noexcept { return size_; }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+private:
+  const uint8_t *data_{nullptr};
+  size_t size_{0};
+#ifdef _WIN32
+  void *file_{nullptr};
+  void *mapping_{nullptr};
+#endif
+};
+
+} // namespace vk_engine
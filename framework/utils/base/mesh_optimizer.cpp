@@ -0,0 +1,549 @@
+#include <framework/utils/base/mesh_optimizer.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace vk_engine {
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t index_count,
+                                    uint32_t vertex_count, uint32_t cache_size) {
+  VertexCacheStats stats;
+  if (index_count < 3)
+    return stats;
+  // fifo: a vertex is in cache if it was pushed within the last cache_size misses
+  std::vector<uint32_t> pushed_at(vertex_count, 0);
+  std::vector<bool> referenced(vertex_count, false);
+  uint32_t misses = 0;
+  uint32_t unique = 0;
+  for (size_t i = 0; i < index_count; ++i) {
+    const uint32_t v = indices[i];
+    assert(v < vertex_count);
+    if (!referenced[v]) {
+      referenced[v] = true;
+      ++unique;
+    }
+    if (pushed_at[v] == 0 || misses - pushed_at[v] + 1 > cache_size) {
+      ++misses;
+      pushed_at[v] = misses;
+    }
+  }
+  stats.acmr = static_cast<float>(misses) / static_cast<float>(index_count / 3);
+  stats.atvr = static_cast<float>(misses) / static_cast<float>(unique);
+  return stats;
+}
+
+uint32_t optimizeVertexCache(uint32_t *indices, size_t index_count,
+                             uint32_t vertex_count, uint32_t cache_size,
+                             uint32_t *cluster_starts) {
+  const size_t face_count = index_count / 3;
+  if (face_count == 0)
+    return 0;
+
+  // vertex -> triangles adjacency
+  std::vector<uint32_t> live(vertex_count, 0);
+  for (size_t i = 0; i < index_count; ++i)
+    ++live[indices[i]];
+  std::vector<uint32_t> offsets(vertex_count + 1, 0);
+  for (uint32_t v = 0; v < vertex_count; ++v)
+    offsets[v + 1] = offsets[v] + live[v];
+  std::vector<uint32_t> adjacency(index_count);
+  {
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < index_count; ++i)
+      adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  std::vector<uint32_t> cache_time(vertex_count, 0);
+  std::vector<bool> emitted(face_count, false);
+  std::vector<uint32_t> dead_end; // recently referenced vertices
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  output.reserve(face_count * 3);
+  uint32_t timestamp = cache_size + 1;
+  uint32_t cursor = 0; // next vertex to scan if the dead end stack is empty
+  uint32_t cluster_count = 0;
+
+  const auto skipDeadEnd = [&]() -> int64_t {
+    while (!dead_end.empty()) {
+      const uint32_t d = dead_end.back();
+      dead_end.pop_back();
+      if (live[d] > 0)
+        return d;
+    }
+    while (cursor < vertex_count) {
+      if (live[cursor] > 0)
+        return cursor;
+      ++cursor;
+    }
+    return -1;
+  };
+
+  int64_t fanning = skipDeadEnd();
+  bool new_cluster = true;
+  while (fanning >= 0) {
+    if (new_cluster && cluster_starts != nullptr)
+      cluster_starts[cluster_count] = static_cast<uint32_t>(output.size() / 3);
+    cluster_count += new_cluster ? 1 : 0;
+
+    candidates.clear();
+    const uint32_t f = static_cast<uint32_t>(fanning);
+    for (uint32_t a = offsets[f]; a < offsets[f + 1]; ++a) {
+      const uint32_t t = adjacency[a];
+      if (emitted[t])
+        continue;
+      emitted[t] = true;
+      for (uint32_t k = 0; k < 3; ++k) {
+        const uint32_t v = indices[3 * t + k];
+        output.emplace_back(v);
+        dead_end.emplace_back(v);
+        candidates.emplace_back(v);
+        --live[v];
+        if (timestamp - cache_time[v] > cache_size) {
+          cache_time[v] = timestamp;
+          ++timestamp;
+        }
+      }
+    }
+
+    // the candidate which stays in cache after its remaining triangles are fanned, oldest first
+    int64_t next = -1;
+    int64_t best_priority = -1;
+    for (uint32_t v : candidates) {
+      if (live[v] == 0)
+        continue;
+      int64_t priority = 0;
+      if (timestamp - cache_time[v] + 2 * live[v] <= cache_size)
+        priority = timestamp - cache_time[v];
+      if (priority > best_priority) {
+        best_priority = priority;
+        next = v;
+      }
+    }
+    new_cluster = (next < 0);
+    fanning = new_cluster ? skipDeadEnd() : next;
+  }
+  assert(output.size() == face_count * 3);
+  memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+  return cluster_count;
+}
+
+void optimizeOverdraw(uint32_t *indices, size_t index_count,
+                      const float *vertices, uint32_t vertex_count,
+                      uint32_t vertex_stride, const uint32_t *cluster_starts,
+                      uint32_t cluster_count, float threshold,
+                      uint32_t cache_size) {
+  const uint32_t face_count = static_cast<uint32_t>(index_count / 3);
+  if (cluster_count < 2)
+    return;
+
+  struct Cluster {
+    uint32_t begin;
+    uint32_t end;
+    float sort_key;
+  };
+  std::vector<Cluster> clusters(cluster_count);
+  double mesh_centroid[3] = {0.0, 0.0, 0.0};
+  double mesh_area = 0.0;
+  std::vector<float> cluster_data(cluster_count * 7); // centroid, normal, area
+  for (uint32_t c = 0; c < cluster_count; ++c) {
+    clusters[c].begin = cluster_starts[c];
+    clusters[c].end = (c + 1 < cluster_count) ? cluster_starts[c + 1] : face_count;
+    float *data = &cluster_data[7 * c];
+    for (uint32_t t = clusters[c].begin; t < clusters[c].end; ++t) {
+      const float *p0 = vertices + indices[3 * t] * vertex_stride;
+      const float *p1 = vertices + indices[3 * t + 1] * vertex_stride;
+      const float *p2 = vertices + indices[3 * t + 2] * vertex_stride;
+      const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      // area weighted normal
+      const float n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                          e1[2] * e2[0] - e1[0] * e2[2],
+                          e1[0] * e2[1] - e1[1] * e2[0]};
+      const float area = 0.5f * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int k = 0; k < 3; ++k) {
+        const float center = (p0[k] + p1[k] + p2[k]) / 3.0f;
+        data[k] += center * area;
+        data[3 + k] += n[k];
+        mesh_centroid[k] += center * area;
+      }
+      data[6] += area;
+      mesh_area += area;
+    }
+  }
+  if (mesh_area <= 0.0)
+    return;
+  for (int k = 0; k < 3; ++k)
+    mesh_centroid[k] /= mesh_area;
+
+  // occlusion potential: how far the cluster faces out from the mesh center
+  for (uint32_t c = 0; c < cluster_count; ++c) {
+    const float *data = &cluster_data[7 * c];
+    float dot = 0.0f;
+    if (data[6] > 0.0f) {
+      const float len = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+      for (int k = 0; k < 3; ++k)
+        dot += (data[k] / data[6] - static_cast<float>(mesh_centroid[k])) *
+               (len > 0.0f ? data[3 + k] / len : 0.0f);
+    }
+    clusters[c].sort_key = dot;
+  }
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const Cluster &a, const Cluster &b) {
+                     return a.sort_key > b.sort_key;
+                   });
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(face_count * 3);
+  for (const auto &c : clusters)
+    sorted.insert(sorted.end(), indices + 3 * c.begin, indices + 3 * c.end);
+
+  // clusters are cut at cache flushes, so the reorder should barely change the acmr
+  const float acmr = analyzeVertexCache(indices, face_count * 3, vertex_count, cache_size).acmr;
+  const float sorted_acmr = analyzeVertexCache(sorted.data(), sorted.size(), vertex_count, cache_size).acmr;
+  if (sorted_acmr <= acmr * threshold)
+    memcpy(indices, sorted.data(), sorted.size() * sizeof(uint32_t));
+}
+
+uint32_t optimizeVertexFetch(float *vertices, uint32_t vertex_count,
+                             uint32_t vertex_stride, uint32_t *indices,
+                             size_t index_count) {
+  constexpr uint32_t UNUSED = 0xFFFFFFFF;
+  std::vector<uint32_t> remap(vertex_count, UNUSED);
+  uint32_t next = 0;
+  for (size_t i = 0; i < index_count; ++i) {
+    uint32_t &r = remap[indices[i]];
+    if (r == UNUSED)
+      r = next++;
+    indices[i] = r;
+  }
+  std::vector<float> reordered(static_cast<size_t>(next) * vertex_stride);
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    if (remap[v] != UNUSED)
+      memcpy(reordered.data() + static_cast<size_t>(remap[v]) * vertex_stride,
+             vertices + static_cast<size_t>(v) * vertex_stride,
+             vertex_stride * sizeof(float));
+  }
+  memcpy(vertices, reordered.data(), reordered.size() * sizeof(float));
+  return next;
+}
+
+namespace {
+//! symmetric 4x4 error quadric, sum of area weighted squared plane distances
+struct Quadric {
+  double a00{0}, a01{0}, a02{0}, a03{0};
+  double a11{0}, a12{0}, a13{0};
+  double a22{0}, a23{0};
+  double a33{0};
+
+  void addPlane(double a, double b, double c, double d, double w) {
+    a00 += w * a * a; a01 += w * a * b; a02 += w * a * c; a03 += w * a * d;
+    a11 += w * b * b; a12 += w * b * c; a13 += w * b * d;
+    a22 += w * c * c; a23 += w * c * d;
+    a33 += w * d * d;
+  }
+
+  void add(const Quadric &q) {
+    a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+    a11 += q.a11; a12 += q.a12; a13 += q.a13;
+    a22 += q.a22; a23 += q.a23;
+    a33 += q.a33;
+  }
+
+  double error(const float *p) const {
+    const double x = p[0], y = p[1], z = p[2];
+    return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+           a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+           a22 * z * z + 2 * a23 * z + a33;
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+void triangleNormal(const float *a, const float *b, const float *c, double n[3]) {
+  const double e0[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const double e1[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+  n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+  n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+} // namespace
+
+size_t simplifyMesh(uint32_t *destination, const uint32_t *indices,
+                    size_t index_count, const float *vertices,
+                    uint32_t vertex_count, uint32_t vertex_stride,
+                    size_t target_index_count, float target_error,
+                    float *result_error) {
+  auto pos = [&](uint32_t v) {
+    return vertices + static_cast<size_t>(v) * vertex_stride;
+  };
+  std::vector<uint32_t> tris(indices, indices + index_count - index_count % 3);
+
+  // extent, errors are relative to it
+  float lo[3] = {INFINITY, INFINITY, INFINITY};
+  float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+  for (uint32_t v : tris)
+    for (int k = 0; k < 3; ++k) {
+      lo[k] = std::min(lo[k], pos(v)[k]);
+      hi[k] = std::max(hi[k], pos(v)[k]);
+    }
+  const double extent = tris.empty() ? 1.0 : std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 1e-12f});
+  const double max_cost = static_cast<double>(target_error) * target_error * extent * extent;
+
+  // lock seam vertices, a collapse would tear the copies apart
+  std::vector<uint8_t> locked(vertex_count, 0);
+  {
+    std::vector<uint32_t> order(vertex_count);
+    for (uint32_t v = 0; v < vertex_count; ++v)
+      order[v] = v;
+    auto less = [&](uint32_t a, uint32_t b) {
+      return std::lexicographical_compare(pos(a), pos(a) + 3, pos(b), pos(b) + 3);
+    };
+    std::sort(order.begin(), order.end(), less);
+    for (uint32_t i = 1; i < vertex_count; ++i)
+      if (!less(order[i - 1], order[i]))
+        locked[order[i - 1]] = locked[order[i]] = 1;
+  }
+  // lock open border vertices, an edge used by one triangle only
+  {
+    std::vector<uint64_t> edges;
+    edges.reserve(tris.size());
+    for (size_t t = 0; t < tris.size(); t += 3)
+      for (int k = 0; k < 3; ++k) {
+        const uint32_t a = tris[t + k], b = tris[t + (k + 1) % 3];
+        edges.push_back(static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b));
+      }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+      size_t j = i;
+      while (j < edges.size() && edges[j] == edges[i])
+        ++j;
+      if (j - i == 1)
+        locked[edges[i] >> 32] = locked[edges[i] & 0xffffffff] = 1;
+      i = j;
+    }
+  }
+
+  std::vector<Quadric> quadrics(vertex_count);
+  for (size_t t = 0; t < tris.size(); t += 3) {
+    const float *a = pos(tris[t]);
+    double n[3];
+    triangleNormal(a, pos(tris[t + 1]), pos(tris[t + 2]), n);
+    const double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len <= 0.0)
+      continue;
+    const double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]) / len;
+    for (int k = 0; k < 3; ++k)
+      quadrics[tris[t + k]].addPlane(n[0] / len, n[1] / len, n[2] / len, d, 0.5 * len);
+  }
+
+  double reached = 0.0;
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> remap(vertex_count);
+  std::vector<uint8_t> touched(vertex_count);
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1);
+  std::vector<uint32_t> adjacency;
+  while (tris.size() > target_index_count) {
+    // collapse candidates, each directed edge from an unlocked vertex
+    collapses.clear();
+    for (size_t t = 0; t < tris.size(); t += 3)
+      for (int k = 0; k < 3; ++k) {
+        const uint32_t from = tris[t + k], to = tris[t + (k + 1) % 3];
+        for (const auto &e : {std::make_pair(from, to), std::make_pair(to, from)}) {
+          if (locked[e.first])
+            continue;
+          Quadric q = quadrics[e.first];
+          q.add(quadrics[e.second]);
+          collapses.push_back({e.first, e.second, std::max(q.error(pos(e.second)), 0.0)});
+        }
+      }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+    // vertex -> triangles
+    std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+    for (uint32_t v : tris)
+      ++adjacency_offsets[v + 1];
+    for (uint32_t v = 0; v < vertex_count; ++v)
+      adjacency_offsets[v + 1] += adjacency_offsets[v];
+    adjacency.resize(tris.size());
+    {
+      std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+      for (size_t i = 0; i < tris.size(); ++i)
+        adjacency[fill[tris[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // an independent set of the cheapest collapses, each removes about 2 triangles
+    const size_t goal = std::max<size_t>((tris.size() - target_index_count) / 6, 1);
+    for (uint32_t v = 0; v < vertex_count; ++v)
+      remap[v] = v;
+    std::fill(touched.begin(), touched.end(), 0);
+    size_t applied = 0;
+    for (const auto &c : collapses) {
+      if (c.cost > max_cost || applied >= goal)
+        break;
+      if (touched[c.from] || touched[c.to])
+        continue;
+      // reject collapses that flip a triangle around from
+      bool flips = false;
+      for (uint32_t i = adjacency_offsets[c.from]; i < adjacency_offsets[c.from + 1] && !flips; ++i) {
+        const uint32_t *t = tris.data() + 3 * adjacency[i];
+        if (t[0] == c.to || t[1] == c.to || t[2] == c.to)
+          continue;
+        const float *p[3] = {pos(t[0]), pos(t[1]), pos(t[2])};
+        double before[3], after[3];
+        triangleNormal(p[0], p[1], p[2], before);
+        for (int k = 0; k < 3; ++k)
+          if (t[k] == c.from)
+            p[k] = pos(c.to);
+        triangleNormal(p[0], p[1], p[2], after);
+        const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        flips = dot <= 0.0;
+      }
+      if (flips)
+        continue;
+      // the triangles around from are frozen for this pass, keeping the flip test valid
+      for (uint32_t i = adjacency_offsets[c.from]; i < adjacency_offsets[c.from + 1]; ++i) {
+        const uint32_t *t = tris.data() + 3 * adjacency[i];
+        touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+      }
+      touched[c.to] = 1;
+      remap[c.from] = c.to;
+      quadrics[c.to].add(quadrics[c.from]);
+      reached = std::max(reached, c.cost);
+      ++applied;
+    }
+    if (applied == 0)
+      break;
+
+    // remap and drop the collapsed triangles
+    size_t write = 0;
+    for (size_t t = 0; t < tris.size(); t += 3) {
+      const uint32_t a = remap[tris[t]], b = remap[tris[t + 1]], c = remap[tris[t + 2]];
+      if (a == b || b == c || a == c)
+        continue;
+      tris[write++] = a;
+      tris[write++] = b;
+      tris[write++] = c;
+    }
+    tris.resize(write);
+  }
+
+  if (result_error != nullptr)
+    *result_error = static_cast<float>(std::sqrt(reached) / extent);
+  std::copy(tris.begin(), tris.end(), destination);
+  return tris.size();
+}
+
+static void computeMeshletBounds(const uint32_t *indices, const float *vertices,
+                                 uint32_t vertex_stride, Meshlet &m) {
+  const uint32_t *tri = indices + m.first_index;
+  const uint32_t face_count = m.index_count / 3;
+  auto pos = [&](uint32_t v) {
+    return vertices + static_cast<size_t>(v) * vertex_stride;
+  };
+
+  // sphere around the aabb center
+  float lo[3] = {INFINITY, INFINITY, INFINITY};
+  float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+  for (uint32_t i = 0; i < m.index_count; ++i) {
+    const float *p = pos(tri[i]);
+    for (int k = 0; k < 3; ++k) {
+      lo[k] = std::min(lo[k], p[k]);
+      hi[k] = std::max(hi[k], p[k]);
+    }
+  }
+  float r2 = 0.0f;
+  for (int k = 0; k < 3; ++k)
+    m.center[k] = 0.5f * (lo[k] + hi[k]);
+  for (uint32_t i = 0; i < m.index_count; ++i) {
+    const float *p = pos(tri[i]);
+    const float d[3] = {p[0] - m.center[0], p[1] - m.center[1], p[2] - m.center[2]};
+    r2 = std::max(r2, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+  }
+  m.radius = std::sqrt(r2);
+
+  // normal cone, axis is the mean of the face normals
+  std::vector<std::array<float, 3>> normals;
+  normals.reserve(face_count);
+  float axis[3] = {0.0f, 0.0f, 0.0f};
+  for (uint32_t f = 0; f < face_count; ++f) {
+    const float *a = pos(tri[3 * f]);
+    const float *b = pos(tri[3 * f + 1]);
+    const float *c = pos(tri[3 * f + 2]);
+    const float e0[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    const float e1[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    std::array<float, 3> n = {e0[1] * e1[2] - e0[2] * e1[1],
+                              e0[2] * e1[0] - e0[0] * e1[2],
+                              e0[0] * e1[1] - e0[1] * e1[0]};
+    const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len <= 0.0f)
+      continue; // degenerate
+    for (int k = 0; k < 3; ++k) {
+      n[k] /= len;
+      axis[k] += n[k];
+    }
+    normals.emplace_back(n);
+  }
+  const float axis_len = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+  float min_dot = 1.0f;
+  if (axis_len > 0.0f) {
+    for (int k = 0; k < 3; ++k)
+      axis[k] /= axis_len;
+    for (const auto &n : normals)
+      min_dot = std::min(min_dot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]);
+  } else {
+    min_dot = -1.0f;
+  }
+  for (int k = 0; k < 3; ++k)
+    m.cone_axis[k] = axis[k];
+  // the spread of the normals is over 90 degrees, never back facing
+  m.cone_cutoff = min_dot <= 0.0f ? 1.0f : std::sqrt(1.0f - min_dot * min_dot);
+}
+
+void buildMeshlets(const uint32_t *indices, size_t index_count,
+                   const float *vertices, uint32_t vertex_stride,
+                   std::vector<Meshlet> &meshlets, uint32_t max_vertices,
+                   uint32_t max_triangles) {
+  assert(max_vertices >= 3 && max_triangles >= 1);
+  std::vector<uint32_t> unique;
+  unique.reserve(max_vertices);
+  Meshlet cur{};
+  auto flush = [&]() {
+    if (cur.index_count == 0)
+      return;
+    computeMeshletBounds(indices, vertices, vertex_stride, cur);
+    meshlets.emplace_back(cur);
+    cur = Meshlet{};
+    unique.clear();
+  };
+  for (size_t i = 0; i + 2 < index_count; i += 3) {
+    uint32_t added = 0;
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t v = indices[i + k];
+      if (std::find(unique.begin(), unique.end(), v) == unique.end() &&
+          std::find(indices + i, indices + i + k, v) == indices + i + k)
+        ++added;
+    }
+    if (unique.size() + added > max_vertices || cur.index_count / 3 >= max_triangles)
+      flush();
+    if (cur.index_count == 0)
+      cur.first_index = static_cast<uint32_t>(i);
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t v = indices[i + k];
+      if (std::find(unique.begin(), unique.end(), v) == unique.end())
+        unique.push_back(v);
+    }
+    cur.index_count += 3;
+  }
+  flush();
+}
+
+} // namespace vk_engine
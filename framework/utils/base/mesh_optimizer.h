@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vk_engine {
+
+constexpr uint32_t DEFAULT_VERTEX_CACHE_SIZE = 16;
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+/**
+ * \brief post transform cache efficiency of a triangle list, simulated with a fifo cache
+ */
+struct VertexCacheStats {
+  float acmr{0.0f}; //!< average cache miss ratio, transformed vertices per triangle, [0.5, 3]
+  float atvr{0.0f}; //!< average transform to vertex ratio, transformed / referenced vertices, >= 1
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t index_count,
+                                    uint32_t vertex_count,
+                                    uint32_t cache_size = DEFAULT_VERTEX_CACHE_SIZE);
+
+/**
+ * \brief reorder triangles for the post transform vertex cache(tipsify, Sander et al. 2007), in place.
+ * cluster_starts(optional, index_count / 3 entries) receives the first triangle of each cluster,
+ * clusters end where the fanning hits a dead end, return the cluster count
+ */
+uint32_t optimizeVertexCache(uint32_t *indices, size_t index_count,
+                             uint32_t vertex_count,
+                             uint32_t cache_size = DEFAULT_VERTEX_CACHE_SIZE,
+                             uint32_t *cluster_starts = nullptr);
+
+/**
+ * \brief sort the clusters of a cache optimized triangle list so the outward facing ones are drawn
+ * first, which occlude the rest. the order is kept if the acmr grows more than threshold times.
+ * positions are the first 3 floats of each vertex, vertex_stride in floats
+ */
+void optimizeOverdraw(uint32_t *indices, size_t index_count,
+                      const float *vertices, uint32_t vertex_count,
+                      uint32_t vertex_stride, const uint32_t *cluster_starts,
+                      uint32_t cluster_count, float threshold = 1.05f,
+                      uint32_t cache_size = DEFAULT_VERTEX_CACHE_SIZE);
+
+/**
+ * \brief reorder vertices by first use in the index buffer, unreferenced vertices are dropped.
+ * indices are remapped in place, return the new vertex count
+ */
+uint32_t optimizeVertexFetch(float *vertices, uint32_t vertex_count,
+                             uint32_t vertex_stride, uint32_t *indices,
+                             size_t index_count);
+
+/**
+ * \brief simplify a triangle list by quadric error edge collapses(Garland and
+ * Heckbert 1997) onto existing vertices, so the result reuses the vertex
+ * buffer. stops at target_index_count, or before a collapse whose error exceeds
+ * target_error, relative to the mesh extent. vertices sharing a position with
+ * another one(attribute seams) or on an open border are locked.
+ * destination holds index_count entries, return the index count written,
+ * result_error(optional) receives the relative error reached
+ */
+size_t simplifyMesh(uint32_t *destination, const uint32_t *indices,
+                    size_t index_count, const float *vertices,
+                    uint32_t vertex_count, uint32_t vertex_stride,
+                    size_t target_index_count, float target_error,
+                    float *result_error = nullptr);
+
+/**
+ * \brief a cluster of consecutive triangles in the index buffer, with its
+ * bounding sphere and normal cone for culling
+ */
+struct Meshlet {
+  uint32_t first_index;
+  uint32_t index_count;
+  int32_t vertex_offset{0}; //!< base vertex of the indices, set by the caller
+  float center[3];
+  float radius;
+  float cone_axis[3];
+  float cone_cutoff; //!< 1 if the cone is too wide to ever be back facing
+};
+
+/**
+ * \brief split a (cache optimized) triangle list in order into meshlets of at
+ * most max_vertices unique vertices and max_triangles triangles, appended to
+ * meshlets. first_index is relative to indices, positions are the first 3
+ * floats of each vertex, vertex_stride in floats
+ */
+void buildMeshlets(const uint32_t *indices, size_t index_count,
+                   const float *vertices, uint32_t vertex_stride,
+                   std::vector<Meshlet> &meshlets,
+                   uint32_t max_vertices = MESHLET_MAX_VERTICES,
+                   uint32_t max_triangles = MESHLET_MAX_TRIANGLES);
+
+/**
+ * \brief the meshlet faces away from a viewer at camera_pos, all in the same space
+ */
+inline bool meshletBackFacing(const float center[3], float radius,
+                              const float cone_axis[3], float cone_cutoff,
+                              const float camera_pos[3]) {
+  const float d[3] = {center[0] - camera_pos[0], center[1] - camera_pos[1],
+                      center[2] - camera_pos[2]};
+  const float len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+  return d[0] * cone_axis[0] + d[1] * cone_axis[1] + d[2] * cone_axis[2] >=
+         cone_cutoff * len + radius;
+}
+
+} // namespace vk_engine
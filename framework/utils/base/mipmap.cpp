@@ -0,0 +1,156 @@
+#include <framework/utils/base/mipmap.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace vk_engine {
+
+namespace {
+constexpr uint32_t LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+
+struct SrgbTables {
+  SrgbTables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      float c = i / 255.0f;
+      to_linear[i] = c <= 0.04045f ? c / 12.92f
+                                   : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (uint32_t i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; ++i) {
+      float l = i / static_cast<float>(LINEAR_TO_SRGB_TABLE_SIZE - 1);
+      float c = l <= 0.0031308f ? l * 12.92f
+                                : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+      to_srgb[i] = static_cast<uint8_t>(std::min(c * 255.0f + 0.5f, 255.0f));
+    }
+  }
+
+  float to_linear[256];
+  uint8_t to_srgb[LINEAR_TO_SRGB_TABLE_SIZE];
+};
+
+const SrgbTables &srgbTables() {
+  static const SrgbTables tables;
+  return tables;
+}
+
+/**
+ * \brief source texels of texel i of the halved axis of size n, weighted by the area they
+ * cover. an odd axis of 2d+1 texels maps 3 taps to each of its d texels, so the extra
+ * texel is folded in instead of dropped
+ */
+struct AxisTaps {
+  uint32_t index[3];
+  float weight[3];
+  uint32_t count;
+};
+
+AxisTaps axisTaps(uint32_t i, uint32_t n) {
+  if (n == 1)
+    return {{0, 0, 0}, {1.0f, 0.0f, 0.0f}, 1};
+  if (n % 2 == 0)
+    return {{2 * i, 2 * i + 1, 0}, {0.5f, 0.5f, 0.0f}, 2};
+  const uint32_t d = n / 2;
+  const float inv = 1.0f / n;
+  return {{2 * i, 2 * i + 1, 2 * i + 2},
+          {(d - i) * inv, d * inv, (i + 1) * inv},
+          3};
+}
+
+/**
+ * \brief downsample with an odd width or height, 2 or 3 taps per axis
+ */
+void downsampleOddRgba8(const uint8_t *src, uint32_t width, uint32_t height,
+                        bool srgb, uint8_t *dst) {
+  const uint32_t dst_width = std::max(width / 2, 1u);
+  const uint32_t dst_height = std::max(height / 2, 1u);
+  const auto &tables = srgbTables();
+  std::vector<AxisTaps> x_taps(dst_width);
+  for (uint32_t x = 0; x < dst_width; ++x)
+    x_taps[x] = axisTaps(x, width);
+  for (uint32_t y = 0; y < dst_height; ++y) {
+    const AxisTaps ty = axisTaps(y, height);
+    uint8_t *out = dst + static_cast<size_t>(y) * dst_width * 4;
+    for (uint32_t x = 0; x < dst_width; ++x) {
+      const AxisTaps &tx = x_taps[x];
+      float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+      for (uint32_t j = 0; j < ty.count; ++j) {
+        const uint8_t *row = src + static_cast<size_t>(ty.index[j]) * width * 4;
+        for (uint32_t i = 0; i < tx.count; ++i) {
+          const uint8_t *px = row + tx.index[i] * 4;
+          const float w = ty.weight[j] * tx.weight[i];
+          for (uint32_t c = 0; c < 3; ++c)
+            sum[c] += w * (srgb ? tables.to_linear[px[c]] : px[c]);
+          sum[3] += w * px[3];
+        }
+      }
+      for (uint32_t c = 0; c < 3; ++c)
+        out[4 * x + c] =
+            srgb ? tables.to_srgb[static_cast<uint32_t>(
+                       std::min(sum[c], 1.0f) * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)]
+                 : static_cast<uint8_t>(std::min(sum[c] + 0.5f, 255.0f));
+      out[4 * x + 3] = static_cast<uint8_t>(std::min(sum[3] + 0.5f, 255.0f));
+    }
+  }
+}
+} // namespace
+
+void downsampleRgba8(const uint8_t *src, uint32_t width, uint32_t height,
+                     bool srgb, uint8_t *dst) {
+  if ((width > 1 && width % 2 != 0) || (height > 1 && height % 2 != 0)) {
+    downsampleOddRgba8(src, width, height, srgb, dst);
+    return;
+  }
+  const uint32_t dst_width = std::max(width / 2, 1u);
+  const uint32_t dst_height = std::max(height / 2, 1u);
+  const uint32_t src_stride = width * 4;
+  for (uint32_t y = 0; y < dst_height; ++y) {
+    // clamp for the 1 pixel wide/high source
+    const uint8_t *row0 = src + std::min(2 * y, height - 1) * src_stride;
+    const uint8_t *row1 = src + std::min(2 * y + 1, height - 1) * src_stride;
+    uint8_t *out = dst + y * dst_width * 4;
+    if (!srgb) {
+      // plain integer loop, vectorized by the compiler
+      for (uint32_t x = 0; x < dst_width; ++x) {
+        const uint32_t x0 = std::min(2 * x, width - 1) * 4;
+        const uint32_t x1 = std::min(2 * x + 1, width - 1) * 4;
+        for (uint32_t c = 0; c < 4; ++c)
+          out[4 * x + c] = static_cast<uint8_t>(
+              (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+      }
+      continue;
+    }
+
+    const auto &tables = srgbTables();
+    constexpr float scale = 0.25f * (LINEAR_TO_SRGB_TABLE_SIZE - 1);
+    for (uint32_t x = 0; x < dst_width; ++x) {
+      const uint32_t x0 = std::min(2 * x, width - 1) * 4;
+      const uint32_t x1 = std::min(2 * x + 1, width - 1) * 4;
+      for (uint32_t c = 0; c < 3; ++c) {
+        float sum = tables.to_linear[row0[x0 + c]] + tables.to_linear[row0[x1 + c]] +
+                    tables.to_linear[row1[x0 + c]] + tables.to_linear[row1[x1 + c]];
+        out[4 * x + c] = tables.to_srgb[static_cast<uint32_t>(sum * scale + 0.5f)];
+      }
+      out[4 * x + 3] = static_cast<uint8_t>(
+          (row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) >> 2);
+    }
+  }
+}
+
+std::vector<std::vector<uint8_t>> generateMipChainRgba8(const uint8_t *data,
+                                                        uint32_t width,
+                                                        uint32_t height,
+                                                        bool srgb) {
+  std::vector<std::vector<uint8_t>> levels;
+  const uint8_t *src = data;
+  while (width > 1 || height > 1) {
+    const uint32_t next_width = std::max(width / 2, 1u);
+    const uint32_t next_height = std::max(height / 2, 1u);
+    levels.emplace_back(static_cast<size_t>(next_width) * next_height * 4);
+    downsampleRgba8(src, width, height, srgb, levels.back().data());
+    src = levels.back().data();
+    width = next_width;
+    height = next_height;
+  }
+  return levels;
+}
+
+} // namespace vk_engine
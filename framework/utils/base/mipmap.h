@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace vk_engine {
+
+/**
+ * \brief 2x2 box filter rgba8 image to max(width/2, 1) x max(height/2, 1). an odd
+ * dimension is filtered with 3 area weighted taps, so npot mips don't shift or darken.
+ * srgb color channels are filtered in linear space, alpha is always linear.
+ */
+void downsampleRgba8(const uint8_t *src, uint32_t width, uint32_t height,
+                     bool srgb, uint8_t *dst);
+
+/**
+ * \brief cpu generated mip levels [1, n) of rgba8 image, tightly packed.
+ * used when the format is not blittable or the upload queue can't blit.
+ */
+std::vector<std::vector<uint8_t>> generateMipChainRgba8(const uint8_t *data,
+                                                        uint32_t width,
+                                                        uint32_t height,
+                                                        bool srgb);
+
+} // namespace vk_engine
@@ -0,0 +1,87 @@
+#include <framework/utils/base/parallel.h>
+
+namespace vk_engine {
+
+WorkerPool &WorkerPool::shared() {
+  static WorkerPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+  return pool;
+}
+
+WorkerPool::WorkerPool(uint32_t worker_count) {
+  workers_.reserve(worker_count);
+  for (uint32_t i = 0; i < worker_count; ++i)
+    workers_.emplace_back([this]() { workerLoop(); });
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &t : workers_)
+    t.join();
+}
+
+void WorkerPool::work(Job &job) {
+  for (uint32_t c = job.next.fetch_add(1); c < job.chunk_count;
+       c = job.next.fetch_add(1)) {
+    (*job.task)(c);
+    if (job.done.fetch_add(1) + 1 == job.chunk_count) {
+      std::lock_guard<std::mutex> lk(job.mtx);
+      job.cv.notify_all();
+    }
+  }
+}
+
+void WorkerPool::run(uint32_t chunk_count,
+                     const std::function<void(uint32_t)> &task) {
+  if (chunk_count == 0)
+    return;
+  auto job = std::make_shared<Job>();
+  job->task = &task;
+  job->chunk_count = chunk_count;
+  if (chunk_count > 1 && !workers_.empty()) {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      jobs_.emplace_back(job);
+    }
+    if (chunk_count - 1 >= workers_.size())
+      cv_.notify_all();
+    else
+      for (uint32_t i = 1; i < chunk_count; ++i)
+        cv_.notify_one();
+  }
+
+  work(*job); // calling thread takes part
+
+  // only the chunks taken by the workers are left
+  std::unique_lock<std::mutex> lk(job->mtx);
+  job->cv.wait(lk, [&job]() { return job->done.load() == job->chunk_count; });
+  lk.unlock();
+  std::lock_guard<std::mutex> jobs_lk(mtx_);
+  auto itr = std::find(jobs_.begin(), jobs_.end(), job);
+  if (itr != jobs_.end())
+    jobs_.erase(itr);
+}
+
+void WorkerPool::workerLoop() {
+  for (;;) {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lk(mtx_);
+      cv_.wait(lk, [this]() { return stop_ || !jobs_.empty(); });
+      if (stop_)
+        return;
+      job = jobs_.front();
+      // all chunks are taken, the rest is up to the threads running them
+      if (job->next.load() >= job->chunk_count) {
+        jobs_.pop_front();
+        continue;
+      }
+    }
+    work(*job);
+  }
+}
+
+} // namespace vk_engine
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vk_engine {
+
+/**
+ * \brief persistent worker threads shared by the renderer and the loaders, so a
+ * parallel loop doesn't pay for creating threads and concurrent loops don't
+ * oversubscribe the cpu.
+ *
+ * a job is split in chunks taken from a shared counter, the calling thread takes
+ * part and only waits for the chunks running on the workers. so run() may be
+ * called concurrently and from inside a job.
+ */
+class WorkerPool final {
+public:
+  /**
+   * \brief hardware_concurrency() - 1 workers, the caller is the last thread
+   */
+  static WorkerPool &shared();
+
+  explicit WorkerPool(uint32_t worker_count);
+
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  uint32_t workerCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+  /**
+   * \brief call task(chunk) for chunk in [0, chunk_count), blocks until done. task should not throw
+   */
+  void run(uint32_t chunk_count, const std::function<void(uint32_t)> &task);
+
+private:
+  struct Job {
+    const std::function<void(uint32_t)> *task;
+    uint32_t chunk_count;
+    std::atomic<uint32_t> next{0};
+    std::atomic<uint32_t> done{0};
+    std::mutex mtx;
+    std::condition_variable cv; //!< signaled when the last chunk is done
+  };
+
+  static void work(Job &job);
+
+  void workerLoop();
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<std::shared_ptr<Job>> jobs_; //!< jobs with chunks left to take
+  bool stop_{false};
+  std::vector<std::thread> workers_;
+};
+
+/**
+ * \brief call func(i) for i in [begin, end) on the shared worker pool, blocks until done.
+ * work is taken in chunks of grain from a shared counter, func should not throw.
+ */
+template <typename Func>
+void parallelFor(uint32_t begin, uint32_t end, Func &&func, uint32_t grain = 1) {
+  if (begin >= end)
+    return;
+  grain = std::max(grain, 1u);
+  const uint32_t chunks = (end - begin + grain - 1) / grain;
+  auto chunk = [&](uint32_t c) {
+    const uint32_t b = begin + c * grain;
+    const uint32_t e = std::min(b + grain, end);
+    for (uint32_t i = b; i < e; ++i)
+      func(i);
+  };
+  auto &pool = WorkerPool::shared();
+  if (chunks == 1 || pool.workerCount() == 0) {
+    for (uint32_t c = 0; c < chunks; ++c)
+      chunk(c);
+    return;
+  }
+  pool.run(chunks, chunk);
+}
+
+} // namespace vk_engine
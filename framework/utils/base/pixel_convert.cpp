@@ -0,0 +1,437 @@
+#include <framework/utils/base/pixel_convert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <framework/utils/base/parallel.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIXEL_CONVERT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define PIXEL_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+// msvc allows the intrinsics of any isa without target flags
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PIXEL_TARGET(isa)
+#else
+#define PIXEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace vk_engine {
+
+static constexpr size_t PARALLEL_PIXEL_COUNT = 1u << 20; //!< smaller images are converted on the calling thread
+static constexpr size_t PARALLEL_CHUNK = 1u << 18;
+
+uint16_t floatToHalf(float value) {
+  uint32_t f;
+  memcpy(&f, &value, sizeof(f));
+  const uint16_t sign = static_cast<uint16_t>((f >> 16) & 0x8000);
+  const uint32_t abs = f & 0x7fffffff;
+  if (abs > 0x7f800000) // nan
+    return sign | 0x7e00;
+  if (abs >= 0x477ff000) // rounds to inf
+    return sign | 0x7c00;
+  if (abs < 0x38800000) { // half subnormal, steps of 2^-24
+    float a;
+    memcpy(&a, &abs, sizeof(a));
+    return sign | static_cast<uint16_t>(std::nearbyint(a * 16777216.0f));
+  }
+  // rebias the exponent, round the mantissa to nearest even
+  const uint32_t rounded = abs + 0xfff + ((abs >> 13) & 1) - (112u << 23);
+  return sign | static_cast<uint16_t>(rounded >> 13);
+}
+
+float halfToFloat(uint16_t value) {
+  const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1f;
+  const uint32_t mantissa = value & 0x3ff;
+  uint32_t f = 0;
+  if (exponent == 0) {
+    const float a = static_cast<float>(mantissa) / 16777216.0f;
+    memcpy(&f, &a, sizeof(f));
+    f |= sign;
+  } else if (exponent == 31) {
+    f = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float ret;
+  memcpy(&ret, &f, sizeof(ret));
+  return ret;
+}
+
+// scalar kernels, also the tails of the simd ones
+static void rgbToRgbaScalar(uint8_t *dst, const uint8_t *src, size_t count) {
+  for (size_t i = 0; i < count; ++i, src += 3, dst += 4) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+    dst[3] = 255;
+  }
+}
+
+static void grayToRgbaScalar(uint8_t *dst, const uint8_t *src, size_t count) {
+  for (size_t i = 0; i < count; ++i, dst += 4)
+    dst[0] = dst[1] = dst[2] = src[i], dst[3] = 255;
+}
+
+static void grayAlphaToRgbaScalar(uint8_t *dst, const uint8_t *src, size_t count) {
+  for (size_t i = 0; i < count; ++i, src += 2, dst += 4)
+    dst[0] = dst[1] = dst[2] = src[0], dst[3] = src[1];
+}
+
+static void rgbaToRScalar(uint8_t *dst, const uint8_t *src, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = src[4 * i];
+}
+
+static void rgbaToRgScalar(uint8_t *dst, const uint8_t *src, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    dst[2 * i] = src[4 * i];
+    dst[2 * i + 1] = src[4 * i + 1];
+  }
+}
+
+static void floatToHalfScalar(uint16_t *dst, const float *src, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = floatToHalf(src[i]);
+}
+
+#if defined(PIXEL_CONVERT_X86)
+PIXEL_TARGET("ssse3")
+static void rgbToRgbaSsse3(uint8_t *dst, const uint8_t *src, size_t count) {
+  const __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 48, dst += 64) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+    // pixels start at byte 0, 12, 24 and 36
+    const __m128i p[4] = {a, _mm_alignr_epi8(b, a, 12), _mm_alignr_epi8(c, b, 8),
+                          _mm_srli_si128(c, 4)};
+    for (int k = 0; k < 4; ++k)
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16 * k),
+                       _mm_or_si128(_mm_shuffle_epi8(p[k], mask), alpha));
+  }
+  rgbToRgbaScalar(dst, src, count - i);
+}
+
+PIXEL_TARGET("ssse3")
+static void grayToRgbaSsse3(uint8_t *dst, const uint8_t *src, size_t count) {
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 16, dst += 64) {
+    const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    for (int k = 0; k < 4; ++k) {
+      const char b = static_cast<char>(4 * k);
+      const __m128i mask = _mm_setr_epi8(b, b, b, -1, b + 1, b + 1, b + 1, -1,
+                                         b + 2, b + 2, b + 2, -1, b + 3, b + 3, b + 3, -1);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16 * k),
+                       _mm_or_si128(_mm_shuffle_epi8(g, mask), alpha));
+    }
+  }
+  grayToRgbaScalar(dst, src, count - i);
+}
+
+PIXEL_TARGET("ssse3")
+static void rgbaToRSsse3(uint8_t *dst, const uint8_t *src, size_t count) {
+  // r of the 4 pixels of each load to its dword of the result
+  const __m128i mask[4] = {
+      _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+      _mm_setr_epi8(-1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1),
+      _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1),
+      _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 4, 8, 12)};
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 64, dst += 16) {
+    __m128i r = _mm_setzero_si128();
+    for (int k = 0; k < 4; ++k) {
+      const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16 * k));
+      r = _mm_or_si128(r, _mm_shuffle_epi8(p, mask[k]));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), r);
+  }
+  rgbaToRScalar(dst, src, count - i);
+}
+
+PIXEL_TARGET("ssse3")
+static void rgbaToRgSsse3(uint8_t *dst, const uint8_t *src, size_t count) {
+  const __m128i lo = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 4, 5, 8, 9, 12, 13);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8, src += 32, dst += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                     _mm_or_si128(_mm_shuffle_epi8(a, lo), _mm_shuffle_epi8(b, hi)));
+  }
+  rgbaToRgScalar(dst, src, count - i);
+}
+
+PIXEL_TARGET("avx2")
+static void rgbToRgbaAvx2(uint8_t *dst, const uint8_t *src, size_t count) {
+  // 8 pixels(24 bytes) of a 32 bytes load, 4 to each lane
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+  const __m256i mask = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000));
+  size_t i = 0;
+  // the load reads 8 bytes past the 8 pixels
+  for (; i + 11 <= count; i += 8, src += 24, dst += 32) {
+    const __m256i p = _mm256_permutevar8x32_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)), lanes);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst),
+                        _mm256_or_si256(_mm256_shuffle_epi8(p, mask), alpha));
+  }
+  rgbToRgbaScalar(dst, src, count - i);
+}
+
+PIXEL_TARGET("avx2")
+static void grayToRgbaAvx2(uint8_t *dst, const uint8_t *src, size_t count) {
+  const __m256i replicate = _mm256_set1_epi32(0x00010101);
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8, src += 8, dst += 32) {
+    const __m256i g = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst),
+                        _mm256_or_si256(_mm256_mullo_epi32(g, replicate), alpha));
+  }
+  grayToRgbaScalar(dst, src, count - i);
+}
+
+PIXEL_TARGET("avx2")
+static void rgbaToRAvx2(uint8_t *dst, const uint8_t *src, size_t count) {
+  const __m256i low = _mm256_set1_epi32(0xff);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32, src += 128, dst += 32) {
+    __m256i p[4];
+    for (int k = 0; k < 4; ++k)
+      p[k] = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32 * k)), low);
+    // packs work in lanes, the dwords are reordered at last
+    const __m256i r = _mm256_packus_epi16(_mm256_packus_epi32(p[0], p[1]),
+                                          _mm256_packus_epi32(p[2], p[3]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permutevar8x32_epi32(r, order));
+  }
+  rgbaToRScalar(dst, src, count - i);
+}
+
+PIXEL_TARGET("avx2")
+static void rgbaToRgAvx2(uint8_t *dst, const uint8_t *src, size_t count) {
+  const __m256i low = _mm256_set1_epi32(0xffff);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 64, dst += 32) {
+    const __m256i a = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)), low);
+    const __m256i b = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32)), low);
+    const __m256i rg = _mm256_packus_epi32(a, b);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute4x64_epi64(rg, 0xd8));
+  }
+  rgbaToRgScalar(dst, src, count - i);
+}
+
+PIXEL_TARGET("avx,f16c")
+static void floatToHalfF16c(uint16_t *dst, const float *src, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+  }
+  floatToHalfScalar(dst + i, src + i, count - i);
+}
+#endif
+
+#if defined(PIXEL_CONVERT_NEON)
+static void rgbToRgbaNeon(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 48, dst += 64) {
+    const uint8x16x3_t rgb = vld3q_u8(src);
+    const uint8x16x4_t rgba = {{rgb.val[0], rgb.val[1], rgb.val[2], vdupq_n_u8(255)}};
+    vst4q_u8(dst, rgba);
+  }
+  rgbToRgbaScalar(dst, src, count - i);
+}
+
+static void grayToRgbaNeon(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 16, dst += 64) {
+    const uint8x16_t g = vld1q_u8(src);
+    const uint8x16x4_t rgba = {{g, g, g, vdupq_n_u8(255)}};
+    vst4q_u8(dst, rgba);
+  }
+  grayToRgbaScalar(dst, src, count - i);
+}
+
+static void grayAlphaToRgbaNeon(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 32, dst += 64) {
+    const uint8x16x2_t ga = vld2q_u8(src);
+    const uint8x16x4_t rgba = {{ga.val[0], ga.val[0], ga.val[0], ga.val[1]}};
+    vst4q_u8(dst, rgba);
+  }
+  grayAlphaToRgbaScalar(dst, src, count - i);
+}
+
+static void rgbaToRNeon(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 64, dst += 16)
+    vst1q_u8(dst, vld4q_u8(src).val[0]);
+  rgbaToRScalar(dst, src, count - i);
+}
+
+static void rgbaToRgNeon(uint8_t *dst, const uint8_t *src, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, src += 64, dst += 32) {
+    const uint8x16x4_t rgba = vld4q_u8(src);
+    const uint8x16x2_t rg = {{rgba.val[0], rgba.val[1]}};
+    vst2q_u8(dst, rg);
+  }
+  rgbaToRgScalar(dst, src, count - i);
+}
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+static void floatToHalfNeon(uint16_t *dst, const float *src, size_t count) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+    vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+  floatToHalfScalar(dst + i, src + i, count - i);
+}
+#endif
+#endif
+
+static std::vector<PixelConvertKernels> supportedKernels() {
+  std::vector<PixelConvertKernels> sets{
+      {"scalar", rgbToRgbaScalar, grayToRgbaScalar, grayAlphaToRgbaScalar,
+       rgbaToRScalar, rgbaToRgScalar, floatToHalfScalar}};
+#if defined(PIXEL_CONVERT_X86)
+  bool ssse3 = false, avx = false, avx2 = false, f16c = false;
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  ssse3 = (info[2] & (1 << 9)) != 0;
+  f16c = (info[2] & (1 << 29)) != 0;
+  // ymm registers saved by the os
+  avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0 &&
+        (_xgetbv(0) & 6) == 6;
+  if (max_leaf >= 7) {
+    __cpuidex(info, 7, 0);
+    avx2 = avx && (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  ssse3 = __builtin_cpu_supports("ssse3");
+  avx = __builtin_cpu_supports("avx");
+  avx2 = __builtin_cpu_supports("avx2");
+  unsigned int eax, ebx, ecx, edx;
+  f16c = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_F16C) != 0;
+#endif
+  if (ssse3) {
+    auto k = sets.back();
+    k.rgb_to_rgba = rgbToRgbaSsse3;
+    k.gray_to_rgba = grayToRgbaSsse3;
+    k.rgba_to_r = rgbaToRSsse3;
+    k.rgba_to_rg = rgbaToRgSsse3;
+    k.isa = "ssse3";
+    sets.emplace_back(k);
+  }
+  if (avx2) {
+    auto k = sets.back();
+    k.rgb_to_rgba = rgbToRgbaAvx2;
+    k.gray_to_rgba = grayToRgbaAvx2;
+    k.rgba_to_r = rgbaToRAvx2;
+    k.rgba_to_rg = rgbaToRgAvx2;
+    k.isa = "avx2";
+    sets.emplace_back(k);
+  }
+  if (avx && f16c) {
+    auto k = sets.back();
+    k.float_to_half = floatToHalfF16c;
+    k.isa = avx2 ? "avx2+f16c" : (ssse3 ? "ssse3+f16c" : "f16c");
+    sets.emplace_back(k);
+  }
+#elif defined(PIXEL_CONVERT_NEON)
+  auto k = sets.back();
+  k.rgb_to_rgba = rgbToRgbaNeon;
+  k.gray_to_rgba = grayToRgbaNeon;
+  k.gray_alpha_to_rgba = grayAlphaToRgbaNeon;
+  k.rgba_to_r = rgbaToRNeon;
+  k.rgba_to_rg = rgbaToRgNeon;
+#if defined(__aarch64__) || defined(_M_ARM64)
+  k.float_to_half = floatToHalfNeon;
+#endif
+  k.isa = "neon";
+  sets.emplace_back(k);
+#endif
+  return sets;
+}
+
+static const PixelConvertKernels &kernels() {
+  static const PixelConvertKernels k = supportedKernels().back();
+  return k;
+}
+
+/**
+ * \brief run kernel over count elements, split in chunks on all threads if large
+ */
+template <typename Dst, typename Src>
+static void convert(void (*kernel)(Dst *, const Src *, size_t), Dst *dst,
+                    size_t dst_stride, const Src *src, size_t src_stride,
+                    size_t count) {
+  if (count < PARALLEL_PIXEL_COUNT) {
+    kernel(dst, src, count);
+    return;
+  }
+  const uint32_t chunks = static_cast<uint32_t>((count + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK);
+  parallelFor(0, chunks, [&](uint32_t c) {
+    const size_t first = c * PARALLEL_CHUNK;
+    kernel(dst + first * dst_stride, src + first * src_stride,
+           std::min(PARALLEL_CHUNK, count - first));
+  });
+}
+
+void expandToRgba8(uint8_t *dst, const uint8_t *src, uint32_t src_channels,
+                   size_t pixel_count) {
+  const auto &k = kernels();
+  switch (src_channels) {
+  case 1:
+    convert(k.gray_to_rgba, dst, 4, src, 1, pixel_count);
+    break;
+  case 2:
+    convert(k.gray_alpha_to_rgba, dst, 4, src, 2, pixel_count);
+    break;
+  case 3:
+    convert(k.rgb_to_rgba, dst, 4, src, 3, pixel_count);
+    break;
+  default:
+    memcpy(dst, src, pixel_count * 4);
+    break;
+  }
+}
+
+void extractChannels8(uint8_t *dst, uint32_t dst_channels, const uint8_t *src,
+                      size_t pixel_count) {
+  const auto &k = kernels();
+  if (dst_channels == 1)
+    convert(k.rgba_to_r, dst, 1, src, 4, pixel_count);
+  else
+    convert(k.rgba_to_rg, dst, 2, src, 4, pixel_count);
+}
+
+void floatToHalf(uint16_t *dst, const float *src, size_t count) {
+  convert(kernels().float_to_half, dst, 1, src, 1, count);
+}
+
+const char *pixelConvertIsa() { return kernels().isa; }
+
+std::vector<PixelConvertKernels> pixelConvertKernels() { return supportedKernels(); }
+
+} // namespace vk_engine
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vk_engine {
+
+/**
+ * \brief expand 8 bit pixels of 1(gray), 2(gray alpha), 3(rgb) or 4 channels to rgba8,
+ * gray is replicated to rgb, missing alpha is 255. src and dst must not overlap.
+ * kernels are selected for the cpu at runtime(sse/avx2/neon), large images are
+ * converted on all hardware threads
+ */
+void expandToRgba8(uint8_t *dst, const uint8_t *src, uint32_t src_channels,
+                   size_t pixel_count);
+
+/**
+ * \brief the first dst_channels(1 or 2) channels of rgba8 pixels, e.g. r8/rg8 data textures
+ */
+void extractChannels8(uint8_t *dst, uint32_t dst_channels, const uint8_t *src,
+                      size_t pixel_count);
+
+/**
+ * \brief float32 to float16, round to nearest even(f16c/neon if supported)
+ */
+void floatToHalf(uint16_t *dst, const float *src, size_t count);
+
+uint16_t floatToHalf(float value);
+
+float halfToFloat(uint16_t value);
+
+/**
+ * \brief instruction set of the selected conversion kernels, for logging
+ */
+const char *pixelConvertIsa();
+
+/**
+ * \brief the conversion kernels of one instruction set, count is in pixels(floats)
+ */
+struct PixelConvertKernels {
+  const char *isa;
+  void (*rgb_to_rgba)(uint8_t *dst, const uint8_t *src, size_t count);
+  void (*gray_to_rgba)(uint8_t *dst, const uint8_t *src, size_t count);
+  void (*gray_alpha_to_rgba)(uint8_t *dst, const uint8_t *src, size_t count);
+  void (*rgba_to_r)(uint8_t *dst, const uint8_t *src, size_t count);
+  void (*rgba_to_rg)(uint8_t *dst, const uint8_t *src, size_t count);
+  void (*float_to_half)(uint16_t *dst, const float *src, size_t count);
+};
+
+/**
+ * \brief the kernel sets the cpu supports, the scalar reference first and the selected one last.
+ * a set falls back to the previous one for the conversions its isa has no kernel for
+ */
+std::vector<PixelConvertKernels> pixelConvertKernels();
+
+} // namespace vk_engine
@@ -0,0 +1,210 @@
+#include <framework/utils/vk/barriers.h>
+
+#include <stdexcept>
+#include <framework/utils/vk/image.h>
+
+namespace vk_engine
+{
+    ImageAccess imageAccessFor(VkImageLayout layout)
+    {
+        switch (layout)
+        {
+        case VK_IMAGE_LAYOUT_UNDEFINED:
+        case VK_IMAGE_LAYOUT_PREINITIALIZED:
+            return {layout, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+        case VK_IMAGE_LAYOUT_GENERAL:
+            return {layout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                    VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT};
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            return {layout, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT};
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            return {layout, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT};
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+            return {layout,
+                    VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+            return {layout, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+            return {layout,
+                    VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                        VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+            return {layout,
+                    VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                        VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT |
+                        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                        VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+            // the presentation engine waits on the semaphore, not on a stage
+            return {layout, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+        default:
+            throw std::runtime_error("Unsupported layout transition.");
+        }
+    }
+
+    // access & ~reads, so the write bits of extensions count as writes too
+    static VkAccessFlags2 writeAccessOf(VkAccessFlags2 access)
+    {
+        constexpr VkAccessFlags2 read_access =
+            VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT |
+            VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_UNIFORM_READ_BIT |
+            VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT |
+            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+            VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+            VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_HOST_READ_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
+        return access & ~read_access;
+    }
+
+    bool isWriteAccess(VkAccessFlags2 access) { return writeAccessOf(access) != 0; }
+
+    static bool sameState(const ImageAccess &a, const ImageAccess &b)
+    {
+        return a.layout == b.layout && a.stages == b.stages && a.access == b.access;
+    }
+
+    void BarrierBatcher::transition(Image &image, const VkImageSubresourceRange &range,
+                                    const ImageAccess &dst)
+    {
+        transition(image.getHandle(), image.states_, range, dst);
+    }
+
+    void BarrierBatcher::transition(VkImage image, std::vector<ImageAccess> &states,
+                                    const VkImageSubresourceRange &range, const ImageAccess &dst)
+    {
+        const uint32_t level_end = range.levelCount == VK_REMAINING_MIP_LEVELS
+                                       ? static_cast<uint32_t>(states.size())
+                                       : range.baseMipLevel + range.levelCount;
+        // index of the barrier of the previous level, extended while the levels share a state
+        size_t run = image_barriers_.size();
+        ImageAccess run_src;
+        for (uint32_t level = range.baseMipLevel; level < level_end; ++level)
+        {
+            const ImageAccess src = states[level];
+            ImageAccess next = dst;
+            if (src.layout == dst.layout && !isWriteAccess(src.access) && !isWriteAccess(dst.access))
+            {
+                // read after read, the earlier readers already see the last write
+                next.stages |= src.stages;
+                next.access |= src.access;
+                if ((dst.stages & ~src.stages) == 0 && (dst.access & ~src.access) == 0)
+                {
+                    run = image_barriers_.size();
+                    continue;
+                }
+            }
+            states[level] = next;
+
+            if (run < image_barriers_.size() && sameState(run_src, src))
+            {
+                ++image_barriers_[run].subresourceRange.levelCount;
+                continue;
+            }
+            run = image_barriers_.size();
+            run_src = src;
+            VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+            barrier.srcStageMask = src.stages;
+            // only writes are made available, readers just have to finish
+            barrier.srcAccessMask = writeAccessOf(src.access);
+            barrier.dstStageMask = dst.stages;
+            barrier.dstAccessMask = dst.access;
+            barrier.oldLayout = src.layout;
+            barrier.newLayout = dst.layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange = {range.aspectMask, level, 1, range.baseArrayLayer,
+                                        range.layerCount};
+            image_barriers_.emplace_back(barrier);
+        }
+    }
+
+    void BarrierBatcher::transition(Image &image, const ImageAccess &dst)
+    {
+        transition(image, image.getSubresourceRange(), dst);
+    }
+
+    void BarrierBatcher::imageBarrier(const VkImageMemoryBarrier2 &barrier)
+    {
+        for (auto &b : image_barriers_)
+        {
+            if (b.image == barrier.image && b.oldLayout == barrier.oldLayout &&
+                b.newLayout == barrier.newLayout &&
+                b.srcQueueFamilyIndex == barrier.srcQueueFamilyIndex &&
+                b.dstQueueFamilyIndex == barrier.dstQueueFamilyIndex &&
+                b.subresourceRange.aspectMask == barrier.subresourceRange.aspectMask &&
+                b.subresourceRange.baseMipLevel == barrier.subresourceRange.baseMipLevel &&
+                b.subresourceRange.levelCount == barrier.subresourceRange.levelCount &&
+                b.subresourceRange.baseArrayLayer == barrier.subresourceRange.baseArrayLayer &&
+                b.subresourceRange.layerCount == barrier.subresourceRange.layerCount)
+            {
+                b.srcStageMask |= barrier.srcStageMask;
+                b.srcAccessMask |= barrier.srcAccessMask;
+                b.dstStageMask |= barrier.dstStageMask;
+                b.dstAccessMask |= barrier.dstAccessMask;
+                return;
+            }
+        }
+        image_barriers_.emplace_back(barrier);
+    }
+
+    void BarrierBatcher::bufferBarrier(const VkBufferMemoryBarrier2 &barrier)
+    {
+        for (auto &b : buffer_barriers_)
+        {
+            if (b.buffer == barrier.buffer && b.offset == barrier.offset && b.size == barrier.size &&
+                b.srcQueueFamilyIndex == barrier.srcQueueFamilyIndex &&
+                b.dstQueueFamilyIndex == barrier.dstQueueFamilyIndex)
+            {
+                b.srcStageMask |= barrier.srcStageMask;
+                b.srcAccessMask |= barrier.srcAccessMask;
+                b.dstStageMask |= barrier.dstStageMask;
+                b.dstAccessMask |= barrier.dstAccessMask;
+                return;
+            }
+        }
+        buffer_barriers_.emplace_back(barrier);
+    }
+
+    void BarrierBatcher::memoryBarrier(VkPipelineStageFlags2 src_stages, VkAccessFlags2 src_access,
+                                       VkPipelineStageFlags2 dst_stages, VkAccessFlags2 dst_access)
+    {
+        // the same source scope made visible to more stages
+        for (auto &b : memory_barriers_)
+        {
+            if (b.srcStageMask == src_stages && b.srcAccessMask == src_access)
+            {
+                b.dstStageMask |= dst_stages;
+                b.dstAccessMask |= dst_access;
+                return;
+            }
+        }
+        VkMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        barrier.srcStageMask = src_stages;
+        barrier.srcAccessMask = src_access;
+        barrier.dstStageMask = dst_stages;
+        barrier.dstAccessMask = dst_access;
+        memory_barriers_.emplace_back(barrier);
+    }
+
+    void BarrierBatcher::flush(VkCommandBuffer cmd_buf)
+    {
+        if (empty())
+            return;
+        VkDependencyInfo dependency_info{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependency_info.memoryBarrierCount = static_cast<uint32_t>(memory_barriers_.size());
+        dependency_info.pMemoryBarriers = memory_barriers_.data();
+        dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_barriers_.size());
+        dependency_info.pBufferMemoryBarriers = buffer_barriers_.data();
+        dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers_.size());
+        dependency_info.pImageMemoryBarriers = image_barriers_.data();
+        vkCmdPipelineBarrier2(cmd_buf, &dependency_info);
+        memory_barriers_.clear();
+        buffer_barriers_.clear();
+        image_barriers_.clear();
+    }
+} // namespace vk_engine
@@ -2,9 +2,12 @@
 
 #include <volk.h>
 #include <string>
+#include <vector>
 
 namespace vk_engine
 {
+    class Image;
+
     struct ImageMemoryBarrier
     {
         VkImageLayout old_layout;
@@ -16,4 +19,83 @@ namespace vk_engine
         uint32_t src_queue_family_index;
         uint32_t dst_queue_family_index;
     };
-} // namespace vk_engine
\ No newline at end of file
+
+    /**
+     * \brief layout of an image subresource and the stages and access of its last use
+     */
+    struct ImageAccess
+    {
+        VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+        VkPipelineStageFlags2 stages{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 access{VK_ACCESS_2_NONE};
+    };
+
+    /**
+     * \brief the usual use of an image in layout, e.g. sampled by fragment and compute shaders
+     * for shader read only. throws for the layouts without one
+     */
+    ImageAccess imageAccessFor(VkImageLayout layout);
+
+    bool isWriteAccess(VkAccessFlags2 access);
+
+    /**
+     * \brief BarrierBatcher collects the barriers needed before a group of commands and records
+     * them with a single vkCmdPipelineBarrier2.
+     *
+     * transition() derives the barrier from the state tracked per subresource by the image, so
+     * the source stages are the ones that really used it instead of TOP_OF_PIPE/ALL_COMMANDS.
+     * Subresources already read in the same layout by the destination stages need no barrier and
+     * are skipped, consecutive levels in the same state share one barrier, and barriers added
+     * twice for the same image range are merged.
+     */
+    class BarrierBatcher final
+    {
+    public:
+        /**
+         * \brief transition the range of image to dst, the tracked state is updated when the
+         * barrier is added, the commands using dst must be recorded after flush
+         */
+        void transition(Image &image, const VkImageSubresourceRange &range, const ImageAccess &dst);
+
+        void transition(Image &image, const ImageAccess &dst);
+
+        /**
+         * \brief transition of an image whose state per mip level is kept by the caller in states,
+         * the same tracking as the Image overload
+         */
+        void transition(VkImage image, std::vector<ImageAccess> &states,
+                        const VkImageSubresourceRange &range, const ImageAccess &dst);
+
+        /**
+         * \brief barrier of an image not tracked by an Image(e.g. swapchain, render graph
+         * transients) or of a queue family ownership transfer
+         */
+        void imageBarrier(const VkImageMemoryBarrier2 &barrier);
+
+        void bufferBarrier(const VkBufferMemoryBarrier2 &barrier);
+
+        void memoryBarrier(VkPipelineStageFlags2 src_stages, VkAccessFlags2 src_access,
+                           VkPipelineStageFlags2 dst_stages, VkAccessFlags2 dst_access);
+
+        /**
+         * \brief record the collected barriers, nothing is recorded if there's none
+         */
+        void flush(VkCommandBuffer cmd_buf);
+
+        bool empty() const
+        {
+            return memory_barriers_.empty() && buffer_barriers_.empty() && image_barriers_.empty();
+        }
+
+        const std::vector<VkMemoryBarrier2> &getMemoryBarriers() const { return memory_barriers_; }
+
+        const std::vector<VkBufferMemoryBarrier2> &getBufferBarriers() const { return buffer_barriers_; }
+
+        const std::vector<VkImageMemoryBarrier2> &getImageBarriers() const { return image_barriers_; }
+
+    private:
+        std::vector<VkMemoryBarrier2> memory_barriers_;
+        std::vector<VkBufferMemoryBarrier2> buffer_barriers_;
+        std::vector<VkImageMemoryBarrier2> image_barriers_;
+    };
+} // namespace vk_engine
@@ -1,6 +1,13 @@
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <framework/utils/base/error.h>
 #include <framework/utils/vk/buffer.h>
+#include <framework/utils/vk/defragmenter.h>
+#include <framework/utils/vk/deletion_queue.h>
+#include <framework/utils/vk/memory_pools.h>
+#include <framework/utils/vk/memory_stats.h>
 #include <framework/utils/vk/vk_driver.h>
 #include <framework/utils/vk/commands.h>
 #include <framework/utils/vk/stage_pool.h>
@@ -31,65 +38,147 @@ Buffer::Buffer(const std::shared_ptr<VkDriver> &driver,
       memory_usage_, // VmaMemoryUsage            usage;
   };
 
+  const auto category = categorizeBuffer(buffer_usage_);
   VmaAllocationInfo allocation_info{};
-  auto result = vmaCreateBuffer(driver_->getAllocator(), &buffer_create_info,
-                                &alloc_create_info, &buffer_, &allocation_,
-                                &allocation_info);
+  auto result = driver_->getMemoryPools()->createBuffer(
+      category, buffer_create_info, alloc_create_info, &buffer_, &allocation_,
+      &allocation_info);
   if (result != VK_SUCCESS) {
     throw VulkanException(result, "failed to create buffer!");
   }
+  driver_->getMemoryStats()->onAllocate(allocation_, category);
 
   if (persistent_) {
     mapped_data_ = static_cast<std::byte *>(allocation_info.pMappedData);
     mapped_ = true;
   }
+
+  VkMemoryPropertyFlags memory_flags = 0;
+  vmaGetAllocationMemoryProperties(driver_->getAllocator(), allocation_, &memory_flags);
+  coherent_ = (memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+  const VkPhysicalDeviceProperties *properties = nullptr;
+  vmaGetPhysicalDeviceProperties(driver_->getAllocator(), &properties);
+  atom_size_ = std::max<VkDeviceSize>(properties->limits.nonCoherentAtomSize, 1);
 }
 
 Buffer::~Buffer() {
-  unmap();
-  vmaDestroyBuffer(driver_->getAllocator(), buffer_, allocation_);
+  if (relocatable_)
+    driver_->getDefragmenter()->untrack(allocation_);
+  // non persistent buffers stay mapped after the first update
+  if (mapped_ && !persistent_)
+    vmaUnmapMemory(driver_->getAllocator(), allocation_);
+  driver_->getMemoryStats()->onFree(allocation_);
+  driver_->getDeletionQueue()->destroyBuffer(buffer_, allocation_);
 }
 
 void Buffer::update(const void *data, size_t size, size_t offset) {
-  if (persistent_) {
-    memcpy(mapped_data_ + offset, data, size);
-    //std::copy(data, data + size, mapped_data_ + offset);
-    flush();
-  } else {
-    map();
-    memcpy(mapped_data_ + offset, data, size);
-    //std::copy(data, data + size, mapped_data_ + offset);
-    flush();
-    unmap();
-  }
+  write(data, size, offset);
+  flushDirty();
+}
+
+void Buffer::write(const void *data, size_t size, size_t offset) {
+  memcpy(mapRange(offset, size), data, size);
+}
+
+void *Buffer::mapRange(size_t offset, size_t size) {
+  assert(offset + size <= size_);
+  map();
+  markDirty(offset, size);
+  return mapped_data_ + offset;
 }
 
 void Buffer::updateByStaging(void *data, size_t size, size_t offset,
                       const std::shared_ptr<StagePool> &stage_pool,
                       const std::shared_ptr<CommandBuffer> &cmd_buf)
 {
-  auto stage = stage_pool->acquireStage(size);
-  // cpu data to stage
-  void* mapped;
-  vmaMapMemory(driver_->getAllocator(), stage->memory, &mapped);
-  memcpy(mapped, data, size);
-  vmaUnmapMemory(driver_->getAllocator(), stage->memory);
-  vmaFlushAllocation(driver_->getAllocator(), stage->memory, 0, size);
+  // cpu data to the staging ring
+  auto stage = stage_pool->allocateStaging(size);
+  memcpy(stage.mapped, data, size);
+  stage_pool->flushStaging(stage, size);
 
   // stage buffer to gpu buffer
   VkBufferCopy region{
-    .srcOffset = 0,
+    .srcOffset = stage.offset,
     .dstOffset = offset,    
     .size = size
   };
 
-  vkCmdCopyBuffer(cmd_buf->getHandle(), stage->buffer, buffer_, 1, &region);
+  vkCmdCopyBuffer(cmd_buf->getHandle(), stage.buffer, buffer_, 1, &region);
+}
+
+void Buffer::setRelocatable() {
+  if (relocatable_)
+    return;
+  relocatable_ = true;
+  driver_->getDefragmenter()->track(allocation_, this);
+}
+
+bool Buffer::relocate(VkCommandBuffer cmd_buf, VmaAllocation allocation) {
+  constexpr VkBufferUsageFlags copy_usage =
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  // a mapped pointer would still point to the old place
+  if (mapped_ || (buffer_usage_ & copy_usage) != copy_usage)
+    return false;
+
+  VkBufferCreateInfo buffer_create_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  buffer_create_info.flags = flags_;
+  buffer_create_info.size = size_;
+  buffer_create_info.usage = buffer_usage_;
+  buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VkBuffer buffer = VK_NULL_HANDLE;
+  if (vkCreateBuffer(driver_->getDevice(), &buffer_create_info, nullptr, &buffer) != VK_SUCCESS)
+    return false;
+  if (vmaBindBufferMemory(driver_->getAllocator(), allocation, buffer) != VK_SUCCESS) {
+    vkDestroyBuffer(driver_->getDevice(), buffer, nullptr);
+    return false;
+  }
+
+  VkBufferCopy region{.srcOffset = 0, .dstOffset = 0, .size = size_};
+  vkCmdCopyBuffer(cmd_buf, buffer_, buffer, 1, &region);
+  // the memory stays with allocation_, only the old handle is destroyed
+  driver_->getDeletionQueue()->destroyBuffer(buffer_, VK_NULL_HANDLE);
+  buffer_ = buffer;
+  return true;
+}
+
+void Buffer::markDirty(VkDeviceSize offset, VkDeviceSize size) {
+  if (coherent_ || size == 0)
+    return;
+  // flushed ranges must be multiples of nonCoherentAtomSize(or reach the end)
+  const VkDeviceSize begin = offset / atom_size_ * atom_size_;
+  const VkDeviceSize end =
+      std::min((offset + size + atom_size_ - 1) / atom_size_ * atom_size_, size_);
+  dirty_ranges_.emplace_back(begin, end);
 }
 
-void Buffer::flush() {
+void Buffer::flushDirty() {
   // called after writing to a mapped memory for memory types that are not HOST_COHERENT
   // Unmap operation doesn't do that automatically.
-  vmaFlushAllocation(driver_->getAllocator(), allocation_, 0, size_);
+  if (dirty_ranges_.empty())
+    return;
+  std::sort(dirty_ranges_.begin(), dirty_ranges_.end());
+  std::vector<VkDeviceSize> offsets, sizes;
+  VkDeviceSize begin = dirty_ranges_.front().first;
+  VkDeviceSize end = dirty_ranges_.front().second;
+  for (const auto &range : dirty_ranges_) {
+    // overlapping or touching ranges are flushed as one
+    if (range.first > end) {
+      offsets.emplace_back(begin);
+      sizes.emplace_back(end - begin);
+      begin = range.first;
+    }
+    end = std::max(end, range.second);
+  }
+  offsets.emplace_back(begin);
+  sizes.emplace_back(end - begin);
+  dirty_ranges_.clear();
+
+  std::vector<VmaAllocation> allocations(offsets.size(), allocation_);
+  auto result = vmaFlushAllocations(driver_->getAllocator(), allocations.size(),
+                                    allocations.data(), offsets.data(), sizes.data());
+  if (result != VK_SUCCESS) {
+    throw VulkanException(result, "failed to flush buffer memory!");
+  }
 }
 
 void Buffer::map() {
@@ -103,11 +192,4 @@ void Buffer::map() {
   }
 }
 
-void Buffer::unmap() {
-  if (mapped_ && !persistent_) {
-    vmaUnmapMemory(driver_->getAllocator(), allocation_);
-    mapped_ = false;
-  }
-}
-
 } // namespace vk_engine
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <vk_mem_alloc.h>
 #include <volk.h>
 
@@ -23,19 +24,52 @@ public:
 
   VkBuffer getHandle() const { return buffer_; }
 
+  VkDeviceSize getSize() const { return size_; }
+
+  /**
+   * \brief copy to the mapped memory and flush only the written range
+   */
   void update(const void *data, size_t size, size_t offset = 0);
 
+  /**
+   * \brief copy to the mapped memory without flushing, the range is flushed by flushDirty
+   */
+  void write(const void *data, size_t size, size_t offset = 0);
+
+  /**
+   * \brief mapped pointer at offset for writing in place, the range is marked dirty.
+   * call flushDirty after writing
+   */
+  void *mapRange(size_t offset, size_t size);
+
+  /**
+   * \brief flush the merged dirty ranges in one call, no-op on host coherent memory
+   */
+  void flushDirty();
+
+  bool isHostCoherent() const { return coherent_; }
+
+  /**
+   * \brief let the defragmenter move the buffer. only for buffers whose handle is read at
+   * record time(e.g. vertex/index bindings), not written into descriptor sets
+   */
+  void setRelocatable();
+
+  /**
+   * \brief recreate the buffer bound to allocation and record the copy of the contents,
+   * the old handle is destroyed after the frame. false if the buffer can't be moved
+   */
+  bool relocate(VkCommandBuffer cmd_buf, VmaAllocation allocation);
+
   void updateByStaging(void *data, size_t size, size_t offset,
                        const std::shared_ptr<StagePool> &stage_pool,
                        const std::shared_ptr<CommandBuffer> &cmd_buf);
 
 private:
-  void flush();
+  void markDirty(VkDeviceSize offset, VkDeviceSize size);
 
   void map();
 
-  void unmap();
-
   std::shared_ptr<VkDriver> driver_;
 
   VkBuffer buffer_{VK_NULL_HANDLE};
@@ -45,6 +79,11 @@ private:
   std::byte *mapped_data_{nullptr};
 
   bool persistent_;
+  bool relocatable_{false};
+  bool coherent_{false};
+  VkDeviceSize atom_size_{1}; //!< nonCoherentAtomSize
+  //! [begin, end) aligned to atom_size_, unmerged until flushDirty
+  std::vector<std::pair<VkDeviceSize, VkDeviceSize>> dirty_ranges_;
   VkBufferCreateFlags flags_;
   VkDeviceSize size_;
   VkBufferUsageFlags buffer_usage_;
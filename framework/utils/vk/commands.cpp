@@ -186,6 +186,24 @@ void CommandBuffer::beginRenderPass(
                        VK_SUBPASS_CONTENTS_INLINE);
 }
 
+void CommandBuffer::beginRenderPass(
+    const std::shared_ptr<RenderPass> &render_pass,
+    const FrameBuffer &frame_buffer,
+    const std::vector<VkClearValue> &clear_values) {
+  VkRenderPassBeginInfo render_pass_begin_info = {};
+  render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  render_pass_begin_info.renderPass = render_pass->getHandle();
+  render_pass_begin_info.framebuffer = frame_buffer.getHandle();
+  render_pass_begin_info.renderArea.offset = {0, 0};
+  render_pass_begin_info.renderArea.extent.width = frame_buffer.getWidth();
+  render_pass_begin_info.renderArea.extent.height = frame_buffer.getHeight();
+  render_pass_begin_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+  render_pass_begin_info.pClearValues = clear_values.data();
+
+  vkCmdBeginRenderPass(command_buffer_, &render_pass_begin_info,
+                       VK_SUBPASS_CONTENTS_INLINE);
+}
+
 void CommandBuffer::setViewPort(const std::initializer_list<VkViewport> &viewports)
 {
   vkCmdSetViewport(command_buffer_, 0, viewports.size(), viewports.begin());
@@ -74,6 +74,13 @@ public:
   void beginRenderPass(const std::shared_ptr<RenderPass> &render_pass,
                        const std::unique_ptr<FrameBuffer> &frame_buffer);
 
+  /**
+   * \brief one clear value per attachment of the render pass
+   */
+  void beginRenderPass(const std::shared_ptr<RenderPass> &render_pass,
+                       const FrameBuffer &frame_buffer,
+                       const std::vector<VkClearValue> &clear_values);
+
   void endRenderPass();
 
   void setViewPort(const std::initializer_list<VkViewport> &viewports);
@@ -0,0 +1,181 @@
+#include <framework/utils/vk/defragmenter.h>
+
+#include <algorithm>
+#include <framework/utils/base/logging.h>
+#include <framework/utils/vk/barriers.h>
+#include <framework/utils/vk/buffer.h>
+#include <framework/utils/vk/image.h>
+#include <framework/utils/vk/memory_pools.h>
+#include <framework/utils/vk/syncs.h>
+
+namespace vk_engine {
+
+Defragmenter::Defragmenter(VmaAllocator allocator, MemoryPools *pools,
+                           const std::shared_ptr<DeviceTimeline> &timeline)
+    : allocator_(allocator), pools_(pools), timeline_(timeline) {}
+
+void Defragmenter::track(VmaAllocation allocation, Buffer *buffer) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  owners_[allocation] = Owner{.buffer = buffer};
+}
+
+void Defragmenter::track(VmaAllocation allocation, Image *image) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  owners_[allocation] = Owner{.image = image};
+}
+
+void Defragmenter::untrack(VmaAllocation allocation) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  owners_.erase(allocation);
+}
+
+void Defragmenter::request() {
+  for (auto category : {MemoryCategory::Geometry, MemoryCategory::Texture}) {
+    if (std::find(queued_.begin(), queued_.end(), category) == queued_.end())
+      queued_.emplace_back(category);
+  }
+}
+
+void Defragmenter::begin(MemoryCategory category) {
+  auto pool = pools_->getPool(category);
+  if (pool == VK_NULL_HANDLE)
+    return;
+  report_ = DefragmentationReport{};
+  report_.category = category;
+  report_.fragmentation_before =
+      MemoryStats::fragmentation(pools_->getPoolStatistics(category));
+
+  VmaDefragmentationInfo info{};
+  info.pool = pool;
+  info.maxBytesPerPass = max_bytes_per_pass_;
+  info.maxAllocationsPerPass = max_allocations_per_pass_;
+  auto result = vmaBeginDefragmentation(allocator_, &info, &context_);
+  if (result != VK_SUCCESS) {
+    LOGW("failed to begin defragmentation of {} pool", memoryCategoryName(category));
+    context_ = VK_NULL_HANDLE;
+  }
+}
+
+void Defragmenter::finish() {
+  VmaDefragmentationStats stats{};
+  vmaEndDefragmentation(allocator_, context_, &stats);
+  context_ = VK_NULL_HANDLE;
+
+  report_.bytes_moved = stats.bytesMoved;
+  report_.bytes_freed = stats.bytesFreed;
+  report_.allocations_moved = stats.allocationsMoved;
+  report_.blocks_freed = stats.deviceMemoryBlocksFreed;
+  report_.fragmentation_after =
+      MemoryStats::fragmentation(pools_->getPoolStatistics(report_.category));
+  LOGI("defragmented {} pool in {} passes: moved {} allocations({}KB), freed {}KB "
+       "and {} blocks, fragmentation {:.2f} -> {:.2f}",
+       memoryCategoryName(report_.category), report_.passes,
+       report_.allocations_moved, report_.bytes_moved >> 10,
+       report_.bytes_freed >> 10, report_.blocks_freed,
+       report_.fragmentation_before, report_.fragmentation_after);
+  std::lock_guard<std::mutex> lk(report_mtx_);
+  last_report_ = report_;
+}
+
+void Defragmenter::retire() {
+  if (!pass_in_flight_ || !timeline_->isCompleted(pass_value_))
+    return;
+  pass_in_flight_ = false;
+  // the copies are done, the moved allocations point to their new place
+  if (vmaEndDefragmentationPass(allocator_, context_, &pass_) == VK_SUCCESS)
+    finish();
+}
+
+void Defragmenter::step(VkCommandBuffer cmd_buf) {
+  ++frame_;
+  if (pass_in_flight_)
+    return;
+
+  if (context_ == VK_NULL_HANDLE) {
+    if (queued_.empty() && threshold_ > 0.0f && frame_ % CHECK_INTERVAL == 0) {
+      for (auto category : {MemoryCategory::Geometry, MemoryCategory::Texture}) {
+        if (pools_->getPool(category) != VK_NULL_HANDLE &&
+            MemoryStats::fragmentation(pools_->getPoolStatistics(category)) > threshold_)
+          queued_.emplace_back(category);
+      }
+    }
+    if (queued_.empty())
+      return;
+    const auto category = queued_.front();
+    queued_.erase(queued_.begin());
+    begin(category);
+    if (context_ == VK_NULL_HANDLE)
+      return;
+  }
+
+  // VK_SUCCESS: nothing left to move
+  if (vmaBeginDefragmentationPass(allocator_, context_, &pass_) == VK_SUCCESS) {
+    finish();
+    return;
+  }
+
+  uint32_t copies = 0;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    std::vector<std::pair<VmaDefragmentationMove *, Owner>> moves;
+    for (uint32_t i = 0; i < pass_.moveCount; ++i) {
+      auto &move = pass_.pMoves[i];
+      auto itr = owners_.find(move.srcAllocation);
+      if (itr == owners_.end())
+        move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+      else
+        moves.emplace_back(&move, itr->second);
+    }
+
+    if (!moves.empty()) {
+      // the previous commands of the queue finish writing before the copies
+      BarrierBatcher barriers;
+      barriers.memoryBarrier(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT,
+                             VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                             VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT);
+      barriers.flush(cmd_buf);
+      for (auto &[move, owner] : moves) {
+        const bool moved = owner.buffer != nullptr
+                               ? owner.buffer->relocate(cmd_buf, move->dstTmpAllocation)
+                               : owner.image->relocate(cmd_buf, move->dstTmpAllocation);
+        if (moved)
+          ++copies;
+        else
+          move->operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+      }
+      // the new places are read by the rest of the frame
+      barriers.memoryBarrier(VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                             VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                             VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT);
+      barriers.flush(cmd_buf);
+    }
+  }
+
+  ++report_.passes;
+  if (copies == 0) {
+    // nothing movable in this pass, the reserved places are released right away.
+    // VK_INCOMPLETE: more passes follow, the next one begins on the next step
+    if (vmaEndDefragmentationPass(allocator_, context_, &pass_) == VK_SUCCESS)
+      finish();
+    return;
+  }
+  pass_in_flight_ = true;
+  pass_value_ = timeline_->pending();
+}
+
+void Defragmenter::cancel() {
+  queued_.clear();
+  if (context_ == VK_NULL_HANDLE)
+    return;
+  if (pass_in_flight_) {
+    pass_in_flight_ = false;
+    vmaEndDefragmentationPass(allocator_, context_, &pass_);
+  }
+  finish();
+}
+
+DefragmentationReport Defragmenter::getLastReport() const {
+  std::lock_guard<std::mutex> lk(report_mtx_);
+  return last_report_;
+}
+} // namespace vk_engine
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <volk.h>
+
+#include <framework/utils/vk/memory_stats.h>
+
+namespace vk_engine {
+class Buffer;
+class Image;
+class DeviceTimeline;
+class MemoryPools;
+
+struct DefragmentationReport {
+  MemoryCategory category{MemoryCategory::Other};
+  VkDeviceSize bytes_moved{0};
+  VkDeviceSize bytes_freed{0};
+  uint32_t allocations_moved{0};
+  uint32_t blocks_freed{0};
+  uint32_t passes{0};
+  float fragmentation_before{0.0f};
+  float fragmentation_after{0.0f};
+};
+
+/**
+ * \brief Defragmenter compacts the geometry and texture pools incrementally with the vma
+ * defragmentation api, one pass per frame.
+ *
+ * Only buffers and images marked relocatable are moved, the other allocations of the pass
+ * are ignored. A pass recreates the moved resources at their new place, records the copies
+ * on the frame's command buffer and switches the owners to the new handles right away, so
+ * the draws recorded after it use them(vertex/index bindings read Buffer::getHandle() per
+ * draw, image views are refreshed by their users). The pass ends, and the old places are
+ * freed, once the device timeline passes the frame.
+ */
+class Defragmenter final {
+public:
+  Defragmenter(VmaAllocator allocator, MemoryPools *pools,
+               const std::shared_ptr<DeviceTimeline> &timeline);
+
+  ~Defragmenter() { cancel(); }
+
+  Defragmenter(const Defragmenter &) = delete;
+  Defragmenter &operator=(const Defragmenter &) = delete;
+
+  void track(VmaAllocation allocation, Buffer *buffer);
+
+  void track(VmaAllocation allocation, Image *image);
+
+  void untrack(VmaAllocation allocation);
+
+  /**
+   * \brief bytes and allocations moved per frame, bounds the gpu copy time of a pass
+   */
+  void setPassBudget(VkDeviceSize max_bytes, uint32_t max_allocations) {
+    max_bytes_per_pass_ = max_bytes;
+    max_allocations_per_pass_ = max_allocations;
+  }
+
+  /**
+   * \brief pools more fragmented than threshold are compacted, checked every few hundred
+   * frames. 0 disables the automatic start
+   */
+  void setThreshold(float fragmentation) { threshold_ = fragmentation; }
+
+  /**
+   * \brief compact all the pools, starting on the next step
+   */
+  void request();
+
+  /**
+   * \brief end the pass once the device finished its copies, called before the deletion
+   * queue pump each frame, so no moved allocation is freed during its pass
+   */
+  void retire();
+
+  /**
+   * \brief record the next pass on cmd_buf if no pass is in flight
+   */
+  void step(VkCommandBuffer cmd_buf);
+
+  /**
+   * \brief abandon the current defragmentation, the device must be idle
+   */
+  void cancel();
+
+  bool active() const { return context_ != VK_NULL_HANDLE; }
+
+  DefragmentationReport getLastReport() const;
+
+  static constexpr uint32_t CHECK_INTERVAL = 300; //!< frames between fragmentation checks
+
+private:
+  struct Owner {
+    Buffer *buffer{nullptr};
+    Image *image{nullptr};
+  };
+
+  void begin(MemoryCategory category);
+
+  void finish();
+
+  VmaAllocator allocator_;
+  MemoryPools *pools_;
+  std::shared_ptr<DeviceTimeline> timeline_;
+
+  std::mutex mtx_; //!< guard owners_, locked while a pass relocates them
+  std::unordered_map<VmaAllocation, Owner> owners_;
+
+  VkDeviceSize max_bytes_per_pass_{16u << 20};
+  uint32_t max_allocations_per_pass_{64};
+  float threshold_{0.3f};
+  uint64_t frame_{0};
+
+  std::vector<MemoryCategory> queued_; //!< pools waiting for defragmentation
+  VmaDefragmentationContext context_{VK_NULL_HANDLE};
+  VmaDefragmentationPassMoveInfo pass_{};
+  bool pass_in_flight_{false};
+  uint64_t pass_value_{0}; //!< timeline value of the frame recording the pass
+  DefragmentationReport report_;
+  mutable std::mutex report_mtx_;
+  DefragmentationReport last_report_;
+};
+} // namespace vk_engine
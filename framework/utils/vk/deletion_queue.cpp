@@ -0,0 +1,96 @@
+#include <framework/utils/vk/deletion_queue.h>
+#include <framework/utils/vk/syncs.h>
+
+namespace vk_engine {
+
+DeletionQueue::DeletionQueue(VkDevice device, VmaAllocator allocator,
+                             const std::shared_ptr<DeviceTimeline> &timeline)
+    : device_(device), allocator_(allocator), timeline_(timeline) {}
+
+void DeletionQueue::enqueue(std::function<void()> &&destroy) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  entries_.emplace_back(timeline_->pending(), std::move(destroy));
+}
+
+void DeletionQueue::destroyBuffer(VkBuffer buffer, VmaAllocation allocation) {
+  enqueue([allocator = allocator_, buffer, allocation]() {
+    vmaDestroyBuffer(allocator, buffer, allocation);
+  });
+}
+
+void DeletionQueue::destroyImage(VkImage image, VmaAllocation allocation) {
+  enqueue([allocator = allocator_, image, allocation]() {
+    vmaDestroyImage(allocator, image, allocation);
+  });
+}
+
+void DeletionQueue::destroyImageView(VkImageView image_view) {
+  enqueue([device = device_, image_view]() {
+    vkDestroyImageView(device, image_view, nullptr);
+  });
+}
+
+void DeletionQueue::destroyFramebuffer(VkFramebuffer framebuffer) {
+  enqueue([device = device_, framebuffer]() {
+    vkDestroyFramebuffer(device, framebuffer, nullptr);
+  });
+}
+
+void DeletionQueue::destroySwapchain(VkSwapchainKHR swapchain) {
+  enqueue([device = device_, swapchain]() {
+    vkDestroySwapchainKHR(device, swapchain, nullptr);
+  });
+}
+
+void DeletionQueue::freeDescriptorSet(VkDescriptorPool pool,
+                                      VkDescriptorSet descriptor_set) {
+  enqueue([device = device_, pool, descriptor_set]() {
+    vkFreeDescriptorSets(device, pool, 1, &descriptor_set);
+  });
+}
+
+void DeletionQueue::destroyDescriptorPool(VkDescriptorPool pool) {
+  enqueue([device = device_, pool]() {
+    vkDestroyDescriptorPool(device, pool, nullptr);
+  });
+}
+
+void DeletionQueue::defer(std::function<void()> &&release) {
+  enqueue(std::move(release));
+}
+
+void DeletionQueue::pump() {
+  const uint64_t completed = timeline_->completed();
+  std::deque<std::pair<uint64_t, std::function<void()>>> ready;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    // in enqueue order, e.g. descriptor sets before their pool
+    while (!entries_.empty() && entries_.front().first <= completed) {
+      ready.emplace_back(std::move(entries_.front()));
+      entries_.pop_front();
+    }
+  }
+  for (auto &entry : ready)
+    entry.second();
+}
+
+void DeletionQueue::flush() {
+  // released objects may enqueue more, e.g. the buffer of a deferred geometry page
+  for (;;) {
+    std::deque<std::pair<uint64_t, std::function<void()>>> entries;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      if (entries_.empty())
+        break;
+      entries.swap(entries_);
+    }
+    for (auto &entry : entries)
+      entry.second();
+  }
+}
+
+size_t DeletionQueue::size() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return entries_.size();
+}
+} // namespace vk_engine
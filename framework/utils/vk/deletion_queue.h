@@ -0,0 +1,79 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vk_mem_alloc.h>
+#include <volk.h>
+
+namespace vk_engine {
+class DeviceTimeline;
+
+/**
+ * \brief DeletionQueue defers destroying vulkan objects until the device is done with them.
+ *
+ * The destructors of the gpu objects enqueue their handles tagged with the pending device
+ * timeline value, which covers every command buffer they may be recorded in. pump() destroys
+ * them in enqueue order once the timeline passes the tag, so releasing a resource never stalls.
+ */
+class DeletionQueue final {
+public:
+  DeletionQueue(VkDevice device, VmaAllocator allocator,
+                const std::shared_ptr<DeviceTimeline> &timeline);
+
+  ~DeletionQueue() { flush(); }
+
+  DeletionQueue(const DeletionQueue &) = delete;
+  DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+  /**
+   * \brief allocation may be null to destroy only the handle, e.g. after a relocation
+   */
+  void destroyBuffer(VkBuffer buffer, VmaAllocation allocation);
+
+  void destroyImage(VkImage image, VmaAllocation allocation);
+
+  void destroyImageView(VkImageView image_view);
+
+  void destroyFramebuffer(VkFramebuffer framebuffer);
+
+  void destroySwapchain(VkSwapchainKHR swapchain);
+
+  /**
+   * \brief the set is freed before its pool, pools are destroyed through the queue too
+   */
+  void freeDescriptorSet(VkDescriptorPool pool, VkDescriptorSet descriptor_set);
+
+  void destroyDescriptorPool(VkDescriptorPool pool);
+
+  /**
+   * \brief run release once the device is done with the work recorded so far, e.g. to return a
+   * sub-allocation of a buffer. objects captured by release are kept alive until then
+   */
+  void defer(std::function<void()> &&release);
+
+  /**
+   * \brief destroy the objects whose last use completed, called once per frame
+   */
+  void pump();
+
+  /**
+   * \brief destroy all objects, the device must be idle
+   */
+  void flush();
+
+  size_t size() const;
+
+private:
+  void enqueue(std::function<void()> &&destroy);
+
+  VkDevice device_;
+  VmaAllocator allocator_;
+  std::shared_ptr<DeviceTimeline> timeline_;
+
+  mutable std::mutex mtx_;
+  //! (timeline value of the last use, destroy function) in enqueue order
+  std::deque<std::pair<uint64_t, std::function<void()>>> entries_;
+};
+} // namespace vk_engine
@@ -1,5 +1,7 @@
 #include <framework/utils/vk/descriptor_set.h>
+#include <framework/utils/vk/deletion_queue.h>
 #include <framework/utils/base/error.h>
+#include <algorithm>
 
 namespace vk_engine {
 DescriptorPool::DescriptorPool(const std::shared_ptr<VkDriver> &driver,
@@ -33,7 +35,8 @@ DescriptorPool::~DescriptorPool()
     }
     descriptor_sets_.clear();
     // all descriptor sets allocated from the pool are implicitly freed and become invalid.
-    vkDestroyDescriptorPool(driver_->getDevice(), descriptor_pool_, nullptr);
+    // deferred after the frees of its sets, which are queued before it
+    driver_->getDeletionQueue()->destroyDescriptorPool(descriptor_pool_);
 }
 
 void DescriptorPool::reset()
@@ -51,6 +54,13 @@ void DescriptorPool::reset()
 
 std::shared_ptr<DescriptorSet> DescriptorPool::requestDescriptorSet(const DescriptorSetLayout &layout)
 {
+    // sets released by their users are freed through the deletion queue, after their last use
+    if (flags_ & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT) {
+        descriptor_sets_.erase(
+            std::remove_if(descriptor_sets_.begin(), descriptor_sets_.end(),
+                           [](const std::shared_ptr<DescriptorSet> &set) { return set.use_count() == 1; }),
+            descriptor_sets_.end());
+    }
     std::shared_ptr<DescriptorSet> ptr(new DescriptorSet(driver_, *this, layout));
     descriptor_sets_.emplace_back(ptr);
     return ptr;
@@ -81,6 +91,6 @@ DescriptorSet::DescriptorSet(const std::shared_ptr<VkDriver> &driver,
 DescriptorSet::~DescriptorSet()
 {
     if(free_able_)
-        vkFreeDescriptorSets(driver_->getDevice(), descriptor_pool_, 1, &descriptor_set_);
+        driver_->getDeletionQueue()->freeDescriptorSet(descriptor_pool_, descriptor_set_);
 }
 } // namespace vk_engine
\ No newline at end of file
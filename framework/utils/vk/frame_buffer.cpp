@@ -1,4 +1,5 @@
 #include <framework/utils/base/error.h>
+#include <framework/utils/vk/deletion_queue.h>
 #include <framework/utils/vk/frame_buffer.h>
 namespace vk_engine {
 
@@ -69,7 +70,7 @@ FrameBuffer::FrameBuffer(const std::shared_ptr<VkDriver> &driver,
 }
 
 FrameBuffer::~FrameBuffer() {
-  vkDestroyFramebuffer(driver_->getDevice(), framebuffer_, nullptr);
+  driver_->getDeletionQueue()->destroyFramebuffer(framebuffer_);
 }
 
 RenderTarget::RenderTarget(const std::shared_ptr<VkDriver> &driver,
@@ -113,4 +114,11 @@ RenderTarget::RenderTarget(
     uint32_t width, uint32_t height, uint32_t layers)
     : color_formats_(color_format), ds_format_(ds_format), width_(width),
       height_(height), layers_(layers), images_views_(image_views) {}
+
+RenderTarget::RenderTarget(
+    const std::vector<std::shared_ptr<ImageView>> &image_views,
+    const std::vector<VkFormat> &color_format, VkFormat ds_format,
+    uint32_t width, uint32_t height, uint32_t layers)
+    : color_formats_(color_format), ds_format_(ds_format), width_(width),
+      height_(height), layers_(layers), images_views_(image_views) {}
 } // namespace vk_engine
\ No newline at end of file
@@ -26,6 +26,10 @@ public:
                const std::initializer_list<VkFormat> &color_format, VkFormat ds_format,
                uint32_t width, uint32_t height, uint32_t layers);
 
+  RenderTarget(const std::vector<std::shared_ptr<ImageView>> &image_views,
+               const std::vector<VkFormat> &color_format, VkFormat ds_format,
+               uint32_t width, uint32_t height, uint32_t layers);
+
   const std::vector<std::shared_ptr<ImageView>> &getImageViews() const {
     return images_views_;
   }
@@ -0,0 +1,112 @@
+#include <framework/utils/vk/geometry_arena.h>
+
+#include <algorithm>
+#include <framework/utils/base/error.h>
+#include <framework/utils/vk/buffer.h>
+#include <framework/utils/vk/deletion_queue.h>
+#include <framework/utils/vk/vk_driver.h>
+
+namespace vk_engine {
+
+GeometryPage::GeometryPage(const std::shared_ptr<VkDriver> &driver,
+                           uint32_t element_size, uint32_t capacity,
+                           VkBufferUsageFlags usage)
+    : deletion_queue(driver->getDeletionQueue()), element_size(element_size),
+      capacity(capacity) {
+  buffer = std::make_shared<Buffer>(
+      driver, 0, static_cast<VkDeviceSize>(element_size) * capacity,
+      usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 0,
+      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+  // pages are bound by handle at record time, the defragmenter may move them
+  buffer->setRelocatable();
+  // the virtual block is measured in elements, offsets are element indices
+  VmaVirtualBlockCreateInfo block_info{.size = capacity};
+  auto result = vmaCreateVirtualBlock(&block_info, &block);
+  if (result != VK_SUCCESS)
+    throw VulkanException(result, "failed to create geometry virtual block!");
+}
+
+GeometryPage::~GeometryPage() { vmaDestroyVirtualBlock(block); }
+
+GeometryRange::~GeometryRange() {
+  // frames in flight may still draw the range, a mesh loaded meanwhile must not
+  // be given it. the deferred free also keeps the page alive until then
+  page_->deletion_queue->defer(
+      [page = std::move(page_), allocation = allocation_]() {
+        std::lock_guard<std::mutex> lk(page->mtx);
+        vmaVirtualFree(page->block, allocation);
+      });
+}
+
+GeometryArena::GeometryArena(const std::shared_ptr<VkDriver> &driver,
+                             VkDeviceSize page_size)
+    : driver_(driver), page_size_(page_size) {}
+
+std::shared_ptr<GeometryRange>
+GeometryArena::allocateVertices(uint32_t stride, uint32_t vertex_count) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return allocate(vertex_pages_[stride], stride, vertex_count,
+                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
+
+std::shared_ptr<GeometryRange>
+GeometryArena::allocateIndices(VkIndexType index_type, uint32_t index_count) {
+  const uint32_t index_size =
+      index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  std::lock_guard<std::mutex> lk(mtx_);
+  return allocate(index_pages_[index_type], index_size, index_count,
+                  VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+std::shared_ptr<GeometryRange>
+GeometryArena::allocate(std::vector<std::shared_ptr<GeometryPage>> &pages,
+                        uint32_t element_size, uint32_t count,
+                        VkBufferUsageFlags usage) {
+  VmaVirtualAllocationCreateInfo alloc_info{.size = std::max(count, 1u)};
+  for (const auto &page : pages) {
+    if (page->capacity < alloc_info.size)
+      continue;
+    std::lock_guard<std::mutex> lk(page->mtx);
+    VmaVirtualAllocation allocation;
+    VkDeviceSize offset;
+    if (vmaVirtualAllocate(page->block, &alloc_info, &allocation, &offset) ==
+        VK_SUCCESS)
+      return std::make_shared<GeometryRange>(
+          page, allocation, static_cast<uint32_t>(offset), count);
+  }
+
+  // a mesh larger than a page gets a page of its own
+  const uint32_t capacity = std::max(
+      static_cast<uint32_t>(page_size_ / element_size), count);
+  auto page = std::make_shared<GeometryPage>(driver_, element_size, capacity,
+                                             usage);
+  pages.emplace_back(page);
+  LOGD("new geometry page: {} elements of {} bytes", capacity, element_size);
+  VmaVirtualAllocation allocation;
+  VkDeviceSize offset;
+  auto result =
+      vmaVirtualAllocate(page->block, &alloc_info, &allocation, &offset);
+  if (result != VK_SUCCESS)
+    throw VulkanException(result, "failed to allocate geometry range!");
+  return std::make_shared<GeometryRange>(page, allocation,
+                                         static_cast<uint32_t>(offset), count);
+}
+
+void GeometryArena::trim() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto trim_pages = [](std::vector<std::shared_ptr<GeometryPage>> &pages) {
+    // a page is only referenced by the arena when it has no live range, and
+    // no range free pending on the timeline
+    pages.erase(std::remove_if(pages.begin(), pages.end(),
+                               [](const std::shared_ptr<GeometryPage> &p) {
+                                 return p.use_count() == 1;
+                               }),
+                pages.end());
+  };
+  for (auto &p : vertex_pages_)
+    trim_pages(p.second);
+  for (auto &p : index_pages_)
+    trim_pages(p.second);
+}
+
+} // namespace vk_engine
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <volk.h>
+
+namespace vk_engine {
+class VkDriver;
+class Buffer;
+class DeletionQueue;
+
+/**
+ * \brief a large device local buffer, sub-allocated in elements of one size
+ * by a vma virtual block(TLSF)
+ */
+struct GeometryPage {
+  GeometryPage(const std::shared_ptr<VkDriver> &driver, uint32_t element_size,
+               uint32_t capacity, VkBufferUsageFlags usage);
+  ~GeometryPage();
+
+  GeometryPage(const GeometryPage &) = delete;
+  GeometryPage &operator=(const GeometryPage &) = delete;
+
+  DeletionQueue *deletion_queue; //!< ranges are freed after their last use
+  std::shared_ptr<Buffer> buffer;
+  VmaVirtualBlock block{VK_NULL_HANDLE};
+  uint32_t element_size;
+  uint32_t capacity; //!< in elements
+  std::mutex mtx;    //!< guard the virtual block
+};
+
+/**
+ * \brief elements [first, first + count) of a page, freed once the device
+ * timeline passes the destruction. the page is kept alive by its ranges
+ */
+class GeometryRange final {
+public:
+  GeometryRange(const std::shared_ptr<GeometryPage> &page,
+                VmaVirtualAllocation allocation, uint32_t first, uint32_t count)
+      : page_(page), allocation_(allocation), first_(first), count_(count) {}
+
+  ~GeometryRange();
+
+  GeometryRange(const GeometryRange &) = delete;
+  GeometryRange &operator=(const GeometryRange &) = delete;
+
+  const std::shared_ptr<Buffer> &buffer() const { return page_->buffer; }
+
+  //! first element, the base vertex or first index to draw with
+  uint32_t first() const { return first_; }
+
+  uint32_t count() const { return count_; }
+
+  VkDeviceSize byteOffset() const {
+    return static_cast<VkDeviceSize>(first_) * page_->element_size;
+  }
+
+  VkDeviceSize byteSize() const {
+    return static_cast<VkDeviceSize>(count_) * page_->element_size;
+  }
+
+private:
+  std::shared_ptr<GeometryPage> page_;
+  VmaVirtualAllocation allocation_;
+  uint32_t first_;
+  uint32_t count_;
+};
+
+/**
+ * \brief all static mesh vertices and indices are sub-allocated from a few
+ * large buffers, one set of pages per vertex stride and index type, so draws
+ * of the same layout share one vertex/index binding.
+ */
+class GeometryArena final {
+public:
+  GeometryArena(const std::shared_ptr<VkDriver> &driver,
+                VkDeviceSize page_size = 64u << 20);
+
+  GeometryArena(const GeometryArena &) = delete;
+  GeometryArena &operator=(const GeometryArena &) = delete;
+
+  std::shared_ptr<GeometryRange> allocateVertices(uint32_t stride,
+                                                  uint32_t vertex_count);
+
+  std::shared_ptr<GeometryRange> allocateIndices(VkIndexType index_type,
+                                                 uint32_t index_count);
+
+  /**
+   * \brief release the pages without live ranges, their buffers are destroyed
+   * through the deletion queue
+   */
+  void trim();
+
+private:
+  std::shared_ptr<GeometryRange>
+  allocate(std::vector<std::shared_ptr<GeometryPage>> &pages,
+           uint32_t element_size, uint32_t count, VkBufferUsageFlags usage);
+
+  std::shared_ptr<VkDriver> driver_;
+  VkDeviceSize page_size_;
+  std::mutex mtx_; //!< guard the page lists
+  std::map<uint32_t, std::vector<std::shared_ptr<GeometryPage>>> vertex_pages_; //!< stride -> pages
+  std::map<VkIndexType, std::vector<std::shared_ptr<GeometryPage>>> index_pages_;
+};
+} // namespace vk_engine
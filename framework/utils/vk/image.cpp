@@ -1,6 +1,13 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
 #include <framework/utils/base/error.h>
 #include <framework/utils/vk/image.h>
 #include <framework/utils/vk/commands.h>
+#include <framework/utils/vk/defragmenter.h>
+#include <framework/utils/vk/deletion_queue.h>
+#include <framework/utils/vk/memory_pools.h>
+#include <framework/utils/vk/memory_stats.h>
 #include <framework/utils/vk/stage_pool.h>
 
 namespace vk_engine {
@@ -8,17 +15,17 @@ namespace vk_engine {
 Image::Image(const std::shared_ptr<VkDriver> &driver, VkImageCreateFlags flags,
              VkFormat format, const VkExtent3D &extent,
              VkSampleCountFlagBits sample_count, VkImageUsageFlags image_usage,
-             VmaMemoryUsage memory_usage)
+             VmaMemoryUsage memory_usage, uint32_t mip_levels)
     : driver_(driver), flags_(flags), format_(format), extent_(extent),
       sample_count_(sample_count), image_usage_(image_usage),
-      memory_usage_(memory_usage) {
+      memory_usage_(memory_usage), mip_levels_(mip_levels) {
   VkImageCreateInfo image_info = {};
   image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   image_info.flags = flags;
   image_info.imageType = VK_IMAGE_TYPE_2D;
   image_info.format = format_;
   image_info.extent = extent_;
-  image_info.mipLevels = 1;
+  image_info.mipLevels = mip_levels_;
   image_info.arrayLayers = 1;
   image_info.samples = sample_count_;
   image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -34,144 +41,306 @@ Image::Image(const std::shared_ptr<VkDriver> &driver, VkImageCreateFlags flags,
     alloc_create_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
   }
 
-  auto result =
-      vmaCreateImage(driver_->getAllocator(), &image_info, &alloc_create_info,
-                     &image_, &allocation_, nullptr);
+  const auto category = categorizeImage(image_usage_);
+  auto result = driver_->getMemoryPools()->createImage(
+      category, image_info, alloc_create_info, &image_, &allocation_, nullptr);
   if (result != VK_SUCCESS) {
     throw VulkanException(result, "failed to create image!");
   }
+  driver_->getMemoryStats()->onAllocate(allocation_, category);
+  states_.resize(mip_levels_);
 }
 
 Image::~Image() {
-  vmaDestroyImage(driver_->getAllocator(), image_, allocation_);
+  if (relocatable_)
+    driver_->getDefragmenter()->untrack(allocation_);
+  driver_->getMemoryStats()->onFree(allocation_);
+  driver_->getDeletionQueue()->destroyImage(image_, allocation_);
 }
 
-void Image::updateByStaging(void *data, const std::shared_ptr<StagePool> &stage_pool,
-                            const std::shared_ptr<CommandBuffer> &cmd_buf)
-{  
-  uint32_t pixel_size = 0;
-  if(format_ == VK_FORMAT_R8G8B8_SRGB)
-  {
+VkDeviceSize Image::getMemorySize() const {
+  VmaAllocationInfo allocation_info{};
+  vmaGetAllocationInfo(driver_->getAllocator(), allocation_, &allocation_info);
+  return allocation_info.size;
+}
+
+void Image::setRelocatable() {
+  if (relocatable_)
+    return;
+  relocatable_ = true;
+  driver_->getDefragmenter()->track(allocation_, this);
+}
+
+bool Image::relocate(VkCommandBuffer cmd_buf, VmaAllocation allocation) {
+  constexpr VkImageUsageFlags copy_usage =
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  // not uploaded(or acquired) yet
+  if (getLayout() != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ||
+      (image_usage_ & copy_usage) != copy_usage)
+    return false;
+
+  VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+  image_info.flags = flags_;
+  image_info.imageType = VK_IMAGE_TYPE_2D;
+  image_info.format = format_;
+  image_info.extent = extent_;
+  image_info.mipLevels = mip_levels_;
+  image_info.arrayLayers = 1;
+  image_info.samples = sample_count_;
+  image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+  image_info.usage = image_usage_;
+  image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  VkImage image = VK_NULL_HANDLE;
+  if (vkCreateImage(driver_->getDevice(), &image_info, nullptr, &image) != VK_SUCCESS)
+    return false;
+  if (vmaBindImageMemory(driver_->getAllocator(), allocation, image) != VK_SUCCESS) {
+    vkDestroyImage(driver_->getDevice(), image, nullptr);
+    return false;
+  }
+
+  // the old image waits for the stages that sampled it, the new one for nothing
+  const auto range = getSubresourceRange();
+  VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+  barrier.srcAccessMask = VK_ACCESS_2_NONE;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+  barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = range;
+  BarrierBatcher barriers;
+  barriers.transition(*this, range, imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+  barriers.imageBarrier(barrier);
+  barriers.flush(cmd_buf);
+
+  std::vector<VkImageCopy> regions(mip_levels_);
+  for (uint32_t i = 0; i < mip_levels_; ++i) {
+    regions[i] = VkImageCopy{.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1},
+                             .srcOffset = {0, 0, 0},
+                             .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1},
+                             .dstOffset = {0, 0, 0},
+                             .extent = levelExtent(i)};
+  }
+  vkCmdCopyImage(cmd_buf, image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
+
+  const auto sampled = imageAccessFor(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+  barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+  barrier.dstStageMask = sampled.stages;
+  barrier.dstAccessMask = sampled.access;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barriers.imageBarrier(barrier);
+  barriers.flush(cmd_buf);
+
+  // the memory stays with allocation_, only the old handle is destroyed
+  driver_->getDeletionQueue()->destroyImage(image_, VK_NULL_HANDLE);
+  image_ = image;
+  setAccess(range, sampled);
+  return true;
+}
+
+uint32_t Image::mipLevelCount(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  for (uint32_t s = std::max(width, height); s > 1; s >>= 1)
+    ++levels;
+  return levels;
+}
+
+// bytes of a texel, or of a 4x4 block of compressed formats(block_size)
+static void formatTexelSize(const VkFormat format, uint32_t &pixel_size,
+                            uint32_t &block_size) {
+  pixel_size = 0;
+  block_size = 0;
+  switch (format) {
+  case VK_FORMAT_R8_UNORM:
+    pixel_size = 1;
+    break;
+  case VK_FORMAT_R8G8B8_SRGB:
     pixel_size = 3;
-  } else if(format_ == VK_FORMAT_R8G8B8A8_SRGB)
-  {
+    break;
+  case VK_FORMAT_R8G8B8A8_SRGB:
+  case VK_FORMAT_R8G8B8A8_UNORM:
     pixel_size = 4;
-  } 
-  else if(format_ == VK_FORMAT_R8_UNORM)
-  {
-    pixel_size = 1;
-  } else if(format_ == VK_FORMAT_R32G32B32A32_SFLOAT)
-  {
+    break;
+  case VK_FORMAT_R32G32B32A32_SFLOAT:
     pixel_size = 16;
-  }
-
-  if(pixel_size == 0)
-  {
+    break;
+  case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+  case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+  case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+  case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+  case VK_FORMAT_BC4_UNORM_BLOCK:
+    block_size = 8;
+    break;
+  case VK_FORMAT_BC3_UNORM_BLOCK:
+  case VK_FORMAT_BC3_SRGB_BLOCK:
+  case VK_FORMAT_BC5_UNORM_BLOCK:
+  case VK_FORMAT_BC7_UNORM_BLOCK:
+  case VK_FORMAT_BC7_SRGB_BLOCK:
+    block_size = 16;
+    break;
+  default:
     throw std::runtime_error("Unsupported image format for update by staging.");
   }
-  auto data_size = extent_.width * extent_.height * pixel_size;
-  auto stage = stage_pool->acquireStage(data_size);
-  
+}
+
+VkExtent3D Image::levelExtent(uint32_t mip_level) const {
+  return {std::max(extent_.width >> mip_level, 1u),
+          std::max(extent_.height >> mip_level, 1u), 1};
+}
+
+VkDeviceSize Image::levelDataSize(uint32_t mip_level) const {
+  uint32_t pixel_size, block_size;
+  formatTexelSize(format_, pixel_size, block_size);
+  const VkExtent3D level_extent = levelExtent(mip_level);
+  // the copy extent of a compressed level is its texel size, data is in whole blocks
+  return (block_size != 0)
+             ? static_cast<VkDeviceSize>((level_extent.width + 3) / 4) *
+                   ((level_extent.height + 3) / 4) * block_size
+             : static_cast<VkDeviceSize>(level_extent.width) *
+                   level_extent.height * pixel_size;
+}
+
+VkDeviceSize Image::copyAlignment() const {
+  uint32_t pixel_size, block_size;
+  formatTexelSize(format_, pixel_size, block_size);
+  // copy offsets are multiples of 4 and of the texel(block) size
+  return std::lcm<VkDeviceSize>(block_size != 0 ? block_size : pixel_size, 4);
+}
+
+void Image::updateByStaging(void *data, const std::shared_ptr<StagePool> &stage_pool,
+                            const std::shared_ptr<CommandBuffer> &cmd_buf,
+                            uint32_t mip_level)
+{
+  assert(mip_level < mip_levels_);
+  const VkExtent3D level_extent = levelExtent(mip_level);
+  const size_t data_size = levelDataSize(mip_level);
+  auto stage = stage_pool->allocateStaging(data_size, copyAlignment());
+
   // cpu data to staging
-  void* mapped;
-  vmaMapMemory(driver_->getAllocator(), stage->memory, &mapped);
-  memcpy(mapped, data, data_size);
-  vmaUnmapMemory(driver_->getAllocator(), stage->memory);
-  vmaFlushAllocation(driver_->getAllocator(), stage->memory, 0, data_size);
+  memcpy(stage.mapped, data, data_size);
+  stage_pool->flushStaging(stage, data_size);
 
   // staging buffer to image
   VkBufferImageCopy copyRegion = {
-      .bufferOffset = {},
+      .bufferOffset = stage.offset,
       .bufferRowLength = {},
       .bufferImageHeight = {},
       .imageSubresource = {
           .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-          .mipLevel = 0,
+          .mipLevel = mip_level,
           .baseArrayLayer = 0,
           .layerCount = 1
       },
       .imageOffset = { 0, 0, 0 },
-      .imageExtent = extent_
+      .imageExtent = level_extent
   };
 
   VkImageSubresourceRange transitionRange = {
       .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
       .baseMipLevel = 0,
-      .levelCount = 1,
+      .levelCount = mip_levels_,
       .baseArrayLayer = 0,
       .layerCount = 1
   };
 
+  // the levels are uploaded one by one, the copies of different levels don't need a barrier
   auto cmd_buf_handle = cmd_buf->getHandle();
-  transitionLayout(cmd_buf_handle, transitionRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  if (getLayout() != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+    transitionLayout(cmd_buf_handle, transitionRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-  vkCmdCopyBufferToImage(cmd_buf_handle, stage->buffer, image_,
+  vkCmdCopyBufferToImage(cmd_buf_handle, stage.buffer, image_,
           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
 
   //transitionLayout(cmd_buf_handle, transitionRange, getDefaultLayout());
 }
 
-void setTransSrcDst(const VkImageLayout old_layout, const VkImageLayout new_layout,
-  VkAccessFlags &src_access_mask, VkAccessFlags &dst_access_mask,
-  VkPipelineStageFlags &src_stage, VkPipelineStageFlags &dst_stage)
-{
-  switch (new_layout) {
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-        src_access_mask = 0;
-        dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        break;
-    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-        src_access_mask = 0;
-        dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
-        src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        break;
-    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-    case VK_IMAGE_LAYOUT_GENERAL:
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
-        src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
-        src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        break;
-
-        // We support PRESENT as a target layout to allow blitting from the swap chain.
-        // See also SwapChain::makePresentable().
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
-        src_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
-        dst_access_mask = 0;
-        src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dst_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        break;
-
-    default:
-        throw std::runtime_error("Unsupported layout transition.");  
+bool Image::supportsBlitMipmaps() const {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(driver_->getPhysicalDevice(), format_,
+                                      &props);
+  const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                        VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  return (props.optimalTilingFeatures & required) == required;
+}
+
+void Image::generateMipmaps(const std::shared_ptr<CommandBuffer> &cmd_buf) {
+  assert(getLayout() == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  auto cmd_buf_handle = cmd_buf->getHandle();
+  BarrierBatcher barriers;
+  int32_t width = extent_.width;
+  int32_t height = extent_.height;
+  for (uint32_t i = 1; i < mip_levels_; ++i) {
+    // level i-1 is written, make it the blit source. level i is still transfer dst
+    barriers.transition(*this, {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, 0, 1},
+                        imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+    barriers.flush(cmd_buf_handle);
+
+    int32_t next_width = std::max(width / 2, 1);
+    int32_t next_height = std::max(height / 2, 1);
+    VkImageBlit blit = {
+        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, 1},
+        .srcOffsets = {{0, 0, 0}, {width, height, 1}},
+        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1},
+        .dstOffsets = {{0, 0, 0}, {next_width, next_height, 1}}};
+    vkCmdBlitImage(cmd_buf_handle, image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                   VK_FILTER_LINEAR);
+    width = next_width;
+    height = next_height;
   }
+
+  // levels [0, n-1) are blit sources, the last one is only written: two barriers
+  barriers.transition(*this, imageAccessFor(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+  barriers.flush(cmd_buf_handle);
+}
+
+VkImageLayout Image::getLayout() const {
+  for (const auto &state : states_) {
+    if (state.layout != states_[0].layout)
+      return VK_IMAGE_LAYOUT_MAX_ENUM;
+  }
+  return states_[0].layout;
+}
+
+void Image::setAccess(const VkImageSubresourceRange &range, const ImageAccess &access) {
+  const uint32_t level_end = range.levelCount == VK_REMAINING_MIP_LEVELS
+                                 ? mip_levels_
+                                 : range.baseMipLevel + range.levelCount;
+  std::fill(states_.begin() + range.baseMipLevel, states_.begin() + level_end, access);
+}
+
+VkImageSubresourceRange Image::getSubresourceRange() const {
+  VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+  switch (format_) {
+  case VK_FORMAT_D16_UNORM:
+  case VK_FORMAT_X8_D24_UNORM_PACK32:
+  case VK_FORMAT_D32_SFLOAT:
+    aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    break;
+  case VK_FORMAT_D16_UNORM_S8_UINT:
+  case VK_FORMAT_D24_UNORM_S8_UINT:
+  case VK_FORMAT_D32_SFLOAT_S8_UINT:
+    aspect = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    break;
+  default:
+    break;
+  }
+  return {aspect, 0, mip_levels_, 0, 1};
 }
 
 void Image::transitionLayout(const VkCommandBuffer cmd_buf, const VkImageSubresourceRange &range, const VkImageLayout layout)
 {
-  if(layout_ == layout) return;
-  // src dst
-  VkAccessFlags src_access_mask, dst_access_mask;
-  VkPipelineStageFlags src_stage, dst_stage;
-  setTransSrcDst(layout_, layout, src_access_mask, dst_access_mask, src_stage, dst_stage);
-  VkImageMemoryBarrier barrier = {};
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.oldLayout = layout_;
-  barrier.newLayout = layout;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image = image_;
-  barrier.subresourceRange = range;
-  barrier.srcAccessMask = src_access_mask;
-  barrier.dstAccessMask = dst_access_mask;
-  vkCmdPipelineBarrier(cmd_buf, src_stage, dst_stage, 0, 0, nullptr, 0,
-          nullptr, 1, &barrier);
-  layout_ = layout;
+  BarrierBatcher barriers;
+  barriers.transition(*this, range, imageAccessFor(layout));
+  barriers.flush(cmd_buf);
 }
 
 // VkImageLayout Image::getDefaultLayout() const
@@ -198,7 +367,8 @@ ImageView::ImageView(const std::shared_ptr<Image> &image,
                      VkImageAspectFlags aspect_flags, uint32_t base_mip_level,
                      uint32_t base_array_layer, uint32_t n_mip_levels,
                      uint32_t n_array_layers)
-    : driver_(image->getDriver()), vk_image_(image->getHandle()), image_ptr_(image) {
+    : driver_(image->getDriver()), vk_image_(image->getHandle()),
+      n_mip_levels_(n_mip_levels), image_ptr_(image) {
   VkImageViewCreateInfo view_info = {};
   view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   view_info.image = image->getHandle();
@@ -215,11 +385,9 @@ ImageView::ImageView(const std::shared_ptr<Image> &image,
   view_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
   view_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
 
-#ifndef NDEBUG
   view_type_ = view_type;
   format_ = format;
   subresource_range_ = view_info.subresourceRange;
-#endif
 
   auto result = vkCreateImageView(image->getDriver()->getDevice(), &view_info,
                                   nullptr, &image_view_);
@@ -233,7 +401,7 @@ ImageView::ImageView(const std::shared_ptr<VkDriver> &driver, VkImage image,
                      VkImageAspectFlags aspect_flags, uint32_t base_mip_level,
                      uint32_t base_array_layer, uint32_t n_mip_levels,
                      uint32_t n_array_layers)
-    : driver_(driver), vk_image_(image) {
+    : driver_(driver), vk_image_(image), n_mip_levels_(n_mip_levels) {
   VkImageViewCreateInfo view_info = {};
   view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   view_info.image = image;
@@ -250,11 +418,9 @@ ImageView::ImageView(const std::shared_ptr<VkDriver> &driver, VkImage image,
   view_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
   view_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
 
-#ifndef NDEBUG
   view_type_ = view_type;
   format_ = format;
   subresource_range_ = view_info.subresourceRange;
-#endif
 
   auto result =
       vkCreateImageView(driver->getDevice(), &view_info, nullptr, &image_view_);
@@ -263,8 +429,28 @@ ImageView::ImageView(const std::shared_ptr<VkDriver> &driver, VkImage image,
   }
 }
 
+bool ImageView::refresh() {
+  if (image_ptr_ == nullptr || image_ptr_->getHandle() == vk_image_)
+    return false;
+  VkImageViewCreateInfo view_info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+  view_info.image = image_ptr_->getHandle();
+  view_info.viewType = view_type_;
+  view_info.format = format_;
+  view_info.subresourceRange = subresource_range_;
+  VkImageView image_view = VK_NULL_HANDLE;
+  auto result =
+      vkCreateImageView(driver_->getDevice(), &view_info, nullptr, &image_view);
+  if (result != VK_SUCCESS) {
+    throw VulkanException(result, "failed to create image view!");
+  }
+  driver_->getDeletionQueue()->destroyImageView(image_view_);
+  image_view_ = image_view;
+  vk_image_ = view_info.image;
+  return true;
+}
+
 ImageView::~ImageView() {
-  vkDestroyImageView(driver_->getDevice(), image_view_, nullptr);
+  driver_->getDeletionQueue()->destroyImageView(image_view_);
 }
 
 } // namespace vk_engine
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <framework/utils/vk/barriers.h>
 #include <framework/utils/vk/vk_driver.h>
 #include <memory>
+#include <vector>
 #include <vk_mem_alloc.h>
 
 namespace vk_engine {
@@ -12,7 +14,7 @@ public:
   Image(const std::shared_ptr<VkDriver> &driver, VkImageCreateFlags flags,
         VkFormat format, const VkExtent3D &extent,
         VkSampleCountFlagBits sample_count, VkImageUsageFlags image_usage,
-        VmaMemoryUsage memory_usage);
+        VmaMemoryUsage memory_usage, uint32_t mip_levels = 1);
 
   Image(const Image &) = delete;
   Image(Image &&) = delete;
@@ -24,15 +26,97 @@ public:
 
   /**
    * update image from cpu to gpu, data should be compatiable with image format, and tightly packed.
+   * block compressed(bc) levels are in whole 4x4 blocks. the whole image is transitioned to transfer dst.
   */
   void updateByStaging(void *data,
                        const std::shared_ptr<StagePool> &stage_pool,
-                       const std::shared_ptr<CommandBuffer> &cmd_buf);
+                       const std::shared_ptr<CommandBuffer> &cmd_buf,
+                       uint32_t mip_level = 0);
+
+  /**
+   * \brief extent of a mip level
+   */
+  VkExtent3D levelExtent(uint32_t mip_level) const;
+
+  /**
+   * \brief bytes of a tightly packed mip level as updateByStaging expects it,
+   * throws for the formats it doesn't support
+   */
+  VkDeviceSize levelDataSize(uint32_t mip_level) const;
+
+  /**
+   * \brief alignment of the staging buffer offset of a copy to the image
+   */
+  VkDeviceSize copyAlignment() const;
+
+  /**
+   * \brief whether the format supports linear filtered blit, required by generateMipmaps
+   */
+  bool supportsBlitMipmaps() const;
+
+  /**
+   * \brief generate mip levels from level 0 by blit, level 0 should be uploaded(image in transfer dst).
+   * all levels are transitioned to shader read only. must be recorded on graphics queue.
+   */
+  void generateMipmaps(const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+  /**
+   * \brief number of levels of a full mip chain
+   */
+  static uint32_t mipLevelCount(uint32_t width, uint32_t height);
 
   std::shared_ptr<VkDriver> getDriver() const { return driver_; }
 
+  /**
+   * \brief transition range to layout for its usual use(see imageAccessFor), from the tracked
+   * state of each level. use a BarrierBatcher to batch it with other barriers
+   */
   void transitionLayout(VkCommandBuffer cmd_buf, const VkImageSubresourceRange &range, const VkImageLayout layout);
 
+  /**
+   * \brief layout shared by all the levels, VK_IMAGE_LAYOUT_MAX_ENUM if they differ
+   */
+  VkImageLayout getLayout() const;
+
+  /**
+   * \brief tracked layout, stages and access of the last use of a level, images have one layer
+   */
+  const ImageAccess &getAccess(uint32_t mip_level) const { return states_[mip_level]; }
+
+  /**
+   * \brief set the tracked state, after the image is used or transitioned by external
+   * barriers(e.g. queue ownership transfer)
+   */
+  void setAccess(const VkImageSubresourceRange &range, const ImageAccess &access);
+
+  /**
+   * \brief all the levels and layers of the image
+   */
+  VkImageSubresourceRange getSubresourceRange() const;
+
+  VkFormat getFormat() const { return format_; }
+
+  const VkExtent3D &getExtent() const { return extent_; }
+
+  uint32_t getMipLevels() const { return mip_levels_; }
+
+  /**
+   * \brief bytes of device memory bound to the image
+   */
+  VkDeviceSize getMemorySize() const;
+
+  /**
+   * \brief let the defragmenter move the image, its views must be refreshed by their users
+   * (e.g. materials) before they're used again
+   */
+  void setRelocatable();
+
+  /**
+   * \brief recreate the image bound to allocation and record the copy of all the levels,
+   * only images in shader read only layout are moved. false if the image can't be moved
+   */
+  bool relocate(VkCommandBuffer cmd_buf, VmaAllocation allocation);
+
   // VkImageLayout getDefaultLayout() const;
 
 private:
@@ -43,10 +127,14 @@ private:
   VkSampleCountFlagBits sample_count_;
   VkImageUsageFlags image_usage_;
   VmaMemoryUsage memory_usage_;
+  uint32_t mip_levels_;
 
   VmaAllocation allocation_{VK_NULL_HANDLE};
   VkImage image_{VK_NULL_HANDLE};
-  VkImageLayout layout_{VK_IMAGE_LAYOUT_UNDEFINED};
+  std::vector<ImageAccess> states_; //!< per mip level
+  bool relocatable_{false};
+
+  friend class BarrierBatcher;
 };
 
 class ImageView final {
@@ -70,22 +158,34 @@ public:
 
   VkImage getVkImage() const { return vk_image_; }
 
-#ifndef NDEBUG
+  uint32_t getMipLevels() const { return n_mip_levels_; }
+
+  /**
+   * \brief the viewed image, nullptr if the view is created from a raw VkImage(e.g. swapchain)
+   */
+  const std::shared_ptr<Image> &getImage() const { return image_ptr_; }
+
+  /**
+   * \brief recreate the view if its image was relocated, the old view is destroyed after the
+   * frame. true if the handle changed and the descriptors holding it must be rewritten
+   */
+  bool refresh();
+
   VkImageSubresourceRange getSubresourceRange() const {
     return subresource_range_;
   }
-#endif
+
+  VkFormat getFormat() const { return format_; }
 
   ~ImageView();
 
 private:
-#ifndef NDEBUG
   VkImageViewType view_type_;
   VkFormat format_;
   VkImageSubresourceRange subresource_range_;
-#endif
   VkImage vk_image_{VK_NULL_HANDLE};
   VkImageView image_view_{VK_NULL_HANDLE};
+  uint32_t n_mip_levels_;
 
   std::shared_ptr<VkDriver> driver_;
   std::shared_ptr<Image> image_ptr_; //!< used to keep image alive
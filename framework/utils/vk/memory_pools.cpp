@@ -0,0 +1,182 @@
+#include <framework/utils/vk/memory_pools.h>
+
+#include <algorithm>
+#include <framework/utils/base/error.h>
+#include <framework/utils/base/logging.h>
+
+namespace vk_engine {
+
+std::vector<MemoryPoolDesc> defaultMemoryPoolDescs() {
+  constexpr VkDeviceSize MB = 1024 * 1024;
+  // stages and uniform buffers live for many frames and are freed in any order, a linear
+  // pool only reclaims its ends, so every class is in a block pool
+  return {
+      {.category = MemoryCategory::Staging, .linear = false, .host_visible = true,
+       .block_size = 64 * MB, .min_block_count = 0, .budget = 256 * MB},
+      {.category = MemoryCategory::Uniform, .linear = false, .host_visible = true,
+       .block_size = 4 * MB, .min_block_count = 1, .budget = 64 * MB},
+      {.category = MemoryCategory::Geometry, .linear = false, .host_visible = false,
+       .block_size = 128 * MB, .min_block_count = 1, .budget = 0},
+      {.category = MemoryCategory::Texture, .linear = false, .host_visible = false,
+       .block_size = 256 * MB, .min_block_count = 1, .budget = 0},
+  };
+}
+
+MemoryPools::MemoryPools(VmaAllocator allocator,
+                         const std::vector<MemoryPoolDesc> &descs)
+    : allocator_(allocator) {
+  for (const auto &desc : descs)
+    createPool(desc);
+}
+
+MemoryPools::~MemoryPools() {
+  for (auto &pool : pools_) {
+    if (pool.pool != VK_NULL_HANDLE)
+      vmaDestroyPool(allocator_, pool.pool);
+  }
+}
+
+void MemoryPools::createPool(const MemoryPoolDesc &desc) {
+  // memory type of a typical resource of the class
+  VmaAllocationCreateInfo alloc_info{};
+  alloc_info.usage = desc.host_visible ? VMA_MEMORY_USAGE_AUTO_PREFER_HOST
+                                       : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+  if (desc.host_visible)
+    alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                       VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+  uint32_t memory_type_index = 0;
+  VkResult result = VK_SUCCESS;
+  if (desc.category == MemoryCategory::Texture) {
+    VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_info.extent = {1024, 1024, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                       VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    result = vmaFindMemoryTypeIndexForImageInfo(allocator_, &image_info,
+                                                &alloc_info, &memory_type_index);
+  } else {
+    VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    buffer_info.size = 65536;
+    switch (desc.category) {
+    case MemoryCategory::Staging:
+      buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+      break;
+    case MemoryCategory::Uniform:
+      buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+      break;
+    default:
+      buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+      break;
+    }
+    result = vmaFindMemoryTypeIndexForBufferInfo(allocator_, &buffer_info,
+                                                 &alloc_info, &memory_type_index);
+  }
+  if (result != VK_SUCCESS) {
+    LOGW("no memory type for {} pool, using default pools", memoryCategoryName(desc.category));
+    return;
+  }
+
+  // at most 1/8 of the heap per block, as vma does for its default pools
+  const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+  vmaGetMemoryProperties(allocator_, &memory_properties);
+  const auto heap_index = memory_properties->memoryTypes[memory_type_index].heapIndex;
+  const VkDeviceSize block_size =
+      std::min(desc.block_size, memory_properties->memoryHeaps[heap_index].size / 8);
+
+  VmaPoolCreateInfo pool_info{};
+  pool_info.memoryTypeIndex = memory_type_index;
+  pool_info.flags = desc.linear ? VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT : 0;
+  pool_info.blockSize = block_size;
+  pool_info.minBlockCount = desc.min_block_count;
+  pool_info.maxBlockCount =
+      desc.budget == 0 ? 0 : std::max<size_t>(desc.budget / block_size, 1);
+
+  auto &pool = pools_[static_cast<uint32_t>(desc.category)];
+  VK_THROW_IF_ERROR(vmaCreatePool(allocator_, &pool_info, &pool.pool),
+                    "failed to create vma pool!");
+  vmaSetPoolName(allocator_, pool.pool, memoryCategoryName(desc.category));
+  pool.host_visible = desc.host_visible;
+  LOGD("{} pool: memory type {} block {}MB max blocks {}",
+       memoryCategoryName(desc.category), memory_type_index, block_size >> 20,
+       pool_info.maxBlockCount);
+}
+
+VmaPool MemoryPools::selectPool(MemoryCategory category,
+                                const VmaAllocationCreateInfo &create_info) const {
+  const auto &pool = pools_[static_cast<uint32_t>(category)];
+  if (pool.pool == VK_NULL_HANDLE || create_info.pool != VK_NULL_HANDLE ||
+      (create_info.flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT))
+    return VK_NULL_HANDLE;
+
+  const auto host_flags = create_info.flags &
+                          (VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                           VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+  const bool host_write =
+      host_flags == VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT ||
+      create_info.usage == VMA_MEMORY_USAGE_CPU_TO_GPU;
+  const bool device_only =
+      host_flags == 0 && (create_info.usage == VMA_MEMORY_USAGE_AUTO ||
+                          create_info.usage == VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE ||
+                          create_info.usage == VMA_MEMORY_USAGE_GPU_ONLY);
+  return (pool.host_visible ? host_write : device_only) ? pool.pool : VK_NULL_HANDLE;
+}
+
+VkResult MemoryPools::createBuffer(MemoryCategory category,
+                                   const VkBufferCreateInfo &buffer_info,
+                                   const VmaAllocationCreateInfo &create_info,
+                                   VkBuffer *buffer, VmaAllocation *allocation,
+                                   VmaAllocationInfo *allocation_info) {
+  auto pool_info = create_info;
+  pool_info.pool = selectPool(category, create_info);
+  if (pool_info.pool != VK_NULL_HANDLE) {
+    if (vmaCreateBuffer(allocator_, &buffer_info, &pool_info, buffer, allocation,
+                        allocation_info) == VK_SUCCESS)
+      return VK_SUCCESS;
+    auto &pool = pools_[static_cast<uint32_t>(category)];
+    if (!pool.fallback_logged.exchange(true))
+      LOGW("{} pool is over its budget or the buffer needs another memory type, "
+           "allocating from the default pools",
+           memoryCategoryName(category));
+  }
+  return vmaCreateBuffer(allocator_, &buffer_info, &create_info, buffer, allocation,
+                         allocation_info);
+}
+
+VkResult MemoryPools::createImage(MemoryCategory category,
+                                  const VkImageCreateInfo &image_info,
+                                  const VmaAllocationCreateInfo &create_info,
+                                  VkImage *image, VmaAllocation *allocation,
+                                  VmaAllocationInfo *allocation_info) {
+  auto pool_info = create_info;
+  pool_info.pool = category == MemoryCategory::Texture
+                       ? selectPool(category, create_info)
+                       : VK_NULL_HANDLE;
+  if (pool_info.pool != VK_NULL_HANDLE) {
+    if (vmaCreateImage(allocator_, &image_info, &pool_info, image, allocation,
+                       allocation_info) == VK_SUCCESS)
+      return VK_SUCCESS;
+    auto &pool = pools_[static_cast<uint32_t>(category)];
+    if (!pool.fallback_logged.exchange(true))
+      LOGW("{} pool is over its budget or the image needs another memory type, "
+           "allocating from the default pools",
+           memoryCategoryName(category));
+  }
+  return vmaCreateImage(allocator_, &image_info, &create_info, image, allocation,
+                        allocation_info);
+}
+
+VmaDetailedStatistics MemoryPools::getPoolStatistics(MemoryCategory category) const {
+  VmaDetailedStatistics stats{};
+  auto pool = getPool(category);
+  if (pool != VK_NULL_HANDLE)
+    vmaCalculatePoolStatistics(allocator_, pool, &stats);
+  return stats;
+}
+} // namespace vk_engine
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <volk.h>
+
+#include <framework/utils/vk/memory_stats.h>
+
+namespace vk_engine {
+
+struct MemoryPoolDesc {
+  MemoryCategory category;
+  bool linear;            //!< VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT, only for ring allocations freed in order
+  bool host_visible;      //!< mapped sequential write memory, otherwise device local
+  VkDeviceSize block_size;
+  size_t min_block_count; //!< blocks allocated up front
+  VkDeviceSize budget;    //!< max bytes of the pool, 0 for unlimited
+};
+
+/**
+ * \brief staging, uniforms, geometry and textures in block pools, the device local ones with
+ * large preallocated blocks, attachments stay in the default pools(mostly dedicated allocations)
+ */
+std::vector<MemoryPoolDesc> defaultMemoryPoolDescs();
+
+/**
+ * \brief MemoryPools keeps a VmaPool per resource class so short lived and long lived
+ * allocations don't fragment each other's blocks.
+ *
+ * createBuffer/createImage place the allocation in the pool of its category when the
+ * requested host access matches the pool's memory, and fall back to the default pools when
+ * the pool is over its budget or the memory type doesn't fit.
+ */
+class MemoryPools final {
+public:
+  MemoryPools(VmaAllocator allocator, const std::vector<MemoryPoolDesc> &descs);
+
+  ~MemoryPools();
+
+  MemoryPools(const MemoryPools &) = delete;
+  MemoryPools &operator=(const MemoryPools &) = delete;
+
+  /**
+   * \brief pool for the allocation, VK_NULL_HANDLE for the default pools
+   */
+  VmaPool selectPool(MemoryCategory category,
+                     const VmaAllocationCreateInfo &create_info) const;
+
+  VkResult createBuffer(MemoryCategory category, const VkBufferCreateInfo &buffer_info,
+                        const VmaAllocationCreateInfo &create_info, VkBuffer *buffer,
+                        VmaAllocation *allocation, VmaAllocationInfo *allocation_info);
+
+  /**
+   * \brief only textures have a pool, other images use the default pools
+   */
+  VkResult createImage(MemoryCategory category, const VkImageCreateInfo &image_info,
+                       const VmaAllocationCreateInfo &create_info, VkImage *image,
+                       VmaAllocation *allocation, VmaAllocationInfo *allocation_info);
+
+  VmaPool getPool(MemoryCategory category) const {
+    return pools_[static_cast<uint32_t>(category)].pool;
+  }
+
+  VmaDetailedStatistics getPoolStatistics(MemoryCategory category) const;
+
+private:
+  struct Pool {
+    VmaPool pool{VK_NULL_HANDLE};
+    bool host_visible{false};
+    std::atomic<bool> fallback_logged{false};
+  };
+
+  void createPool(const MemoryPoolDesc &desc);
+
+  VmaAllocator allocator_;
+  std::array<Pool, static_cast<uint32_t>(MemoryCategory::Count)> pools_;
+};
+} // namespace vk_engine
@@ -0,0 +1,162 @@
+#include <framework/utils/vk/memory_stats.h>
+
+#include <fstream>
+#include <sstream>
+#include <framework/utils/base/logging.h>
+
+namespace vk_engine {
+
+const char *memoryCategoryName(MemoryCategory category) {
+  static const char *names[] = {"staging", "geometry", "texture",
+                                "uniform", "attachment", "other"};
+  static_assert(sizeof(names) / sizeof(names[0]) ==
+                static_cast<uint32_t>(MemoryCategory::Count));
+  return names[static_cast<uint32_t>(category)];
+}
+
+MemoryCategory categorizeBuffer(VkBufferUsageFlags usage) {
+  if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+    return MemoryCategory::Uniform;
+  if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT))
+    return MemoryCategory::Geometry;
+  if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+    return MemoryCategory::Staging;
+  return MemoryCategory::Other;
+}
+
+MemoryCategory categorizeImage(VkImageUsageFlags usage) {
+  if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+               VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+               VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT))
+    return MemoryCategory::Attachment;
+  if (usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+    return MemoryCategory::Texture;
+  return MemoryCategory::Other;
+}
+
+MemoryStats::MemoryStats(VmaAllocator allocator) : allocator_(allocator) {
+  const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+  vmaGetMemoryProperties(allocator_, &memory_properties);
+  heap_count_ = memory_properties->memoryHeapCount;
+  over_budget_.resize(heap_count_, false);
+  for (uint32_t i = 0; i < category_bytes_.size(); ++i) {
+    category_bytes_[i] = 0;
+    category_counts_[i] = 0;
+  }
+}
+
+void MemoryStats::onAllocate(VmaAllocation allocation, MemoryCategory category) {
+  const auto index = static_cast<uint32_t>(category);
+  // index + 1, untagged allocations have null user data
+  vmaSetAllocationUserData(allocator_, allocation,
+                           reinterpret_cast<void *>(static_cast<uintptr_t>(index + 1)));
+  vmaSetAllocationName(allocator_, allocation, memoryCategoryName(category));
+  VmaAllocationInfo info{};
+  vmaGetAllocationInfo(allocator_, allocation, &info);
+  category_bytes_[index] += info.size;
+  ++category_counts_[index];
+}
+
+void MemoryStats::onFree(VmaAllocation allocation) {
+  VmaAllocationInfo info{};
+  vmaGetAllocationInfo(allocator_, allocation, &info);
+  const auto tag = reinterpret_cast<uintptr_t>(info.pUserData);
+  if (tag == 0)
+    return;
+  category_bytes_[tag - 1] -= info.size;
+  --category_counts_[tag - 1];
+}
+
+void MemoryStats::setBudgetWarning(float fraction, BudgetCallback callback) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  warning_fraction_ = fraction;
+  budget_callback_ = std::move(callback);
+  std::fill(over_budget_.begin(), over_budget_.end(), false);
+}
+
+MemorySnapshot MemoryStats::snapshot() {
+  MemorySnapshot snap;
+  snap.heap_budgets.resize(VK_MAX_MEMORY_HEAPS);
+  vmaGetHeapBudgets(allocator_, snap.heap_budgets.data());
+  snap.heap_budgets.resize(heap_count_);
+  for (uint32_t i = 0; i < category_bytes_.size(); ++i) {
+    snap.category_bytes[i] = category_bytes_[i];
+    snap.category_counts[i] = category_counts_[i];
+  }
+
+  std::lock_guard<std::mutex> lk(mtx_);
+  snap.frame = frame_++;
+  for (uint32_t i = 0; i < heap_count_; ++i) {
+    const auto &budget = snap.heap_budgets[i];
+    const bool over = budget.budget > 0 &&
+                      budget.usage > static_cast<VkDeviceSize>(
+                                         warning_fraction_ * budget.budget);
+    if (over && !over_budget_[i]) {
+      if (budget_callback_)
+        budget_callback_(i, budget);
+      else
+        LOGW("memory heap {} usage {}MB passes {:.0f}% of budget {}MB", i,
+             budget.usage >> 20, warning_fraction_ * 100.0f, budget.budget >> 20);
+    }
+    over_budget_[i] = over;
+  }
+
+  history_.emplace_back(snap);
+  if (history_.size() > HISTORY_SIZE)
+    history_.pop_front();
+  return snap;
+}
+
+MemorySnapshot MemoryStats::getLatest() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return history_.empty() ? MemorySnapshot{} : history_.back();
+}
+
+std::vector<MemorySnapshot> MemoryStats::getHistory() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return {history_.begin(), history_.end()};
+}
+
+VmaTotalStatistics MemoryStats::calculateStatistics() const {
+  VmaTotalStatistics stats{};
+  vmaCalculateStatistics(allocator_, &stats);
+  return stats;
+}
+
+float MemoryStats::fragmentation(const VmaDetailedStatistics &stats) {
+  const VkDeviceSize unused_bytes =
+      stats.statistics.blockBytes - stats.statistics.allocationBytes;
+  if (unused_bytes == 0 || stats.unusedRangeCount == 0)
+    return 0.0f;
+  return 1.0f - static_cast<float>(stats.unusedRangeSizeMax) /
+                    static_cast<float>(unused_bytes);
+}
+
+std::string MemoryStats::buildJson(bool detailed) const {
+  std::stringstream ss;
+  ss << "{\"categories\": {";
+  for (uint32_t i = 0; i < category_bytes_.size(); ++i) {
+    ss << (i == 0 ? "" : ", ") << "\""
+       << memoryCategoryName(static_cast<MemoryCategory>(i))
+       << "\": {\"bytes\": " << category_bytes_[i].load()
+       << ", \"count\": " << category_counts_[i].load() << "}";
+  }
+  ss << "}, \"vma\": ";
+  char *vma_stats = nullptr;
+  vmaBuildStatsString(allocator_, &vma_stats, detailed ? VK_TRUE : VK_FALSE);
+  ss << vma_stats << "}";
+  vmaFreeStatsString(allocator_, vma_stats);
+  return ss.str();
+}
+
+bool MemoryStats::dumpJson(const std::string &path, bool detailed) const {
+  std::ofstream ofs(path);
+  if (!ofs) {
+    LOGE("failed to open {} for memory stats", path);
+    return false;
+  }
+  ofs << buildJson(detailed);
+  return true;
+}
+} // namespace vk_engine
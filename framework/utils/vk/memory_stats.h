@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <volk.h>
+
+namespace vk_engine {
+
+enum class MemoryCategory : uint32_t {
+  Staging = 0,
+  Geometry,
+  Texture,
+  Uniform,
+  Attachment,
+  Other,
+  Count
+};
+
+const char *memoryCategoryName(MemoryCategory category);
+
+/**
+ * \brief category from the usage, uniform > geometry(vertex/index/storage/indirect) > staging
+ */
+MemoryCategory categorizeBuffer(VkBufferUsageFlags usage);
+
+/**
+ * \brief attachment if rendered to, texture otherwise
+ */
+MemoryCategory categorizeImage(VkImageUsageFlags usage);
+
+struct MemorySnapshot {
+  uint64_t frame{0};
+  std::array<VkDeviceSize, static_cast<uint32_t>(MemoryCategory::Count)> category_bytes{};
+  std::array<uint32_t, static_cast<uint32_t>(MemoryCategory::Count)> category_counts{};
+  std::vector<VmaBudget> heap_budgets; //!< one per memory heap
+};
+
+/**
+ * \brief MemoryStats reports where the device memory goes.
+ *
+ * Allocations are tagged with a category(stored as vma user data and name), the bytes per
+ * category are counted on allocate/free. snapshot() is cheap(vmaGetHeapBudgets) and called
+ * once per frame, it keeps a short history and calls the budget callback when a heap's usage
+ * crosses the warning fraction of its budget. The full statistics and the json dump walk all
+ * the vma blocks and are meant for debugging.
+ */
+class MemoryStats final {
+public:
+  using BudgetCallback =
+      std::function<void(uint32_t heap_index, const VmaBudget &budget)>;
+
+  static constexpr uint32_t HISTORY_SIZE = 240;
+
+  explicit MemoryStats(VmaAllocator allocator);
+
+  MemoryStats(const MemoryStats &) = delete;
+  MemoryStats &operator=(const MemoryStats &) = delete;
+
+  void onAllocate(VmaAllocation allocation, MemoryCategory category);
+
+  /**
+   * \brief call before destroying an allocation tagged by onAllocate
+   */
+  void onFree(VmaAllocation allocation);
+
+  /**
+   * \brief the callback defaults to a warning log, fraction defaults to 0.9
+   */
+  void setBudgetWarning(float fraction, BudgetCallback callback = nullptr);
+
+  /**
+   * \brief record the heap budgets and category usage of this frame
+   */
+  MemorySnapshot snapshot();
+
+  MemorySnapshot getLatest() const;
+
+  std::vector<MemorySnapshot> getHistory() const;
+
+  VmaTotalStatistics calculateStatistics() const;
+
+  /**
+   * \brief 0 for a single free range, close to 1 for many small free ranges
+   */
+  static float fragmentation(const VmaDetailedStatistics &stats);
+
+  /**
+   * \brief {"categories": {...}, "vma": vmaBuildStatsString}
+   */
+  std::string buildJson(bool detailed = true) const;
+
+  bool dumpJson(const std::string &path, bool detailed = true) const;
+
+private:
+  VmaAllocator allocator_;
+  uint32_t heap_count_{0};
+
+  std::array<std::atomic<VkDeviceSize>, static_cast<uint32_t>(MemoryCategory::Count)>
+      category_bytes_{};
+  std::array<std::atomic<uint32_t>, static_cast<uint32_t>(MemoryCategory::Count)>
+      category_counts_{};
+
+  mutable std::mutex mtx_; //!< guard the history and the budget warning
+  uint64_t frame_{0};
+  std::deque<MemorySnapshot> history_;
+  float warning_fraction_{0.9f};
+  BudgetCallback budget_callback_;
+  std::vector<bool> over_budget_; //!< warn once per crossing
+};
+} // namespace vk_engine
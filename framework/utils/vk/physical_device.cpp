@@ -37,6 +37,7 @@ PhysicalDevice::getPhysicalDevices(VkInstance instance) {
         queue_family_count);
     vkGetPhysicalDeviceQueueFamilyProperties(handle, &queue_family_count,
                                              queue_family_properties.data());
+    bool transfer_only = false;
     for (uint32_t j = 0; j < queue_family_count; ++j) {
       const auto &p = queue_family_properties[j];
       if ((p.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
@@ -44,7 +45,15 @@ PhysicalDevice::getPhysicalDevices(VkInstance instance) {
           (p.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
         physical_devices[i].graphics_queue_family_index_ = j;
       }
+
+      // dedicated transfer queue: the dma engine on discrete gpu
+      if ((p.queueFlags & VK_QUEUE_GRAPHICS_BIT) || !(p.queueFlags & VK_QUEUE_TRANSFER_BIT) ||
+          transfer_only)
+        continue;
+      transfer_only = !(p.queueFlags & VK_QUEUE_COMPUTE_BIT);
+      physical_devices[i].transfer_queue_family_index_ = j;
     }
+    physical_devices[i].queue_families_ = std::move(queue_family_properties);
   }
   return physical_devices;
 }
@@ -19,6 +19,18 @@ public:
     return graphics_queue_family_index_;
   }
 
+  /**
+   * \brief queue family supports transfer but not graphics, 0xFFFFFFFF if none.
+   * transfer-only family is preferred over async compute family.
+   */
+  uint32_t getTransferQueueFamilyIndex() const {
+    return transfer_queue_family_index_;
+  }
+
+  const std::vector<VkQueueFamilyProperties> &getQueueFamilies() const {
+    return queue_families_;
+  }
+
   VkPhysicalDevice getHandle() const { return physical_device_; }
 
   VkPhysicalDeviceProperties getProperties() const { return properties_; }
@@ -44,6 +56,7 @@ private:
   VkPhysicalDeviceFeatures features_;             //!< supported features
   std::vector<VkExtensionProperties> extensions_; //!< supported extensions
   uint32_t graphics_queue_family_index_{0xFFFFFFFF};
+  uint32_t transfer_queue_family_index_{0xFFFFFFFF};
   std::vector<VkQueueFamilyProperties> queue_families_;
 };
 } // namespace vk_engine
\ No newline at end of file
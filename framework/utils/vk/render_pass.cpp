@@ -100,8 +100,12 @@ RenderPass::RenderPass(const std::shared_ptr<VkDriver> &driver,
     attachment_descriptions[i].stencilLoadOp = load_store_infos[i].load_op;
     attachment_descriptions[i].stencilStoreOp = load_store_infos[i].store_op;
     attachment_descriptions[i].initialLayout = attachments[i].initial_layout;
+    // a defined initial layout is kept through the pass, the transitions are left to the
+    // caller's barriers(e.g. the render graph)
     attachment_descriptions[i].finalLayout =
-        is_depth_stencil_format(attachments[i].format)
+        attachments[i].initial_layout != VK_IMAGE_LAYOUT_UNDEFINED
+            ? attachments[i].initial_layout
+        : is_depth_stencil_format(attachments[i].format)
             ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
             : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
   }
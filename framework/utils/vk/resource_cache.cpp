@@ -111,13 +111,15 @@ std::shared_ptr<Sampler> ResourceCache::requestSampler(const std::shared_ptr<VkD
                                         VkFilter min_filter,
                                         VkSamplerMipmapMode mipmap_mode,
                                         VkSamplerAddressMode address_mode_u,
-                                        VkSamplerAddressMode address_mode_v) {
+                                        VkSamplerAddressMode address_mode_v,
+                                        float max_lod) {
   size_t hash_code = 0;
   glm::detail::hash_combine(hash_code, static_cast<size_t>(mag_filter));
   glm::detail::hash_combine(hash_code, static_cast<size_t>(min_filter));
   glm::detail::hash_combine(hash_code, static_cast<size_t>(mipmap_mode));
   glm::detail::hash_combine(hash_code, static_cast<size_t>(address_mode_u));
   glm::detail::hash_combine(hash_code, static_cast<size_t>(address_mode_v));
+  glm::detail::hash_combine(hash_code, std::hash<float>{}(max_lod));
 
   std::unique_lock<std::mutex> lock(state_.samples_mtx);
   auto itr = state_.samplers.find(hash_code);
@@ -126,7 +128,7 @@ std::shared_ptr<Sampler> ResourceCache::requestSampler(const std::shared_ptr<VkD
     return itr->second;
   }
   auto s = std::make_shared<Sampler>(driver, mag_filter, min_filter, mipmap_mode,
-                                     address_mode_u, address_mode_v);
+                                     address_mode_u, address_mode_v, max_lod);
   state_.samplers[hash_code] = s;
   return s;
 }
@@ -95,7 +95,8 @@ public:
   std::shared_ptr<Sampler>
   requestSampler(const std::shared_ptr<VkDriver> &driver,
     VkFilter mag_filter, VkFilter min_filter, VkSamplerMipmapMode mipmap_mode,
-    VkSamplerAddressMode address_mode_u, VkSamplerAddressMode address_mode_v);
+    VkSamplerAddressMode address_mode_u, VkSamplerAddressMode address_mode_v,
+    float max_lod = 0.0f);
 
   VkPipelineCache getPipelineCache() const {
     return (state_.pipeline_cache == nullptr) ? VK_NULL_HANDLE : state_.pipeline_cache->getHandle();
@@ -4,7 +4,8 @@
 namespace vk_engine
 {
     Sampler::Sampler(const std::shared_ptr<VkDriver> &driver, VkFilter mag_filter, VkFilter min_filter,
-    VkSamplerMipmapMode mipmap_mode, VkSamplerAddressMode address_mode_u, VkSamplerAddressMode address_mode_v)
+    VkSamplerMipmapMode mipmap_mode, VkSamplerAddressMode address_mode_u, VkSamplerAddressMode address_mode_v,
+    float max_lod)
         : driver_(driver)
     {
       VkSamplerCreateInfo info{
@@ -23,7 +24,7 @@ namespace vk_engine
         .compareEnable = VK_FALSE,
         .compareOp = VK_COMPARE_OP_ALWAYS,
         .minLod = 0.0f,
-        .maxLod = 0.0f,
+        .maxLod = max_lod,
         .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
         .unnormalizedCoordinates = VK_FALSE,
       };
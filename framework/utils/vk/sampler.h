@@ -19,9 +19,11 @@ public:
    * \param address_mode_v. used to transform coordinate that is outside the image.
    *    for example: VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
    *    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER
+   * \param max_lod. max mip level could be sampled, usually mip levels - 1.
   */
   Sampler(const std::shared_ptr<VkDriver> &driver, VkFilter mag_filter, VkFilter min_filter,
-    VkSamplerMipmapMode mipmap_mode, VkSamplerAddressMode address_mode_u, VkSamplerAddressMode address_mode_v);
+    VkSamplerMipmapMode mipmap_mode, VkSamplerAddressMode address_mode_u, VkSamplerAddressMode address_mode_v,
+    float max_lod = 0.0f);
 
   VkSampler getHandle() const noexcept { return handle_; }
 
@@ -1,7 +1,9 @@
 #include <framework/utils/base/compiler.h>
 #include <framework/utils/base/error.h>
 #include <framework/utils/vk/stage_pool.h>
-#include <framework/utils/vk/vk_constants.h>
+#include <framework/utils/vk/barriers.h>
+#include <framework/utils/vk/memory_pools.h>
+#include <framework/utils/vk/memory_stats.h>
 #include <framework/utils/vk/vk_common.h>
 #include <framework/utils/vk/vk_constants.h>
 
@@ -10,14 +12,17 @@
 namespace vk_engine
 {
     // Finds or creates a stage whose capacity is at least the given number of bytes.
-    // The stage is automatically released back to the pool after TIME_BEFORE_EVICTION frames.
+    // The stage is released back to the pool once the device timeline passes its last use.
     VulkanStage const* StagePool::acquireStage(uint32_t numBytes)
     {
+        std::lock_guard<std::mutex> lk(mtx_);
         // First check if a stage exists whose capacity is greater than or equal to the requested size.
         auto iter = free_stages_.lower_bound(numBytes);
         if (iter != free_stages_.end()) {
             auto stage = iter->second;
             free_stages_.erase(iter);
+            stage->lastAccessed = current_frame_;
+            stage->lastUse = useValue();
             used_stages_.insert(stage);
             return stage;
         }
@@ -25,8 +30,10 @@ namespace vk_engine
         VulkanStage* stage = new VulkanStage({
             .memory = VK_NULL_HANDLE,
             .buffer = VK_NULL_HANDLE,
+            .mapped = nullptr,
             .capacity = numBytes,
             .lastAccessed = current_frame_,
+            .lastUse = useValue(),
         });
 
         // Create the VkBuffer.
@@ -36,21 +43,89 @@ namespace vk_engine
             .size = numBytes,
             .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         };
-        VmaAllocationCreateInfo allocInfo { .usage = VMA_MEMORY_USAGE_CPU_ONLY };
-        UTILS_UNUSED_IN_RELEASE VkResult result = vmaCreateBuffer(driver_->getAllocator(), &bufferInfo,
-                &allocInfo, &stage->buffer, &stage->memory, nullptr);
+        VmaAllocationCreateInfo allocInfo {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST
+        };
+        VmaAllocationInfo info{};
+        UTILS_UNUSED_IN_RELEASE VkResult result = driver_->getMemoryPools()->createBuffer(
+                MemoryCategory::Staging, bufferInfo, allocInfo, &stage->buffer, &stage->memory, &info);
 
         VK_THROW_IF_ERROR(result, "Create Staging buffer failed!");
+        driver_->getMemoryStats()->onAllocate(stage->memory, MemoryCategory::Staging);
+        stage->mapped = info.pMappedData;
 
         return stage;
     }
 
+    void StagePool::createRing()
+    {
+        VkBufferCreateInfo bufferInfo {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = ring_size_,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        };
+        VmaAllocationCreateInfo allocInfo {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST
+        };
+        VmaAllocationInfo info{};
+        VkResult result = driver_->getMemoryPools()->createBuffer(
+                MemoryCategory::Staging, bufferInfo, allocInfo, &ring_buffer_, &ring_memory_, &info);
+        VK_THROW_IF_ERROR(result, "Create staging ring failed!");
+        driver_->getMemoryStats()->onAllocate(ring_memory_, MemoryCategory::Staging);
+        ring_mapped_ = static_cast<std::byte *>(info.pMappedData);
+    }
+
+    StagingRegion StagePool::allocateStaging(VkDeviceSize numBytes, VkDeviceSize alignment)
+    {
+        if (numBytes <= ring_size_ / 4) {
+            std::lock_guard<std::mutex> lk(ring_mtx_);
+            if (ring_buffer_ == VK_NULL_HANDLE) {
+                createRing();
+            }
+            const VkDeviceSize offset = ring_head_ % ring_size_;
+            VkDeviceSize aligned = (offset + alignment - 1) / alignment * alignment;
+            VkDeviceSize start = ring_head_ - offset + aligned;
+            if (aligned + numBytes > ring_size_) {
+                // Not enough room before the end of the buffer, wrap around to the beginning.
+                aligned = 0;
+                start = ring_head_ - offset + ring_size_;
+            }
+            if (start + numBytes - ring_tail_ > ring_size_) {
+                retireRing();
+            }
+            if (start + numBytes - ring_tail_ <= ring_size_) {
+                ring_head_ = start + numBytes;
+                const uint64_t use = useValue();
+                if (ring_uses_.empty() || ring_uses_.back().first != use) {
+                    ring_uses_.emplace_back(use, ring_head_);
+                } else {
+                    ring_uses_.back().second = ring_head_;
+                }
+                return {ring_buffer_, aligned, ring_mapped_ + aligned, ring_memory_};
+            }
+            // The ring is full of data the device may still read.
+        }
+        auto stage = acquireStage(static_cast<uint32_t>(numBytes));
+        return {stage->buffer, 0, stage->mapped, stage->memory};
+    }
+
+    void StagePool::flushStaging(const StagingRegion &region, VkDeviceSize numBytes)
+    {
+        // No-op for coherent memory, otherwise VMA rounds the range to nonCoherentAtomSize.
+        vmaFlushAllocation(driver_->getAllocator(), region.memory, region.offset, numBytes);
+    }
+
 
     // Images have VK_IMAGE_LAYOUT_GENERAL and must not be transitioned to any other layout
     VulkanStageImage const* StagePool::acquireImage(VkFormat format, uint32_t width, uint32_t height, VkCommandBuffer cmd_buf)
     {
+        std::lock_guard<std::mutex> lk(mtx_);
         for (auto image : free_images_) {
             if (image->format == format && image->width == width && image->height == height) {
+                image->lastAccessed = current_frame_;
+                image->lastUse = useValue();
                 free_images_.erase(image);
                 used_images_.insert(image);
                 return image;
@@ -62,6 +137,7 @@ namespace vk_engine
             .width = width,
             .height = height,
             .lastAccessed = current_frame_,
+            .lastUse = useValue(),
         });
 
         used_images_.insert(image);
@@ -75,7 +151,9 @@ namespace vk_engine
             .arrayLayers = 1,
             .samples = VK_SAMPLE_COUNT_1_BIT,
             .tiling = VK_IMAGE_TILING_LINEAR,
-            .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+            .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            // keeps the host writes made before the transition below executes
+            .initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED
         };
 
         const VmaAllocationCreateInfo allocInfo {
@@ -87,6 +165,7 @@ namespace vk_engine
                 &image->image, &image->memory, nullptr);
 
         VK_THROW_IF_ERROR(result, "Create staging image failed!");
+        driver_->getMemoryStats()->onAllocate(image->memory, MemoryCategory::Staging);
 
         VkImageAspectFlags aspectFlags = isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT
                                                                     : VK_IMAGE_ASPECT_COLOR_BIT;
@@ -97,101 +176,147 @@ namespace vk_engine
         // VK_IMAGE_LAYOUT_PREINITIALIZED or VK_IMAGE_LAYOUT_GENERAL layout. Calling
         // vkGetImageSubresourceLayout for a linear image returns a subresource layout mapping that is
         // valid for either of those image layouts."
-        transitionImageLayout(cmd_buf, blitterTransitionHelper({
-                .image = image->image,
-                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        // It starts PREINITIALIZED so host writes made before the transition executes are kept,
+        // they are visible at the submit and the transfers using the image only wait for the
+        // transition.
+        BarrierBatcher barriers;
+        barriers.imageBarrier(VkImageMemoryBarrier2{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+                .srcAccessMask = VK_ACCESS_2_NONE,
+                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
                 .newLayout = VK_IMAGE_LAYOUT_GENERAL,
-                .subresources = { aspectFlags, 0, 1, 0, 1 }
-        }));
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = image->image,
+                .subresourceRange = { aspectFlags, 0, 1, 0, 1 }
+        });
+        barriers.flush(cmd_buf);
 
         return image;
     }
 
 
-    // Evicts old unused stages and bumps the current frame number.
-    void StagePool::gc() noexcept
+    void StagePool::retireRing()
     {
-    // If this is one of the first few frames, return early to avoid wrapping unsigned integers.
-    if (++current_frame_ <= TIME_BEFORE_EVICTION) {
-        return;
+        while (!ring_uses_.empty() && timeline_->isCompleted(ring_uses_.front().first)) {
+            ring_tail_ = ring_uses_.front().second;
+            ring_uses_.pop_front();
+        }
     }
-    const uint64_t evictionTime = current_frame_ - TIME_BEFORE_EVICTION;
 
-    // Destroy buffers that have not been used for several frames.
-    decltype(free_stages_) freeStages;
-    freeStages.swap(free_stages_);
-    for (auto pair : freeStages) {
-        if (pair.second->lastAccessed < evictionTime) {
-            vmaDestroyBuffer(driver_->getAllocator(), pair.second->buffer, pair.second->memory);
-            delete pair.second;
-        } else {
-            free_stages_.insert(pair);
+    // Reclaims the stages the device is done with, evicts the ones unused for
+    // TIME_BEFORE_EVICTION frames and bumps the current frame number.
+    void StagePool::gc() noexcept
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        {
+            std::lock_guard<std::mutex> ring_lk(ring_mtx_);
+            retireRing();
         }
-    }
 
-    // Reclaim buffers that are no longer being used by any command buffer.
-    decltype(used_stages_) usedStages;
-    usedStages.swap(used_stages_);
-    for (auto stage : usedStages) {
-        if (stage->lastAccessed < evictionTime) {
-            stage->lastAccessed = current_frame_;
-            free_stages_.insert(std::make_pair(stage->capacity, stage));
-        } else {
-            used_stages_.insert(stage);
+        // Reclaim buffers that are no longer being used by any command buffer.
+        const uint64_t completed = timeline_->completed();
+        decltype(used_stages_) usedStages;
+        usedStages.swap(used_stages_);
+        for (auto stage : usedStages) {
+            if (stage->lastUse <= completed) {
+                stage->lastAccessed = current_frame_;
+                free_stages_.insert(std::make_pair(stage->capacity, stage));
+            } else {
+                used_stages_.insert(stage);
+            }
         }
-    }
 
-    // Destroy images that have not been used for several frames.
-    decltype(free_images_) freeImages;
-    freeImages.swap(free_images_);
-    for (auto image : freeImages) {
-        if (image->lastAccessed < evictionTime) {
-            vmaDestroyImage(driver_->getAllocator(), image->image, image->memory);
-            delete image;
-        } else {
-            free_images_.insert(image);
+        // Reclaim images that are no longer being used by any command buffer.
+        decltype(used_images_) usedImages;
+        usedImages.swap(used_images_);
+        for (auto image : usedImages) {
+            if (image->lastUse <= completed) {
+                image->lastAccessed = current_frame_;
+                free_images_.insert(image);
+            } else {
+                used_images_.insert(image);
+            }
         }
-    }
 
-    // Reclaim images that are no longer being used by any command buffer.
-    decltype(used_images_) usedImages;
-    usedImages.swap(used_images_);
-    for (auto image : usedImages) {
-        if (image->lastAccessed < evictionTime) {
-            image->lastAccessed = current_frame_;
-            free_images_.insert(image);
-        } else {
-            used_images_.insert(image);
+        // If this is one of the first few frames, return early to avoid wrapping unsigned integers.
+        if (++current_frame_ <= TIME_BEFORE_EVICTION) {
+            return;
+        }
+        const uint64_t evictionTime = current_frame_ - TIME_BEFORE_EVICTION;
+
+        // Destroy buffers that have not been used for several frames.
+        decltype(free_stages_) freeStages;
+        freeStages.swap(free_stages_);
+        for (auto pair : freeStages) {
+            if (pair.second->lastAccessed < evictionTime) {
+                driver_->getMemoryStats()->onFree(pair.second->memory);
+                vmaDestroyBuffer(driver_->getAllocator(), pair.second->buffer, pair.second->memory);
+                delete pair.second;
+            } else {
+                free_stages_.insert(pair);
+            }
+        }
+
+        // Destroy images that have not been used for several frames.
+        decltype(free_images_) freeImages;
+        freeImages.swap(free_images_);
+        for (auto image : freeImages) {
+            if (image->lastAccessed < evictionTime) {
+                driver_->getMemoryStats()->onFree(image->memory);
+                vmaDestroyImage(driver_->getAllocator(), image->image, image->memory);
+                delete image;
+            } else {
+                free_images_.insert(image);
+            }
         }
-    }
     }
 
     // Destroys all unused stages and asserts that there are no stages currently in use.
     // This should be called while the context's VkDevice is still alive.
     void StagePool::reset() noexcept
     {
+        std::lock_guard<std::mutex> lk(mtx_);
         for (auto stage : used_stages_) {
+            driver_->getMemoryStats()->onFree(stage->memory);
             vmaDestroyBuffer(driver_->getAllocator(), stage->buffer, stage->memory);
             delete stage;
         }
         used_stages_.clear();
 
         for (auto pair : free_stages_) {
+            driver_->getMemoryStats()->onFree(pair.second->memory);
             vmaDestroyBuffer(driver_->getAllocator(), pair.second->buffer, pair.second->memory);
             delete pair.second;
         }
         free_stages_.clear();
 
         for (auto image : used_images_) {
+            driver_->getMemoryStats()->onFree(image->memory);
             vmaDestroyImage(driver_->getAllocator(), image->image, image->memory);
             delete image;
         }
         used_images_.clear();
 
         for (auto image : free_images_) {
+            driver_->getMemoryStats()->onFree(image->memory);
             vmaDestroyImage(driver_->getAllocator(), image->image, image->memory);
             delete image;
         }
         free_images_.clear();
+
+        std::lock_guard<std::mutex> ring_lk(ring_mtx_);
+        if (ring_buffer_ != VK_NULL_HANDLE) {
+            driver_->getMemoryStats()->onFree(ring_memory_);
+            vmaDestroyBuffer(driver_->getAllocator(), ring_buffer_, ring_memory_);
+            ring_buffer_ = VK_NULL_HANDLE;
+            ring_memory_ = VK_NULL_HANDLE;
+            ring_mapped_ = nullptr;
+        }
+        ring_head_ = ring_tail_ = 0;
+        ring_uses_.clear();
     }
 }
\ No newline at end of file
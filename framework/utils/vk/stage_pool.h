@@ -1,8 +1,11 @@
 #pragma once
 
 #include <framework/utils/vk/buffer.h>
+#include <framework/utils/vk/syncs.h>
+#include <deque>
 #include <unordered_set>
 #include <map>
+#include <mutex>
 
 namespace vk_engine
 {
@@ -10,8 +13,10 @@ namespace vk_engine
     struct VulkanStage {
         VmaAllocation memory;
         VkBuffer buffer;
+        void *mapped; // persistently mapped
         uint32_t capacity;
         mutable uint64_t lastAccessed;
+        mutable uint64_t lastUse; // device timeline value after which the stage is no longer read
     };
 
     struct VulkanStageImage {
@@ -19,29 +24,54 @@ namespace vk_engine
         uint32_t width;
         uint32_t height;
         mutable uint64_t lastAccessed;
+        mutable uint64_t lastUse;
         VmaAllocation memory;
         VkImage image;
     };
 
+    // A range of host-visible memory to copy from, sub-allocated from the staging ring or a whole
+    // dedicated stage. Valid until the device timeline passes the submits that may read it.
+    struct StagingRegion {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        void *mapped; // host address of offset
+        VmaAllocation memory;
+    };
+
+    static constexpr VkDeviceSize STAGING_RING_SIZE = 32u << 20;
+    static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
     // Manages a pool of stages, periodically releasing stages that have been unused for a while.
     // This class manages two types of host-mappable staging areas: buffer stages and image stages.    
     class StagePool final
     {
     public:
-        StagePool(const std::shared_ptr<VkDriver> &driver): driver_(driver) {}
+        StagePool(const std::shared_ptr<VkDriver> &driver, const std::shared_ptr<DeviceTimeline> &timeline,
+                  VkDeviceSize ring_size = STAGING_RING_SIZE)
+            : driver_(driver), timeline_(timeline), ring_size_(ring_size) {}
 
         ~StagePool() { reset(); }
         
         // Finds or creates a stage whose capacity is at least the given number of bytes.
-        // The stage is automatically released back to the pool after TIME_BEFORE_EVICTION frames.
+        // The stage is released back to the pool once the device timeline passes its last use.
         VulkanStage const* acquireStage(uint32_t numBytes);
 
+        // Sub-allocates numBytes from a persistently mapped ring, so small uploads share one buffer.
+        // The ring wraps around once the submits reading it have completed. Uploads larger than
+        // a quarter of the ring, or that don't fit while it is full of in-flight data, get a dedicated
+        // stage. Thread safe.
+        StagingRegion allocateStaging(VkDeviceSize numBytes, VkDeviceSize alignment = STAGING_ALIGNMENT);
+
+        // Makes the host writes of the first numBytes of the region visible to the device.
+        void flushStaging(const StagingRegion &region, VkDeviceSize numBytes);
+
 
         // Images have VK_IMAGE_LAYOUT_GENERAL and must not be transitioned to any other layout
         VulkanStageImage const* acquireImage(VkFormat format, uint32_t width, uint32_t height, VkCommandBuffer cmd_buf);
 
 
-        // Evicts old unused stages and bumps the current frame number.
+        // Reclaims the stages the device is done with, evicts the ones unused for
+        // TIME_BEFORE_EVICTION frames and bumps the current frame number.
         void gc() noexcept;
 
         // Destroys all unused stages and asserts that there are no stages currently in use.
@@ -49,8 +79,19 @@ namespace vk_engine
         void reset() noexcept;
 
     private:
+        void createRing();
+
+        // Releases the ring space the device is done with, ring_mtx_ is locked.
+        void retireRing();
+
+        // Staged data is read by the current frame's submit, or by a transfer batch submitted at
+        // the end of the frame and acquired, so waited on, by the next one.
+        uint64_t useValue() const { return timeline_->pending() + 1; }
 
         std::shared_ptr<VkDriver> driver_;
+        std::shared_ptr<DeviceTimeline> timeline_;
+        // Stages are acquired by the threads recording uploads, e.g. synchronous asset requests.
+        std::mutex mtx_;
         // Use an ordered multimap for quick (capacity => stage) lookups using lower_bound().
         std::multimap<uint32_t, VulkanStage const*> free_stages_;    
     
@@ -62,5 +103,16 @@ namespace vk_engine
 
         // Store the current "time" (really just a frame count) and LRU eviction parameters.
         uint64_t current_frame_{0};
+
+        // Staging ring, head and tail grow monotonically, the buffer offset is head % ring_size_.
+        std::mutex ring_mtx_;
+        VkDeviceSize ring_size_;
+        VkBuffer ring_buffer_{VK_NULL_HANDLE};
+        VmaAllocation ring_memory_{VK_NULL_HANDLE};
+        std::byte *ring_mapped_{nullptr};
+        VkDeviceSize ring_head_{0};
+        VkDeviceSize ring_tail_{0}; // oldest byte the device may still read
+        // (timeline value, head after the last allocation read by it) of the uses still in flight
+        std::deque<std::pair<uint64_t, VkDeviceSize>> ring_uses_;
     };
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <framework/utils/base/error.h>
+#include <framework/utils/vk/deletion_queue.h>
 #include <framework/utils/vk/swapchain.h>
 #include <framework/utils/base/error.h>
 
@@ -56,8 +57,9 @@ void Swapchain::initSwapchain(const SwapchainProperties &properties) {
   
 
   if(old_swapchain != VK_NULL_HANDLE) {
+    // the views and the old swapchain are destroyed once the frames using them completed
     image_views_.clear();
-    vkDestroySwapchainKHR(driver_->getDevice(), old_swapchain, nullptr);
+    driver_->getDeletionQueue()->destroySwapchain(old_swapchain);
   }
 
   initImages();
@@ -87,7 +89,7 @@ Swapchain::~Swapchain()
   }
   #endif
   image_views_.clear();
-  vkDestroySwapchainKHR(driver_->getDevice(), swapchain_, nullptr);  
+  driver_->getDeletionQueue()->destroySwapchain(swapchain_);
 }
 
 uint32_t Swapchain::acquireNextImage(VkSemaphore semaphore, VkFence fence)
@@ -1,6 +1,11 @@
 #include <framework/utils/vk/syncs.h>
 
+#include <algorithm>
 #include <stdexcept>
+#include <vector>
+#include <framework/utils/base/error.h>
+#include <framework/utils/vk/commands.h>
+#include <framework/utils/vk/queue.h>
 
 namespace vk_engine
 {
@@ -54,4 +59,108 @@ namespace vk_engine
     {
         vkDestroySemaphore(driver_->getDevice(), handle_, nullptr);
     }
+
+    TimelineSemaphore::TimelineSemaphore(VkDevice device, const uint64_t initial_value)
+        : device_(device)
+    {
+        VkSemaphoreTypeCreateInfo type_create_info{};
+        type_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_create_info.initialValue = initial_value;
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo{};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreCreateInfo.pNext = &type_create_info;
+
+        if (vkCreateSemaphore(device_, &semaphoreCreateInfo, nullptr, &handle_) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timeline semaphore!");
+        }
+    }
+
+    TimelineSemaphore::~TimelineSemaphore()
+    {
+        vkDestroySemaphore(device_, handle_, nullptr);
+    }
+
+    uint64_t TimelineSemaphore::getValue() const
+    {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(device_, handle_, &value);
+        return value;
+    }
+
+    void TimelineSemaphore::wait(const uint64_t value, const uint64_t timeout) const
+    {
+        VkSemaphoreWaitInfo wait_info{};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &handle_;
+        wait_info.pValues = &value;
+        vkWaitSemaphores(device_, &wait_info, timeout);
+    }
+
+    DeviceTimeline::DeviceTimeline(VkDevice device) : semaphore_(device, 0) {}
+
+    uint64_t DeviceTimeline::completed() const
+    {
+        uint64_t value = completed_.load(std::memory_order_relaxed);
+        if (value + 1 < pending()) {
+            value = semaphore_.getValue();
+            completed_.store(value, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    uint64_t DeviceTimeline::submit(const CommandQueue &queue, const VkSubmitInfo &submit_info, VkFence fence)
+    {
+        std::vector<VkSemaphore> signal_semaphores(submit_info.pSignalSemaphores,
+            submit_info.pSignalSemaphores + submit_info.signalSemaphoreCount);
+        signal_semaphores.emplace_back(semaphore_.getHandle());
+        // values of binary semaphores are ignored
+        std::vector<uint64_t> signal_values(signal_semaphores.size(), 0);
+
+        // a chain may hold only one timeline struct, the caller's values are merged into ours
+        VkTimelineSemaphoreSubmitInfo timeline_info{};
+        timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.pNext = submit_info.pNext;
+        auto head = static_cast<const VkBaseInStructure *>(submit_info.pNext);
+        if (head != nullptr && head->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO) {
+            auto caller_info = reinterpret_cast<const VkTimelineSemaphoreSubmitInfo *>(head);
+            timeline_info.pNext = caller_info->pNext;
+            timeline_info.waitSemaphoreValueCount = caller_info->waitSemaphoreValueCount;
+            timeline_info.pWaitSemaphoreValues = caller_info->pWaitSemaphoreValues;
+            if (caller_info->pSignalSemaphoreValues != nullptr)
+                std::copy_n(caller_info->pSignalSemaphoreValues,
+                            std::min(caller_info->signalSemaphoreValueCount, submit_info.signalSemaphoreCount),
+                            signal_values.begin());
+        }
+        for (auto next = static_cast<const VkBaseInStructure *>(timeline_info.pNext); next != nullptr; next = next->pNext) {
+            if (next->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO)
+                throw VulkanUseException("timeline semaphore submit info must be the first in the submit pNext chain!");
+        }
+
+        std::lock_guard<std::mutex> lk(submit_mtx_);
+        const uint64_t value = pending_.load(std::memory_order_relaxed);
+        signal_values.back() = value;
+        timeline_info.signalSemaphoreValueCount = signal_values.size();
+        timeline_info.pSignalSemaphoreValues = signal_values.data();
+
+        VkSubmitInfo info = submit_info;
+        info.pNext = &timeline_info;
+        info.signalSemaphoreCount = signal_semaphores.size();
+        info.pSignalSemaphores = signal_semaphores.data();
+        VK_THROW_IF_ERROR(queue.submit({info}, fence), "failed to submit to timeline!");
+        pending_.store(value + 1, std::memory_order_release);
+        return value;
+    }
+
+    uint64_t DeviceTimeline::submit(const CommandQueue &queue, const std::shared_ptr<CommandBuffer> &cmd_buf)
+    {
+        auto cmd_buf_handle = cmd_buf->getHandle();
+        VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &cmd_buf_handle;
+        return submit(queue, submit_info);
+    }
 }
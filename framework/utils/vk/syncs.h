@@ -1,10 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <framework/utils/vk/vk_driver.h>
 
 namespace vk_engine
 {
+    class CommandQueue;
+    class CommandBuffer;
+
     /**
      * @brief Vulkan Fence, used for gpu-to-cpu synchronization
     */
@@ -56,8 +61,81 @@ namespace vk_engine
     };
     
 
+    /**
+     * @brief Vulkan timeline semaphore(core in 1.2), a 64 bit counter increased by the device.
+     * only keeps the device handle, so the driver can own it
+    */
+    class TimelineSemaphore final
+    {
+    public:
+        TimelineSemaphore(VkDevice device, const uint64_t initial_value = 0);
+
+        TimelineSemaphore(const TimelineSemaphore &) = delete;
+        TimelineSemaphore(TimelineSemaphore &&) = delete;
+        TimelineSemaphore &operator=(const TimelineSemaphore &) = delete;
+        TimelineSemaphore &operator=(TimelineSemaphore &&) = delete;
+
+        ~TimelineSemaphore();
+
+        uint64_t getValue() const;
+
+        /**
+         * @brief wait on host until the counter reaches value
+        */
+        void wait(const uint64_t value, const uint64_t timeout = std::numeric_limits<uint64_t>::max()) const;
+
+        VkSemaphore getHandle() const { return handle_; }
+    private:
+        VkDevice device_;
+        VkSemaphore handle_{VK_NULL_HANDLE};
+    };
+
+    /**
+     * @brief DeviceTimeline tracks gpu completion with one timeline semaphore, every graphics
+     * submit signals the next value.
+     *
+     * A resource is tagged with pending() when recorded into a command buffer and reclaimed once
+     * isCompleted(tag). The signal also covers the earlier submits to the graphics queue, and the
+     * transfer batches the submit waits on, so the counter is monotonic without ordering the queues.
+    */
+    class DeviceTimeline final
+    {
+    public:
+        DeviceTimeline(VkDevice device);
+
+        /**
+         * @brief value signaled by the next submit, i.e. the tag of the work recorded until then
+        */
+        uint64_t pending() const { return pending_.load(std::memory_order_acquire); }
+
+        /**
+         * @brief the last value signaled by the device
+        */
+        uint64_t completed() const;
+
+        bool isCompleted(const uint64_t value) const { return value <= completed(); }
+
+        void wait(const uint64_t value) const { semaphore_.wait(value); }
+
+        /**
+         * @brief submit to queue, additionally signaling the timeline, return the signaled value.
+         * a VkTimelineSemaphoreSubmitInfo of the caller must be the first struct of submit_info.pNext,
+         * its values are merged with the timeline's
+        */
+        uint64_t submit(const CommandQueue &queue, const VkSubmitInfo &submit_info, VkFence fence = VK_NULL_HANDLE);
+
+        uint64_t submit(const CommandQueue &queue, const std::shared_ptr<CommandBuffer> &cmd_buf);
+
+        VkSemaphore getHandle() const { return semaphore_.getHandle(); }
+    private:
+        TimelineSemaphore semaphore_;
+        std::mutex submit_mtx_; //!< values are signaled in submission order
+        std::atomic<uint64_t> pending_{1};
+        mutable std::atomic<uint64_t> completed_{0}; //!< cached, the counter only grows
+    };
+
     struct RenderOutputSync {
-    std::shared_ptr<Fence> render_fence;
+    std::shared_ptr<Fence> render_fence; //!< frame completion of apps not using the DeviceTimeline
     std::shared_ptr<Semaphore> render_semaphore;
     std::shared_ptr<Semaphore> present_semaphore;
     };    
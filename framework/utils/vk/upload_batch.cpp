@@ -0,0 +1,101 @@
+#include <framework/utils/vk/upload_batch.h>
+
+#include <algorithm>
+#include <cstring>
+#include <framework/utils/vk/barriers.h>
+#include <framework/utils/vk/buffer.h>
+#include <framework/utils/vk/image.h>
+#include <framework/utils/vk/commands.h>
+#include <framework/utils/vk/stage_pool.h>
+
+namespace vk_engine {
+
+UploadBatch::UploadBatch(const std::shared_ptr<StagePool> &stage_pool)
+    : stage_pool_(stage_pool) {}
+
+void UploadBatch::addBuffer(const std::shared_ptr<Buffer> &buffer,
+                            const void *data, VkDeviceSize size,
+                            VkDeviceSize offset) {
+  auto stage = stage_pool_->allocateStaging(size);
+  memcpy(stage.mapped, data, size);
+  stage_pool_->flushStaging(stage, size);
+
+  auto key = std::make_pair(stage.buffer, static_cast<const void *>(buffer.get()));
+  auto itr = buffer_index_.find(key);
+  if (itr == buffer_index_.end()) {
+    itr = buffer_index_.emplace(key, buffer_copies_.size()).first;
+    buffer_copies_.emplace_back(BufferCopies{stage.buffer, buffer, {}});
+  }
+  auto &regions = buffer_copies_[itr->second].regions;
+  // adjacent in both staging and destination, e.g. consecutive ranges of an arena
+  if (!regions.empty() && regions.back().srcOffset + regions.back().size == stage.offset &&
+      regions.back().dstOffset + regions.back().size == offset)
+    regions.back().size += size;
+  else
+    regions.emplace_back(VkBufferCopy{
+        .srcOffset = stage.offset, .dstOffset = offset, .size = size});
+}
+
+void UploadBatch::addImage(const std::shared_ptr<Image> &image,
+                           const void *data, uint32_t mip_level) {
+  const VkDeviceSize size = image->levelDataSize(mip_level);
+  auto stage = stage_pool_->allocateStaging(size, image->copyAlignment());
+  memcpy(stage.mapped, data, size);
+  stage_pool_->flushStaging(stage, size);
+
+  auto key = std::make_pair(stage.buffer, static_cast<const void *>(image.get()));
+  auto itr = image_index_.find(key);
+  if (itr == image_index_.end()) {
+    itr = image_index_.emplace(key, image_copies_.size()).first;
+    image_copies_.emplace_back(ImageCopies{stage.buffer, image, {}});
+  }
+  image_copies_[itr->second].regions.emplace_back(VkBufferImageCopy{
+      .bufferOffset = stage.offset,
+      .bufferRowLength = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                           .mipLevel = mip_level,
+                           .baseArrayLayer = 0,
+                           .layerCount = 1},
+      .imageOffset = {0, 0, 0},
+      .imageExtent = image->levelExtent(mip_level)});
+}
+
+// one barrier call transitioning the whole images to layout, levels already in it are skipped
+static void transitionImages(VkCommandBuffer cmd_buf,
+                             const std::vector<Image *> &images,
+                             VkImageLayout layout) {
+  BarrierBatcher barriers;
+  const auto dst = imageAccessFor(layout);
+  for (auto image : images)
+    barriers.transition(*image, dst);
+  barriers.flush(cmd_buf);
+}
+
+void UploadBatch::record(const std::shared_ptr<CommandBuffer> &cmd_buf,
+                         VkImageLayout final_layout) {
+  auto cmd_buf_handle = cmd_buf->getHandle();
+  std::vector<Image *> images;
+  images.reserve(image_copies_.size());
+  for (const auto &copies : image_copies_)
+    images.emplace_back(copies.dst.get());
+  // an image staged through several buffers has several copies, transition it once
+  std::sort(images.begin(), images.end());
+  images.erase(std::unique(images.begin(), images.end()), images.end());
+
+  transitionImages(cmd_buf_handle, images, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  for (const auto &copies : buffer_copies_)
+    vkCmdCopyBuffer(cmd_buf_handle, copies.src, copies.dst->getHandle(),
+                    copies.regions.size(), copies.regions.data());
+  for (const auto &copies : image_copies_)
+    vkCmdCopyBufferToImage(cmd_buf_handle, copies.src, copies.dst->getHandle(),
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           copies.regions.size(), copies.regions.data());
+  transitionImages(cmd_buf_handle, images, final_layout);
+
+  buffer_copies_.clear();
+  image_copies_.clear();
+  buffer_index_.clear();
+  image_index_.clear();
+}
+} // namespace vk_engine
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <framework/utils/vk/vk_driver.h>
+
+namespace vk_engine {
+class Buffer;
+class Image;
+class CommandBuffer;
+class StagePool;
+
+/**
+ * \brief UploadBatch collects buffer and image uploads and records them with
+ * as few commands as possible.
+ *
+ * The data is copied into the staging ring when added, so it needn't outlive
+ * the add call, and consecutive uploads are packed in the same staging buffer.
+ * record() transitions all the images to transfer dst with one barrier, emits
+ * one multi-region copy per (staging buffer, destination) pair and transitions
+ * the images to the final layout with one more barrier.
+ * The destination ranges of a batch should not overlap.
+ */
+class UploadBatch final {
+public:
+  explicit UploadBatch(const std::shared_ptr<StagePool> &stage_pool);
+
+  UploadBatch(const UploadBatch &) = delete;
+  UploadBatch &operator=(const UploadBatch &) = delete;
+
+  void addBuffer(const std::shared_ptr<Buffer> &buffer, const void *data,
+                 VkDeviceSize size, VkDeviceSize offset);
+
+  /**
+   * \brief upload a whole mip level, tightly packed as Image::updateByStaging expects
+   */
+  void addImage(const std::shared_ptr<Image> &image, const void *data,
+                uint32_t mip_level = 0);
+
+  /**
+   * \brief record the uploads added so far and clear the batch. with final_layout
+   * VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL the images are left for a queue
+   * ownership transfer or generateMipmaps
+   */
+  void record(const std::shared_ptr<CommandBuffer> &cmd_buf,
+              VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  bool empty() const { return buffer_copies_.empty() && image_copies_.empty(); }
+
+private:
+  struct BufferCopies {
+    VkBuffer src;
+    std::shared_ptr<Buffer> dst;
+    std::vector<VkBufferCopy> regions;
+  };
+
+  struct ImageCopies {
+    VkBuffer src;
+    std::shared_ptr<Image> dst;
+    std::vector<VkBufferImageCopy> regions;
+  };
+
+  std::shared_ptr<StagePool> stage_pool_;
+  std::vector<BufferCopies> buffer_copies_;
+  std::vector<ImageCopies> image_copies_;
+  //! (staging buffer, destination) to the index of its copies
+  std::map<std::pair<VkBuffer, const void *>, size_t> buffer_index_;
+  std::map<std::pair<VkBuffer, const void *>, size_t> image_index_;
+};
+} // namespace vk_engine
@@ -0,0 +1,207 @@
+#include <framework/utils/vk/upload_scheduler.h>
+
+#include <framework/utils/base/error.h>
+#include <framework/utils/vk/barriers.h>
+#include <framework/utils/vk/buffer.h>
+#include <framework/utils/vk/image.h>
+#include <framework/utils/vk/commands.h>
+#include <framework/utils/vk/queue.h>
+#include <framework/utils/vk/syncs.h>
+#include <framework/utils/vk/stage_pool.h>
+#include <framework/utils/vk/upload_batch.h>
+
+namespace vk_engine {
+
+UploadScheduler::UploadScheduler(const std::shared_ptr<VkDriver> &driver,
+                                 const std::shared_ptr<StagePool> &stage_pool,
+                                 const std::shared_ptr<DeviceTimeline> &timeline)
+    : driver_(driver), stage_pool_(stage_pool), timeline_(timeline) {
+  graphics_family_ = driver_->getGraphicsQueue()->getFamilyIndex();
+  queue_ = driver_->getTransferQueue();
+  if (queue_ == nullptr)
+    queue_ = driver_->getGraphicsQueue();
+  transfer_family_ = queue_->getFamilyIndex();
+}
+
+UploadScheduler::~UploadScheduler() {
+  // make sure no batch is in use by the device
+  queue_->waitIdle();
+}
+
+UploadScheduler::TransferBatch &UploadScheduler::recordingBatch() {
+  if (recording_ != nullptr)
+    return *recording_;
+
+  if (!free_.empty()) {
+    recording_ = std::move(free_.back());
+    free_.pop_back();
+    recording_->cmd_pool->reset();
+  } else {
+    recording_ = std::make_unique<TransferBatch>();
+    recording_->cmd_pool = std::make_unique<CommandPool>(
+        driver_, transfer_family_, CommandPool::CmbResetMode::ResetPool);
+    recording_->semaphore = std::make_unique<Semaphore>(driver_);
+    recording_->uploads = std::make_unique<UploadBatch>(stage_pool_);
+  }
+  recording_->cmd_buf =
+      recording_->cmd_pool->requestCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+  recording_->cmd_buf->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  return *recording_;
+}
+
+void UploadScheduler::uploadBuffer(const std::shared_ptr<Buffer> &buffer,
+                                   const void *data, VkDeviceSize size,
+                                   VkDeviceSize offset,
+                                   VkPipelineStageFlags dst_stage,
+                                   VkAccessFlags dst_access) {
+  auto &batch = recordingBatch();
+  batch.uploads->addBuffer(buffer, data, size, offset);
+  batch.buffers.emplace_back(
+      BufferUpload{buffer, offset, size, dst_stage, dst_access});
+}
+
+void UploadScheduler::uploadImage(const std::shared_ptr<Image> &image,
+                                  const void *data, uint32_t mip_level) {
+  auto &batch = recordingBatch();
+  batch.uploads->addImage(image, data, mip_level);
+  VkImageSubresourceRange range = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                   .baseMipLevel = mip_level,
+                                   .levelCount = 1,
+                                   .baseArrayLayer = 0,
+                                   .layerCount = 1};
+  batch.images.emplace_back(ImageUpload{image, range});
+}
+
+void UploadScheduler::onAcquired(std::function<void()> &&callback) {
+  recordingBatch().callbacks.emplace_back(std::move(callback));
+}
+
+void UploadScheduler::submit() {
+  if (recording_ == nullptr)
+    return;
+  auto &batch = *recording_;
+  // images stay in transfer dst until acquired
+  batch.uploads->record(batch.cmd_buf, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+  // release queue family ownership, the destination scope is ignored by the release
+  if (hasDedicatedQueue()) {
+    BarrierBatcher barriers;
+    for (const auto &b : batch.buffers) {
+      barriers.bufferBarrier(VkBufferMemoryBarrier2{
+          .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+          .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+          .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+          .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+          .dstAccessMask = VK_ACCESS_2_NONE,
+          .srcQueueFamilyIndex = transfer_family_,
+          .dstQueueFamilyIndex = graphics_family_,
+          .buffer = b.buffer->getHandle(),
+          .offset = b.offset,
+          .size = b.size});
+    }
+    for (const auto &img : batch.images) {
+      barriers.imageBarrier(VkImageMemoryBarrier2{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+          .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+          .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+          .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+          .dstAccessMask = VK_ACCESS_2_NONE,
+          .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          .srcQueueFamilyIndex = transfer_family_,
+          .dstQueueFamilyIndex = graphics_family_,
+          .image = img.image->getHandle(),
+          .subresourceRange = img.range});
+    }
+    barriers.flush(batch.cmd_buf->getHandle());
+  }
+  batch.cmd_buf->end();
+
+  auto cmd_buf_handle = batch.cmd_buf->getHandle();
+  auto semaphore = batch.semaphore->getHandle();
+  VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &cmd_buf_handle;
+  submit_info.signalSemaphoreCount = 1;
+  submit_info.pSignalSemaphores = &semaphore;
+  VK_THROW_IF_ERROR(queue_->submit({submit_info}, VK_NULL_HANDLE),
+                    "failed to submit upload batch!");
+  submitted_.emplace_back(std::move(recording_));
+}
+
+void UploadScheduler::acquire(const std::shared_ptr<CommandBuffer> &cmd_buf,
+                              std::vector<VkSemaphore> &wait_semaphores,
+                              std::vector<VkPipelineStageFlags> &wait_stages) {
+  // recycle the finished batches, the graphics submits acquiring them waited on the transfer
+  for (auto itr = acquired_.begin(); itr != acquired_.end();) {
+    if (timeline_->isCompleted((*itr)->acquire_value)) {
+      (*itr)->buffers.clear();
+      (*itr)->images.clear();
+      (*itr)->callbacks.clear();
+      free_.emplace_back(std::move(*itr));
+      itr = acquired_.erase(itr);
+    } else
+      ++itr;
+  }
+
+  const bool dedicated = hasDedicatedQueue();
+  const uint32_t src_family = dedicated ? transfer_family_ : VK_QUEUE_FAMILY_IGNORED;
+  const uint32_t dst_family = dedicated ? graphics_family_ : VK_QUEUE_FAMILY_IGNORED;
+  // same queue family: plain barrier after the transfer in submission order
+  const VkAccessFlags2 src_access = dedicated ? VK_ACCESS_2_NONE : VK_ACCESS_2_TRANSFER_WRITE_BIT;
+  const auto sampled = imageAccessFor(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  for (auto &batch : submitted_) {
+    VkPipelineStageFlags2 dst_stage = VK_PIPELINE_STAGE_2_NONE;
+    for (const auto &b : batch->buffers)
+      dst_stage |= b.dst_stage;
+    if (!batch->images.empty())
+      dst_stage |= sampled.stages;
+    // the acquire barrier's first scope chains with the semaphore wait
+    const VkPipelineStageFlags2 src_stage =
+        dedicated ? dst_stage : VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+
+    BarrierBatcher barriers;
+    for (const auto &b : batch->buffers) {
+      barriers.bufferBarrier(VkBufferMemoryBarrier2{
+          .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+          .srcStageMask = src_stage,
+          .srcAccessMask = src_access,
+          .dstStageMask = b.dst_stage,
+          .dstAccessMask = b.dst_access,
+          .srcQueueFamilyIndex = src_family,
+          .dstQueueFamilyIndex = dst_family,
+          .buffer = b.buffer->getHandle(),
+          .offset = b.offset,
+          .size = b.size});
+    }
+    for (const auto &img : batch->images) {
+      barriers.imageBarrier(VkImageMemoryBarrier2{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+          .srcStageMask = src_stage,
+          .srcAccessMask = src_access,
+          .dstStageMask = sampled.stages,
+          .dstAccessMask = sampled.access,
+          .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          .srcQueueFamilyIndex = src_family,
+          .dstQueueFamilyIndex = dst_family,
+          .image = img.image->getHandle(),
+          .subresourceRange = img.range});
+      img.image->setAccess(img.range, sampled);
+    }
+    barriers.flush(cmd_buf->getHandle());
+    wait_semaphores.emplace_back(batch->semaphore->getHandle());
+    // dst_stage only has legacy stages. a batch with nothing to acquire is still waited on so
+    // its semaphore can be signaled again, TOP_OF_PIPE blocks no stage of the submit
+    wait_stages.emplace_back(dst_stage != VK_PIPELINE_STAGE_2_NONE
+                                 ? static_cast<VkPipelineStageFlags>(dst_stage)
+                                 : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
+    for (auto &callback : batch->callbacks)
+      callback();
+    batch->acquire_value = timeline_->pending();
+    acquired_.emplace_back(std::move(batch));
+  }
+  submitted_.clear();
+}
+} // namespace vk_engine
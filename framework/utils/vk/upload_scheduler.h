@@ -0,0 +1,120 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <vector>
+#include <framework/utils/vk/vk_driver.h>
+
+namespace vk_engine {
+class Buffer;
+class Image;
+class CommandPool;
+class CommandBuffer;
+class CommandQueue;
+class Semaphore;
+class DeviceTimeline;
+class StagePool;
+class UploadBatch;
+
+/**
+ * \brief UploadScheduler records uploads on the dedicated transfer queue, so
+ * streaming doesn't take graphics queue time.
+ *
+ * Uploads are collected into an UploadBatch and recorded into the transfer
+ * command buffer with a few multi-region copies at submit(). submit() releases the queue family ownership and signals a semaphore.
+ * acquire() records the matching acquire barriers into the graphics command
+ * buffer, runs the callbacks of the acquired batches and returns the semaphores
+ * the graphics submit must wait on.
+ * Without a dedicated transfer queue the batches are submitted to the graphics
+ * queue and no ownership transfer is needed.
+ */
+class UploadScheduler final {
+public:
+  UploadScheduler(const std::shared_ptr<VkDriver> &driver,
+                  const std::shared_ptr<StagePool> &stage_pool,
+                  const std::shared_ptr<DeviceTimeline> &timeline);
+
+  ~UploadScheduler();
+
+  UploadScheduler(const UploadScheduler &) = delete;
+  UploadScheduler &operator=(const UploadScheduler &) = delete;
+
+  /**
+   * \brief upload data to buffer, the buffer is used at dst_stage/dst_access after acquire
+   */
+  void uploadBuffer(const std::shared_ptr<Buffer> &buffer, const void *data,
+                    VkDeviceSize size, VkDeviceSize offset,
+                    VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+
+  /**
+   * \brief upload a whole mip level of image, transitioned to shader read only after acquire
+   */
+  void uploadImage(const std::shared_ptr<Image> &image, const void *data,
+                   uint32_t mip_level = 0);
+
+  /**
+   * \brief callback is called in acquire(), after the uploads recorded so far are acquired
+   */
+  void onAcquired(std::function<void()> &&callback);
+
+  /**
+   * \brief submit the recorded uploads to transfer queue, should be called before the graphics submit
+   */
+  void submit();
+
+  /**
+   * \brief record acquire barriers of the submitted uploads into the graphics command buffer,
+   * and append the semaphores the graphics submit should wait on
+   */
+  void acquire(const std::shared_ptr<CommandBuffer> &cmd_buf,
+               std::vector<VkSemaphore> &wait_semaphores,
+               std::vector<VkPipelineStageFlags> &wait_stages);
+
+  bool hasDedicatedQueue() const { return transfer_family_ != graphics_family_; }
+
+  /**
+   * \brief no submitted batch is waiting for acquire or for its transfer to complete
+   */
+  bool idle() const { return submitted_.empty() && acquired_.empty(); }
+
+private:
+  struct BufferUpload {
+    std::shared_ptr<Buffer> buffer;
+    VkDeviceSize offset; //!< only the uploaded range changes ownership
+    VkDeviceSize size;
+    VkPipelineStageFlags dst_stage;
+    VkAccessFlags dst_access;
+  };
+
+  struct ImageUpload {
+    std::shared_ptr<Image> image;
+    VkImageSubresourceRange range;
+  };
+
+  struct TransferBatch {
+    std::unique_ptr<CommandPool> cmd_pool;
+    std::shared_ptr<CommandBuffer> cmd_buf;
+    std::unique_ptr<Semaphore> semaphore;
+    uint64_t acquire_value{0}; //!< timeline value of the graphics submit waiting on the batch
+    std::unique_ptr<UploadBatch> uploads;
+    std::vector<BufferUpload> buffers;
+    std::vector<ImageUpload> images;
+    std::vector<std::function<void()>> callbacks;
+  };
+
+  TransferBatch &recordingBatch();
+
+  std::shared_ptr<VkDriver> driver_;
+  std::shared_ptr<StagePool> stage_pool_;
+  std::shared_ptr<DeviceTimeline> timeline_;
+  std::shared_ptr<CommandQueue> queue_;
+  uint32_t transfer_family_;
+  uint32_t graphics_family_;
+
+  std::unique_ptr<TransferBatch> recording_;
+  std::list<std::unique_ptr<TransferBatch>> submitted_; //!< waiting for acquire
+  std::list<std::unique_ptr<TransferBatch>> acquired_;  //!< waiting for transfer complete
+  std::vector<std::unique_ptr<TransferBatch>> free_;
+};
+} // namespace vk_engine
@@ -18,24 +18,4 @@ static constexpr bool isDepthFormat(VkFormat format) noexcept {
   }
 }
 
-struct VulkanLayoutTransition {
-  VkImage image;
-  VkImageLayout oldLayout;
-  VkImageLayout newLayout;
-  VkImageSubresourceRange subresources;
-  VkPipelineStageFlags srcStage;
-  VkAccessFlags srcAccessMask;
-  VkPipelineStageFlags dstStage;
-  VkAccessFlags dstAccessMask;
-};
-
-VulkanLayoutTransition
-blitterTransitionHelper(VulkanLayoutTransition transition);
-
-VulkanLayoutTransition
-textureTransitionHelper(VulkanLayoutTransition transition);
-
-
-void transitionImageLayout(VkCommandBuffer cmdbuffer, VulkanLayoutTransition transition);
-
 } // namespace vk_engine
\ No newline at end of file
@@ -33,6 +33,28 @@ uint32_t Vk13Config::checkSelectAndUpdate(
     extension_features_list_ = ext_feature.get();
   }
 
+  // device timeline, core in vulkan 1.2
+  auto timeline_feature =
+      std::make_shared<VkPhysicalDeviceTimelineSemaphoreFeatures>();
+  timeline_feature->sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+  extension_features_.emplace(
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+      timeline_feature);
+  timeline_feature->pNext = extension_features_list_;
+  extension_features_list_ = timeline_feature.get();
+
+  // vkCmdPipelineBarrier2 of the barrier batcher, core in vulkan 1.3
+  auto sync2_feature =
+      std::make_shared<VkPhysicalDeviceSynchronization2Features>();
+  sync2_feature->sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+  extension_features_.emplace(
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+      sync2_feature);
+  sync2_feature->pNext = extension_features_list_;
+  extension_features_list_ = sync2_feature.get();
+
   uint32_t selected_physical_device_index = -1;
   enabled_device_extensions_.reserve(request_device_extensions_.size());
   for (uint32_t device_index = 0; device_index < physical_devices.size();
@@ -88,6 +110,8 @@ uint32_t Vk13Config::checkSelectAndUpdate(
     if (extension_features_list_ != nullptr) {
       pd.getExtensionFeatures(extension_features_list_);
     }
+    if (!timeline_feature->timelineSemaphore || !sync2_feature->synchronization2)
+      continue;
     selected_physical_device_index = device_index;
     break;
   }
@@ -96,6 +120,9 @@ uint32_t Vk13Config::checkSelectAndUpdate(
     return selected_physical_device_index;
 
   // TODO setup device features
+  // optional features, enabled if supported
+  const auto features = physical_devices[selected_physical_device_index].getFeatures();
+  device_features_.textureCompressionBC = features.textureCompressionBC;
 
   // update device create info
   create_info.pEnabledFeatures = &device_features_;
@@ -41,7 +41,8 @@ public:
     KHR_DEDICATED_ALLOCATION = 13,
     KHR_BUFFER_DEVICE_ADDRESS = 14,
     KHR_DEVICE_GROUP = 15,
-    DEVICE_EXTENSION_END_PIVOT = 16,
+    EXT_MEMORY_BUDGET = 16,
+    DEVICE_EXTENSION_END_PIVOT = 17,
 
     //// Device features
     MAX_FEATURE_EXTENSION_COUNT
@@ -67,7 +68,8 @@ public:
       VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME, // 13
       VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME, // 14
       VK_KHR_DEVICE_GROUP_EXTENSION_NAME, // 15
-      "DEVICE_EXTENSION_END_PIVOT", // 16
+      VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, // 16
+      "DEVICE_EXTENSION_END_PIVOT", // 17
   };
 
   VkConfig()
@@ -144,6 +146,8 @@ public:
     enableds_[static_cast<uint32_t>(FeatureExtension::KHR_BUFFER_DEVICE_ADDRESS)] = EnableState::REQUIRED;
     enableds_[static_cast<uint32_t>(FeatureExtension::KHR_DEVICE_GROUP_CREATION)] = EnableState::REQUIRED;
     enableds_[static_cast<uint32_t>(FeatureExtension::KHR_DEVICE_GROUP)] = EnableState::REQUIRED;
+    // real heap budgets instead of vma's estimation
+    enableds_[static_cast<uint32_t>(FeatureExtension::EXT_MEMORY_BUDGET)] = EnableState::OPTIONAL;
 
     //enableds_[static_cast<uint32_t>(FeatureExtension::KHR_UNIFORM_BUFFER_STANDARD_LAYOUT)] = EnableState::REQUIRED;
     enableds_[static_cast<uint32_t>(FeatureExtension::VK_KHR_SHADER_NON_SEMANTIC_INFO)] = EnableState::REQUIRED;
@@ -10,9 +10,14 @@
 #include <GLFW/glfw3.h>
 
 #include <framework/utils/base/error.h>
+#include <framework/utils/vk/defragmenter.h>
+#include <framework/utils/vk/deletion_queue.h>
+#include <framework/utils/vk/memory_pools.h>
+#include <framework/utils/vk/memory_stats.h>
 #include <framework/utils/vk/physical_device.h>
 #include <framework/utils/vk/vk_driver.h>
 #include <framework/utils/vk/queue.h>
+#include <framework/utils/vk/syncs.h>
 #include <framework/platform/window.h>
 
 namespace vk_engine {
@@ -51,6 +56,9 @@ void VkDriver::initDevice() {
   }
 
   physical_device_ = physical_devices[physical_device_index].getHandle();
+  enabled_device_extensions_.assign(
+      device_info.ppEnabledExtensionNames,
+      device_info.ppEnabledExtensionNames + device_info.enabledExtensionCount);
   auto graphics_queue_family_index =
       physical_devices[physical_device_index].getGraphicsQueueFamilyIndex();
 
@@ -89,23 +97,36 @@ void VkDriver::initDevice() {
 #endif
 
   // queue info
-  VkDeviceQueueCreateInfo queue_info{};
+  VkDeviceQueueCreateInfo queue_infos[2]{};
   float queue_priority = 1.0f;
-  queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-  queue_info.queueFamilyIndex = graphics_queue_family_index;
-  queue_info.queueCount = 1;
-  queue_info.pQueuePriorities = &queue_priority;
+  queue_infos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queue_infos[0].queueFamilyIndex = graphics_queue_family_index;
+  queue_infos[0].queueCount = 1;
+  queue_infos[0].pQueuePriorities = &queue_priority;
+
+  // dedicated transfer queue if exist, used for async uploading
+  auto transfer_queue_family_index =
+      physical_devices[physical_device_index].getTransferQueueFamilyIndex();
+  const bool has_transfer_queue = transfer_queue_family_index != 0xFFFFFFFF;
+  if (has_transfer_queue) {
+    queue_infos[1] = queue_infos[0];
+    queue_infos[1].queueFamilyIndex = transfer_queue_family_index;
+  }
 
   // logical device
   device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-  device_info.pQueueCreateInfos = &queue_info;
-  device_info.queueCreateInfoCount = 1;
+  device_info.pQueueCreateInfos = queue_infos;
+  device_info.queueCreateInfoCount = has_transfer_queue ? 2 : 1;
 
   VK_THROW_IF_ERROR(
       vkCreateDevice(physical_device_, &device_info, nullptr, &device_),
       "failed to create vulkan device!");
   volkLoadDevice(device_);      
   graphics_cmd_queue_.reset(new CommandQueue(device_, graphics_queue_family_index, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT, VK_TRUE, 0));
+  if (has_transfer_queue) {
+    transfer_cmd_queue_.reset(new CommandQueue(device_, transfer_queue_family_index, VK_QUEUE_TRANSFER_BIT, VK_FALSE, 0));
+    LOGI("using dedicated transfer queue family {}", transfer_queue_family_index);
+  }
 }
 
 void VkDriver::init(const std::string &app_name,
@@ -121,6 +142,10 @@ void VkDriver::init(const std::string &app_name,
   initDevice();
 
   initAllocator();
+
+  timeline_ = std::make_shared<DeviceTimeline>(device_);
+  deletion_queue_ = std::make_unique<DeletionQueue>(device_, allocator_, timeline_);
+  defragmenter_ = std::make_unique<Defragmenter>(allocator_, memory_pools_.get(), timeline_);
 }
 
 bool VkDriver::isDeviceExtensionEnabled(const char *extension_name) {
@@ -268,19 +293,35 @@ void VkDriver::initAllocator() {
     allocator_info.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
   }
 
+  if (isDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+    allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+  }
+
   auto result = vmaCreateAllocator(&allocator_info, &allocator_);
   if (result != VK_SUCCESS) {
     throw VulkanException(result, "failed to create vma allocator");
   }
+  memory_stats_ = std::make_unique<MemoryStats>(allocator_);
+  memory_pools_ = std::make_unique<MemoryPools>(allocator_, defaultMemoryPoolDescs());
 }
 
 VkDriver::~VkDriver() {
+  if (device_ != VK_NULL_HANDLE)
+    vkDeviceWaitIdle(device_);
+  // a pass in flight is ended before its allocations can be freed
+  defragmenter_.reset();
+  deletion_queue_.reset();
+  timeline_.reset();
 
   if(allocator_)
   {
-		//VmaTotalStatistics stats;
-		//vmaCalculateStatistics(allocator_, &stats);
-		//LOGI("Total device memory leaked: {} bytes.", stats.total.);
+    const auto stats = memory_stats_->calculateStatistics();
+    if (stats.total.statistics.allocationCount > 0)
+      LOGW("Total device memory leaked: {} bytes in {} allocations.",
+           stats.total.statistics.allocationBytes,
+           stats.total.statistics.allocationCount);
+    memory_pools_.reset();
+    memory_stats_.reset();
 		vmaDestroyAllocator(allocator_);
   }
 
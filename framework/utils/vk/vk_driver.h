@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <vk_mem_alloc.h>
@@ -11,6 +12,11 @@
 namespace vk_engine {
 
 class CommandQueue;
+class DeletionQueue;
+class Defragmenter;
+class DeviceTimeline;
+class MemoryPools;
+class MemoryStats;
 class Window;
 
 struct RequestedDeviceExtension {
@@ -42,8 +48,38 @@ public:
 
   std::shared_ptr<CommandQueue> getGraphicsQueue() const { return graphics_cmd_queue_; }
 
+  /**
+   * \brief queue of a transfer-only(or async compute) family, nullptr if the device has none
+   */
+  std::shared_ptr<CommandQueue> getTransferQueue() const { return transfer_cmd_queue_; }
+
   VkResult waitIdle() const { return vkDeviceWaitIdle(device_); }
 
+  /**
+   * \brief timeline signaled by the graphics submits, tracks the last use of gpu objects
+   */
+  std::shared_ptr<DeviceTimeline> getTimeline() const { return timeline_; }
+
+  /**
+   * \brief destructors of gpu objects defer the vulkan destroy calls to it
+   */
+  DeletionQueue *getDeletionQueue() const { return deletion_queue_.get(); }
+
+  /**
+   * \brief memory usage per category and heap budgets
+   */
+  MemoryStats *getMemoryStats() const { return memory_stats_.get(); }
+
+  /**
+   * \brief vma pools per resource class, Buffer and Image allocate through it
+   */
+  MemoryPools *getMemoryPools() const { return memory_pools_.get(); }
+
+  /**
+   * \brief incremental compaction of the geometry and texture pools
+   */
+  Defragmenter *getDefragmenter() const { return defragmenter_.get(); }
+
   void update(const std::vector<VkWriteDescriptorSet> &descriptor_writes)
   {
     vkUpdateDescriptorSets(device_, static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);    
@@ -80,11 +116,18 @@ private:
   std::vector<const char *> enabled_device_extensions_;
 
   std::shared_ptr<CommandQueue> graphics_cmd_queue_;
+  std::shared_ptr<CommandQueue> transfer_cmd_queue_;
 
   VkSurfaceKHR surface_{VK_NULL_HANDLE};
 
   VmaAllocator allocator_{VK_NULL_HANDLE};
 
+  std::shared_ptr<DeviceTimeline> timeline_;
+  std::unique_ptr<DeletionQueue> deletion_queue_;
+  std::unique_ptr<MemoryStats> memory_stats_;
+  std::unique_ptr<MemoryPools> memory_pools_;
+  std::unique_ptr<Defragmenter> defragmenter_;
+
   VkDebugUtilsMessengerEXT debug_messenger_;
 };
 } // namespace vk_engine
\ No newline at end of file
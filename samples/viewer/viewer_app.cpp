@@ -1,5 +1,4 @@
 #include "viewer_app.h"
-#include <framework/scene/loader.h>
 #include <framework/utils/app_context.h>
 #include <framework/vk/stage_pool.h>
 #include <framework/scene/asset_manager.hpp>
@@ -22,34 +21,41 @@ void ViewerApp::init(Window * window, const std::shared_ptr<VkDriver> &driver,
   cmd_buf->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
   initGlobalParamSet(cmd_buf);
-  
-  AssimpLoader loader;
-  loader.loadScene(scene_path_, *scene_, cmd_buf);
   cmd_buf->end();
-  auto &render_output_syncs = getDefaultAppContext().render_output_syncs;  
   auto cmd_queue = driver->getGraphicsQueue();
-  render_output_syncs[0].render_fence->reset();
-  cmd_queue->submit(cmd_buf, render_output_syncs[0].render_fence->getHandle());
-  render_output_syncs[0].render_fence->wait();
+  auto &timeline = getDefaultAppContext().timeline;
+  frames_data[0].timeline_value = timeline->submit(*cmd_queue, cmd_buf);
+  timeline->wait(frames_data[0].timeline_value);
   gui_->init(window);
+  aspect_ = static_cast<float>(rts[0]->getWidth()) / rts[0]->getHeight();
+
+  // scene is loaded in background, camera is set up once published
+  streamer_ = std::make_unique<SceneStreamer>();
+  streamer_->start(scene_path_);
+}
+
+void ViewerApp::setupCamera()
+{
   auto& camera_manager = scene_->camera_manager();
 
   auto view_camera = camera_manager.view<std::shared_ptr<TransformRelationship>,
                                          Camera>();
-  const auto &cam_tr = camera_manager.get<std::shared_ptr<TransformRelationship>>(*view_camera.begin());
   auto &cam = camera_manager.get<Camera>(*view_camera.begin());
-  cam.setAspect(static_cast<float>(rts[0]->getWidth()) / rts[0]->getHeight());
+  cam.setAspect(aspect_);
   event_manager_.registHandler(std::make_shared<Trackball>(&cam));
+  camera_ready_ = true;
 }
 
 void ViewerApp::updateRts(const std::vector<std::shared_ptr<RenderTarget>> &rts)
 {
-  auto& camera_manager = scene_->camera_manager();
-  auto view_camera = camera_manager.view<std::shared_ptr<TransformRelationship>,
-                                         Camera>();  
-  const auto &cam_tr = camera_manager.get<std::shared_ptr<TransformRelationship>>(*view_camera.begin());
-  auto &cam = camera_manager.get<Camera>(*view_camera.begin());
-  cam.setAspect(static_cast<float>(rts[0]->getWidth()) / rts[0]->getHeight());
+  aspect_ = static_cast<float>(rts[0]->getWidth()) / rts[0]->getHeight();
+  if (camera_ready_) {
+    auto& camera_manager = scene_->camera_manager();
+    auto view_camera = camera_manager.view<std::shared_ptr<TransformRelationship>,
+                                           Camera>();  
+    auto &cam = camera_manager.get<Camera>(*view_camera.begin());
+    cam.setAspect(aspect_);
+  }
 
   // update rts in app context
   updateRtsInContext(rts);
@@ -66,8 +72,22 @@ void ViewerApp::tick(const float seconds, const uint32_t rt_index,
   getDefaultAppContext().stage_pool->gc();
   getDefaultAppContext().gpu_asset_manager->gc();
   render_->beginFrame(seconds, frame_index, rt_index);
+  if (!streamer_->finished()) {
+    streamer_->update(*scene_);
+    if (!camera_ready_ && streamer_->sceneReady()) setupCamera();
+  }
   render_->render(scene_.get(), gui_.get());
   render_->endFrame();
+  if (frame_count_++ % 600 == 0) {
+    const auto &stats = render_->stats();
+    LOGI("frame {}: {} draws, {} triangles", frame_count_, stats.draws,
+         stats.triangles);
+    const auto &assets = getDefaultAppContext().gpu_asset_manager->stats();
+    LOGI("assets: {} MB textures, {} MB images, {} hits, {} misses, {} evictions, {} downgrades",
+         assets.resident_bytes[static_cast<uint32_t>(AssetClass::TEXTURE)] >> 20,
+         assets.resident_bytes[static_cast<uint32_t>(AssetClass::IMAGE)] >> 20,
+         assets.hits, assets.misses, assets.evictions, assets.downgrades);
+  }
 }
 
 void
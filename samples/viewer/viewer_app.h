@@ -6,6 +6,7 @@
 #include <framework/utils/gui.h>
 #include <framework/vk/commands.h>
 #include <framework/vk/descriptor_set.h>
+#include <framework/resources/scene_streamer.h>
 
 namespace vk_engine {
 class CommandBuffer;
@@ -36,6 +37,12 @@ private:
   std::unique_ptr<Render> render_;
   std::unique_ptr<Scene> scene_;
   std::unique_ptr<Gui> gui_;
+  std::unique_ptr<SceneStreamer> streamer_;
+  float aspect_{1.0f};
+  bool camera_ready_{false};
+  uint32_t frame_count_{0};
   EventManager event_manager_;  
+
+  void setupCamera();
 };
 } // namespace vk_engine
\ No newline at end of file
@@ -2,8 +2,15 @@
 #extension GL_EXT_scalar_block_layout : require
 
 // vertex data binding = 0
+#if defined(VERTEX_QUANTIZED16) || defined(VERTEX_QUANTIZED8)
+layout(location=0) in vec4 vpos_q;
+#if defined(VERTEX_QUANTIZED16)
+layout(location=1) in vec2 normal_oct;
+#endif
+#else
 layout(location=0) in vec3 vpos;
 layout(location=1) in vec3 normal;
+#endif
 layout(location=2) in vec2 uv;
 
 layout(location=0) out vec2 out_uv;
@@ -38,10 +45,43 @@ layout(std430, set=GLOBAL_SET_INDEX, binding = 0) uniform GlobalUniform
 layout(set=PER_OBJECT_SET_INDEX, binding = 0) uniform MeshUniform
 {
     mat4 model;
+    vec4 dequant_offset; // quantized position = offset + scale * unorm
+    vec4 dequant_scale;
 } mesh_uniform;
 
+#if defined(VERTEX_QUANTIZED16) || defined(VERTEX_QUANTIZED8)
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+vec3 decodePosition()
+{
+    return mesh_uniform.dequant_offset.xyz + mesh_uniform.dequant_scale.xyz * vpos_q.xyz;
+}
+
+vec3 decodeNormal()
+{
+#if defined(VERTEX_QUANTIZED8)
+    // snorm8 octahedral normal in pos.w, x in the low byte
+    int packed = int(vpos_q.w * 65535.0 + 0.5);
+    vec2 e = vec2((packed << 24) >> 24, (packed << 16) >> 24) / 127.0;
+    return octDecode(max(e, vec2(-1.0)));
+#else
+    return octDecode(normal_oct);
+#endif
+}
+#endif
+
 void main(void)
 {
+#if defined(VERTEX_QUANTIZED16) || defined(VERTEX_QUANTIZED8)
+    vec3 vpos = decodePosition();
+    vec3 normal = decodeNormal();
+#endif
     out_uv = uv;
     out_normal = normalize(mat3x3(mesh_uniform.model) * normal);
     vec4 gpos = mesh_uniform.model * vec4(vpos, 1.0f);
@@ -0,0 +1,224 @@
+#include "check.h"
+
+#include <framework/utils/vk/barriers.h>
+#include <stdexcept>
+
+using namespace vk_engine;
+
+// the batcher only records handles, no device is needed
+static const VkImage IMAGE = (VkImage)0x1000;
+static const VkImage OTHER_IMAGE = (VkImage)0x2000;
+static const VkBuffer BUFFER = (VkBuffer)0x3000;
+
+static const VkImageSubresourceRange ALL_LEVELS{VK_IMAGE_ASPECT_COLOR_BIT, 0,
+                                                VK_REMAINING_MIP_LEVELS, 0, 1};
+
+static bool sameAccess(const ImageAccess &a, const ImageAccess &b) {
+  return a.layout == b.layout && a.stages == b.stages && a.access == b.access;
+}
+
+static void testAccessFor() {
+  CHECK(isWriteAccess(VK_ACCESS_2_TRANSFER_WRITE_BIT));
+  CHECK(isWriteAccess(VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT));
+  CHECK(!isWriteAccess(VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_MEMORY_READ_BIT));
+  CHECK(!isWriteAccess(VK_ACCESS_2_NONE));
+
+  const ImageAccess sampled = imageAccessFor(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  CHECK(sampled.layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  CHECK(!isWriteAccess(sampled.access));
+  CHECK(isWriteAccess(imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL).access));
+
+  bool threw = false;
+  try {
+    imageAccessFor(VK_IMAGE_LAYOUT_MAX_ENUM);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+// levels in the same state share one barrier, from the stages that really used them
+static void testFirstUse() {
+  std::vector<ImageAccess> states(5);
+  const ImageAccess dst = imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  BarrierBatcher barriers;
+  barriers.transition(IMAGE, states, ALL_LEVELS, dst);
+
+  const auto &image_barriers = barriers.getImageBarriers();
+  CHECK(image_barriers.size() == 1);
+  const auto &b = image_barriers[0];
+  CHECK(b.image == IMAGE);
+  CHECK(b.oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+  CHECK(b.newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  CHECK(b.srcStageMask == VK_PIPELINE_STAGE_2_NONE);
+  CHECK(b.srcAccessMask == VK_ACCESS_2_NONE);
+  CHECK(b.dstStageMask == dst.stages);
+  CHECK(b.dstAccessMask == dst.access);
+  CHECK(b.subresourceRange.baseMipLevel == 0);
+  CHECK(b.subresourceRange.levelCount == 5);
+  CHECK(b.srcQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED);
+  for (const auto &s : states)
+    CHECK(sameAccess(s, dst));
+  CHECK(!barriers.empty());
+}
+
+// a run is cut where the source state changes, only writes are made available
+static void testMixedLevels() {
+  const ImageAccess read = imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+  const ImageAccess write = imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  std::vector<ImageAccess> states = {read, read, write, write, write};
+  const ImageAccess dst = imageAccessFor(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  BarrierBatcher barriers;
+  barriers.transition(IMAGE, states, ALL_LEVELS, dst);
+
+  const auto &image_barriers = barriers.getImageBarriers();
+  CHECK(image_barriers.size() == 2);
+  CHECK(image_barriers[0].subresourceRange.baseMipLevel == 0);
+  CHECK(image_barriers[0].subresourceRange.levelCount == 2);
+  CHECK(image_barriers[0].oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+  CHECK(image_barriers[0].srcStageMask == VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  CHECK(image_barriers[0].srcAccessMask == VK_ACCESS_2_NONE);
+  CHECK(image_barriers[1].subresourceRange.baseMipLevel == 2);
+  CHECK(image_barriers[1].subresourceRange.levelCount == 3);
+  CHECK(image_barriers[1].oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  CHECK(image_barriers[1].srcAccessMask == VK_ACCESS_2_TRANSFER_WRITE_BIT);
+  for (const auto &s : states)
+    CHECK(sameAccess(s, dst));
+}
+
+// a read in the layout and stages that already read the level needs no barrier
+static void testReadAfterRead() {
+  const ImageAccess sampled = imageAccessFor(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  std::vector<ImageAccess> states(3, sampled);
+  BarrierBatcher barriers;
+
+  ImageAccess fragment = sampled;
+  fragment.stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+  barriers.transition(IMAGE, states, ALL_LEVELS, fragment);
+  CHECK(barriers.empty());
+  for (const auto &s : states)
+    CHECK(sameAccess(s, sampled));
+
+  // a new reader stage waits for the last write, the readers are merged into the state
+  ImageAccess vertex = sampled;
+  vertex.stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+  barriers.transition(IMAGE, states, ALL_LEVELS, vertex);
+  const auto &image_barriers = barriers.getImageBarriers();
+  CHECK(image_barriers.size() == 1);
+  CHECK(image_barriers[0].oldLayout == image_barriers[0].newLayout);
+  CHECK(image_barriers[0].srcAccessMask == VK_ACCESS_2_NONE);
+  CHECK(image_barriers[0].subresourceRange.levelCount == 3);
+  for (const auto &s : states)
+    CHECK(s.stages == (sampled.stages | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT));
+}
+
+// a skipped level splits the run, the barrier never spans a level it doesn't cover
+static void testSkippedLevel() {
+  const ImageAccess sampled = imageAccessFor(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  const ImageAccess write = imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  std::vector<ImageAccess> states = {write, sampled, write};
+  BarrierBatcher barriers;
+  barriers.transition(IMAGE, states, ALL_LEVELS, sampled);
+
+  const auto &image_barriers = barriers.getImageBarriers();
+  CHECK(image_barriers.size() == 2);
+  CHECK(image_barriers[0].subresourceRange.baseMipLevel == 0);
+  CHECK(image_barriers[0].subresourceRange.levelCount == 1);
+  CHECK(image_barriers[1].subresourceRange.baseMipLevel == 2);
+  CHECK(image_barriers[1].subresourceRange.levelCount == 1);
+}
+
+// only the levels of the range are transitioned
+static void testPartialRange() {
+  const ImageAccess write = imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  const ImageAccess read = imageAccessFor(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+  std::vector<ImageAccess> states(6, write);
+  BarrierBatcher barriers;
+  barriers.transition(IMAGE, states, {VK_IMAGE_ASPECT_COLOR_BIT, 1, 1, 0, 1}, read);
+  barriers.transition(IMAGE, states, {VK_IMAGE_ASPECT_COLOR_BIT, 4, VK_REMAINING_MIP_LEVELS, 0, 1}, read);
+
+  const auto &image_barriers = barriers.getImageBarriers();
+  CHECK(image_barriers.size() == 2);
+  CHECK(image_barriers[0].subresourceRange.baseMipLevel == 1);
+  CHECK(image_barriers[0].subresourceRange.levelCount == 1);
+  CHECK(image_barriers[1].subresourceRange.baseMipLevel == 4);
+  CHECK(image_barriers[1].subresourceRange.levelCount == 2);
+  for (uint32_t level = 0; level < states.size(); ++level) {
+    const bool transitioned = level == 1 || level >= 4;
+    CHECK(sameAccess(states[level], transitioned ? read : write));
+  }
+}
+
+// untracked barriers of the same range are merged, other ranges and images are not
+static void testMerging() {
+  BarrierBatcher barriers;
+  VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  barrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+  barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = IMAGE;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  barriers.imageBarrier(barrier);
+
+  VkImageMemoryBarrier2 compute = barrier;
+  compute.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barriers.imageBarrier(compute);
+  CHECK(barriers.getImageBarriers().size() == 1);
+  CHECK(barriers.getImageBarriers()[0].dstStageMask ==
+        (VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT));
+
+  VkImageMemoryBarrier2 other_level = barrier;
+  other_level.subresourceRange.baseMipLevel = 1;
+  barriers.imageBarrier(other_level);
+  VkImageMemoryBarrier2 other_image = barrier;
+  other_image.image = OTHER_IMAGE;
+  barriers.imageBarrier(other_image);
+  CHECK(barriers.getImageBarriers().size() == 3);
+
+  VkBufferMemoryBarrier2 buffer{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+  buffer.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+  buffer.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+  buffer.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT;
+  buffer.dstAccessMask = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+  buffer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  buffer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  buffer.buffer = BUFFER;
+  buffer.offset = 0;
+  buffer.size = 256;
+  barriers.bufferBarrier(buffer);
+  VkBufferMemoryBarrier2 index = buffer;
+  index.dstAccessMask = VK_ACCESS_2_INDEX_READ_BIT;
+  barriers.bufferBarrier(index);
+  VkBufferMemoryBarrier2 other_range = buffer;
+  other_range.offset = 256;
+  barriers.bufferBarrier(other_range);
+  CHECK(barriers.getBufferBarriers().size() == 2);
+  CHECK(barriers.getBufferBarriers()[0].dstAccessMask ==
+        (VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT));
+
+  barriers.memoryBarrier(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                         VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+  barriers.memoryBarrier(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                         VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+  barriers.memoryBarrier(VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                         VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+  CHECK(barriers.getMemoryBarriers().size() == 2);
+  CHECK(barriers.getMemoryBarriers()[0].dstStageMask ==
+        (VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT));
+}
+
+int main() {
+  testAccessFor();
+  testFirstUse();
+  testMixedLevels();
+  testReadAfterRead();
+  testSkippedLevel();
+  testPartialRange();
+  testMerging();
+  return vk_engine_test::result();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdio>
+
+/**
+ * \brief minimal checks for the unit tests, a failed check is reported and fails the test
+ */
+namespace vk_engine_test {
+inline int &failures() {
+  static int count = 0;
+  return count;
+}
+
+inline int result() {
+  if (failures() == 0)
+    std::printf("all checks passed\n");
+  else
+    std::printf("%d check(s) failed\n", failures());
+  return failures() == 0 ? 0 : 1;
+}
+} // namespace vk_engine_test
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+      ++vk_engine_test::failures();                                            \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_NEAR(a, b, eps)                                                  \
+  do {                                                                         \
+    const double check_a_ = (a), check_b_ = (b);                               \
+    if (!(check_a_ - check_b_ <= (eps) && check_b_ - check_a_ <= (eps))) {     \
+      std::printf("%s:%d: check failed: %s == %s(%g vs %g, eps %g)\n",         \
+                  __FILE__, __LINE__, #a, #b, check_a_, check_b_,              \
+                  static_cast<double>(eps));                                   \
+      ++vk_engine_test::failures();                                            \
+    }                                                                          \
+  } while (0)
@@ -0,0 +1,119 @@
+#include "check.h"
+#include "test_mesh.h"
+
+#include <cmath>
+#include <framework/utils/base/mesh_optimizer.h>
+
+using namespace vk_engine;
+using namespace vk_engine_test;
+
+static void testAnalyze() {
+  const uint32_t one[] = {0, 1, 2};
+  auto stats = analyzeVertexCache(one, 3, 3);
+  CHECK_NEAR(stats.acmr, 3.0, 1e-6);
+  CHECK_NEAR(stats.atvr, 1.0, 1e-6);
+
+  // the second triangle only hits the cache
+  const uint32_t twice[] = {0, 1, 2, 2, 1, 0};
+  stats = analyzeVertexCache(twice, 6, 3);
+  CHECK_NEAR(stats.acmr, 1.5, 1e-6);
+
+  // a cache of 3 has evicted vertex 0 by the last triangle
+  const uint32_t strip[] = {0, 1, 2, 3, 4, 5, 0, 1, 2};
+  stats = analyzeVertexCache(strip, 9, 6, 3);
+  CHECK_NEAR(stats.acmr, 3.0, 1e-6);
+  CHECK_NEAR(stats.atvr, 1.5, 1e-6);
+}
+
+static void testVertexCache(uint32_t n, uint32_t cache_size) {
+  Mesh mesh = makeFlatGrid(n, n);
+  const auto before_set = triangleSet(mesh.indices.data(), mesh.indices.size());
+  const float before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                          mesh.vertexCount(), cache_size).acmr;
+
+  std::vector<uint32_t> cluster_starts(mesh.indices.size() / 3);
+  const uint32_t clusters = optimizeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                                mesh.vertexCount(), cache_size,
+                                                cluster_starts.data());
+  const float after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                         mesh.vertexCount(), cache_size).acmr;
+
+  // same triangles with the same winding, only reordered
+  CHECK(triangleSet(mesh.indices.data(), mesh.indices.size()) == before_set);
+  CHECK(after < before);
+  // a regular grid has 2 triangles per vertex, 0.5 is the ideal
+  CHECK(after < 1.0f);
+  CHECK(clusters >= 1);
+  CHECK(cluster_starts[0] == 0);
+  for (uint32_t c = 1; c < clusters; ++c)
+    CHECK(cluster_starts[c] > cluster_starts[c - 1]);
+  CHECK(cluster_starts[clusters - 1] < mesh.indices.size() / 3);
+}
+
+static void testOverdraw() {
+  // a bumpy surface, so the clusters face different ways
+  Mesh mesh = makeGrid(24, [](float x, float y) {
+    return 0.2f * std::sin(9.0f * x) * std::cos(7.0f * y);
+  }, 7);
+  std::vector<uint32_t> cluster_starts(mesh.indices.size() / 3);
+  const uint32_t clusters = optimizeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                                mesh.vertexCount(), DEFAULT_VERTEX_CACHE_SIZE,
+                                                cluster_starts.data());
+  const auto before_set = triangleSet(mesh.indices.data(), mesh.indices.size());
+  const float before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                          mesh.vertexCount()).acmr;
+  const float threshold = 1.05f;
+  optimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(),
+                   mesh.vertexCount(), STRIDE, cluster_starts.data(), clusters, threshold);
+  const float after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(),
+                                         mesh.vertexCount()).acmr;
+  CHECK(triangleSet(mesh.indices.data(), mesh.indices.size()) == before_set);
+  CHECK(after <= before * threshold + 1e-6f);
+}
+
+static void testVertexFetch() {
+  Mesh mesh = makeFlatGrid(9, 3);
+  const uint32_t original_count = mesh.vertexCount();
+  // drop a corner triangle pair, so some vertices become unreferenced
+  const uint32_t corner = 0;
+  std::vector<uint32_t> kept;
+  for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    if (mesh.indices[i] != corner)
+      kept.insert(kept.end(), mesh.indices.begin() + i, mesh.indices.begin() + i + 3);
+  mesh.indices = kept;
+
+  std::vector<uint32_t> referenced(mesh.indices);
+  std::sort(referenced.begin(), referenced.end());
+  referenced.erase(std::unique(referenced.begin(), referenced.end()), referenced.end());
+
+  // the expected original vertex of every index
+  std::vector<float> expected;
+  for (uint32_t v : mesh.indices)
+    expected.push_back(mesh.vertices[v * STRIDE + 3]);
+
+  const uint32_t count = optimizeVertexFetch(mesh.vertices.data(), original_count, STRIDE,
+                                             mesh.indices.data(), mesh.indices.size());
+  CHECK(count == referenced.size());
+  CHECK(count < original_count);
+
+  // vertices are in order of first use, and each index still reaches its vertex
+  uint32_t next = 0;
+  for (size_t i = 0; i < mesh.indices.size(); ++i) {
+    const uint32_t v = mesh.indices[i];
+    CHECK(v < count);
+    CHECK(v <= next);
+    if (v == next)
+      ++next;
+    CHECK(mesh.vertices[v * STRIDE + 3] == expected[i]);
+  }
+}
+
+int main() {
+  testAnalyze();
+  testVertexCache(4, DEFAULT_VERTEX_CACHE_SIZE);
+  testVertexCache(31, DEFAULT_VERTEX_CACHE_SIZE);
+  testVertexCache(31, 32);
+  testOverdraw();
+  testVertexFetch();
+  return vk_engine_test::result();
+}
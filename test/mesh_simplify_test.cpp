@@ -0,0 +1,96 @@
+#include "check.h"
+#include "test_mesh.h"
+
+#include <cmath>
+#include <framework/utils/base/mesh_optimizer.h>
+
+using namespace vk_engine;
+using namespace vk_engine_test;
+
+static double signedAreaZ(const Mesh &mesh, const uint32_t *indices, size_t count) {
+  double area = 0.0;
+  for (size_t i = 0; i + 2 < count; i += 3) {
+    const float *a = &mesh.vertices[indices[i] * STRIDE];
+    const float *b = &mesh.vertices[indices[i + 1] * STRIDE];
+    const float *c = &mesh.vertices[indices[i + 2] * STRIDE];
+    area += 0.5 * ((b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]));
+  }
+  return area;
+}
+
+static void testSimplifyFlat() {
+  const uint32_t n = 16;
+  const Mesh mesh = makeFlatGrid(n, 5);
+  std::vector<uint32_t> out(mesh.indices.size());
+  float error = -1.0f;
+  const size_t count = simplifyMesh(out.data(), mesh.indices.data(), mesh.indices.size(),
+                                    mesh.vertices.data(), mesh.vertexCount(), STRIDE,
+                                    mesh.indices.size() / 8, 1e-3f, &error);
+  // interior vertices of a plane collapse for free, the border is locked
+  CHECK(count % 3 == 0);
+  CHECK(count < mesh.indices.size() / 2);
+  CHECK(count >= 3 * (4 * n - 2));
+  CHECK_NEAR(error, 0.0, 1e-5);
+  for (size_t i = 0; i < count; ++i)
+    CHECK(out[i] < mesh.vertexCount());
+  // no flipped or lost triangles, the covered area is unchanged
+  CHECK_NEAR(signedAreaZ(mesh, out.data(), count), 1.0, 1e-4);
+  for (size_t i = 0; i < count; i += 3)
+    CHECK(signedAreaZ(mesh, out.data() + i, 3) > 0.0);
+  // border vertices are all still used
+  std::vector<bool> used(mesh.vertexCount(), false);
+  for (size_t i = 0; i < count; ++i)
+    used[out[i]] = true;
+  for (uint32_t k = 0; k <= n; ++k) {
+    CHECK(used[k]);
+    CHECK(used[n * (n + 1) + k]);
+    CHECK(used[k * (n + 1)]);
+    CHECK(used[k * (n + 1) + n]);
+  }
+}
+
+static void testSimplifyErrorBound() {
+  Mesh mesh = makeGrid(16, [](float x, float y) {
+    return 0.3f * std::sin(6.0f * x) * std::sin(5.0f * y);
+  }, 11);
+  std::vector<uint32_t> out(mesh.indices.size());
+  const float target_error = 0.01f;
+  float error = -1.0f;
+  const size_t count = simplifyMesh(out.data(), mesh.indices.data(), mesh.indices.size(),
+                                    mesh.vertices.data(), mesh.vertexCount(), STRIDE,
+                                    0, target_error, &error);
+  CHECK(count > 0);
+  CHECK(count < mesh.indices.size());
+  CHECK(error >= 0.0f);
+  CHECK(error <= target_error);
+
+  // a zero error bound keeps a curved surface as it is
+  const size_t kept = simplifyMesh(out.data(), mesh.indices.data(), mesh.indices.size(),
+                                   mesh.vertices.data(), mesh.vertexCount(), STRIDE,
+                                   0, 0.0f, &error);
+  CHECK(kept <= mesh.indices.size());
+  CHECK(error == 0.0f);
+}
+
+static void testSimplifySeams() {
+  // every vertex has a copy at the same position, as an attribute seam would
+  Mesh mesh = makeFlatGrid(8, 13);
+  const uint32_t count = mesh.vertexCount();
+  for (uint32_t v = 0; v < count; ++v) {
+    mesh.vertices.insert(mesh.vertices.end(), mesh.vertices.begin() + v * STRIDE,
+                         mesh.vertices.begin() + v * STRIDE + 3);
+    mesh.vertices.push_back(static_cast<float>(count + v));
+  }
+  std::vector<uint32_t> out(mesh.indices.size());
+  const size_t written = simplifyMesh(out.data(), mesh.indices.data(), mesh.indices.size(),
+                                      mesh.vertices.data(), mesh.vertexCount(), STRIDE,
+                                      0, 1.0f);
+  CHECK(triangleSet(out.data(), written) == triangleSet(mesh.indices.data(), mesh.indices.size()));
+}
+
+int main() {
+  testSimplifyFlat();
+  testSimplifyErrorBound();
+  testSimplifySeams();
+  return vk_engine_test::result();
+}
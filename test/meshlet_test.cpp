@@ -0,0 +1,57 @@
+#include "check.h"
+#include "test_mesh.h"
+
+#include <cmath>
+#include <framework/utils/base/mesh_optimizer.h>
+
+using namespace vk_engine;
+using namespace vk_engine_test;
+
+static void testMeshlets(uint32_t max_vertices, uint32_t max_triangles) {
+  Mesh mesh = makeFlatGrid(20, 17);
+  optimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+  std::vector<Meshlet> meshlets;
+  buildMeshlets(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), STRIDE,
+                meshlets, max_vertices, max_triangles);
+  CHECK(!meshlets.empty());
+
+  uint32_t next_index = 0;
+  for (const auto &m : meshlets) {
+    // the meshlets tile the index buffer in order
+    CHECK(m.first_index == next_index);
+    CHECK(m.index_count > 0);
+    CHECK(m.index_count % 3 == 0);
+    CHECK(m.index_count / 3 <= max_triangles);
+    next_index += m.index_count;
+
+    std::vector<uint32_t> unique(mesh.indices.begin() + m.first_index,
+                                 mesh.indices.begin() + m.first_index + m.index_count);
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    CHECK(unique.size() <= max_vertices);
+
+    // the sphere bounds every vertex
+    for (uint32_t v : unique) {
+      const float *p = &mesh.vertices[v * STRIDE];
+      const float d = std::sqrt((p[0] - m.center[0]) * (p[0] - m.center[0]) +
+                                (p[1] - m.center[1]) * (p[1] - m.center[1]) +
+                                (p[2] - m.center[2]) * (p[2] - m.center[2]));
+      CHECK(d <= m.radius + 1e-5f);
+    }
+
+    // a flat meshlet facing +z is back facing from below, never from above
+    CHECK_NEAR(m.cone_axis[2], 1.0, 1e-5);
+    const float below[3] = {0.5f, 0.5f, -10.0f};
+    const float above[3] = {0.5f, 0.5f, 10.0f};
+    CHECK(meshletBackFacing(m.center, m.radius, m.cone_axis, m.cone_cutoff, below));
+    CHECK(!meshletBackFacing(m.center, m.radius, m.cone_axis, m.cone_cutoff, above));
+  }
+  CHECK(next_index == mesh.indices.size());
+}
+
+int main() {
+  testMeshlets(MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+  testMeshlets(3, 1);
+  testMeshlets(17, 9);
+  return vk_engine_test::result();
+}
@@ -0,0 +1,88 @@
+#include "check.h"
+
+#include <cstdlib>
+#include <framework/utils/base/mipmap.h>
+
+using namespace vk_engine;
+
+// a constant image stays constant at every level, whatever the dimensions
+static void testConstant(uint32_t width, uint32_t height, bool srgb) {
+  std::vector<uint8_t> src(static_cast<size_t>(width) * height * 4);
+  for (size_t i = 0; i < src.size(); i += 4) {
+    src[i] = 200;
+    src[i + 1] = 90;
+    src[i + 2] = 17;
+    src[i + 3] = 128;
+  }
+  const auto levels = generateMipChainRgba8(src.data(), width, height, srgb);
+  for (const auto &l : levels) {
+    for (size_t i = 0; i < l.size(); i += 4) {
+      CHECK(std::abs(l[i] - 200) <= 1);
+      CHECK(std::abs(l[i + 1] - 90) <= 1);
+      CHECK(std::abs(l[i + 2] - 17) <= 1);
+      CHECK(l[i + 3] == 128);
+    }
+  }
+}
+
+// the area weights keep the mean, and the last row and column are not dropped
+static void testOddMean(uint32_t width, uint32_t height) {
+  std::vector<uint8_t> src(static_cast<size_t>(width) * height * 4);
+  double src_mean = 0.0;
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      // bright last column and row, a dropped edge would darken the mip
+      const uint8_t v = (x == width - 1 || y == height - 1) ? 255 : static_cast<uint8_t>((x * 37 + y * 11) % 128);
+      uint8_t *px = src.data() + (static_cast<size_t>(y) * width + x) * 4;
+      px[0] = px[1] = px[2] = px[3] = v;
+      src_mean += v;
+    }
+  }
+  src_mean /= static_cast<double>(width) * height;
+
+  const uint32_t dst_width = std::max(width / 2, 1u);
+  const uint32_t dst_height = std::max(height / 2, 1u);
+  std::vector<uint8_t> dst(static_cast<size_t>(dst_width) * dst_height * 4);
+  downsampleRgba8(src.data(), width, height, false, dst.data());
+  double dst_mean = 0.0;
+  for (size_t i = 0; i < dst.size(); i += 4) {
+    CHECK(dst[i] == dst[i + 3]);
+    dst_mean += dst[i];
+  }
+  dst_mean /= static_cast<double>(dst_width) * dst_height;
+  CHECK_NEAR(dst_mean, src_mean, 0.5);
+}
+
+static void testThreeTaps() {
+  // 3x1 -> 1x1 averages all three texels
+  const uint8_t src[12] = {0, 0, 0, 0, 90, 90, 90, 90, 255, 255, 255, 255};
+  uint8_t dst[4];
+  downsampleRgba8(src, 3, 1, false, dst);
+  CHECK(dst[0] == 115);
+  CHECK(dst[3] == 115);
+
+  // 5 texels -> 2: (2/5, 2/5, 1/5) and (1/5, 2/5, 2/5) of texels 0-2 and 2-4
+  const uint8_t row[20] = {50, 50, 50, 50, 100, 100, 100, 100, 0, 0, 0, 0,
+                           200, 200, 200, 200, 250, 250, 250, 250};
+  uint8_t out[8];
+  downsampleRgba8(row, 5, 1, false, out);
+  CHECK(out[0] == 60);
+  CHECK(out[4] == 180);
+}
+
+int main() {
+  for (const bool srgb : {false, true}) {
+    testConstant(1, 1, srgb);
+    testConstant(7, 1, srgb);
+    testConstant(1, 9, srgb);
+    testConstant(13, 7, srgb);
+    testConstant(64, 33, srgb);
+    testConstant(256, 256, srgb);
+  }
+  testOddMean(5, 5);
+  testOddMean(7, 4);
+  testOddMean(8, 3);
+  testOddMean(101, 67);
+  testThreeTaps();
+  return vk_engine_test::result();
+}
@@ -0,0 +1,60 @@
+#include "check.h"
+
+#include <framework/utils/base/parallel.h>
+
+using namespace vk_engine;
+
+static void testCoverage() {
+  for (const uint32_t grain : {1u, 3u, 4u, 64u, 1000u}) {
+    std::vector<std::atomic<uint32_t>> hits(997);
+    parallelFor(5, 997, [&](uint32_t i) { hits[i].fetch_add(1); }, grain);
+    for (uint32_t i = 0; i < hits.size(); ++i)
+      CHECK(hits[i].load() == (i < 5 ? 0u : 1u));
+  }
+  bool called = false;
+  parallelFor(3, 3, [&](uint32_t) { called = true; });
+  CHECK(!called);
+}
+
+// loaders run loops on their own threads, and a loop body may run another loop
+static void testConcurrentAndNested() {
+  constexpr uint32_t callers = 4, outer = 16, inner = 100;
+  std::atomic<uint64_t> sum{0};
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < callers; ++t) {
+    threads.emplace_back([&]() {
+      parallelFor(0, outer, [&](uint32_t) {
+        parallelFor(0, inner, [&](uint32_t i) { sum.fetch_add(i); }, 7);
+      });
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+  CHECK(sum.load() == uint64_t{callers} * outer * (inner * (inner - 1) / 2));
+}
+
+static void testPool() {
+  // a pool without workers runs everything on the calling thread
+  WorkerPool pool(0);
+  const auto caller = std::this_thread::get_id();
+  uint32_t count = 0;
+  pool.run(10, [&](uint32_t) {
+    CHECK(std::this_thread::get_id() == caller);
+    ++count;
+  });
+  CHECK(count == 10);
+
+  WorkerPool pool3(3);
+  CHECK(pool3.workerCount() == 3);
+  std::atomic<uint32_t> chunks{0};
+  for (uint32_t i = 0; i < 100; ++i)
+    pool3.run(i, [&](uint32_t) { chunks.fetch_add(1); });
+  CHECK(chunks.load() == 99 * 100 / 2);
+}
+
+int main() {
+  testCoverage();
+  testConcurrentAndNested();
+  testPool();
+  return vk_engine_test::result();
+}
@@ -0,0 +1,145 @@
+#include "check.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <framework/utils/base/pixel_convert.h>
+
+using namespace vk_engine;
+
+// the simd loops are 8, 11, 16 or 32 pixels wide, every tail length of them is covered
+static const size_t COUNTS[] = {0, 1, 2, 3, 5, 7, 8, 11, 13, 15, 16, 17, 31, 32, 33,
+                                47, 63, 64, 65, 95, 127, 129, 1023, 4097};
+static constexpr uint8_t GUARD = 0xcd; //!< past the end of dst, must be untouched
+
+static std::mt19937 rng(20240917);
+
+static std::vector<uint8_t> randomBytes(size_t size) {
+  std::vector<uint8_t> ret(size);
+  std::uniform_int_distribution<int> dist(0, 255);
+  for (auto &b : ret)
+    b = static_cast<uint8_t>(dist(rng));
+  return ret;
+}
+
+/**
+ * \brief run kernel and the scalar reference on the same input, outputs must match byte by
+ * byte, and nothing past count may be written. src is offset by one byte, unaligned
+ */
+static void compareU8(const char *isa, const char *name,
+                      void (*kernel)(uint8_t *, const uint8_t *, size_t),
+                      void (*reference)(uint8_t *, const uint8_t *, size_t),
+                      size_t src_channels, size_t dst_channels) {
+  for (const size_t count : COUNTS) {
+    const auto src = randomBytes(count * src_channels + 1);
+    std::vector<uint8_t> expected(count * dst_channels + 64, GUARD);
+    std::vector<uint8_t> actual(count * dst_channels + 64, GUARD);
+    reference(expected.data(), src.data() + 1, count);
+    kernel(actual.data(), src.data() + 1, count);
+    if (expected != actual) {
+      std::printf("%s %s differs from scalar for %zu pixels\n", isa, name, count);
+      CHECK(expected == actual);
+    }
+  }
+}
+
+static bool isHalfNan(uint16_t h) { return (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0; }
+
+static std::vector<float> halfTestValues() {
+  std::vector<float> ret = {0.0f, -0.0f, 1.0f, -1.0f, 65504.0f, 65519.0f, 65520.0f, 1e10f,
+                            -1e10f, 6.1e-5f, 5.96e-8f, 2.98e-8f, 2.99e-8f, 1e-10f,
+                            std::numeric_limits<float>::infinity(),
+                            -std::numeric_limits<float>::infinity(),
+                            std::numeric_limits<float>::quiet_NaN()};
+  // halfway between two halves rounds to even
+  for (uint32_t h = 0x3c00; h < 0x3c10; ++h) {
+    const float a = halfToFloat(static_cast<uint16_t>(h));
+    const float b = halfToFloat(static_cast<uint16_t>(h + 1));
+    ret.push_back(0.5f * (a + b));
+  }
+  std::uniform_real_distribution<float> uniform(-2.0f, 2.0f);
+  std::uniform_int_distribution<int> exponent(-30, 17);
+  while (ret.size() < 4099)
+    ret.push_back(std::ldexp(uniform(rng), exponent(rng)));
+  return ret;
+}
+
+static void compareHalf(const char *isa, void (*kernel)(uint16_t *, const float *, size_t),
+                        void (*reference)(uint16_t *, const float *, size_t)) {
+  const auto values = halfTestValues();
+  for (const size_t count : COUNTS) {
+    const size_t n = std::min(count, values.size());
+    // start at an odd float, unaligned for the vector loads
+    std::vector<uint16_t> expected(n + 16, 0xcdcd), actual(n + 16, 0xcdcd);
+    reference(expected.data(), values.data() + 1, n - (n > 0 ? 1 : 0));
+    kernel(actual.data(), values.data() + 1, n - (n > 0 ? 1 : 0));
+    for (size_t i = 0; i < expected.size(); ++i) {
+      // nan payloads may differ, only quietness is required
+      const bool same = expected[i] == actual[i] || (isHalfNan(expected[i]) && isHalfNan(actual[i]));
+      if (!same) {
+        std::printf("%s float_to_half differs at %zu of %zu: %04x vs %04x\n", isa, i, n,
+                    expected[i], actual[i]);
+        CHECK(same);
+        break;
+      }
+    }
+  }
+}
+
+static void testScalarHalf() {
+  CHECK(floatToHalf(1.0f) == 0x3c00);
+  CHECK(floatToHalf(-2.0f) == 0xc000);
+  CHECK(floatToHalf(65504.0f) == 0x7bff);
+  CHECK(floatToHalf(65520.0f) == 0x7c00);
+  CHECK(floatToHalf(5.9604645e-8f) == 0x0001);
+  CHECK(isHalfNan(floatToHalf(std::numeric_limits<float>::quiet_NaN())));
+  // 1 + 2^-11 is halfway between 1 and the next half, rounds to even(1)
+  CHECK(floatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+  CHECK(floatToHalf(1.0f + 3.0f * std::ldexp(1.0f, -11)) == 0x3c02);
+  for (uint32_t h = 0; h < 0x7c00; ++h)
+    CHECK(floatToHalf(halfToFloat(static_cast<uint16_t>(h))) == h);
+}
+
+// the public entry points split large images in chunks on the worker pool
+static void testDispatch() {
+  const size_t count = (1u << 20) + 333;
+  const auto scalar = pixelConvertKernels().front();
+  const auto src = randomBytes(count * 4);
+  for (const uint32_t channels : {1u, 2u, 3u}) {
+    std::vector<uint8_t> expected(count * 4), actual(count * 4);
+    if (channels == 1)
+      scalar.gray_to_rgba(expected.data(), src.data(), count);
+    else if (channels == 2)
+      scalar.gray_alpha_to_rgba(expected.data(), src.data(), count);
+    else
+      scalar.rgb_to_rgba(expected.data(), src.data(), count);
+    expandToRgba8(actual.data(), src.data(), channels, count);
+    CHECK(expected == actual);
+  }
+  for (const uint32_t channels : {1u, 2u}) {
+    std::vector<uint8_t> expected(count * channels), actual(count * channels);
+    (channels == 1 ? scalar.rgba_to_r : scalar.rgba_to_rg)(expected.data(), src.data(), count);
+    extractChannels8(actual.data(), channels, src.data(), count);
+    CHECK(expected == actual);
+  }
+}
+
+int main() {
+  const auto sets = pixelConvertKernels();
+  CHECK(!sets.empty() && strcmp(sets.front().isa, "scalar") == 0);
+  CHECK(strcmp(sets.back().isa, pixelConvertIsa()) == 0);
+  const auto &scalar = sets.front();
+  for (const auto &k : sets) {
+    std::printf("checking %s kernels\n", k.isa);
+    compareU8(k.isa, "rgb_to_rgba", k.rgb_to_rgba, scalar.rgb_to_rgba, 3, 4);
+    compareU8(k.isa, "gray_to_rgba", k.gray_to_rgba, scalar.gray_to_rgba, 1, 4);
+    compareU8(k.isa, "gray_alpha_to_rgba", k.gray_alpha_to_rgba, scalar.gray_alpha_to_rgba, 2, 4);
+    compareU8(k.isa, "rgba_to_r", k.rgba_to_r, scalar.rgba_to_r, 4, 1);
+    compareU8(k.isa, "rgba_to_rg", k.rgba_to_rg, scalar.rgba_to_rg, 4, 2);
+    compareHalf(k.isa, k.float_to_half, scalar.float_to_half);
+  }
+  testScalarHalf();
+  testDispatch();
+  return vk_engine_test::result();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/**
+ * \brief grid meshes shared by the mesh processing tests
+ */
+namespace vk_engine_test {
+constexpr uint32_t STRIDE = 4; // position and the original vertex id
+
+struct Mesh {
+  std::vector<float> vertices;
+  std::vector<uint32_t> indices;
+  uint32_t vertexCount() const {
+    return static_cast<uint32_t>(vertices.size() / STRIDE);
+  }
+};
+
+// n x n quads in the z = height(x, y) plane, facing +z, triangles shuffled
+template <typename F> inline Mesh makeGrid(uint32_t n, F height, uint32_t seed) {
+  Mesh mesh;
+  for (uint32_t y = 0; y <= n; ++y)
+    for (uint32_t x = 0; x <= n; ++x) {
+      const float fx = static_cast<float>(x) / n, fy = static_cast<float>(y) / n;
+      mesh.vertices.insert(mesh.vertices.end(), {fx, fy, height(fx, fy),
+                                                 static_cast<float>(mesh.vertexCount())});
+    }
+  std::vector<std::array<uint32_t, 3>> tris;
+  for (uint32_t y = 0; y < n; ++y)
+    for (uint32_t x = 0; x < n; ++x) {
+      const uint32_t v = y * (n + 1) + x;
+      tris.push_back({v, v + 1, v + n + 2});
+      tris.push_back({v, v + n + 2, v + n + 1});
+    }
+  std::shuffle(tris.begin(), tris.end(), std::mt19937(seed));
+  for (const auto &t : tris)
+    mesh.indices.insert(mesh.indices.end(), t.begin(), t.end());
+  return mesh;
+}
+
+inline Mesh makeFlatGrid(uint32_t n, uint32_t seed = 1) {
+  return makeGrid(n, [](float, float) { return 0.0f; }, seed);
+}
+
+// triangles as sorted, rotation independent keys
+inline std::vector<std::array<uint32_t, 3>> triangleSet(const uint32_t *indices, size_t count) {
+  std::vector<std::array<uint32_t, 3>> tris;
+  for (size_t i = 0; i + 2 < count; i += 3) {
+    const uint32_t *t = indices + i;
+    const int r = static_cast<int>(std::min_element(t, t + 3) - t);
+    tris.push_back({t[r], t[(r + 1) % 3], t[(r + 2) % 3]});
+  }
+  std::sort(tris.begin(), tris.end());
+  return tris;
+}
+} // namespace vk_engine_test
@@ -0,0 +1,143 @@
+#include "check.h"
+
+#include <cmath>
+#include <cstring>
+#include <framework/resources/vertex_quantizer.h>
+
+using namespace vk_engine;
+
+/**
+ * \brief packed vertices(pos3 | normal3 | uv2) of a uv sphere of radius
+ */
+static std::vector<float> sphere(float radius, uint32_t rings, uint32_t segments) {
+  std::vector<float> ret;
+  for (uint32_t r = 0; r <= rings; ++r) {
+    const float theta = 3.14159265f * r / rings;
+    for (uint32_t s = 0; s <= segments; ++s) {
+      const float phi = 2.0f * 3.14159265f * s / segments;
+      const Eigen::Vector3f n(std::sin(theta) * std::cos(phi), std::cos(theta),
+                              std::sin(theta) * std::sin(phi));
+      const Eigen::Vector3f p = n * radius + Eigen::Vector3f(radius, -0.5f * radius, 3.0f);
+      ret.insert(ret.end(), {p.x(), p.y(), p.z(), n.x(), n.y(), n.z(),
+                             static_cast<float>(s) / segments,
+                             static_cast<float>(r) / rings});
+    }
+  }
+  return ret;
+}
+
+static Eigen::Vector3f octDecode(float x, float y) {
+  Eigen::Vector3f n(x, y, 1.0f - std::abs(x) - std::abs(y));
+  const float t = std::max(-n.z(), 0.0f);
+  n.x() += (n.x() >= 0.0f) ? -t : t;
+  n.y() += (n.y() >= 0.0f) ? -t : t;
+  return n.normalized();
+}
+
+/**
+ * \brief dequantize the vertices as the vertex shader does, check each
+ * attribute against the bound and the reported error
+ */
+static void checkDequantized(const std::vector<float> &vertices,
+                             const VertexQuantization &quantization,
+                             const std::vector<uint8_t> &out,
+                             const Eigen::Vector3f &offset,
+                             const Eigen::Vector3f &scale,
+                             const VertexQuantizeError &error) {
+  const uint32_t stride = vertexStride(quantization.layout);
+  const uint32_t nv = static_cast<uint32_t>(vertices.size() / 8);
+  CHECK(out.size() == static_cast<size_t>(nv) * stride);
+  const float extent = scale.maxCoeff();
+  float max_position = 0.0f, max_normal = 0.0f, max_uv = 0.0f;
+  for (uint32_t i = 0; i < nv; ++i) {
+    const float *v = vertices.data() + 8 * i;
+    const uint8_t *src = out.data() + static_cast<size_t>(i) * stride;
+    uint16_t pos[4];
+    memcpy(pos, src, 8);
+    Eigen::Vector3f p;
+    for (int k = 0; k < 3; ++k)
+      p[k] = offset[k] + scale[k] * (pos[k] / 65535.0f);
+    max_position = std::max(max_position, (p - Eigen::Vector3f::Map(v)).norm() / extent);
+
+    Eigen::Vector3f n;
+    uint16_t uv[2];
+    if (quantization.layout == VertexLayout::QUANTIZED16) {
+      int16_t oct[2];
+      memcpy(oct, src + 8, 4);
+      n = octDecode(oct[0] / 32767.0f, oct[1] / 32767.0f);
+      memcpy(uv, src + 12, 4);
+    } else {
+      const int8_t ox = static_cast<int8_t>(pos[3] & 0xff);
+      const int8_t oy = static_cast<int8_t>(pos[3] >> 8);
+      n = octDecode(ox / 127.0f, oy / 127.0f);
+      memcpy(uv, src + 8, 4);
+    }
+    const float dot = std::clamp(n.dot(Eigen::Vector3f::Map(v + 3).normalized()), -1.0f, 1.0f);
+    max_normal = std::max(max_normal, std::acos(dot));
+    for (int k = 0; k < 2; ++k)
+      max_uv = std::max(max_uv, std::abs(halfToFloat(uv[k]) - v[6 + k]));
+  }
+  CHECK(max_position <= quantization.max_position_error);
+  CHECK(max_normal <= quantization.max_normal_error + 1e-4f);
+  CHECK(max_uv <= quantization.max_uv_error);
+  CHECK_NEAR(max_position, error.position, 1e-6f);
+  CHECK_NEAR(max_normal, error.normal, 1e-3f);
+  CHECK_NEAR(max_uv, error.uv, 1e-6f);
+}
+
+static void testWithinBounds(VertexLayout layout, float radius) {
+  const auto vertices = sphere(radius, 17, 33);
+  const VertexQuantization quantization{.layout = layout};
+  std::vector<uint8_t> out;
+  Eigen::Vector3f offset, scale;
+  VertexQuantizeError error;
+  CHECK(quantizeVertices(vertices.data(), static_cast<uint32_t>(vertices.size() / 8),
+                         quantization, out, offset, scale, error));
+  CHECK_NEAR(scale.maxCoeff(), 2.0f * radius, 1e-3f * radius);
+  checkDequantized(vertices, quantization, out, offset, scale, error);
+}
+
+static void testFallback() {
+  const auto vertices = sphere(1.0f, 9, 9);
+  const uint32_t nv = static_cast<uint32_t>(vertices.size() / 8);
+  std::vector<uint8_t> out;
+  Eigen::Vector3f offset, scale;
+  VertexQuantizeError error;
+
+  // tighter than the unorm16 step
+  VertexQuantization quantization{.layout = VertexLayout::QUANTIZED16,
+                                  .max_position_error = 1e-7f};
+  CHECK(!quantizeVertices(vertices.data(), nv, quantization, out, offset, scale, error));
+  CHECK(error.position > quantization.max_position_error);
+
+  // snorm8 octahedral normals are coarser than a tight angle bound
+  quantization = VertexQuantization{.layout = VertexLayout::QUANTIZED8,
+                                    .max_normal_error = 1e-3f};
+  CHECK(!quantizeVertices(vertices.data(), nv, quantization, out, offset, scale, error));
+  CHECK(error.normal > quantization.max_normal_error);
+
+  // half float uvs lose precision on large tiled coordinates
+  auto tiled = vertices;
+  for (uint32_t i = 0; i < nv; ++i)
+    tiled[8 * i + 6] += 1000.0f;
+  quantization = VertexQuantization{.layout = VertexLayout::QUANTIZED16};
+  CHECK(!quantizeVertices(tiled.data(), nv, quantization, out, offset, scale, error));
+  CHECK(error.uv > quantization.max_uv_error);
+
+  // FLOAT32 keeps the vertices as they are
+  quantization = VertexQuantization{};
+  CHECK(quantizeVertices(vertices.data(), nv, quantization, out, offset, scale, error));
+  CHECK(out.size() == vertices.size() * sizeof(float));
+  CHECK(memcmp(out.data(), vertices.data(), out.size()) == 0);
+  CHECK(offset == Eigen::Vector3f::Zero());
+  CHECK(scale == Eigen::Vector3f::Ones());
+}
+
+int main() {
+  for (const float radius : {0.01f, 1.0f, 100.0f, 5000.0f}) {
+    testWithinBounds(VertexLayout::QUANTIZED16, radius);
+    testWithinBounds(VertexLayout::QUANTIZED8, radius);
+  }
+  testFallback();
+  return vk_engine_test::result();
+}